@@ -398,7 +398,7 @@ int fsci_enter_bootloader(Framer *framer)
     FSCIFrame *temp_frame = CreateFSCIFrame(framer, 0xA3, 0xCF, NULL, 0, 0);
     int return_value = SendFrame(framer, temp_frame);
     sleep(1);
-    free(temp_frame);
+    DestroyFSCIFrame(temp_frame);
     return return_value;
 }
 
@@ -406,7 +406,7 @@ int fsci_firmware_cancel_process(Framer *framer)
 {
     FSCIFrame *temp_frame = CreateFSCIFrame(framer, 0xA3, 0x2C, NULL, 0, 0);
     int return_value = SendFrame(framer, temp_frame);
-    free(temp_frame);
+    DestroyFSCIFrame(temp_frame);
     return return_value;
 }
 
@@ -423,7 +423,7 @@ int fsci_firmware_start_image(Framer *framer, uint32_t size)
     FSCIFrame *temp_frame = CreateFSCIFrame(framer, 0xA3, 0x29, buffer, 4, 0);
     free(buffer);
     int return_value = SendFrame(framer, temp_frame);
-    free(temp_frame);
+    DestroyFSCIFrame(temp_frame);
     return return_value;
 }
 
@@ -431,7 +431,7 @@ int fsci_firmware_push_image_chunk(Framer *framer, uint8_t *data, uint32_t size)
 {
     FSCIFrame *temp_frame = CreateFSCIFrame(framer, 0xA3, 0x2A, data, size, 0);
     int return_value = SendFrame(framer, temp_frame);
-    free(temp_frame);
+    DestroyFSCIFrame(temp_frame);
     return return_value;
 }
 
@@ -447,7 +447,7 @@ int fsci_firmware_commit_image(Framer *framer, uint8_t *bitmask, uint16_t crc)
     Store16(crc, buffer + 32, _LITTLE_ENDIAN);
     FSCIFrame *temp_frame = CreateFSCIFrame(framer, 0xA3, 0x2B, buffer, 34, 0);
     int return_value = SendFrame(framer, temp_frame);
-    free(temp_frame);
+    DestroyFSCIFrame(temp_frame);
     free(buffer);
     return return_value;
 }
@@ -456,7 +456,7 @@ int fsci_cpu_reset(Framer *framer)
 {
     FSCIFrame *temp_frame = CreateFSCIFrame(framer, 0xA3, 0x08, NULL, 0, 0);
     int return_value = SendFrame(framer, temp_frame);
-    free(temp_frame);
+    DestroyFSCIFrame(temp_frame);
     return return_value;
 }
 
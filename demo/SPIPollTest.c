@@ -0,0 +1,271 @@
+/*! *********************************************************************************
+* \file SPIPollTest.c
+* This is a source file checking the adaptive polling of a SPI slave, against a
+* simulated slave.
+*
+* Copyright 2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************** */
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/spi/spidev.h>
+
+#include "PhysicalDeviceManager.h"
+#include "Framer.h"
+#include "FSCIFrame.h"
+#include "SPIConfiguration.h"
+#include "SPIDevice.h"
+#include "utils.h"
+
+#define SIM_SPIDEV "/dev/spidev-sim"
+#define LENGTH_FIELD_SIZE 2
+#define CRC_FIELD_SIZE 1
+#define FRAME_SIZE 7
+#define MAX_FRAMES 10000
+#define FRAME_PERIOD_US 1000
+#define POLL_IDLE_US 20000
+#define TEST_OG 0xA1
+#define TIMEOUT_MS 5000
+
+/* The slave: frame i is ready i * FRAME_PERIOD_US after the start, and clocked out
+   by the transfers of the library, all FFs when it has nothing to send. */
+static uint8_t stream[MAX_FRAMES * FRAME_SIZE];
+static volatile uint32_t streamPos = 0;
+static volatile uint64_t startUs = 0;
+static int frames = 1000;
+static int spiFd = -1, uio[2];
+
+static volatile int received = 0;
+static volatile int corrupted = 0;
+static volatile int stop = 0;
+
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint32_t ready_bytes(void)
+{
+    uint64_t ready;
+
+    if (startUs == 0) {
+        return 0;
+    }
+    ready = (now_us() - startUs) / FRAME_PERIOD_US + 1;
+    return (ready > (uint64_t)frames) ? frames * FRAME_SIZE : ready * FRAME_SIZE;
+}
+
+/*
+ * Replaces the libc open: /dev/uio0 is one end of a socket pair and the spidev node
+ * a descriptor whose transfers are simulated by ioctl.
+ */
+int open(const char *path, int flags, ...)
+{
+    mode_t mode = 0;
+
+    if (flags & O_CREAT) {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+
+    if (strcmp(path, UIO_DEV) == 0) {
+        return dup(uio[0]);
+    }
+    if (strcmp(path, SIM_SPIDEV) == 0) {
+        spiFd = syscall(SYS_openat, AT_FDCWD, "/dev/null", O_RDWR);
+        return spiFd;
+    }
+    return syscall(SYS_openat, AT_FDCWD, path, flags, mode);
+}
+
+/*
+ * Replaces the libc ioctl: the transfers of the simulated spidev clock in the stream.
+ */
+int ioctl(int fd, unsigned long request, ...)
+{
+    va_list ap;
+    va_start(ap, request);
+    void *arg = va_arg(ap, void *);
+    va_end(ap);
+
+    if (fd != spiFd || spiFd < 0) {
+        return syscall(SYS_ioctl, fd, request, arg);
+    }
+    if (_IOC_TYPE(request) == SPI_IOC_MAGIC && _IOC_NR(request) == 0) {
+        struct spi_ioc_transfer *xfer = (struct spi_ioc_transfer *)arg;
+        uint32_t i, j, n = _IOC_SIZE(request) / sizeof(*xfer), ready = ready_bytes();
+
+        for (i = 0; i < n; i++) {
+            uint8_t *rx = (uint8_t *)(uintptr_t)xfer[i].rx_buf;
+            for (j = 0; rx != NULL && j < xfer[i].len; j++) {
+                rx[j] = (streamPos < ready) ? stream[streamPos++] : 0xFF;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * The interrupt line of the slave, raised while it has data and the interrupt is
+ * unmasked by a write to /dev/uio0.
+ */
+static void *interrupt_routine(void *arg)
+{
+    struct pollfd pfd = { uio[1], POLLIN, 0 };
+    uint32_t info;
+    int unmasked = 0;
+
+    while (!stop) {
+        while (poll(&pfd, 1, 0) == 1 && read(uio[1], &info, sizeof(info)) == sizeof(info)) {
+            unmasked = 1;
+        }
+        if (unmasked && streamPos < ready_bytes()) {
+            info = 1;
+            if (write(uio[1], &info, sizeof(info)) == sizeof(info)) {
+                unmasked = 0;
+            }
+        }
+        usleep(100);
+    }
+
+    return NULL;
+}
+
+/*
+ * Executes on every RX packet.
+ */
+void callback(void *callee, void *response)
+{
+    FSCIFrame *frame = (FSCIFrame *)response;
+
+    if (frame->opGroup != TEST_OG || frame->opCode != (received & 0xFF) ||
+            frame->length != 1 || frame->data[0] != (uint8_t)(received >> 8)) {
+        corrupted++;
+    }
+    received++;
+    DestroyFSCIFrame(frame);
+}
+
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && (frames = atoi(argv[1])) <= 0) {
+        printf("Usage: # %s [frames]\n", argv[0]);
+        printf("\t* frames defaults to \x1b[32m1000\x1b[0m, at most %d.\n", MAX_FRAMES);
+        printf("The slave is simulated, one frame every %d us, polled by the library after\n", FRAME_PERIOD_US);
+        printf("its second interrupt. Set \x1b[32mIoUring=1\x1b[0m in hsdk.conf to run the test under the\n");
+        printf("io_uring reactor, \x1b[32mIoUring=0\x1b[0m under the poll() one.\n");
+        exit(1);
+    }
+    if (frames > MAX_FRAMES) {
+        frames = MAX_FRAMES;
+    }
+
+    int i;
+    for (i = 0; i < frames; i++) {
+        uint8_t *f = stream + i * FRAME_SIZE;
+        f[0] = 0x02;
+        f[1] = TEST_OG;
+        f[2] = (uint8_t)i;
+        f[3] = 1;
+        f[4] = 0;
+        f[5] = (uint8_t)(i >> 8);
+        f[6] = f[1] ^ f[2] ^ f[3] ^ f[4] ^ f[5];
+    }
+
+    ConfigParams *params = ParseConfig();
+    printf("reactor: %s\n", params->ioUring ? "io_uring" : "poll");
+    free(params);
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, uio) != 0) {
+        perror("socketpair");
+        exit(1);
+    }
+
+    SPIConfigurationData *config = defaultSettingsSPI();
+    setLengthFieldSize(config, LENGTH_FIELD_SIZE);
+    setBurstReadSPI(config, 64, 2);
+    setAdaptivePollSPI(config, POLL_IDLE_US);
+
+    PhysicalDeviceManager *manager = InitPhysicalDeviceManager(1);
+    PhysicalDevice *device = AddToPhysicalDeviceManager(manager, SPI, config, SIM_SPIDEV, NONE);
+    if (device == NULL) {
+        printf("Cannot create the SPI device\n");
+        exit(1);
+    }
+    Framer *framer = InitializeFramer(device, FSCI, LENGTH_FIELD_SIZE, CRC_FIELD_SIZE, _LITTLE_ENDIAN);
+    AttachToFramer(framer, NULL, callback);
+
+    pthread_t interrupt;
+    pthread_create(&interrupt, NULL, interrupt_routine, NULL);
+    if (OpenAllPhysicalDevices(manager) != 0) {
+        printf("Cannot open the SPI device\n");
+        exit(1);
+    }
+
+    uint64_t last = now_us();
+    int seen = 0;
+    startUs = last;
+    /* Wait as long as frames keep coming, the slave stalls if one is not serviced. */
+    while (received < frames && now_us() - last < TIMEOUT_MS * 1000ULL) {
+        if (received != seen) {
+            seen = received;
+            last = now_us();
+        }
+        usleep(1000);
+    }
+    usleep(2 * POLL_IDLE_US);
+
+    SPICounters counters;
+    SPIGetCounters(device->deviceHandle, &counters);
+    printf("slave -> host: %d/%d frames, %d bad, %u mode switches, %llu ms\n", received, frames, corrupted,
+           counters.modeSwitches, (unsigned long long)((now_us() - startUs) / 1000));
+
+    stop = 1;
+    pthread_join(interrupt, NULL);
+    CloseAllPhysicalDevices(manager);
+    DestroyFramer(framer);
+    DestroyPhysicalDeviceManager(manager);
+
+    return (received == frames && corrupted == 0) ? 0 : 1;
+}
@@ -476,11 +476,14 @@ int main(int argc, char **argv)
     if (argc >= 6) {
         if (dev_type == UART) {
             int baudrate = get_baudrate(atoi(argv[5]));
-            if (baudrate == -1) {
+            if (baudrate != -1) {
+                setBaudrate(config, baudrate);
+            } else if (atoi(argv[5]) > 0) {
+                /* e.g. 1000000, 2000000 or 3000000 */
+                setCustomBaudrate(config, atoi(argv[5]));
+            } else {
                 printf("Wrong baudrate value.\n");
                 exit(1);
-            } else {
-                setBaudrate(config, baudrate);
             }
         } else {
             setSpeedHzSPI(config, atoi(argv[5]));
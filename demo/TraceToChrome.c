@@ -0,0 +1,139 @@
+/*! *********************************************************************************
+* \file TraceToChrome.c
+* This is a source file which converts a trace dump written by DumpTrace to the
+* Chrome trace JSON format, opened by chrome://tracing and Perfetto.
+*
+* Copyright 2013-2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************** */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hsdkTrace.h"
+
+static int ReadThread(FILE *in, TraceThreadHeader *thread, TraceEvent **events)
+{
+    if (fread(thread, sizeof(TraceThreadHeader), 1, in) != 1) {
+        return 0;
+    }
+    thread->name[HSDK_THREAD_NAME_SIZE - 1] = '\0';
+
+    *events = (TraceEvent *)malloc((thread->eventCount ? thread->eventCount : 1) * sizeof(TraceEvent));
+    if (*events == NULL) {
+        return 0;
+    }
+    if (fread(*events, sizeof(TraceEvent), thread->eventCount, in) != thread->eventCount) {
+        free(*events);
+        return 0;
+    }
+
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t header[3], i, j;
+    uint64_t origin = UINT64_MAX;
+    long start;
+    int first = 1;
+
+    if (argc != 3) {
+        printf("Usage: %s <trace dump> <output.json>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (in == NULL) {
+        printf("Cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    if (fread(header, sizeof(header), 1, in) != 1 || header[0] != TRACE_MAGIC || header[1] != TRACE_VERSION) {
+        printf("%s is not a trace dump of this version\n", argv[1]);
+        fclose(in);
+        return 1;
+    }
+
+    /* Timestamps are shown relative to the oldest event of the dump. */
+    start = ftell(in);
+    for (i = 0; i < header[2]; i++) {
+        TraceThreadHeader thread;
+        TraceEvent *events;
+
+        if (!ReadThread(in, &thread, &events)) {
+            printf("%s is truncated\n", argv[1]);
+            fclose(in);
+            return 1;
+        }
+        if (thread.eventCount && events[0].timestampNs < origin) {
+            origin = events[0].timestampNs;
+        }
+        free(events);
+    }
+    fseek(in, start, SEEK_SET);
+
+    FILE *out = fopen(argv[2], "w");
+    if (out == NULL) {
+        printf("Cannot open %s\n", argv[2]);
+        fclose(in);
+        return 1;
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (i = 0; i < header[2]; i++) {
+        TraceThreadHeader thread;
+        TraceEvent *events;
+
+        ReadThread(in, &thread, &events);
+
+        fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",", thread.threadId, thread.name[0] ? thread.name : "thread");
+        first = 0;
+
+        for (j = 0; j < thread.eventCount; j++) {
+            TraceEvent *event = &events[j];
+            uint64_t ns = event->timestampNs - origin;
+
+            fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"hsdk\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03u",
+                    TraceEventName(event->id), event->phase, thread.threadId,
+                    (unsigned long long)(ns / 1000), (unsigned)(ns % 1000));
+            if (event->phase == TRACE_INSTANT) {
+                fprintf(out, ",\"s\":\"t\"");
+            }
+            fprintf(out, ",\"args\":{\"arg\":%u}}", event->arg);
+        }
+
+        free(events);
+    }
+    fprintf(out, "\n]}\n");
+
+    fclose(out);
+    fclose(in);
+
+    return 0;
+}
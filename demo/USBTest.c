@@ -0,0 +1,204 @@
+/*! *********************************************************************************
+* \file USBTest.c
+* This is a source file checking the libusb device against a CDC ACM gadget.
+*
+* Copyright 2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************** */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "PhysicalDevice.h"
+#include "Framer.h"
+#include "FSCIFrame.h"
+
+#define LENGTH_FIELD_SIZE 2
+#define CRC_FIELD_SIZE 1
+#define PAYLOAD_SIZE 200
+#define TEST_OG 0xA1
+#define TIMEOUT_MS 5000
+
+static volatile int received = 0;
+static volatile int corrupted = 0;
+static uint8_t payload[PAYLOAD_SIZE];
+
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Executes on every RX packet.
+ */
+void callback(void *callee, void *response)
+{
+    FSCIFrame *frame = (FSCIFrame *)response;
+
+    if (frame->opGroup != TEST_OG || frame->opCode != (received & 0xFF) ||
+            frame->length != PAYLOAD_SIZE || memcmp(frame->data, payload, PAYLOAD_SIZE) != 0) {
+        corrupted++;
+    }
+    received++;
+    DestroyFSCIFrame(frame);
+}
+
+/*
+ * Opens the gadget side of the link, e.g. /dev/ttyGS0, in raw mode.
+ */
+static int open_gadget(char *name)
+{
+    struct termios tio;
+    int fd = open(name, O_RDWR | O_NOCTTY);
+
+    if (fd < 0) {
+        perror(name);
+        return -1;
+    }
+    tcgetattr(fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+    tcflush(fd, TCIOFLUSH);
+
+    return fd;
+}
+
+/*
+ * Host to gadget: the frames are sent by the library and read back from the gadget tty.
+ */
+static void test_host_to_gadget(Framer *framer, int gadget, int frames)
+{
+    static uint8_t in[PAYLOAD_SIZE + 6];
+    uint32_t expected = frames * (PAYLOAD_SIZE + 6), total = 0, bad = 0, offset = 0;
+    struct pollfd pfd = { gadget, POLLIN, 0 };
+    uint64_t start = now_ms();
+    int i, rc;
+
+    for (i = 0; i < frames; i++) {
+        FSCIFrame *frame = CreateFSCIFrame(framer, TEST_OG, i & 0xFF, payload, PAYLOAD_SIZE, 0);
+        SendFrame(framer, frame);
+        DestroyFSCIFrame(frame);
+    }
+
+    while (total < expected && poll(&pfd, 1, TIMEOUT_MS) == 1) {
+        rc = read(gadget, in + offset, sizeof(in) - offset);
+        if (rc <= 0) {
+            break;
+        }
+        total += rc;
+        offset += rc;
+        if (offset == sizeof(in)) {
+            if (in[0] != FSCI_SYNC_BYTE || in[1] != TEST_OG || memcmp(in + 5, payload, PAYLOAD_SIZE) != 0) {
+                bad++;
+            }
+            offset = 0;
+        }
+    }
+
+    printf("host -> gadget: %u/%u bytes, %u bad frames, %llu ms\n", total, expected, bad,
+           (unsigned long long)(now_ms() - start));
+}
+
+/*
+ * Gadget to host: the packed frames are written to the gadget tty and received by the library.
+ */
+static void test_gadget_to_host(Framer *framer, int gadget, int frames)
+{
+    uint64_t start = now_ms(), last;
+    uint32_t size;
+    int i;
+
+    for (i = 0; i < frames; i++) {
+        FSCIFrame *frame = CreateFSCIFrame(framer, TEST_OG, i & 0xFF, payload, PAYLOAD_SIZE, 0);
+        uint8_t *packet = PackageFrame(framer, frame, &size);
+        if (packet == NULL || write(gadget, packet, size) != (ssize_t)size) {
+            printf("write to the gadget failed\n");
+        }
+        free(packet);
+        DestroyFSCIFrame(frame);
+    }
+
+    last = now_ms();
+    while (received < frames && now_ms() - last < TIMEOUT_MS) {
+        usleep(1000);
+    }
+
+    printf("gadget -> host: %d/%d frames, %d bad, %llu ms\n", received, frames, corrupted,
+           (unsigned long long)(now_ms() - start));
+}
+
+
+int main(int argc, char **argv)
+{
+    /* Check number of arguments. */
+    if (argc < 3) {
+        printf("Usage: # %s vid:pid[@bus.address] /dev/ttyGSx [frames]\n", argv[0]);
+        printf("\t* vid:pid are the IDs of a CDC ACM gadget, e.g. \x1b[32m0525:a4a7\x1b[0m for g_serial.\n");
+        printf("\t* /dev/ttyGSx is the gadget side of the same link.\n");
+        printf("\t* frames defaults to \x1b[32m1000\x1b[0m.\n");
+        printf("With \x1b[32mmodprobe dummy_hcd; modprobe g_serial\x1b[0m both ends are on this machine;\n");
+        printf("a gadget exported by another machine can be attached with usbip instead.\n");
+        exit(1);
+    }
+
+    int frames = (argc > 3) ? atoi(argv[3]) : 1000;
+    int i, gadget = open_gadget(argv[2]);
+    if (gadget < 0) {
+        exit(1);
+    }
+    for (i = 0; i < PAYLOAD_SIZE; i++) {
+        payload[i] = (uint8_t)(i * 7);
+    }
+
+    PhysicalDevice *device = InitPhysicalDevice(USB, NULL, argv[1], NONE);
+    if (device == NULL) {
+        printf("Cannot create the USB device %s\n", argv[1]);
+        exit(1);
+    }
+    Framer *framer = InitializeFramer(device, FSCI, LENGTH_FIELD_SIZE, CRC_FIELD_SIZE, _LITTLE_ENDIAN);
+    AttachToFramer(framer, NULL, callback);
+    if (OpenPhysicalDevice(device) != 0) {
+        printf("Cannot open the USB device %s\n", argv[1]);
+        exit(1);
+    }
+
+    test_host_to_gadget(framer, gadget, frames);
+    test_gadget_to_host(framer, gadget, frames);
+
+    ClosePhysicalDevice(device);
+    close(gadget);
+
+    return (received == frames && corrupted == 0) ? 0 : 1;
+}
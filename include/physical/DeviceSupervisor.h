@@ -0,0 +1,99 @@
+/*! *********************************************************************************
+* \file DeviceSupervisor.h
+* This is the header file for the DeviceSupervisor module.
+*
+* Copyright 2013-2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************** */
+#ifndef __DEVICE_SUPERVISOR__
+#define __DEVICE_SUPERVISOR__
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdint.h>
+
+#include "hsdkOSCommon.h"
+#include "PhysicalDevice.h"
+
+#ifdef _WINDLL
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+/**
+ * @brief Watches a physical device and reopens it, in place, when it fails or is
+ * removed, so that its framers and their observers stay attached.
+ */
+typedef struct {
+    PhysicalDevice *device;     /**< The supervised device. */
+    Thread thread;              /**< The thread waiting for the device to be lost and reopening it. */
+    Event stopThread;           /**< An event used to signal the thread to stop. */
+    void *context;              /**< Passed back to the callback. */
+    void (*callback) (void *, PhysicalDevice *, DeviceStatus); /**< Optional: told of each transition to PHYS_LOST, PHYS_RECONNECTING and back to PHYS_OPENED. */
+    uint32_t reconnects;        /**< Number of times the device was reopened. */
+} DeviceSupervisor;
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public memory declarations
+*************************************************************************************
+********************************************************************************** */
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+DLLEXPORT DeviceSupervisor *SupervisePhysicalDevice(PhysicalDevice *device, void *context, void(*Callback)(void *, PhysicalDevice *, DeviceStatus));
+DLLEXPORT int DestroyDeviceSupervisor(DeviceSupervisor *supervisor);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif
@@ -0,0 +1,139 @@
+/*! *********************************************************************************
+* \file IoUring.h
+* This is the header file for the IoUring module.
+*
+* Copyright 2013-2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************** */
+#ifndef __IO_URING__
+#define __IO_URING__
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdint.h>
+
+#ifdef __linux__uring__
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __linux__uring__
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+/**
+ * @brief An io_uring instance with its submission and completion rings mapped.
+ */
+typedef struct {
+    int ringFd;                     /**< Descriptor returned by io_uring_setup. */
+    uint32_t features;              /**< IORING_FEAT_* flags reported by the kernel. */
+    uint8_t readMultishot;          /**< Whether the kernel supports multishot reads into a buffer ring. */
+
+    uint32_t *sqHead;               /**< Submission ring head, advanced by the kernel. */
+    uint32_t *sqTail;               /**< Submission ring tail, advanced by the application. */
+    uint32_t *sqArray;              /**< Indirection array from ring entries to SQEs. */
+    uint32_t sqMask;                /**< Mask of the submission ring indexes. */
+    uint32_t sqEntries;             /**< Number of entries in the submission ring. */
+    uint32_t sqLocalTail;           /**< Tail including the SQEs not published yet. */
+    struct io_uring_sqe *sqes;      /**< The submission queue entries. */
+
+    uint32_t *cqHead;               /**< Completion ring head, advanced by the application. */
+    uint32_t *cqTail;               /**< Completion ring tail, advanced by the kernel. */
+    uint32_t cqMask;                /**< Mask of the completion ring indexes. */
+    struct io_uring_cqe *cqes;      /**< The completion queue entries. */
+
+    void *sqRing;                   /**< Mapping of the submission ring. */
+    size_t sqRingSize;              /**< Size of the submission ring mapping. */
+    void *cqRing;                   /**< Mapping of the completion ring, equal to sqRing with IORING_FEAT_SINGLE_MMAP. */
+    size_t cqRingSize;              /**< Size of the completion ring mapping. */
+    size_t sqesSize;                /**< Size of the SQE array mapping. */
+} IoUring;
+
+/**
+ * @brief A group of equally sized buffers registered with the kernel, from which
+ * multishot reads pick the buffer to read into.
+ */
+typedef struct {
+    struct io_uring_buf_ring *ring; /**< The ring through which the buffers are handed to the kernel. */
+    uint8_t *buffers;               /**< Memory of the buffers, count * size bytes. */
+    uint32_t count;                 /**< Number of buffers, a power of two. */
+    uint32_t size;                  /**< Size of each buffer. */
+    uint16_t groupId;               /**< Buffer group selected by the reads. */
+    uint16_t tail;                  /**< Tail of the ring including the buffers not published yet. */
+} IoUringBufferRing;
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+/* IORING_OP_READ_MULTISHOT (Linux 6.7), missing from older kernel headers. */
+#define IO_URING_OP_READ_MULTISHOT 49
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+IoUring *IoUringCreate(uint32_t entries);
+void IoUringDestroy(IoUring *ring);
+struct io_uring_sqe *IoUringGetSqe(IoUring *ring);
+int IoUringReserve(IoUring *ring, uint32_t count);
+int IoUringSubmit(IoUring *ring, uint32_t waitCount);
+struct io_uring_cqe *IoUringPeekCqe(IoUring *ring);
+void IoUringCqeSeen(IoUring *ring);
+
+IoUringBufferRing *IoUringCreateBufferRing(IoUring *ring, uint16_t groupId, uint32_t count, uint32_t size);
+void IoUringDestroyBufferRing(IoUring *ring, IoUringBufferRing *bufferRing);
+uint8_t *IoUringBuffer(IoUringBufferRing *bufferRing, uint16_t bufferId);
+void IoUringRecycleBuffer(IoUringBufferRing *bufferRing, uint16_t bufferId);
+
+void IoUringPrepPollMultishot(struct io_uring_sqe *sqe, int fd, uint64_t userData);
+void IoUringPrepReadMultishot(struct io_uring_sqe *sqe, int fd, uint16_t groupId, uint64_t userData);
+void IoUringPrepRead(struct io_uring_sqe *sqe, int fd, void *buffer, uint32_t size, uint64_t userData);
+void IoUringPrepWritev(struct io_uring_sqe *sqe, int fd, const struct iovec *iov, uint32_t count, uint64_t userData);
+void IoUringPrepLinkTimeout(struct io_uring_sqe *sqe, struct __kernel_timespec *timeout, uint64_t userData);
+void IoUringPrepCancel(struct io_uring_sqe *sqe, uint64_t target, uint64_t userData);
+
+#endif
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif
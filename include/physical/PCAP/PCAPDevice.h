@@ -41,6 +41,13 @@
 
 #include "PhysicalDevice.h"
 
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+#define SIZE_ETHERNET 14
+
 /*! *********************************************************************************
 *************************************************************************************
 * Public type definitions
@@ -53,6 +60,8 @@ typedef struct {
     char *ifName;            /**< The network interface name in the operating system. */
     pcap_t *ifHandle;        /**< The file abstraction of the device in the operating system. */
     PhysicalDevice *parent;  /**< Needed for auto-recovery. */
+    uint8_t etherHeader[SIZE_ETHERNET];  /**< Ethernet header prepended to every frame sent on this interface. */
+    Thread loopThread;       /**< The thread running pcap_loop. */
 } PCAPHandle;
 
 /*! *********************************************************************************
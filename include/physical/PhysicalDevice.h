@@ -42,6 +42,7 @@
 #include "EventManager.h"
 #include "hsdkOSCommon.h"
 #include "MessageQueue.h"
+#include "RawFrame.h"
 #include "utils.h"
 
 #ifdef _WINDLL
@@ -77,7 +78,9 @@ typedef enum {
 typedef enum {
     PHYS_CLOSED,
     PHYS_OPENED,
-    PHYS_ERROR
+    PHYS_ERROR,
+    PHYS_LOST,          /**< Opened, but a read or write failed or the device was removed; it is no longer serviced. */
+    PHYS_RECONNECTING   /**< Lost and closed, being reopened by its DeviceSupervisor. */
 } DeviceStatus;
 
 /**
@@ -105,17 +108,55 @@ typedef struct {
     Thread eventThread;         /**< The thread to wait for events from the device. */
     Event startThread;          /**< An event used to synchronize the main thread and the eventThread. */
     Event stopThread;           /**< An event used to signal the eventThread to stop. */
+    uint8_t lengthFieldSize;    /**< Length field size of the attached framer, needed for sending and checking ACKs. */
+    uint8_t clearBus;           /**< SPI specific: whether to drain the bus the first time the device is started. */
+    void *shard;                /**< The reactor shard servicing the device if owned by a PhysicalDeviceManager, NULL otherwise. */
+    uint32_t rxBufferSize;      /**< Largest single read from the device, sized from the link MTU if configured. */
+    uint32_t rxSequence;        /**< Sequence number of the next RawFrame received, incremented atomically. */
+    uint32_t txSequence;        /**< Sequence number of the next RawFrame sent, incremented atomically. */
+    uint32_t rxFramesDropped;   /**< Received frames dropped by the framers, incremented atomically. */
+    uint8_t rxUndelivered;      /**< Set by a framer that could not take the data being delivered, for the FSCI ACK lock. */
+    RawFrame *txFrame;          /**< Frame taken from inMessages and partly written, resumed once the device is writable. */
+    SpinWait spin;              /**< Spin-then-block state of eventThread, set from SpinBudgetUs when the thread starts. */
+    Event lostEvent;            /**< Signaled each time the device becomes PHYS_LOST, waited for by its DeviceSupervisor. */
 
     int(*open) (void *, void *);                /**< Function pointer for the device specific open function. It passes specificData as an argument. */
     int(*close) (void *);                       /**< Function pointer for the device specific close function. */
     int(*write) (void *, uint8_t *, uint32_t);  /**< Function pointer to the device specific function to write data into it. */
+    int(*writeSegments) (void *, RawSegment *, uint32_t); /**< Optional: writes the segments of a frame without blocking; returns the bytes written, 0 if the device accepts no data now, -1 on failure. */
     int(*read) (void *, uint8_t *, uint32_t *); /**< Function pointer to the device specific function for reading data from it. */
+    int(*readWrite) (void *, uint8_t *, uint32_t, uint8_t *, uint32_t *); /**< Optional: reads like read and writes a frame waiting to be sent in the same transfers; HSDK_ERROR_BUSY if the data was read but the frame left to the TX. */
+    int(*available) (void *, uint32_t *);       /**< Optional: number of bytes that can be read without blocking, used to size the RX buffer. */
     int(*initialize) (void *, uint8_t);         /**< SPI specific: read data available on the bus at thread start. */
     int(*configure) (void *, void *);           /**< Configuration function. */
 
     Event (*waitable) (void *, void **); /**< A pointer to a function that returns an event that is waitable until the data has arrived to be read. */
+    Event (*writable) (void *, void **); /**< Set with writeSegments: returns an event that is waitable until the device accepts data again. */
 } PhysicalDevice;
 
+/**
+ * @brief Statistics of a physical device.
+ */
+typedef struct {
+    uint64_t deviceThreadCpuNs; /**< CPU time of the thread servicing the device, its own thread or its reactor shard. */
+    uint64_t pcapThreadCpuNs;   /**< CPU time of the pcap_loop thread, PCAP only. */
+    uint32_t heapBytes;         /**< Heap memory owned by the device, including the frames waiting to be sent. */
+    uint32_t stackBytes;        /**< Stack reserved for the threads owned by the device. */
+    uint32_t queuedMessages;    /**< Frames waiting to be sent. */
+    uint32_t spinWaits;         /**< Waits of the device thread that spun before blocking. */
+    uint32_t spinHits;          /**< Spinning waits that an RX or TX event ended before blocking. */
+    uint32_t rxOverruns;        /**< UART on Linux: bytes lost to receive FIFO overruns since the device was opened. */
+    uint32_t rxParityErrors;    /**< UART on Linux: bytes received with a parity error. */
+    uint32_t rxFrameErrors;     /**< UART on Linux: bytes received with a framing error. */
+    uint32_t rxBufferOverruns;  /**< UART on Linux: bytes lost because the tty buffer was full. */
+    uint32_t duplexFrames;      /**< SPI full duplex: frames sent in the transfers of a read, each sparing a transfer. */
+    uint32_t pollModeSwitches;  /**< SPI adaptive mode: switches between waiting for the interrupt and polling the slave. */
+    uint32_t rxCrcErrors;       /**< SPI: frames received with a wrong CRC. */
+    uint32_t rxResyncs;         /**< SPI: runs of unexpected bytes dismissed between frames. */
+    uint32_t speedHz;           /**< SPI: clock of the bus, tuned if auto-tuning is enabled. */
+    uint32_t rxFramesDropped;   /**< Frames dropped whole by a framer more than MaxQueuedMessages reads behind, and reads lost to a failed allocation. */
+} PhysicalDeviceStats;
+
 
 /*! *********************************************************************************
 *************************************************************************************
@@ -128,6 +169,11 @@ typedef struct {
 * Public macros
 *************************************************************************************
 ********************************************************************************** */
+/* Size of the buffer into which a single read from the device is done. */
+#define PHYS_RX_SIZE 0x8FF
+
+/* Bytes added by FSCI framing to a payload: STX, opGroup, opCode, 2-byte length and CRC. */
+#define PHYS_FRAMING_OVERHEAD 6
 
 /*! *********************************************************************************
 *************************************************************************************
@@ -140,8 +186,17 @@ DLLEXPORT int OpenPhysicalDevice(PhysicalDevice *);
 DLLEXPORT int ClosePhysicalDevice(PhysicalDevice *);
 DLLEXPORT int ConfigurePhysicalDevice(PhysicalDevice *, void *);
 DLLEXPORT int WritePhysicalDevice(void *, uint8_t *, uint32_t);
+DLLEXPORT int WritePhysicalDeviceFrame(void *, RawFrame *);
 DLLEXPORT void AttachToPhysicalDevice(void *, void *, void(*Callback)(void *, void *));
 DLLEXPORT void DetachFromPhysicalDevice(void *, void *);
+DLLEXPORT int GetPhysicalDeviceStats(PhysicalDevice *, PhysicalDeviceStats *);
+
+int ServicePhysicalDeviceRx(PhysicalDevice *device);
+int DeliverPhysicalDeviceRx(PhysicalDevice *device, uint8_t *dataBuffer, uint32_t size);
+int ServicePhysicalDeviceTx(PhysicalDevice *device);
+void FailPhysicalDevice(PhysicalDevice *device);
+int SuspendPhysicalDevice(PhysicalDevice *device);
+int ResumePhysicalDevice(PhysicalDevice *device);
 
 #ifdef __cplusplus
 } /* extern "C" */
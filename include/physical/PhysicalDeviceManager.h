@@ -0,0 +1,105 @@
+/*! *********************************************************************************
+* \file PhysicalDeviceManager.h
+* This is the header file for the PhysicalDeviceManager module.
+*
+* Copyright 2013-2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************** */
+#ifndef __PHYS_DEVICE_MANAGER__
+#define __PHYS_DEVICE_MANAGER__
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdint.h>
+
+#include "hsdkOSCommon.h"
+#include "PhysicalDevice.h"
+
+#ifdef _WINDLL
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+/**
+ * @brief Owner of a set of physical devices whose RX/TX is multiplexed on a pool of
+ * reactor threads (shards). Each device is pinned to one shard for its lifetime.
+ */
+typedef struct {
+    PhysicalDevice **devices;   /**< The devices added to the manager. */
+    uint32_t deviceCount;       /**< Number of devices added to the manager. */
+    uint32_t deviceCapacity;    /**< Number of entries allocated in devices. */
+    void **shards;              /**< The reactor shards, each one served by its own thread. */
+    uint32_t shardCount;        /**< Number of reactor shards. */
+} PhysicalDeviceManager;
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public memory declarations
+*************************************************************************************
+********************************************************************************** */
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+DLLEXPORT PhysicalDeviceManager *InitPhysicalDeviceManager(uint32_t shardCount);
+DLLEXPORT int DestroyPhysicalDeviceManager(PhysicalDeviceManager *manager);
+DLLEXPORT PhysicalDevice *AddToPhysicalDeviceManager(PhysicalDeviceManager *manager, DeviceType type, void *pConfigData, char *deviceName, FsciAckPolicy policy);
+DLLEXPORT int OpenAllPhysicalDevices(PhysicalDeviceManager *manager);
+DLLEXPORT int CloseAllPhysicalDevices(PhysicalDeviceManager *manager);
+
+int ReactorAttachDevice(PhysicalDevice *device);
+int ReactorDetachDevice(PhysicalDevice *device);
+int ReactorGetThreadCpuTime(PhysicalDevice *device, uint64_t *nanoseconds);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif
@@ -66,6 +66,11 @@ typedef struct {
     // uint8_t bitJustification;
     uint8_t bitsPerWord;
     uint32_t maxSpeedHz;
+    uint32_t burstSize;       // bytes read ahead per ioctl; 0 reads a header and a payload per frame
+    uint8_t burstSegments;    // spi_ioc_transfer segments a burst is split into
+    uint8_t fullDuplex;       // with burstSize: send a pending frame in the transfers of a read
+    uint32_t pollIdleUs;      // adaptive mode: poll the slave until it is idle this long; 0 for interrupts only
+    uint32_t tuneMinSpeedHz;  // auto-tune: lowest clock tried below maxSpeedHz; 0 keeps maxSpeedHz
 } SPIConfigurationData;
 
 /*! *********************************************************************************
@@ -77,6 +82,10 @@ SPIConfigurationData *defaultSettingsSPI();
 void freeSettingsSPI(SPIConfigurationData *);
 void setLengthFieldSize(SPIConfigurationData *, uint8_t);
 void setSpeedHzSPI(SPIConfigurationData *, uint32_t);
+void setBurstReadSPI(SPIConfigurationData *, uint32_t, uint8_t);
+void setFullDuplexSPI(SPIConfigurationData *, uint8_t);
+void setAdaptivePollSPI(SPIConfigurationData *, uint32_t);
+void setAutoTuneSPI(SPIConfigurationData *, uint32_t);
 int initPortSPI(File, SPIConfigurationData *);
 
 #ifdef __cplusplus
@@ -55,6 +55,17 @@ extern "C" {
 * Public type definitions
 *************************************************************************************
 ********************************************************************************** */
+/**
+ * @brief Counters of the SPI modes.
+ */
+typedef struct {
+    uint32_t duplexFrames;  /**< Frames sent in the bursts of a read. */
+    uint32_t modeSwitches;  /**< Switches between interrupts and polling. */
+    uint32_t crcErrors;     /**< Frames received with a wrong CRC. */
+    uint32_t resyncs;       /**< Runs of unexpected bytes dismissed between frames. */
+    uint32_t speedHz;       /**< Clock of the bus, set by the auto-tuning if enabled. */
+} SPICounters;
+
 /**
  * @brief Structure to identify a SPI port.
  */
@@ -69,6 +80,49 @@ typedef struct {
     File uioPortHandle;
     /* Used to read packets in two chunks: header + payload and CRC. */
     uint8_t lengthFieldSize;
+    /* Batched read: bytes clocked in per ioctl, 0 to read each frame in two chunks. */
+    uint32_t burstSize;
+    /* Batched read: number of spi_ioc_transfer segments of a burst. */
+    uint8_t burstSegments;
+    /* Batched read: the bytes of the last burst. */
+    uint8_t *burst;
+    /* Batched read: where the parsing of the bursts stopped, kept across interrupts
+    when a frame does not fit in the read buffer. */
+    uint8_t frameState;
+    uint8_t frameHeader[5];
+    uint8_t frameHeaderCount;
+    uint32_t frameBytesLeft;
+    /* Full duplex: send the pending frames in the bursts of the reads. */
+    uint8_t fullDuplex;
+    /* Full duplex: the bytes clocked out by a burst, a part of the frame padded with 0. */
+    uint8_t *burstTx;
+    /* Adaptive mode: the interrupt and pollKick, waited for by the device thread. */
+    File epollHandle;
+    /* Adaptive mode: an eventfd kept readable while the slave is polled. */
+    File pollKick;
+    /* Adaptive mode: idle period after which the interrupt is unmasked again, 0 if disabled. */
+    uint32_t pollIdleUs;
+    /* Adaptive mode: whether the slave is polled, its interrupt masked. */
+    uint8_t polling;
+    /* Adaptive mode: when the slave last sent data. */
+    uint64_t lastDataNs;
+    /* XOR of the bytes of the frame being cut from the bursts. */
+    uint8_t frameCrc;
+    /* Auto-tune: lowest and highest clock tried, tuneMinSpeedHz 0 if the clock is fixed. */
+    uint32_t tuneMinSpeedHz;
+    uint32_t tuneMaxSpeedHz;
+    /* Auto-tune: fastest clock found stable and slowest clock that failed, 0 if
+    none yet; kept across reopens, along with counters.speedHz. */
+    uint32_t stableSpeedHz;
+    uint32_t failedSpeedHz;
+    /* Auto-tune: frames and errors since the last step, and clean windows in a row. */
+    uint32_t windowFrames;
+    uint32_t windowErrors;
+    uint32_t cleanWindows;
+    /* Updated by the thread reading the device, read by GetPhysicalDeviceStats. */
+    SPICounters counters;
+    /* The device whose readWrite is set when the port opens in full-duplex mode. */
+    PhysicalDevice *parent;
 } SPIHandle;
 
 /*! *********************************************************************************
@@ -90,6 +144,7 @@ typedef struct {
 ********************************************************************************** */
 int AttachToSPIDevice(PhysicalDevice *pDevice, char *deviceName);
 int DetachFromSPIDevice(PhysicalDevice *pDevice);
+int SPIGetCounters(void *specificData, SPICounters *counters);
 
 #ifdef __cplusplus
 } /* extern "C" */
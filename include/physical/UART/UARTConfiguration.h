@@ -73,6 +73,7 @@ typedef enum {
     BR57600,
     BR115200,
     BR921600,
+    BR_CUSTOM,  /**< The baudrate set in customBaudrate. */
 } Baudrate;
 
 /**
@@ -138,6 +139,9 @@ typedef struct {
     uint8_t inX;                    /**< Whether to enable flow control on input. */
     uint8_t outCtsFlow;             /**< Whether to enable CTS flow control on input. */
     uint8_t outDsrFlow;             /**< Whether to enable DSR flow control on input. */
+    uint32_t customBaudrate;        /**< Baudrate in bits per second when baudrate is BR_CUSTOM, e.g. 1000000, 2000000, 3000000. */
+    uint8_t lowLatency;             /**< Linux: set ASYNC_LOW_LATENCY on the port, so received bytes are pushed to the reader at once. */
+    uint8_t latencyTimerMs;         /**< Linux, FTDI bridges: latency timer of the bridge in ms; 0 keeps the driver default (16 ms). */
 } UARTLineConfig;
 
 /**
@@ -161,6 +165,25 @@ typedef struct {
     UARTTimeConfig *timeConfig; /**< Pointer to the UART timeout configuration structure. */
 } UARTConfigurationData;
 
+/**
+ * @brief Settings in effect on an open UART port, as read back from the driver.
+ */
+typedef struct {
+    uint32_t baudrate;      /**< The baudrate in bits per second. */
+    uint8_t lowLatency;     /**< Whether ASYNC_LOW_LATENCY is set, Linux only. */
+    int latencyTimerMs;     /**< Latency timer of the USB-serial bridge in ms, -1 if the driver has none. */
+} UARTPortSettings;
+
+/**
+ * @brief Receive error counters of a UART port, counted by the driver.
+ */
+typedef struct {
+    uint32_t overrun;       /**< Bytes lost because the receive FIFO of the UART overflowed. */
+    uint32_t parity;        /**< Bytes received with a parity error. */
+    uint32_t frame;         /**< Bytes received with a framing error. */
+    uint32_t bufOverrun;    /**< Bytes lost because the tty buffer was full. */
+} UARTLineCounters;
+
 /*! *********************************************************************************
 *************************************************************************************
 * Public prototypes
@@ -171,8 +194,13 @@ DLLEXPORT void setDefaultTimeConfig(UARTTimeConfig *);
 DLLEXPORT UARTConfigurationData *defaultConfigurationData();
 DLLEXPORT void freeConfigurationData(UARTConfigurationData *);
 DLLEXPORT void setBaudrate(UARTConfigurationData *, Baudrate);
+DLLEXPORT void setCustomBaudrate(UARTConfigurationData *, uint32_t);
+DLLEXPORT void setLowLatency(UARTConfigurationData *, uint8_t, uint8_t);
+DLLEXPORT void setHardwareFlowControl(UARTConfigurationData *, uint8_t);
 void setParity(UARTConfigurationData *config, ParityType pt);
 int InitPort(File portHandle, UARTConfigurationData *config);
+DLLEXPORT int GetPortSettings(File portHandle, UARTPortSettings *settings);
+DLLEXPORT int GetPortLineCounters(File portHandle, UARTLineCounters *counters);
 
 #ifdef __cplusplus
 }
@@ -39,6 +39,7 @@
 ************************************************************************************/
 #include "hsdkOSCommon.h"
 #include "PhysicalDevice.h"
+#include "UARTConfiguration.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -55,6 +56,8 @@ extern "C" {
 typedef struct {
     char *deviceName;   /**< The name of the device, in some cases the system path of the device. */
     File portHandle;    /**< The file abstraction of the device in the operating system. */
+    UARTLineCounters countersAtOpen;    /**< Error counters of the driver when the port was opened. */
+    PhysicalDevice *parent;             /**< The device the port belongs to, for its configuration. */
 } UARTHandle;
 
 /*! *********************************************************************************
@@ -76,6 +79,7 @@ typedef struct {
 ********************************************************************************** */
 int AttachToUARTDevice(PhysicalDevice *pDevice, char *deviceName);
 int DetachFromUARTDevice(PhysicalDevice *pDevice);
+int UARTGetLineCounters(void *specificData, UARTLineCounters *counters);
 
 #ifdef __cplusplus
 } /* extern "C" */
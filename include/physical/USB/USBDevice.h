@@ -0,0 +1,82 @@
+/*! *********************************************************************************
+* \file USBDevice.h
+* This is the header file for the USBDevice module.
+*
+* Copyright 2015-2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************** */
+#ifndef __USB_DEV_
+#define __USB_DEV_
+
+/************************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+************************************************************************************/
+#include <libusb-1.0/libusb.h>
+
+#include "PhysicalDevice.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+/**
+ * @brief Structure to identify a USB device driven through libusb.
+ */
+typedef struct {
+    char *deviceName;               /**< vid:pid in hex, optionally followed by @bus.address, e.g. 1fc9:0021@1.4. */
+    uint16_t vendorId;              /**< USB vendor ID of the board. */
+    uint16_t productId;             /**< USB product ID of the board. */
+    int busNumber;                  /**< Bus of the board, -1 for the first board matching the IDs. */
+    int deviceAddress;              /**< Address of the board on its bus, -1 for any. */
+    libusb_context *context;        /**< The libusb context, one per device. */
+    libusb_device_handle *usbHandle;/**< The opened board. */
+    int commInterface;              /**< The CDC communication interface, -1 if the board has none. */
+    int dataInterface;              /**< The CDC data interface holding the bulk endpoints. */
+    uint8_t inEndpoint;             /**< Address of the bulk IN endpoint. */
+    uint8_t outEndpoint;            /**< Address of the bulk OUT endpoint. */
+    uint16_t maxPacketSize;         /**< Packet size of the bulk OUT endpoint. */
+    struct libusb_transfer **rxTransfers; /**< The bulk IN transfers kept in flight. */
+    uint32_t transferCount;         /**< Number of bulk IN transfers. */
+    uint32_t transferSize;          /**< Size of the buffer of each bulk IN transfer. */
+    uint32_t activeTransfers;       /**< Bulk IN transfers submitted and not yet retired. */
+    uint8_t stopping;               /**< Set while the port closes, the transfers are not resubmitted. */
+    Thread eventThread;             /**< The thread handling the libusb events. */
+    PhysicalDevice *parent;         /**< The device the received data is delivered to. */
+} USBHandle;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+int AttachToUSBDevice(PhysicalDevice *pDevice, char *deviceName);
+int DetachFromUSBDevice(PhysicalDevice *pDevice);
+
+#endif
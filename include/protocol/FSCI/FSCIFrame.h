@@ -72,14 +72,19 @@ typedef struct {
      * a second byte to the CRC field in case the virtualInterface is not 0
      */
     uint32_t crc;
-    /*! Timestamp of the FSCIFrame. It is the recorded timestamp of the RX of the SYNC
-     * byte of the current FSCI if it is a received frame. It is the creation time of a
-     * TX frame.
+    /*! Timestamp of the FSCIFrame, from HSDKMonotonicNs. It is the time of the read
+     * that received the SYNC byte of the current FSCI if it is a received frame. It
+     * is the creation time of a TX frame.
      */
-    time_t timeStamp;
-    uint32_t index;             /**< The index in the global sequence of received packets of the packet containing the SYNC byte. */
+    uint64_t timestampNs;
+    uint32_t index;             /**< The sequence number, among the packets received by the device, of the packet containing the SYNC byte. */
     endianness endian;          /**< The endianness of the frame. */
     uint8_t virtualInterface;   /**< The virtual interface on which the FSCIFrame is going to operate. */
+    /*! FSCI_FRAME_POOLED and FSCI_DATA_POOLED, set by the library for the frames and
+     * payloads taken from its pools. A frame allocated by the application with malloc
+     * and zeroed has none, and DestroyFSCIFrame releases it and its data with free().
+     */
+    uint8_t pooled;
 } FSCIFrame;
 
 /*! *********************************************************************************
@@ -103,6 +108,13 @@ typedef struct {
 #define MAX_CRC_SIZE 1
 #define EXPECTED_CRC_SIZE 1
 
+/* The payload stored in the same block as the frame, right after the structure. */
+#define FSCI_INLINE_DATA(frame) ((uint8_t *)((FSCIFrame *)(frame) + 1))
+
+/* Flags of FSCIFrame.pooled. */
+#define FSCI_FRAME_POOLED 0x01
+#define FSCI_DATA_POOLED 0x02
+
 /*! *********************************************************************************
  ************************************************************************************
  * Public prototypes
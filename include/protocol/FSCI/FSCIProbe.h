@@ -0,0 +1,111 @@
+/*! *********************************************************************************
+* \file FSCIProbe.h
+* This is the header file for the FSCIProbe module.
+*
+* Copyright 2013-2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************* */
+#ifndef __FSCI_PROBE__
+#define __FSCI_PROBE__
+
+/************************************************************************************
+ ************************************************************************************
+ * Include
+ ************************************************************************************
+ ***********************************************************************************/
+#include <stdint.h>
+
+#include "PhysicalDevice.h"
+#include "utils.h"
+
+#ifdef _WINDLL
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! *********************************************************************************
+ ************************************************************************************
+ * Public type definitions
+ ************************************************************************************
+ ********************************************************************************* */
+/**
+ * @brief The identification request sent to every probed device and the response
+ * expected from it.
+ */
+typedef struct {
+    DeviceType type;            /**< The type of the probed devices. */
+    void *configData;           /**< Device specific configuration, as given to AddToPhysicalDeviceManager. */
+    uint8_t lengthFieldSize;    /**< Length field size of the FSCI frames, 1 or 2. */
+    endianness endian;          /**< The endianness of the FSCI frames. */
+    uint8_t opGroup;            /**< The operation group of the request. */
+    uint8_t opCode;             /**< The operation code of the request. */
+    uint8_t *data;              /**< The payload of the request, may be NULL. */
+    uint32_t length;            /**< The length of the payload of the request. */
+    uint8_t responseOpGroup;    /**< The operation group of the response that identifies the device. */
+    uint8_t responseOpCode;     /**< The operation code of the response that identifies the device. */
+} FSCIProbeRequest;
+
+/**
+ * @brief The outcome of probing one device.
+ */
+typedef struct {
+    char *deviceName;           /**< The probed device, as given to ProbeFSCIDevices. */
+    int status;                 /**< HSDK_ERROR_SUCCESS if the device answered, HSDK_ERROR_TIMEOUT if it did not answer in time, another error code if it could not be probed. */
+    uint8_t *identity;          /**< Copy of the payload of the response, NULL if the device did not answer. */
+    uint32_t identityLength;    /**< The length of identity. */
+} FSCIProbeResult;
+
+/*! *********************************************************************************
+ ************************************************************************************
+ * Public memory declarations
+ ************************************************************************************
+ ********************************************************************************* */
+
+/*! *********************************************************************************
+ ************************************************************************************
+ * Public macros
+ ************************************************************************************
+ ********************************************************************************* */
+
+/*! *********************************************************************************
+ ************************************************************************************
+ * Public prototypes
+ ************************************************************************************
+ ********************************************************************************* */
+DLLEXPORT FSCIProbeResult *ProbeFSCIDevices(char **deviceNames, uint32_t count, FSCIProbeRequest *request, uint32_t timeoutMs);
+DLLEXPORT void DestroyFSCIProbeResults(FSCIProbeResult *results, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
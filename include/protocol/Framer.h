@@ -39,6 +39,7 @@
  ********************************************************************************* */
 #include "EventManager.h"
 #include "hsdkOSCommon.h"
+#include "MemoryPool.h"
 #include "MessageQueue.h"
 #include "PhysicalDevice.h"
 #include "utils.h"
@@ -124,6 +125,12 @@ typedef struct _Framer {
     /** The current state the framer is in. It's a travesty to keep it an int but
     each specific implementation of a protocol state machine has a different enum. */
     int currentState;
+    /** Pool of the received frames, set up by the protocol implementation. Frames
+    taken from it may be released from any thread, also after the framer is gone. */
+    MemoryPool *framePool;
+    /** Spin-then-block state of the framer thread, from SpinBudgetUs of the device.
+    Its waits and hits give the spin-hit ratio of the framer. */
+    SpinWait spin;
 
     /***********************************************************************
      Framer function pointers
@@ -138,6 +145,11 @@ typedef struct _Framer {
     /** Protocol specific function to create a byte array containing the data in the
     specific frame. */
     uint8_t *(*CreatePacket) (struct _Framer *, void *, uint32_t *);
+    /** Optional: protocol specific function to create the RawFrame to be sent for a
+    frame, with the header and the CRC as separate segments around the payload, so
+    that no contiguous packet is assembled. The last argument is the TX counter of
+    the device. */
+    RawFrame *(*CreateTxFrame) (struct _Framer *, void *, uint32_t *);
 } Framer;
 
 /*! *********************************************************************************
@@ -170,6 +182,7 @@ DLLEXPORT void SetEndianness(Framer *framer, endianness endian);
 
 uint8_t ReadSingleByte(MessageQueue *queue);
 uint8_t *ReadMultiByte(MessageQueue *queue, uint32_t cbDemanded);
+uint32_t ReadMultiByteInto(MessageQueue *queue, uint8_t *buffer, uint32_t cbDemanded);
 uint8_t *ReadDataUntilByte(MessageQueue *queue, uint16_t *cbSize, uint8_t startByte, uint8_t *found);
 
 #ifdef __cplusplus
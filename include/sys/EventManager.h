@@ -93,6 +93,7 @@ DLLEXPORT void RegisterToEventManager(EventManager *evt, void *callee, void(*Cal
 DLLEXPORT void DeregisterFromEvent(EventManager *evt, void *callee);
 DLLEXPORT void NotifyOnEvent(EventManager *evt, void *object);
 DLLEXPORT void NotifyOnSameEvent(EventManager *evt, void *object, void *(*func) (void *));
+DLLEXPORT void NotifyOnSameEventMove(EventManager *evt, void *object, void *(*clone) (void *), void (*destroy) (void *));
 
 #ifdef __cplusplus
 }
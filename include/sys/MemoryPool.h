@@ -0,0 +1,107 @@
+/*! *********************************************************************************
+* \file MemoryPool.h
+* This is the header file for the MemoryPool module.
+*
+* Copyright 2013-2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************* */
+#ifndef __MEMORY_POOL_H__
+#define __MEMORY_POOL_H__
+
+/*! *********************************************************************************
+ ************************************************************************************
+ * Include
+ ************************************************************************************
+ ********************************************************************************* */
+#include <stddef.h>
+
+#include "hsdkOSCommon.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! *********************************************************************************
+ ************************************************************************************
+ * Public type definitions
+ ************************************************************************************
+ ********************************************************************************* */
+/**
+ * @brief Pool of fixed size blocks. Freed blocks are kept in a free list and reused
+ * instead of going back to the system heap.
+ */
+typedef struct {
+    uint32_t blockSize;     /**< Usable size of each block. */
+    uint32_t maxFree;       /**< Maximum number of free blocks kept for reuse. */
+    uint32_t freeCount;     /**< Number of blocks in the free list. */
+    uint32_t outstanding;   /**< Number of blocks handed out and not yet returned. */
+    uint8_t closing;        /**< Set by DestroyMemoryPool while blocks are still outstanding. */
+    void *freeList;         /**< Blocks available for reuse. */
+    Lock lock;              /**< A lock to synchronize access to the pool. */
+} MemoryPool;
+
+/**
+ * @brief Allocator backing every pool, e.g. a jemalloc arena or a static arena.
+ */
+typedef struct {
+    void *(*allocate) (void *context, size_t size);   /**< Returns size bytes, NULL on failure. */
+    void (*release) (void *context, void *block);     /**< Releases a block returned by allocate. */
+    void *context;                                    /**< Passed to allocate and release. */
+} AllocatorHooks;
+
+/*! *********************************************************************************
+ ************************************************************************************
+ * Public memory declarations
+ ************************************************************************************
+ ********************************************************************************* */
+
+/*! *********************************************************************************
+ ************************************************************************************
+ * Public macros
+ ************************************************************************************
+ ********************************************************************************* */
+
+/*! *********************************************************************************
+ ************************************************************************************
+ * Public prototypes
+ ************************************************************************************
+ ********************************************************************************* */
+MemoryPool *CreateMemoryPool(uint32_t blockSize, uint32_t preallocated, uint32_t maxFree);
+void DestroyMemoryPool(MemoryPool *pool);
+void *MemoryPoolGet(MemoryPool *pool);
+void MemoryPoolPut(void *block);
+void *PoolAlloc(uint32_t size);
+void PoolFree(void *block);
+DLLEXPORT int SetAllocatorHooks(AllocatorHooks *hooks);
+DLLEXPORT int EnableZeroMalloc(uint32_t blocksPerClass, uint8_t failOnMiss);
+DLLEXPORT uint32_t GetPoolMisses(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -65,6 +65,8 @@ typedef struct {
     uint32_t cAvailableData;    /**< A generic count of the data stored. Can be used to store number of messages of total size of messages. */
     Semaphore sAnnounceData;    /**< A semaphore to indicate availability of  messages to be processed. */
     Lock lock;                  /**< A lock to synchronize access to the message queue. */
+    uint32_t cMessages;         /**< Number of messages in the queue. */
+    uint32_t maxMessages;       /**< Maximum number of messages the queue may hold at once. */
 } MessageQueue;
 
 
@@ -88,14 +90,14 @@ typedef struct {
 MessageQueue *InitializeMessageQueue(uint32_t maxMessageFlow);
 int DestroyMessageQueue(MessageQueue *pMessageQueue);
 int ClearMessageQueue(MessageQueue *pMessageQueue);
-void MessageQueuePut(MessageQueue *pMessageQueue, void *pData);
+int MessageQueuePut(MessageQueue *pMessageQueue, void *pData);
 void *MessageQueueGet(MessageQueue *pMessageQueue);
-void MessageQueuePutWithSize(MessageQueue *pMessageQueue, void *pData, uint32_t);
+int MessageQueuePutWithSize(MessageQueue *pMessageQueue, void *pData, uint32_t);
 uint32_t MessageQueueDecrementSize(MessageQueue *pMessageQueue, uint32_t);
 uint32_t MessageQueueGetContentSize(MessageQueue *pMessageQueue);
 uint8_t IsEmpty(MessageQueue *pMessageQueue, uint8_t synchronized);
 void *PeekFront(MessageQueue *pMessageQueue);
-void PushFront(MessageQueue *pMessageQueue, void *pData);
+int PushFront(MessageQueue *pMessageQueue, void *pData);
 
 #ifdef DEBUG
 void InspectQueue(MessageQueue *pMessageQueue);
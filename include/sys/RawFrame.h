@@ -55,15 +55,32 @@ extern "C" {
 * Public type definitions
 *************************************************************************************
 ********************************************************************************** */
+/* Segments of a TX RawFrame: header, payload and CRC. */
+#define RAW_FRAME_SEGMENTS 3
+
+/* Room in a TX RawFrame for the header and CRC around its payload. */
+#define RAW_FRAME_FRAMING_SIZE 8
+
+/**
+ * @brief A piece of a RawFrame to be sent. The pieces are written in order, in a single call.
+ */
+typedef struct {
+    uint8_t *data;          /**< First byte of the piece. */
+    uint32_t size;          /**< Number of bytes in the piece. */
+} RawSegment;
+
 /**
  * @brief Simple structure for encapsulating data. Has no protocol representation.
  */
 typedef struct {
-    uint32_t packetIndex;   /**< The index of the global count of RawFrames created. */
-    uint8_t *aRawData;      /**< An array containing the data stored in the RawFrame. */
-    uint32_t cbTotalSize;   /**< The size of the payload of the RawFrame. */
-    uint32_t iCrtIndex;     /**< An index into the array used in processing the data contained within the structure. */
-    time_t timeStamp;       /**< Timestamp of the creation of the RawFrame. */
+    uint32_t packetIndex;   /**< Sequence number of the RawFrame among the frames received, or sent, by its device. */
+    uint8_t *aRawData;      /**< An array containing the data stored in the RawFrame; only the payload of a segmented TX RawFrame. */
+    uint32_t cbTotalSize;   /**< The size of the payload of the RawFrame; all the segments of a TX RawFrame. */
+    uint32_t iCrtIndex;     /**< An index into the array used in processing the data contained within the structure; bytes already written for a TX RawFrame. */
+    uint64_t timestampNs;   /**< HSDKMonotonicNs of the read that received the RawFrame, or of the write that sent it. */
+    RawSegment segments[RAW_FRAME_SEGMENTS]; /**< TX only: the data to be written; the first segment starts with the protocol header. */
+    uint32_t segmentCount;  /**< TX only: number of segments used. */
+    uint8_t framing[RAW_FRAME_FRAMING_SIZE]; /**< TX only: header and CRC written around the payload of a segmented RawFrame. */
 } RawFrame;
 
 /*! *********************************************************************************
@@ -84,8 +101,12 @@ typedef struct {
 *************************************************************************************
 ********************************************************************************** */
 uint8_t *GetAckFrame(uint8_t lengthFieldSize);
-RawFrame *CreateTxRawFrame(uint8_t *data, uint32_t size);
-RawFrame *CreateRxRawFrame(uint8_t *data, uint32_t size);
+RawFrame *CreateTxRawFrame(uint8_t *data, uint32_t size, uint32_t *sequence);
+RawFrame *CreateSegmentedTxRawFrame(uint8_t *header, uint32_t headerSize, uint8_t *payload, uint32_t payloadSize,
+                                    uint8_t *trailer, uint32_t trailerSize, uint32_t *sequence);
+int FlattenRawFrame(RawFrame *frame);
+RawFrame *CreateRxRawFrame(uint8_t *data, uint32_t size, uint32_t *sequence);
+RawFrame *AdoptRxRawFrame(uint8_t *data, uint32_t size, uint32_t *sequence);
 RawFrame *CloneRawFrame(RawFrame *frame);
 DLLEXPORT void DestroyRawFrame(RawFrame *frame);
 
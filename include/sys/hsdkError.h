@@ -41,11 +41,15 @@ extern "C" {
 #define HSDK_ERROR_SUCCESS ERROR_SUCCESS
 #define HSDK_ERROR_INVALID ERROR_INVALID_DATA
 #define HSDK_ERROR_ALLOC ERROR_NOT_ENOUGH_MEMORY
+#define HSDK_ERROR_BUSY ERROR_BUSY
+#define HSDK_ERROR_TIMEOUT ERROR_TIMEOUT
 #else
 #include <errno.h>
 #define HSDK_ERROR_SUCCESS 0
 #define HSDK_ERROR_INVALID EINVAL
 #define HSDK_ERROR_ALLOC ENOMEM
+#define HSDK_ERROR_BUSY EBUSY
+#define HSDK_ERROR_TIMEOUT ETIMEDOUT
 #endif
 
 #ifdef __cplusplus
@@ -38,7 +38,6 @@
 *************************************************************************************
 ************************************************************************************/
 #include "hsdkOSCommon.h"
-#include "MessageQueue.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -49,16 +48,32 @@ extern "C" {
 *************************************************************************************
 ********************************************************************************** */
 /**
- * @brief The logger structure, containing a thread, a queue of messages to be
- * logged, a message count and an event signaling the end of logging.
+ * @brief The logger structure, containing the writer thread, the per-thread
+ * rings of records waiting to be written and an event waking up the writer.
  */
 typedef struct {
-    Thread loggerThread;	/**< A separate thread for the Logger. */
-    MessageQueue *queue;	/**< Queue for Logger messages. */
+    Thread loggerThread;	/**< A separate thread for the Logger, writing the records of the rings. */
+    void *rings;		/**< List of the per-thread rings of records. */
+    uint32_t ringSize;		/**< Records held by a ring, a power of two. */
+    uint32_t flushIntervalMs;	/**< Longest time a record waits in a ring before it is written. */
     int referenceCount;		/**< The number of the logged messages. */
-    Event stopThread;		/**< Event for signaling the Logger to stop. */
+    Event wakeup;		/**< Wakes up the writer when a ring reaches its watermark or the Logger stops. */
+    uint32_t wakeupPending;	/**< A wakeup was signaled and not yet consumed by the writer. */
+    uint8_t stopping;		/**< Set when the Logger stops, the writer drains the rings and exits. */
+    uint8_t synchronous;	/**< Lines are written by the calling thread, there is no logger thread or ring. */
+    Lock fileLock;		/**< Serializes the writers of a synchronous logger and the registration of the rings. */
 } Logger;
 
+/**
+ * @brief A logMessage call site, with the module it belongs to and the state of
+ * its rate limiter. Each site has a static instance of its own.
+ */
+typedef struct {
+    uint8_t module;             /**< Module of the site, HSDK_LOG_MODULES until its first message. */
+    uint32_t nextAllowedMs;     /**< Rate limiter: when the bucket is full again, on the log clock. */
+    uint32_t suppressed;        /**< Messages dropped by the rate limiter since the last one written. */
+} LogSite;
+
 /*! *********************************************************************************
 *************************************************************************************
 * Public macros
@@ -67,15 +82,61 @@ typedef struct {
 #define HSDK_ERROR 1
 #define HSDK_WARNING 2
 #define HSDK_INFO 3
+#define HSDK_DEBUG 4
+
+/* Highest priority compiled in, the runtime levels select up to this one. */
+#ifndef LOG_PRIORITY
+#define LOG_PRIORITY HSDK_DEBUG
+#endif
+
+/* Modules with a log level of their own, set with SetLogLevel or LogLevel<Module>. */
+#define HSDK_LOG_SYS 0
+#define HSDK_LOG_PHYSICAL 1
+#define HSDK_LOG_FRAMER 2
+#define HSDK_LOG_FSCI 3
+#define HSDK_LOG_MODULES 4
+
+/*
+ * Logs a message if its priority is enabled for the module of the call site.
+ * A disabled message costs a single compare, its arguments are not evaluated.
+ * The first message of a site resolves the module from the source file path.
+ */
+#ifdef USE_LOGGER
+#define logMessage(prio, messageTag, message, threadId) \
+    do { \
+        static LogSite logSite = { HSDK_LOG_MODULES, 0, 0 }; \
+        if ((prio) <= LOG_PRIORITY && (prio) <= logLevels[logSite.module]) { \
+            logSiteMessage(&logSite, __FILE__, (prio), (messageTag), (message), (threadId)); \
+        } \
+    } while (0)
+#else
+#define logMessage(prio, messageTag, message, threadId) \
+    do { \
+        if (0) { \
+            logSiteMessage(NULL, __FILE__, (prio), (messageTag), (message), (threadId)); \
+        } \
+    } while (0)
+#endif
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public memory declarations
+*************************************************************************************
+********************************************************************************** */
+/* Runtime level of each module; the extra last entry lets unresolved sites through. */
+extern volatile uint8_t logLevels[HSDK_LOG_MODULES + 1];
 
 /*! *********************************************************************************
 *************************************************************************************
 * Public prototypes
 *************************************************************************************
 ********************************************************************************** */
-void logMessage(int prio, const char *messageTag, const char *message, int threadId);
+void logSiteMessage(LogSite *site, const char *file, int prio, const char *messageTag, const char *message, int threadId);
 void initLogger(char *filename);
 void closeLogger();
+DLLEXPORT int SetLogLevel(int module, int level);
+DLLEXPORT int GetLogLevel(int module);
+DLLEXPORT void SetLogRateLimit(uint32_t messagesPerSecond, uint32_t burst);
 
 #ifdef __cplusplus
 }
@@ -96,11 +96,15 @@
 
 /**
  * @brief Structure for describing an event, on Linux.
- * @details On Linux, the event is an eventfd object.
+ * @details On Linux, an event is a counter signaled and waited for with futexes,
+ * until it is polled along with files; from then on it is an eventfd object.
  */
 typedef struct {
-    int event;			/**< Implemented on Linux with eventfd. */
+    int event;			/**< The eventfd of the event, -1 until needed; the file of a device event. */
     uint8_t pureEvent;	/**< Whether or not the event is an actual frame. */
+    uint8_t writable;	/**< Device events only: triggered when the device accepts data rather than when it has data. */
+    uint32_t count;		/**< Signals not yet taken, while the event has no eventfd. */
+    uint32_t waiters;	/**< Threads sleeping on count. */
 } EvtWrapper;
 
 #define Event EvtWrapper*
@@ -118,6 +122,7 @@ typedef struct {
     int read_end;		/**< The read end of the pipe. */
     int write_end;		/**< The write end of the pipe. */
     uint8_t pureEvent;	/**< Whether or not the event is an actual frame. */
+    uint8_t writable;	/**< Device events only: triggered when the device accepts data rather than when it has data. */
 } EvtWrapper;
 
 #define Event EvtWrapper*
@@ -127,6 +132,39 @@ typedef struct {
 
 #define INFINITE_WAIT -1
 
+/* Maximum length of a thread name, including the terminating null byte. */
+#define HSDK_THREAD_NAME_SIZE 16
+
+/**
+ * @brief Scheduling policies available for HSDK threads.
+ */
+typedef enum {
+    HSDK_SCHED_DEFAULT,     /**< The default time-sharing policy. */
+    HSDK_SCHED_FIFO,        /**< Real-time first-in, first-out policy. */
+    HSDK_SCHED_RR           /**< Real-time round-robin policy. */
+} ThreadPolicy;
+
+/**
+ * @brief Attributes applied to a thread when it is created.
+ */
+typedef struct {
+    uint64_t cpuMask;                   /**< CPUs the thread may run on, bit n for CPU n; 0 keeps the inherited affinity. */
+    ThreadPolicy policy;                /**< Scheduling policy of the thread. */
+    int priority;                       /**< Real-time priority, used with HSDK_SCHED_FIFO and HSDK_SCHED_RR. */
+    char name[HSDK_THREAD_NAME_SIZE];   /**< Name shown by top and perf; empty keeps the process name. */
+    uint32_t stackSize;                 /**< Stack size in bytes; 0 keeps the OS default. */
+} ThreadAttributes;
+
+/**
+ * @brief State of a spin-then-block wait, owned by the waiting thread.
+ */
+typedef struct {
+    uint32_t budgetUs;  /**< Longest spin before blocking, in microseconds; 0 always blocks. */
+    uint32_t spinUs;    /**< Spin of the next wait, adapted within budgetUs to how soon the events arrive. */
+    uint32_t waits;     /**< Waits that spun. */
+    uint32_t hits;      /**< Waits that ended while spinning. */
+} SpinWait;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -147,6 +185,19 @@ extern "C" {
  ********************************************************************************* */
 DLLEXPORT Thread HSDKCreateThread(void *(*startRoutine) (void *), void *arg);
 
+/*! *********************************************************************************
+ * \brief  Creates an OS specific thread with the given affinity, scheduling policy
+ *         and name. If real-time scheduling is not permitted the thread is created
+ *         with the default policy.
+ *
+ * \param[in] startRoutine   start address of the thread
+ * \param[in] arg            pointer to the arguments for the thread
+ * \param[in] attributes     the attributes of the thread, NULL for the defaults
+ *
+ * \return A Thread
+ ********************************************************************************* */
+DLLEXPORT Thread HSDKCreateThreadWithAttributes(void *(*startRoutine) (void *), void *arg, ThreadAttributes *attributes);
+
 /*! *********************************************************************************
  * \brief  Stops and deallocates the memory for a thread
  *
@@ -163,6 +214,34 @@ DLLEXPORT int HSDKDestroyThread(Thread thread);
 ********************************************************************************** */
 DLLEXPORT int HSDKThreadId();
 
+/*! *********************************************************************************
+* \brief  Returns the CPU time consumed by a thread
+*
+* \param[in] thread         the thread
+* \param[out] nanoseconds   the CPU time consumed, in nanoseconds
+*
+* \return 0 for success, an error code otherwise
+********************************************************************************** */
+DLLEXPORT int HSDKGetThreadCpuTime(Thread thread, uint64_t *nanoseconds);
+
+/*! *********************************************************************************
+* \brief  Returns the stack size reserved for a thread
+*
+* \param[in] thread         the thread
+* \param[out] stackSize     the stack size, in bytes
+*
+* \return 0 for success, an error code otherwise
+********************************************************************************** */
+DLLEXPORT int HSDKGetThreadStackSize(Thread thread, uint32_t *stackSize);
+
+/*! *********************************************************************************
+* \brief  Returns a timestamp of a monotonic clock that is not stepped or slewed when
+*         the wall clock is adjusted (CLOCK_MONOTONIC_RAW on Linux)
+*
+* \return the time in nanoseconds since an unspecified origin
+********************************************************************************** */
+DLLEXPORT uint64_t HSDKMonotonicNs(void);
+
 
 /*! *********************************************************************************
  * \brief  Creates an OS specific event
@@ -181,6 +260,18 @@ DLLEXPORT Event HSDKCreateEvent(int initialValue);
  * \return An Event
  ********************************************************************************* */
 DLLEXPORT Event HSDKDeviceTriggerableEvent(File e, void **context);
+#if __linux__ || __APPLE__
+/*! *********************************************************************************
+ * \brief  Creates an event that waits for a device to accept data. The context is
+ * destroyed with HSDKFinishTriggerableEvent
+ *
+ * \param[in] e      the device on which to wait
+ * \param[in] context pointer to a pointer to a structure to store the context
+ *
+ * \return An Event
+ ********************************************************************************* */
+DLLEXPORT Event HSDKDeviceWritableEvent(File e, void **context);
+#endif
 /*! *********************************************************************************
  * \brief  Destroys the context of the device waitable event
  *
@@ -198,7 +289,8 @@ DLLEXPORT int HSDKFinishTriggerableEvent(void *context);
  ********************************************************************************* */
 DLLEXPORT int HSDKDestroyEvent(Event e);
 /*! *********************************************************************************
- * \brief  Resets the value of the event
+ * \brief  Resets the value of the event. On Linux it no longer waits for a pending
+ * signal: an event that is not signalled is left as it is and the call returns at once.
  *
  * \param[in] e the event
  *
@@ -235,6 +327,29 @@ DLLEXPORT int HSDKWaitEvent(Event e, int64_t milisecondToWait);
  * signaled the first one to be signaled is returned
  ********************************************************************************* */
 DLLEXPORT int HSDKWaitMultipleEvents(Event *events, uint32_t noEvents, int64_t milisecondToWait, int *triggeredEvent);
+/*! *********************************************************************************
+ * \brief  Waits for multiple events, checking them without blocking for up to
+ *         spin->spinUs microseconds before blocking until one is signaled
+ *
+ * \param[in,out] spin              the spin state of the waiting thread
+ * \param[in] events				an array of events
+ * \param[in] noEvents				the number of events
+ * \param[in,out] triggeredEvent	the index of the signaled event
+ *
+ * \return 0 for success, an error code otherwise
+ ********************************************************************************* */
+DLLEXPORT int HSDKSpinWaitMultipleEvents(SpinWait *spin, Event *events, uint32_t noEvents, int *triggeredEvent);
+#ifdef __linux__
+/*! *********************************************************************************
+ * \brief  Returns the file to poll for an event, creating the eventfd of a pure
+ *         event the first time; signals then go through the file
+ *
+ * \param[in] e	the event
+ *
+ * \return The file, -1 on failure
+ ********************************************************************************* */
+DLLEXPORT File HSDKEventFile(Event e);
+#endif
 
 
 /*! *********************************************************************************
@@ -273,6 +388,37 @@ DLLEXPORT int HSDKWriteFile(File file, uint8_t *buffer, uint32_t count);
 * \return Count of bytes read
 ********************************************************************************** */
 DLLEXPORT int HSDKReadFile(File file, uint8_t *buffer, uint32_t *count);
+/*! *********************************************************************************
+* \brief  Gets the number of bytes that can be read from the file without blocking
+*
+* \param[in] file  The file
+* \param[out] count Number of bytes waiting in the input buffer
+*
+* \return 0 if successful, an error code otherwise
+********************************************************************************** */
+DLLEXPORT int HSDKBytesAvailable(File file, uint32_t *count);
+#if __linux__ || __APPLE__
+/*! *********************************************************************************
+* \brief  Makes reads and writes of the file return at once instead of blocking
+*
+* \param[in] file  The file
+*
+* \return 0 if successful, an error code otherwise
+********************************************************************************** */
+DLLEXPORT int HSDKSetFileNonBlocking(File file);
+/*! *********************************************************************************
+* \brief  Writes several buffers to the file in a single call, without waiting for
+* the file to accept them
+*
+* \param[in] file  The file
+* \param[in] buffers The buffers, written in order
+* \param[in] counts Number of bytes of each buffer
+* \param[in] noBuffers Number of buffers
+*
+* \return Number of bytes written, 0 if the file accepts no data now, -1 on failure
+********************************************************************************** */
+DLLEXPORT int HSDKWriteFileVector(File file, uint8_t **buffers, uint32_t *counts, uint32_t noBuffers);
+#endif
 /*! *********************************************************************************
  * \brief  Checks for the validity of a descriptor. An open file has a valid descriptor
  *
@@ -0,0 +1,137 @@
+/*! *********************************************************************************
+* \file hsdkTrace.h
+* This is the header file for the trace module.
+*
+* Copyright 2013-2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************* */
+#ifndef __HSDK_TRACE_H__
+#define __HSDK_TRACE_H__
+
+/*! *********************************************************************************
+ ************************************************************************************
+ * Include
+ ************************************************************************************
+ ********************************************************************************* */
+#include "hsdkOSCommon.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! *********************************************************************************
+ ************************************************************************************
+ * Public type definitions
+ ************************************************************************************
+ ********************************************************************************* */
+/**
+ * @brief Points of the RX and TX paths recorded by the trace.
+ */
+typedef enum {
+    TRACE_RX_READ = 1,          /**< read() returned, arg is the number of bytes. */
+    TRACE_RX_ENQUEUE,           /**< RawFrame put in the framer queue, arg is its size. */
+    TRACE_FRAMER_DEQUEUE,       /**< Framer took the queued bytes, arg is their number. */
+    TRACE_CRC_CHECK,            /**< Frame checksum verified, arg is 1 if it matched. */
+    TRACE_FRAME_COMPLETE,       /**< Frame parsed, arg is its opGroup << 8 | opCode. */
+    TRACE_CALLBACK,             /**< Subscriber callbacks of a frame, begin and end. */
+    TRACE_TX_ENQUEUE,           /**< RawFrame put in the TX queue, arg is its size. */
+    TRACE_TX_WRITE,             /**< write() of a frame, begin and end, arg is its size. */
+    TRACE_ACK_SENT,             /**< FSCI ACK written for a received frame. */
+    TRACE_ACK_RECEIVED,         /**< FSCI ACK received for a sent frame. */
+    TRACE_EVENT_COUNT
+} TraceEventId;
+
+/**
+ * @brief A recorded event, 16 bytes in memory and in a trace dump.
+ */
+typedef struct {
+    uint64_t timestampNs;       /**< Monotonic clock, nanoseconds. */
+    uint32_t arg;               /**< Argument of the event, see TraceEventId. */
+    uint16_t id;                /**< TraceEventId. */
+    uint8_t phase;              /**< TRACE_BEGIN, TRACE_END or TRACE_INSTANT. */
+    uint8_t reserved;
+} TraceEvent;
+
+/**
+ * @brief Header of the events of a thread in a trace dump. A dump starts with
+ * TRACE_MAGIC, the format version and the number of threads, all 32-bit words in
+ * the byte order of the host, followed by a TraceThreadHeader and its events for
+ * every thread.
+ */
+typedef struct {
+    uint32_t threadId;                      /**< HSDKThreadId of the thread. */
+    uint32_t eventCount;                    /**< Events following the header, oldest first. */
+    char name[HSDK_THREAD_NAME_SIZE];       /**< Name of the thread, if it has one. */
+} TraceThreadHeader;
+
+/*! *********************************************************************************
+ ************************************************************************************
+ * Public memory declarations
+ ************************************************************************************
+ ********************************************************************************* */
+/* Set by StartTrace, checked before anything else is done for an event. */
+extern volatile uint8_t traceEnabled;
+
+/*! *********************************************************************************
+ ************************************************************************************
+ * Public macros
+ ************************************************************************************
+ ********************************************************************************* */
+#define TRACE_BEGIN 'B'
+#define TRACE_END 'E'
+#define TRACE_INSTANT 'i'
+
+#define TRACE_MAGIC 0x43525448      /* "HTRC" */
+#define TRACE_VERSION 1
+
+/* Default number of events kept per thread, the oldest are overwritten. */
+#define DEFAULT_TRACE_RING_SIZE 4096
+
+/* Records an event of the calling thread; a single branch while the trace is off. */
+#define HSDK_TRACE(id, phase, arg) \
+    do { \
+        if (traceEnabled) { \
+            TraceRecord((id), (phase), (arg)); \
+        } \
+    } while (0)
+
+/*! *********************************************************************************
+ ************************************************************************************
+ * Public prototypes
+ ************************************************************************************
+ ********************************************************************************* */
+void TraceRecord(uint16_t id, uint8_t phase, uint32_t arg);
+DLLEXPORT void StartTrace(uint32_t eventsPerThread);
+DLLEXPORT void StopTrace(void);
+DLLEXPORT int DumpTrace(const char *path);
+DLLEXPORT const char *TraceEventName(uint16_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
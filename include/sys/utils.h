@@ -43,6 +43,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "hsdkOSCommon.h"
+#include "hsdkLogger.h"
+
 #ifdef _WINDLL
 #define DLLEXPORT __declspec(dllexport)
 #else
@@ -66,6 +69,15 @@ typedef enum {
     _UNKNOWN_ENDIAN
 } endianness;
 
+/**
+ * @brief What happens to the frames written to a device while it is lost.
+ */
+typedef enum {
+    RECONNECT_TX_HOLD,  /**< Frames are queued and sent once the device is reopened. */
+    RECONNECT_TX_DROP,  /**< Frames are accepted and discarded. */
+    RECONNECT_TX_FAIL   /**< Writes fail with HSDK_ERROR_BUSY. */
+} ReconnectTxPolicy;
+
 /**
  * @brief Structure to store configuration parameters.
  */
@@ -74,6 +86,35 @@ typedef struct {
     uint8_t numberOfRetries;
     int timeoutAckMs;
     uint8_t fsciRxAck;
+    ThreadAttributes deviceThread;  /**< Attributes of the device (RX/TX) thread. */
+    ThreadAttributes framerThread;  /**< Attributes of the framer thread. */
+    ThreadAttributes loggerThread;  /**< Attributes of the logger thread. */
+    ThreadAttributes pcapThread;    /**< Attributes of the pcap_loop thread. */
+    ThreadAttributes usbThread;     /**< Attributes of the libusb event thread. */
+    uint8_t lowFootprint;           /**< Low-footprint profile: small stacks, MTU-sized buffers, bounded queues, no logger thread. */
+    uint32_t linkMtu;               /**< Largest FSCI payload on the link, sizes the RX buffer; 0 for the default size. */
+    uint32_t maxQueuedMessages;     /**< Maximum frames held by a device TX queue, and reads a framer may lag behind before dropping frames. */
+    uint8_t syncLogger;             /**< Write log lines from the calling thread instead of a logger thread. */
+    uint32_t logRingSize;           /**< Log records buffered per thread for the logger thread, rounded up to a power of two. */
+    uint32_t logFlushIntervalMs;    /**< Longest time a log record waits before the logger thread writes it. */
+    uint8_t logLevel[HSDK_LOG_MODULES]; /**< Highest priority logged by each module, 0 disables the module. */
+    uint32_t logRateLimit;          /**< Messages per second written by a log call site, 0 for no limit. */
+    uint32_t logRateBurst;          /**< Messages a log call site may write at once. */
+    uint8_t traceEnabled;           /**< Start the event trace when a device is initialized. */
+    uint32_t traceRingSize;         /**< Trace events kept per thread; 0 for the default. */
+    uint32_t fsciInlinePayload;     /**< Payloads up to this size are stored inline in pooled received FSCI frames. */
+    uint32_t zeroMallocBlocks;      /**< Blocks preallocated per pool size class by the zero-malloc mode; 0 disables the mode. */
+    uint8_t zeroMallocFailFast;     /**< In zero-malloc mode, fail allocations the pools cannot serve instead of counting them. */
+    uint8_t ioUring;                /**< Service the devices of a PhysicalDeviceManager through io_uring where the kernel supports it. */
+    uint32_t ioUringEntries;        /**< Submission queue entries of the io_uring of a reactor shard. */
+    uint32_t ioUringBuffers;        /**< RX buffers registered per reactor shard for multishot reads. */
+    uint32_t spinBudgetUs;          /**< Microseconds the device and framer threads poll their events before blocking; 0 always blocks. */
+    uint32_t usbTransfers;          /**< Bulk IN transfers kept in flight by a libusb device. */
+    uint32_t usbTransferSize;       /**< Buffer size of each bulk IN transfer of a libusb device. */
+    uint32_t reconnectMinDelayMs;   /**< Delay of a DeviceSupervisor after the first failed attempt to reopen a lost device. */
+    uint32_t reconnectMaxDelayMs;   /**< Longest delay between attempts, reached by doubling the previous one. */
+    ReconnectTxPolicy reconnectTxPolicy; /**< Fate of the frames written while the device is lost. */
+    uint32_t writeTimeoutMs;        /**< Longest wait of a blocking write for the device to accept more of the data. */
 } ConfigParams;
 
 /*! *********************************************************************************
@@ -87,6 +128,39 @@ typedef struct {
 * Public macros
 *************************************************************************************
 ********************************************************************************** */
+/* Defaults of the low-footprint profile, enabled by HSDK_LOW_FOOTPRINT or LowFootprint=1. */
+#define LOW_FOOTPRINT_STACK_SIZE    (64 * 1024)
+#define LOW_FOOTPRINT_LINK_MTU      256
+#define LOW_FOOTPRINT_MAX_QUEUED    64
+#define LOW_FOOTPRINT_LOG_RING_SIZE 32
+#define LOW_FOOTPRINT_TRACE_RING_SIZE 256
+#define LOW_FOOTPRINT_IO_URING_BUFFERS 16
+#define LOW_FOOTPRINT_USB_TRANSFERS 2
+#define LOW_FOOTPRINT_USB_TRANSFER_SIZE 512
+
+/* Defaults of the logger thread. */
+#define DEFAULT_LOG_RING_SIZE       256
+#define DEFAULT_LOG_FLUSH_INTERVAL_MS 100
+#define DEFAULT_LOG_RATE_LIMIT      0   /* Rate limiting is opted into, e.g. 50 per second. */
+#define DEFAULT_LOG_RATE_BURST      100
+
+/* Default size of the payload stored inline in received FSCI frames. */
+#define DEFAULT_FSCI_INLINE_PAYLOAD 32
+
+/* Defaults of the io_uring reactor. */
+#define DEFAULT_IO_URING_ENTRIES    256
+#define DEFAULT_IO_URING_BUFFERS    64
+
+/* Defaults of the libusb bulk-endpoint device. */
+#define DEFAULT_USB_TRANSFERS       4
+#define DEFAULT_USB_TRANSFER_SIZE   16384
+
+/* Defaults of the reconnection backoff of a DeviceSupervisor. */
+#define DEFAULT_RECONNECT_MIN_DELAY_MS 10
+#define DEFAULT_RECONNECT_MAX_DELAY_MS 100
+
+/* Default of the wait of a blocking write for the device to drain. */
+#define DEFAULT_WRITE_TIMEOUT_MS    1000
 
 /*! *********************************************************************************
 *************************************************************************************
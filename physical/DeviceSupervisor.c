@@ -0,0 +1,280 @@
+/*! *********************************************************************************
+* \file DeviceSupervisor.c
+* This is a source file which reopens the physical devices that fail or are removed.
+*
+* Copyright 2013-2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************** */
+
+/************************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "DeviceSupervisor.h"
+#include "PhysicalDevice.h"
+
+#include "hsdkError.h"
+#include "hsdkLogger.h"
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+static void *SupervisorThreadRoutine(void *lpParameter);
+static uint8_t ReconnectDevice(DeviceSupervisor *supervisor);
+static void ReportStatus(DeviceSupervisor *supervisor, DeviceStatus status);
+
+/************************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+************************************************************************************/
+
+/************************************************************************************
+*************************************************************************************
+* Public memory declarations
+*************************************************************************************
+************************************************************************************/
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief    Starts supervising a physical device. When a read or write of the device
+*           fails, or the device is removed, the supervisor closes it and opens it
+*           again with its configuration data, at once and then with a delay doubling
+*           from ReconnectMinDelayMs up to ReconnectMaxDelayMs, until it succeeds.
+*           The device keeps its framers, their observers and, with ReconnectTxPolicy
+*           hold, the frames queued meanwhile, so the application does not have to
+*           rebuild anything. The device may be opened before or after this call.
+*
+* \param[in] device     pointer to the device
+* \param[in] context    passed back to the callback
+* \param[in] Callback   optional, called from the supervisor thread when the device is
+*                       lost, when it is being reconnected and when it is opened again;
+*                       it must not destroy the supervisor
+*
+* \return pointer to the supervisor, NULL on failure
+********************************************************************************** */
+DeviceSupervisor *SupervisePhysicalDevice(PhysicalDevice *device, void *context, void(*Callback)(void *, PhysicalDevice *, DeviceStatus))
+{
+    if (device == NULL) {
+        logMessage(HSDK_ERROR, "[DeviceSupervisor]SupervisePhysicalDevice", "Physical device is NULL", HSDKThreadId());
+        return NULL;
+    }
+
+    DeviceSupervisor *supervisor = (DeviceSupervisor *)calloc(1, sizeof(DeviceSupervisor));
+    if (supervisor == NULL) {
+        logMessage(HSDK_ERROR, "[DeviceSupervisor]SupervisePhysicalDevice", "Memory allocation failed", HSDKThreadId());
+        return NULL;
+    }
+
+    supervisor->device = device;
+    supervisor->context = context;
+    supervisor->callback = Callback;
+
+    supervisor->stopThread = HSDKCreateEvent(0);
+    if (supervisor->stopThread == INVALID_EVENT_HANDLE) {
+        logMessage(HSDK_ERROR, "[DeviceSupervisor]SupervisePhysicalDevice", "Event stopThread creation failed", HSDKThreadId());
+        free(supervisor);
+        return NULL;
+    }
+
+    supervisor->thread = HSDKCreateThread(SupervisorThreadRoutine, supervisor);
+    if (supervisor->thread == INVALID_THREAD_HANDLE) {
+        logMessage(HSDK_ERROR, "[DeviceSupervisor]SupervisePhysicalDevice", "Supervisor thread creation failed", HSDKThreadId());
+        HSDKDestroyEvent(supervisor->stopThread);
+        free(supervisor);
+        return NULL;
+    }
+
+    return supervisor;
+}
+
+/*! *********************************************************************************
+* \brief    Stops supervising the device and frees the supervisor. A device stopped
+*           while being reconnected is left PHYS_RECONNECTING, with its port closed;
+*           ClosePhysicalDevice closes it for good. The supervisor must be destroyed
+*           before its device is closed.
+*
+* \param[in] supervisor     pointer to the supervisor
+*
+* \return HSDK_ERROR_SUCCESS on success, an error code otherwise
+********************************************************************************** */
+int DestroyDeviceSupervisor(DeviceSupervisor *supervisor)
+{
+    if (supervisor == NULL) {
+        logMessage(HSDK_ERROR, "[DeviceSupervisor]DestroyDeviceSupervisor", "Supervisor is NULL", HSDKThreadId());
+        return HSDK_ERROR_INVALID;
+    }
+
+    int err = HSDKSignalEvent(supervisor->stopThread);
+    if (err != HSDK_ERROR_SUCCESS) {
+        logMessage(HSDK_ERROR, "[DeviceSupervisor]DestroyDeviceSupervisor", "stopThread signaling error", HSDKThreadId());
+        return err;
+    }
+
+    err = HSDKDestroyThread(supervisor->thread);
+    if (err != HSDK_ERROR_SUCCESS) {
+        logMessage(HSDK_ERROR, "[DeviceSupervisor]DestroyDeviceSupervisor", "Error destroying supervisor thread", HSDKThreadId());
+        return err;
+    }
+
+    HSDKDestroyEvent(supervisor->stopThread);
+    free(supervisor);
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Thread function which waits for either its termination or the loss of the
+* supervised device, and reconnects the device.
+*
+* \param[in] lpParameter    pointer to a DeviceSupervisor
+*
+* \return None
+********************************************************************************** */
+static void *SupervisorThreadRoutine(void *lpParameter)
+{
+    DeviceSupervisor *supervisor = (DeviceSupervisor *)lpParameter;
+    PhysicalDevice *device = supervisor->device;
+    int triggeredEvent;
+
+    Event eventArray[2];
+    eventArray[0] = supervisor->stopThread;
+    eventArray[1] = device->lostEvent;
+
+    while (1) {
+        triggeredEvent = -1;
+        if (HSDKWaitMultipleEvents(eventArray, 2, INFINITE_WAIT, &triggeredEvent) != HSDK_ERROR_SUCCESS ||
+                triggeredEvent != 1) {
+            break;
+        }
+        HSDKResetEvent(device->lostEvent);
+
+        /* Signals left from a loss already handled, or from before the device was closed, are ignored. */
+        if (device->status == PHYS_LOST && ReconnectDevice(supervisor)) {
+            break;
+        }
+    }
+
+    logMessage(HSDK_INFO, "[DeviceSupervisor]SupervisorThreadRoutine", "Supervisor thread finished", HSDKThreadId());
+
+    return NULL;
+}
+
+/*! *********************************************************************************
+* \brief  Closes the lost device and opens it again, retrying with an exponential
+* backoff. The first attempt is made at once, a board that only reset is usually back.
+*
+* \param[in] supervisor     pointer to the DeviceSupervisor
+*
+* \return 1 if the supervisor was stopped before the device could be opened, 0 otherwise
+********************************************************************************** */
+static uint8_t ReconnectDevice(DeviceSupervisor *supervisor)
+{
+    PhysicalDevice *device = supervisor->device;
+    uint32_t delayMs = device->configParams->reconnectMinDelayMs;
+    uint32_t maxDelayMs = device->configParams->reconnectMaxDelayMs;
+    int triggeredEvent;
+
+    /* ParseConfig keeps them so, but the parameters may have been changed since: a
+    0 delay would never double and spin on the attempts. */
+    if (delayMs == 0) {
+        delayMs = 1;
+    }
+    if (maxDelayMs < delayMs) {
+        maxDelayMs = delayMs;
+    }
+
+    ReportStatus(supervisor, PHYS_LOST);
+
+    if (SuspendPhysicalDevice(device) != HSDK_ERROR_SUCCESS) {
+        logMessage(HSDK_ERROR, "[DeviceSupervisor]ReconnectDevice", "Could not close the lost device", HSDKThreadId());
+        return 0;
+    }
+
+    ReportStatus(supervisor, PHYS_RECONNECTING);
+
+    while (ResumePhysicalDevice(device) != HSDK_ERROR_SUCCESS) {
+        triggeredEvent = -1;
+        HSDKWaitMultipleEvents(&supervisor->stopThread, 1, delayMs, &triggeredEvent);
+        if (triggeredEvent == 0) {
+            logMessage(HSDK_INFO, "[DeviceSupervisor]ReconnectDevice", "Stopped before the device could be reopened", HSDKThreadId());
+            return 1;
+        }
+
+        delayMs = (delayMs < maxDelayMs / 2) ? delayMs * 2 : maxDelayMs;
+    }
+
+    supervisor->reconnects++;
+    logMessage(HSDK_INFO, "[DeviceSupervisor]ReconnectDevice", "Device reopened", HSDKThreadId());
+    ReportStatus(supervisor, PHYS_OPENED);
+
+    return 0;
+}
+
+/*! *********************************************************************************
+* \brief  Tells the callback of the supervisor, if any, the new status of the device.
+*
+* \param[in] supervisor     pointer to the DeviceSupervisor
+* \param[in] status         the new status of the device
+*
+* \return None
+********************************************************************************** */
+static void ReportStatus(DeviceSupervisor *supervisor, DeviceStatus status)
+{
+    if (supervisor->callback != NULL) {
+        supervisor->callback(supervisor->context, supervisor->device, status);
+    }
+}
@@ -0,0 +1,580 @@
+/*! *********************************************************************************
+* \file IoUring.c
+* This is a source file which drives an io_uring instance through the raw system calls.
+*
+* Copyright 2013-2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************** */
+
+/************************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+************************************************************************************/
+#ifdef __linux__uring__
+
+#include <endian.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "IoUring.h"
+
+#include "hsdkError.h"
+#include "hsdkLogger.h"
+#include "hsdkOSCommon.h"
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+/* The rings are shared with the kernel: the producer publishes with release, the consumer reads with acquire. */
+#define RING_LOAD_ACQUIRE(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define RING_STORE_RELEASE(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/* Largest opcode looked up in the probe. */
+#define PROBE_OPS 256
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+static int ProbeOperations(IoUring *ring);
+static void PrepOperation(struct io_uring_sqe *sqe, uint8_t opcode, int fd, const void *addr, uint32_t len, uint64_t userData);
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief    Creates an io_uring instance and maps its rings. Fails on kernels older
+*           than 5.13, which lack multishot polls, and where io_uring is disabled, so
+*           that the caller can keep using poll().
+*
+* \param[in] entries    number of submission queue entries, rounded up by the kernel
+*
+* \return pointer to the instance, NULL if io_uring cannot be used
+********************************************************************************** */
+IoUring *IoUringCreate(uint32_t entries)
+{
+    struct io_uring_params params;
+    uint32_t i;
+
+    IoUring *ring = (IoUring *)calloc(1, sizeof(IoUring));
+    if (ring == NULL) {
+        logMessage(HSDK_ERROR, "[IoUring]IoUringCreate", "Memory allocation failed", HSDKThreadId());
+        return NULL;
+    }
+
+    /* Completions are reaped by the thread that submits, no need to interrupt it. */
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_COOP_TASKRUN;
+    ring->ringFd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->ringFd == -1 && errno == EINVAL) {
+        memset(&params, 0, sizeof(params));
+        ring->ringFd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    }
+    if (ring->ringFd == -1) {
+        logMessage(HSDK_INFO, "[IoUring]IoUringCreate io_uring_setup", strerror(errno), HSDKThreadId());
+        free(ring);
+        return NULL;
+    }
+
+    ring->features = params.features;
+    if (!(ring->features & IORING_FEAT_NODROP) || !(ring->features & IORING_FEAT_RSRC_TAGS)) {
+        logMessage(HSDK_INFO, "[IoUring]IoUringCreate", "Kernel too old for multishot polls", HSDKThreadId());
+        close(ring->ringFd);
+        free(ring);
+        return NULL;
+    }
+
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (ring->features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cqRingSize > ring->sqRingSize) {
+            ring->sqRingSize = ring->cqRingSize;
+        }
+        ring->cqRingSize = ring->sqRingSize;
+    }
+
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ringFd, IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED) {
+        ring->sqRing = NULL;
+        goto mapFailedLabel;
+    }
+
+    if (ring->features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cqRing = ring->sqRing;
+    } else {
+        ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ringFd, IORING_OFF_CQ_RING);
+        if (ring->cqRing == MAP_FAILED) {
+            ring->cqRing = NULL;
+            goto mapFailedLabel;
+        }
+    }
+
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ringFd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        goto mapFailedLabel;
+    }
+
+    ring->sqHead = (uint32_t *)((uint8_t *)ring->sqRing + params.sq_off.head);
+    ring->sqTail = (uint32_t *)((uint8_t *)ring->sqRing + params.sq_off.tail);
+    ring->sqArray = (uint32_t *)((uint8_t *)ring->sqRing + params.sq_off.array);
+    ring->sqMask = *(uint32_t *)((uint8_t *)ring->sqRing + params.sq_off.ring_mask);
+    ring->sqEntries = params.sq_entries;
+    ring->sqLocalTail = *ring->sqTail;
+
+    ring->cqHead = (uint32_t *)((uint8_t *)ring->cqRing + params.cq_off.head);
+    ring->cqTail = (uint32_t *)((uint8_t *)ring->cqRing + params.cq_off.tail);
+    ring->cqMask = *(uint32_t *)((uint8_t *)ring->cqRing + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((uint8_t *)ring->cqRing + params.cq_off.cqes);
+
+    /* SQEs are used in ring order, the indirection array is the identity. */
+    for (i = 0; i < ring->sqEntries; i++) {
+        ring->sqArray[i] = i;
+    }
+
+    if (ProbeOperations(ring) != HSDK_ERROR_SUCCESS) {
+        IoUringDestroy(ring);
+        return NULL;
+    }
+
+    return ring;
+
+mapFailedLabel:
+    logMessage(HSDK_ERROR, "[IoUring]IoUringCreate mmap", strerror(errno), HSDKThreadId());
+    IoUringDestroy(ring);
+    return NULL;
+}
+
+/*! *********************************************************************************
+* \brief    Unmaps the rings and closes an io_uring instance. The kernel cancels the
+*           requests still in flight.
+*
+* \param[in] ring   pointer to the instance
+*
+* \return None
+********************************************************************************** */
+void IoUringDestroy(IoUring *ring)
+{
+    if (ring == NULL) {
+        return;
+    }
+
+    if (ring->sqes != NULL) {
+        munmap(ring->sqes, ring->sqesSize);
+    }
+    if (ring->cqRing != NULL && ring->cqRing != ring->sqRing) {
+        munmap(ring->cqRing, ring->cqRingSize);
+    }
+    if (ring->sqRing != NULL) {
+        munmap(ring->sqRing, ring->sqRingSize);
+    }
+
+    close(ring->ringFd);
+    free(ring);
+}
+
+/*! *********************************************************************************
+* \brief    Returns the next free submission queue entry, cleared. The entry is
+*           handed to the kernel by the next IoUringSubmit.
+*
+* \param[in] ring   pointer to the instance
+*
+* \return pointer to the entry, NULL if the submission ring is full
+********************************************************************************** */
+struct io_uring_sqe *IoUringGetSqe(IoUring *ring)
+{
+    struct io_uring_sqe *sqe;
+
+    if (ring->sqLocalTail - RING_LOAD_ACQUIRE(ring->sqHead) >= ring->sqEntries) {
+        return NULL;
+    }
+
+    sqe = &ring->sqes[ring->sqLocalTail & ring->sqMask];
+    ring->sqLocalTail++;
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+    return sqe;
+}
+
+/*! *********************************************************************************
+* \brief    Makes room for a number of entries in the submission ring, submitting the
+*           prepared entries if needed. Entries that must be linked are reserved at
+*           once so that a chain is never cut by a full ring.
+*
+* \param[in] ring       pointer to the instance
+* \param[in] count      number of entries needed
+*
+* \return HSDK_ERROR_SUCCESS if count entries can be taken, HSDK_ERROR_BUSY otherwise
+********************************************************************************** */
+int IoUringReserve(IoUring *ring, uint32_t count)
+{
+    if (ring->sqEntries - (ring->sqLocalTail - RING_LOAD_ACQUIRE(ring->sqHead)) >= count) {
+        return HSDK_ERROR_SUCCESS;
+    }
+
+    IoUringSubmit(ring, 0);
+
+    if (ring->sqEntries - (ring->sqLocalTail - RING_LOAD_ACQUIRE(ring->sqHead)) >= count) {
+        return HSDK_ERROR_SUCCESS;
+    }
+
+    return HSDK_ERROR_BUSY;
+}
+
+/*! *********************************************************************************
+* \brief    Submits the prepared entries and, in the same system call, waits for
+*           completions.
+*
+* \param[in] ring           pointer to the instance
+* \param[in] waitCount      number of completions to wait for, 0 to only submit
+*
+* \return number of entries consumed by the kernel, a negative errno on failure
+********************************************************************************** */
+int IoUringSubmit(IoUring *ring, uint32_t waitCount)
+{
+    uint32_t toSubmit;
+    int rc;
+
+    RING_STORE_RELEASE(ring->sqTail, ring->sqLocalTail);
+    toSubmit = ring->sqLocalTail - RING_LOAD_ACQUIRE(ring->sqHead);
+
+    if (toSubmit == 0 && waitCount == 0) {
+        return 0;
+    }
+
+    rc = (int)syscall(__NR_io_uring_enter, ring->ringFd, toSubmit, waitCount, waitCount ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    if (rc == -1) {
+        return -errno;
+    }
+
+    return rc;
+}
+
+/*! *********************************************************************************
+* \brief    Returns the oldest completion not consumed yet, without consuming it.
+*
+* \param[in] ring   pointer to the instance
+*
+* \return pointer to the completion, NULL if there is none
+********************************************************************************** */
+struct io_uring_cqe *IoUringPeekCqe(IoUring *ring)
+{
+    uint32_t head = *ring->cqHead;
+
+    if (head == RING_LOAD_ACQUIRE(ring->cqTail)) {
+        return NULL;
+    }
+
+    return &ring->cqes[head & ring->cqMask];
+}
+
+/*! *********************************************************************************
+* \brief    Consumes the completion returned by IoUringPeekCqe.
+*
+* \param[in] ring   pointer to the instance
+*
+* \return None
+********************************************************************************** */
+void IoUringCqeSeen(IoUring *ring)
+{
+    RING_STORE_RELEASE(ring->cqHead, *ring->cqHead + 1);
+}
+
+/*! *********************************************************************************
+* \brief    Registers a group of buffers with the kernel for multishot reads. Every
+*           buffer is handed to the kernel; a buffer filled by a read must be given
+*           back with IoUringRecycleBuffer.
+*
+* \param[in] ring       pointer to the instance
+* \param[in] groupId    identifier of the group, selected by the reads
+* \param[in] count      number of buffers, rounded up to a power of two
+* \param[in] size       size of each buffer
+*
+* \return pointer to the group, NULL on failure
+********************************************************************************** */
+IoUringBufferRing *IoUringCreateBufferRing(IoUring *ring, uint16_t groupId, uint32_t count, uint32_t size)
+{
+    struct io_uring_buf_reg reg;
+    uint32_t entries = 1, i;
+
+    while (entries < count && entries < 32768) {
+        entries <<= 1;
+    }
+
+    IoUringBufferRing *bufferRing = (IoUringBufferRing *)calloc(1, sizeof(IoUringBufferRing));
+    if (bufferRing == NULL) {
+        logMessage(HSDK_ERROR, "[IoUring]IoUringCreateBufferRing", "Memory allocation failed", HSDKThreadId());
+        return NULL;
+    }
+
+    bufferRing->count = entries;
+    bufferRing->size = size;
+    bufferRing->groupId = groupId;
+
+    /* The kernel requires the ring to be page aligned. */
+    bufferRing->ring = (struct io_uring_buf_ring *)mmap(NULL, entries * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bufferRing->ring == MAP_FAILED) {
+        logMessage(HSDK_ERROR, "[IoUring]IoUringCreateBufferRing mmap", strerror(errno), HSDKThreadId());
+        free(bufferRing);
+        return NULL;
+    }
+
+    bufferRing->buffers = (uint8_t *)malloc((size_t)entries * size);
+    if (bufferRing->buffers == NULL) {
+        logMessage(HSDK_ERROR, "[IoUring]IoUringCreateBufferRing", "Memory allocation failed", HSDKThreadId());
+        munmap(bufferRing->ring, entries * sizeof(struct io_uring_buf));
+        free(bufferRing);
+        return NULL;
+    }
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)bufferRing->ring;
+    reg.ring_entries = entries;
+    reg.bgid = groupId;
+    if (syscall(__NR_io_uring_register, ring->ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) {
+        logMessage(HSDK_INFO, "[IoUring]IoUringCreateBufferRing io_uring_register", strerror(errno), HSDKThreadId());
+        free(bufferRing->buffers);
+        munmap(bufferRing->ring, entries * sizeof(struct io_uring_buf));
+        free(bufferRing);
+        return NULL;
+    }
+
+    for (i = 0; i < entries; i++) {
+        IoUringRecycleBuffer(bufferRing, (uint16_t)i);
+    }
+
+    return bufferRing;
+}
+
+/*! *********************************************************************************
+* \brief    Unregisters a group of buffers and frees it. No read may be using the
+*           group anymore.
+*
+* \param[in] ring           pointer to the instance the group is registered with
+* \param[in] bufferRing     pointer to the group
+*
+* \return None
+********************************************************************************** */
+void IoUringDestroyBufferRing(IoUring *ring, IoUringBufferRing *bufferRing)
+{
+    struct io_uring_buf_reg reg;
+
+    if (bufferRing == NULL) {
+        return;
+    }
+
+    memset(&reg, 0, sizeof(reg));
+    reg.bgid = bufferRing->groupId;
+    syscall(__NR_io_uring_register, ring->ringFd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+
+    munmap(bufferRing->ring, bufferRing->count * sizeof(struct io_uring_buf));
+    free(bufferRing->buffers);
+    free(bufferRing);
+}
+
+/*! *********************************************************************************
+* \brief    Returns the memory of a buffer, as identified by a read completion.
+*
+* \param[in] bufferRing     pointer to the group
+* \param[in] bufferId       identifier of the buffer, cqe->flags >> IORING_CQE_BUFFER_SHIFT
+*
+* \return pointer to the buffer
+********************************************************************************** */
+uint8_t *IoUringBuffer(IoUringBufferRing *bufferRing, uint16_t bufferId)
+{
+    return bufferRing->buffers + (size_t)bufferId * bufferRing->size;
+}
+
+/*! *********************************************************************************
+* \brief    Gives a buffer back to the kernel for the next reads.
+*
+* \param[in] bufferRing     pointer to the group
+* \param[in] bufferId       identifier of the buffer
+*
+* \return None
+********************************************************************************** */
+void IoUringRecycleBuffer(IoUringBufferRing *bufferRing, uint16_t bufferId)
+{
+    struct io_uring_buf *buf = &bufferRing->ring->bufs[bufferRing->tail & (bufferRing->count - 1)];
+
+    buf->addr = (uint64_t)(uintptr_t)IoUringBuffer(bufferRing, bufferId);
+    buf->len = bufferRing->size;
+    buf->bid = bufferId;
+
+    bufferRing->tail++;
+    RING_STORE_RELEASE(&bufferRing->ring->tail, bufferRing->tail);
+}
+
+/*! *********************************************************************************
+* \brief    Prepares a multishot poll for input, completed every time the descriptor
+*           becomes readable, with IORING_CQE_F_MORE set while it stays armed.
+*
+* \param[in] sqe        the entry to prepare
+* \param[in] fd         the descriptor to poll
+* \param[in] userData   value returned in the completions
+*
+* \return None
+********************************************************************************** */
+void IoUringPrepPollMultishot(struct io_uring_sqe *sqe, int fd, uint64_t userData)
+{
+    PrepOperation(sqe, IORING_OP_POLL_ADD, fd, NULL, IORING_POLL_ADD_MULTI, userData);
+#if __BYTE_ORDER == __BIG_ENDIAN
+    sqe->poll32_events = (POLLIN << 16) | (POLLIN >> 16);
+#else
+    sqe->poll32_events = POLLIN;
+#endif
+}
+
+/*! *********************************************************************************
+* \brief    Prepares a multishot read, completed every time data is read from the
+*           descriptor into a buffer picked from a group.
+*
+* \param[in] sqe        the entry to prepare
+* \param[in] fd         the descriptor to read from
+* \param[in] groupId    the buffer group to read into
+* \param[in] userData   value returned in the completions
+*
+* \return None
+********************************************************************************** */
+void IoUringPrepReadMultishot(struct io_uring_sqe *sqe, int fd, uint16_t groupId, uint64_t userData)
+{
+    PrepOperation(sqe, IO_URING_OP_READ_MULTISHOT, fd, NULL, 0, userData);
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = groupId;
+}
+
+void IoUringPrepRead(struct io_uring_sqe *sqe, int fd, void *buffer, uint32_t size, uint64_t userData)
+{
+    PrepOperation(sqe, IORING_OP_READ, fd, buffer, size, userData);
+}
+
+void IoUringPrepWritev(struct io_uring_sqe *sqe, int fd, const struct iovec *iov, uint32_t count, uint64_t userData)
+{
+    PrepOperation(sqe, IORING_OP_WRITEV, fd, iov, count, userData);
+}
+
+/*! *********************************************************************************
+* \brief    Prepares a timeout for the previous entry, which must be submitted with
+*           IOSQE_IO_LINK. The previous request is cancelled if it does not complete
+*           in time.
+*
+* \param[in] sqe        the entry to prepare
+* \param[in] timeout    the relative timeout, must stay valid until the completion
+* \param[in] userData   value returned in the completion
+*
+* \return None
+********************************************************************************** */
+void IoUringPrepLinkTimeout(struct io_uring_sqe *sqe, struct __kernel_timespec *timeout, uint64_t userData)
+{
+    PrepOperation(sqe, IORING_OP_LINK_TIMEOUT, -1, timeout, 1, userData);
+}
+
+/*! *********************************************************************************
+* \brief    Prepares the cancellation of the request submitted with a given user data.
+*
+* \param[in] sqe        the entry to prepare
+* \param[in] target     user data of the request to cancel
+* \param[in] userData   value returned in the completion of the cancellation
+*
+* \return None
+********************************************************************************** */
+void IoUringPrepCancel(struct io_uring_sqe *sqe, uint64_t target, uint64_t userData)
+{
+    PrepOperation(sqe, IORING_OP_ASYNC_CANCEL, -1, NULL, 0, userData);
+    sqe->addr = target;
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Checks that the kernel supports the operations used by the reactor and
+* whether it supports multishot reads.
+*
+* \param[in,out] ring   pointer to the instance
+*
+* \return HSDK_ERROR_SUCCESS if io_uring can be used, HSDK_ERROR_INVALID otherwise
+********************************************************************************** */
+static int ProbeOperations(IoUring *ring)
+{
+    static const uint8_t required[] = { IORING_OP_POLL_ADD, IORING_OP_READ, IORING_OP_WRITEV, IORING_OP_LINK_TIMEOUT, IORING_OP_ASYNC_CANCEL };
+    uint32_t i;
+
+    struct io_uring_probe *probe = (struct io_uring_probe *)calloc(1, sizeof(struct io_uring_probe) + PROBE_OPS * sizeof(struct io_uring_probe_op));
+    if (probe == NULL) {
+        logMessage(HSDK_ERROR, "[IoUring]ProbeOperations", "Memory allocation failed", HSDKThreadId());
+        return HSDK_ERROR_ALLOC;
+    }
+
+    if (syscall(__NR_io_uring_register, ring->ringFd, IORING_REGISTER_PROBE, probe, PROBE_OPS) == -1) {
+        logMessage(HSDK_INFO, "[IoUring]ProbeOperations io_uring_register", strerror(errno), HSDKThreadId());
+        free(probe);
+        return HSDK_ERROR_INVALID;
+    }
+
+    for (i = 0; i < sizeof(required); i++) {
+        if (required[i] >= probe->ops_len || !(probe->ops[required[i]].flags & IO_URING_OP_SUPPORTED)) {
+            logMessage(HSDK_INFO, "[IoUring]ProbeOperations", "Required operation not supported", HSDKThreadId());
+            free(probe);
+            return HSDK_ERROR_INVALID;
+        }
+    }
+
+    ring->readMultishot = IO_URING_OP_READ_MULTISHOT < probe->ops_len &&
+                          (probe->ops[IO_URING_OP_READ_MULTISHOT].flags & IO_URING_OP_SUPPORTED);
+
+    free(probe);
+    return HSDK_ERROR_SUCCESS;
+}
+
+static void PrepOperation(struct io_uring_sqe *sqe, uint8_t opcode, int fd, const void *addr, uint32_t len, uint64_t userData)
+{
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)addr;
+    sqe->len = len;
+    sqe->user_data = userData;
+}
+
+#endif
@@ -61,7 +61,6 @@
 ************************************************************************************/
 #define PCAP_DEBUG 0
 
-#define SIZE_ETHERNET 14
 #define SIZE_MACADDR 6
 #define FSCI_ETHERTYPE 0x88B5
 
@@ -78,7 +77,7 @@ static int PCAPOpenPort(void *, void *);
 static int PCAPClosePort(void *);
 static int PCAPWrite(void *pDevice, uint8_t *buffer, uint32_t count);
 static Event PCAPGetWaitEvent(void *, void **);
-static void FillEthernetHeader(char *);
+static void FillEthernetHeader(PCAPHandle *);
 
 /************************************************************************************
 *************************************************************************************
@@ -97,7 +96,6 @@ static void FillEthernetHeader(char *);
 * Private memory declarations
 *************************************************************************************
 ************************************************************************************/
-static uint8_t ether_header[SIZE_ETHERNET] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x88, 0xB5};
 
 /************************************************************************************
 *************************************************************************************
@@ -189,6 +187,10 @@ PCAPHandle *InitPCAPDevice(char *ifName)
 
     device->ifName = strdup(ifName);
 
+    /* EtherType is fixed, the MAC addresses are filled when the port is opened. */
+    device->etherHeader[SIZE_ETHERNET - 2] = (uint8_t)(FSCI_ETHERTYPE >> 8);
+    device->etherHeader[SIZE_ETHERNET - 1] = (uint8_t)(FSCI_ETHERTYPE & 0xFF);
+
     return device;
 }
 
@@ -226,14 +228,14 @@ void PCAPCallback(u_char *userData, const struct pcap_pkthdr *h, const u_char *b
     printf("[%ld.%06ld] caplen %d, len %d\n", h->ts.tv_sec, h->ts.tv_usec, h->caplen, h->len);
 #endif
     /* Strip Ethernet header */
-    RawFrame *frame = CreateRxRawFrame(((uint8_t *)bytes) + SIZE_ETHERNET, h->caplen - SIZE_ETHERNET);
+    PhysicalDevice *device = (PhysicalDevice *)userData;
+    RawFrame *frame = CreateRxRawFrame(((uint8_t *)bytes) + SIZE_ETHERNET, h->caplen - SIZE_ETHERNET, &device->rxSequence);
     if (frame == NULL) {
         logMessage(HSDK_ERROR, "[PCAPDevice]PCAPCallback", "Memory allocation failed", HSDKThreadId());
+        return;
     }
-    /* Notify */
-    NotifyOnSameEvent(((PhysicalDevice *)userData)->evtManager, frame, (void *(*)(void *))CloneRawFrame);
-    /* Destroy */
-    DestroyRawFrame(frame);
+    /* Notify; the last observer takes the frame itself */
+    NotifyOnSameEventMove(device->evtManager, frame, (void *(*)(void *))CloneRawFrame, (void (*)(void *))DestroyRawFrame);
 }
 
 /*! *********************************************************************************
@@ -272,8 +274,8 @@ int PCAPOpenPort(void *pDevice, void *configData)
         return HSDK_ERROR_INVALID;
     }
 
-    /* Fill the global Ethernet header. */
-    FillEthernetHeader(device->ifName);
+    /* Fill the Ethernet header of this interface. */
+    FillEthernetHeader(device);
 
     return HSDK_ERROR_SUCCESS;
 }
@@ -348,7 +350,7 @@ int PCAPWrite(void *pDevice, uint8_t *buffer, uint32_t count)
 
     /* Add Ethernet header */
     uint8_t finalBuf[SIZE_ETHERNET + count];
-    memcpy(finalBuf, ether_header, SIZE_ETHERNET);
+    memcpy(finalBuf, device->etherHeader, SIZE_ETHERNET);
     memcpy(finalBuf + SIZE_ETHERNET, buffer, count);
 
     int rc = pcap_inject(device->ifHandle, finalBuf, SIZE_ETHERNET + count);
@@ -364,7 +366,8 @@ int PCAPWrite(void *pDevice, uint8_t *buffer, uint32_t count)
         PCAPOpenPort(device, NULL);
         sleep(2);
         /* Re-establish RX path. */
-        Thread rxThread = HSDKCreateThread(PCAPLoopThreadRoutine, device->parent);
+        Thread rxThread = HSDKCreateThreadWithAttributes(PCAPLoopThreadRoutine, device->parent, &device->parent->configParams->pcapThread);
+        device->loopThread = rxThread;
         if (rxThread == INVALID_THREAD_HANDLE) {
             logMessage(HSDK_ERROR, "[PCAPWrite]HSDKCreateThread", "rxThread creation failed", HSDKThreadId());
             return HSDK_ERROR_INVALID;
@@ -380,11 +383,13 @@ Event PCAPGetWaitEvent(void *device, void **asyncMask)
 }
 
 
-void FillEthernetHeader(char *ifName)
+void FillEthernetHeader(PCAPHandle *device)
 {
 #ifdef __linux__
     int s, rc;
     struct ifreq buffer;
+    char *ifName = device->ifName;
+    uint8_t *ether_header = device->etherHeader;
 
     if (ifName == NULL) {
         logMessage(HSDK_ERROR, "[FillEthernetHeader] ifName", "interface name cannot be NULL", HSDKThreadId());
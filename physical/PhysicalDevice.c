@@ -41,6 +41,7 @@
 
 #include "EventManager.h"
 #include "Framer.h"
+#include "MemoryPool.h"
 #include "PhysicalDevice.h"
 #include "RawFrame.h"
 
@@ -52,23 +53,27 @@
 #    include "PCAPDevice.h"
 #endif
 
+#ifdef __linux__libusb__
+#    include "USBDevice.h"
+#endif
+
 #ifdef __linux__spi__
 #   include "SPIDevice.h"
 #endif
 
 #include "UARTDevice.h"
 #include "UART/UARTConfiguration.h"
+#include "PhysicalDeviceManager.h"
 
 #include "hsdkError.h"
 #include "hsdkLogger.h"
+#include "hsdkTrace.h"
 
 /************************************************************************************
 *************************************************************************************
 * Private macros
 *************************************************************************************
 ************************************************************************************/
-#define RX_SIZE 0x8FF
-
 /************************************************************************************
 *************************************************************************************
 * Private prototypes
@@ -77,6 +82,11 @@
 static void *DeviceThreadRoutine(void *lpParameter);
 static int AttachToConcreteImplementation(PhysicalDevice *device, char *deviceName);
 static int DetachFromConcreteImplementation(PhysicalDevice *device);
+static void SetThreadNames(ConfigParams *params, char *deviceName);
+static int WriteRawFrame(PhysicalDevice *device, RawFrame *tx);
+static int ResendRawFrame(PhysicalDevice *device, RawFrame *tx);
+static int StartDeviceService(PhysicalDevice *device);
+static int StopDeviceService(PhysicalDevice *device);
 
 /************************************************************************************
 *************************************************************************************
@@ -95,14 +105,94 @@ static int DetachFromConcreteImplementation(PhysicalDevice *device);
 * Private memory declarations
 *************************************************************************************
 ************************************************************************************/
-static uint8_t LENGTH_FIELD_SIZE = 2;  // needed for ACKs
-static uint8_t spiClearBus = 1;
 
 /************************************************************************************
 *************************************************************************************
 * Private functions
 *************************************************************************************
 ************************************************************************************/
+/*! *********************************************************************************
+* \brief  Writes what is left of a frame, starting at tx->iCrtIndex. Devices with
+* writeSegments get all the remaining segments in a single non-blocking call, the
+* others get the flattened frame through device->write.
+*
+* \param[in] device    pointer to the PhysicalDevice
+* \param[in,out] tx    the frame, iCrtIndex is advanced by the bytes written
+*
+* \return HSDK_ERROR_SUCCESS once the frame is written, HSDK_ERROR_BUSY if the device
+*         accepts no more data for now, HSDK_ERROR_INVALID if the write failed
+********************************************************************************** */
+static int WriteRawFrame(PhysicalDevice *device, RawFrame *tx)
+{
+    RawSegment remaining[RAW_FRAME_SEGMENTS];
+    uint32_t count, skip, i;
+    int rc;
+
+    if (device->writeSegments == NULL) {
+        rc = device->write(device->deviceHandle, tx->segments[0].data, tx->segments[0].size);
+        tx->iCrtIndex = tx->cbTotalSize;
+        return (rc < 0) ? HSDK_ERROR_INVALID : HSDK_ERROR_SUCCESS;
+    }
+
+    while (tx->iCrtIndex < tx->cbTotalSize) {
+        /* Skip what was written by the previous calls. */
+        for (i = 0, count = 0, skip = tx->iCrtIndex; i < tx->segmentCount; i++) {
+            if (skip >= tx->segments[i].size) {
+                skip -= tx->segments[i].size;
+                continue;
+            }
+            remaining[count].data = tx->segments[i].data + skip;
+            remaining[count].size = tx->segments[i].size - skip;
+            skip = 0;
+            count++;
+        }
+
+        rc = device->writeSegments(device->deviceHandle, remaining, count);
+        if (rc < 0) {
+            return HSDK_ERROR_INVALID;
+        } else if (rc == 0) {
+            return HSDK_ERROR_BUSY;
+        }
+        tx->iCrtIndex += (uint32_t)rc;
+    }
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+* \brief  Writes a whole frame again, waiting for the device to accept all of it.
+* Used when an FSCI ACK did not come.
+*
+* \param[in] device    pointer to the PhysicalDevice
+* \param[in,out] tx    the frame
+*
+* \return the size of the frame on success, -1 if the write failed
+********************************************************************************** */
+static int ResendRawFrame(PhysicalDevice *device, RawFrame *tx)
+{
+    int err, triggeredEvent;
+    void *writeMask = NULL;
+    Event writable;
+
+    tx->iCrtIndex = 0;
+    err = WriteRawFrame(device, tx);
+
+    while (err == HSDK_ERROR_BUSY) {
+        writable = device->writable(device->deviceHandle, &writeMask);
+        if (writable == INVALID_EVENT_HANDLE) {
+            return -1;
+        }
+        err = HSDKWaitMultipleEvents(&writable, 1, device->configParams->timeoutAckMs, &triggeredEvent);
+        HSDKFinishTriggerableEvent(writeMask);
+        if (err != HSDK_ERROR_SUCCESS) {
+            return -1;
+        }
+        err = WriteRawFrame(device, tx);
+    }
+
+    return (err == HSDK_ERROR_SUCCESS) ? (int)tx->cbTotalSize : -1;
+}
+
 static void CheckFSCIAck(PhysicalDevice *device, RawFrame *tx)
 {
 #ifdef __linux__
@@ -124,7 +214,7 @@ static void CheckFSCIAck(PhysicalDevice *device, RawFrame *tx)
 
     pfds[0].events = POLLIN;
 
-    uint8_t temp[3 + LENGTH_FIELD_SIZE + 1 + 1];
+    uint8_t temp[3 + device->lengthFieldSize + 1 + 1];
     uint8_t retries_left = device->configParams->numberOfRetries;
 
     do {
@@ -142,7 +232,7 @@ static void CheckFSCIAck(PhysicalDevice *device, RawFrame *tx)
             printf("[CheckFSCIAck] No ACK received in %d ms. Retrying...\n", device->configParams->timeoutAckMs);
             logMessage(HSDK_INFO, "[CheckFSCIAck] poll", "timeout", HSDKThreadId());
 
-            rc = device->write(device->deviceHandle, tx->aRawData, tx->cbTotalSize);
+            rc = ResendRawFrame(device, tx);
             if (rc == -1) {
                 perror("[CheckFSCIAck] write");
                 logMessage(HSDK_ERROR, "[CheckFSCIAck] write", strerror(errno), HSDKThreadId());
@@ -169,12 +259,13 @@ static void CheckFSCIAck(PhysicalDevice *device, RawFrame *tx)
                 logMessage(HSDK_ERROR, "[CheckFSCIAck] read", strerror(errno), HSDKThreadId());
                 break;
             } else {
-                if (memcmp(GetAckFrame(LENGTH_FIELD_SIZE), temp, sizeof(temp)) == 0) {
+                if (memcmp(GetAckFrame(device->lengthFieldSize), temp, sizeof(temp)) == 0) {
+                    HSDK_TRACE(TRACE_ACK_RECEIVED, TRACE_INSTANT, 0);
                     break;
                 } else {
                     printf("[CheckFSCIAck] Received something, but not ACK. Retrying... \n");
 
-                    rc = device->write(device->deviceHandle, tx->aRawData, tx->cbTotalSize);
+                    rc = ResendRawFrame(device, tx);
                     if (rc == -1) {
                         perror("[CheckFSCIAck] write");
                         logMessage(HSDK_ERROR, "[CheckFSCIAck] write", strerror(errno), HSDKThreadId());
@@ -188,7 +279,7 @@ static void CheckFSCIAck(PhysicalDevice *device, RawFrame *tx)
         /* Poll success, but no POLLIN data */
         else {
             printf("[CheckFSCIAck] No POLLIN data, probably poll errored. Retrying... \n");
-            rc = device->write(device->deviceHandle, tx->aRawData, tx->cbTotalSize);
+            rc = ResendRawFrame(device, tx);
             if (rc == -1) {
                 perror("[CheckFSCIAck] write");
                 logMessage(HSDK_ERROR, "[CheckFSCIAck] write", strerror(errno), HSDKThreadId());
@@ -210,8 +301,8 @@ static void CheckFSCIAck(PhysicalDevice *device, RawFrame *tx)
         return;
     }
 
-    uint8_t ackCount = 3 + LENGTH_FIELD_SIZE + 1 + 1;
-    uint8_t *temp = (uint8_t *)calloc(ackCount, sizeof(uint8_t));
+    uint8_t ackCount = 3 + device->lengthFieldSize + 1 + 1;
+    uint8_t temp[7];
     uint8_t retries_left = device->configParams->numberOfRetries;
 
     do {
@@ -229,7 +320,7 @@ static void CheckFSCIAck(PhysicalDevice *device, RawFrame *tx)
             printf("[CheckFSCIAck] No ACK received in %d ms. Retrying...\n", device->configParams->timeoutAckMs);
             logMessage(HSDK_INFO, "[CheckFSCIAck] poll", "timeout", HSDKThreadId());
 
-            rc = device->write(device->deviceHandle, tx->aRawData, tx->cbTotalSize);
+            rc = ResendRawFrame(device, tx);
             if (rc == -1) {
                 perror("[CheckFSCIAck] write");
                 logMessage(HSDK_ERROR, "[CheckFSCIAck] write", strerror(errno), HSDKThreadId());
@@ -250,11 +341,12 @@ static void CheckFSCIAck(PhysicalDevice *device, RawFrame *tx)
                 logMessage(HSDK_ERROR, "[CheckFSCIAck] read", strerror(errno), HSDKThreadId());
                 break;
             } else {
-                if (memcmp(GetAckFrame(LENGTH_FIELD_SIZE), temp, ackCount) == 0) {
+                if (memcmp(GetAckFrame(device->lengthFieldSize), temp, ackCount) == 0) {
+                    HSDK_TRACE(TRACE_ACK_RECEIVED, TRACE_INSTANT, 0);
                     break;
                 } else {
                     printf("[CheckFSCIAck] Received something, but not ACK. Retrying... \n");
-                    rc = device->write(device->deviceHandle, tx->aRawData, tx->cbTotalSize);
+                    rc = ResendRawFrame(device, tx);
                     if (rc == -1) {
                         perror("[CheckFSCIAck] write");
                         logMessage(HSDK_ERROR, "[CheckFSCIAck] write", strerror(errno), HSDKThreadId());
@@ -268,7 +360,7 @@ static void CheckFSCIAck(PhysicalDevice *device, RawFrame *tx)
         /* Poll success, but no POLLIN data */
         else {
             printf("[CheckFSCIAck] No POLLIN data, probably poll errored. Retrying... \n");
-            rc = device->write(device->deviceHandle, tx->aRawData, tx->cbTotalSize);
+            rc = ResendRawFrame(device, tx);
             if (rc == -1) {
                 perror("[CheckFSCIAck] write");
                 logMessage(HSDK_ERROR, "[CheckFSCIAck] write", strerror(errno), HSDKThreadId());
@@ -280,10 +372,97 @@ static void CheckFSCIAck(PhysicalDevice *device, RawFrame *tx)
     } while (retries_left);
 
     HSDKFinishTriggerableEvent(asyncMask);
-    free(temp);
 #endif
 }
 
+/*! *********************************************************************************
+* \brief  Starts servicing the RX and TX of a device whose port was just opened: a
+* device owned by a PhysicalDeviceManager is attached to its reactor shard, the others
+* get a thread of their own.
+*
+* \param[in] device    pointer to the PhysicalDevice
+*
+* \return HSDK_ERROR_SUCCESS on success, an error code otherwise
+********************************************************************************** */
+static int StartDeviceService(PhysicalDevice *device)
+{
+    int ret;
+
+    if (device->shard != NULL) {
+        // A device owned by a PhysicalDeviceManager is serviced by its reactor shard, not by its own thread
+        ret = ReactorAttachDevice(device);
+        if (ret != HSDK_ERROR_SUCCESS) {
+            logMessage(HSDK_ERROR, "[PhysicalDevice]OpenPhysicalDevice", "Failed to attach device to reactor shard", HSDKThreadId());
+            return ret;
+        }
+
+        logMessage(HSDK_INFO, "[PhysicalDevice]OpenPhysicalDevice", "Attached device to reactor shard", HSDKThreadId());
+    } else {
+        ret = HSDKSignalEvent(device->startThread);
+        if (ret != HSDK_ERROR_SUCCESS) {
+            logMessage(HSDK_WARNING, "[PhysicalDevice]OpenPhysicalDevice", "Failed to signal thread to start", HSDKThreadId());
+            return ret;
+        }
+
+        // Create a new thread to process data on device open not creation
+        device->eventThread = HSDKCreateThreadWithAttributes(DeviceThreadRoutine, device, &device->configParams->deviceThread);
+        if (device->eventThread == INVALID_THREAD_HANDLE) {
+            logMessage(HSDK_ERROR, "[PhysicalDevice]OpenPhysicalDevice", "Physical device is NULL", HSDKThreadId());
+            return HSDK_ERROR_INVALID;
+        }
+
+        logMessage(HSDK_INFO, "[PhysicalDevice]OpenPhysicalDevice", "Created and start device thread", HSDKThreadId());
+    }
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+* \brief  Stops servicing the RX and TX of a device before its port is closed.
+*
+* \param[in] device    pointer to the PhysicalDevice
+*
+* \return HSDK_ERROR_SUCCESS on success, an error code otherwise
+********************************************************************************** */
+static int StopDeviceService(PhysicalDevice *device)
+{
+    int err;
+
+    if (device->shard != NULL) {
+        // Stop the reactor shard from polling the device before closing the port
+        err = ReactorDetachDevice(device);
+        if (err != HSDK_ERROR_SUCCESS) {
+            logMessage(HSDK_ERROR, "[PhysicalDevice]ClosePhysicalDevice", "Error detaching device from reactor shard", HSDKThreadId());
+            return err;
+        }
+    } else {
+        if (device->stopThread == INVALID_EVENT_HANDLE) {
+            logMessage(HSDK_ERROR, "[PhysicalDevice]ClosePhysicalDevice", "stopThread event is invalid", HSDKThreadId());
+            return HSDK_ERROR_INVALID;
+        }
+
+        err = HSDKSignalEvent(device->stopThread);
+        if (err != HSDK_ERROR_SUCCESS) {
+            logMessage(HSDK_ERROR, "[PhysicalDevice]ClosePhysicalDevice", "stopThread signaling error", HSDKThreadId());
+            return err;
+        }
+
+        if (device->eventThread == INVALID_THREAD_HANDLE) {
+            logMessage(HSDK_ERROR, "[PhysicalDevice]ClosePhysicalDevice", "EventThread thread is invalid", HSDKThreadId());
+            return HSDK_ERROR_INVALID;
+        }
+
+        err = HSDKDestroyThread(device->eventThread);
+        if (err != HSDK_ERROR_SUCCESS) {
+            logMessage(HSDK_ERROR, "[PhysicalDevice]ClosePhysicalDevice", "Error destroying thread eventThread", HSDKThreadId());
+            return err;
+        }
+        device->eventThread = INVALID_THREAD_HANDLE;
+    }
+
+    return HSDK_ERROR_SUCCESS;
+}
+
 /************************************************************************************
 *************************************************************************************
 * Public functions
@@ -326,9 +505,22 @@ PhysicalDevice *InitPhysicalDevice(DeviceType type, void *pConfigData, char *dev
         pConnDev->configParams->fsciTxAck = policy & TX;
         pConnDev->configParams->fsciRxAck = policy & RX;
     }
+    SetThreadNames(pConnDev->configParams, deviceName);
+
+    // Fill the pools up front so that RX, parsing and TX do not reach the heap
+    if (pConnDev->configParams->zeroMallocBlocks) {
+        if (EnableZeroMalloc(pConnDev->configParams->zeroMallocBlocks, pConnDev->configParams->zeroMallocFailFast) != HSDK_ERROR_SUCCESS) {
+            logMessage(HSDK_WARNING, "[PhysicalDevice]InitPhysicalDevice", "Zero-malloc pools could not be filled", HSDKThreadId());
+        }
+    }
+
+    // Record the RX and TX events from the start, dumped later with DumpTrace
+    if (pConnDev->configParams->traceEnabled && !traceEnabled) {
+        StartTrace(pConnDev->configParams->traceRingSize);
+    }
 
     // Initialize the message queue for the current device
-    pConnDev->inMessages = InitializeMessageQueue(INT32_MAX);
+    pConnDev->inMessages = InitializeMessageQueue(pConnDev->configParams->maxQueuedMessages);
     if (pConnDev->inMessages == NULL) {
         logMessage(HSDK_ERROR, "[PhysicalDevice]InitPhysicalDevice", "MessageQueue init failed", HSDKThreadId());
         free(pConnDev);
@@ -370,8 +562,25 @@ PhysicalDevice *InitPhysicalDevice(DeviceType type, void *pConfigData, char *dev
 
     logMessage(HSDK_INFO, "[PhysicalDevice]InitPhysicalDevice", "Created stopThread event", HSDKThreadId());
 
+    // Create the event lostEvent. It signals a DeviceSupervisor that the device failed or was removed.
+    pConnDev->lostEvent = HSDKCreateEvent(0);
+    if (pConnDev->lostEvent == INVALID_EVENT_HANDLE) {
+        logMessage(HSDK_ERROR, "[PhysicalDevice]InitPhysicalDevice", "Event lostEvent creation failed", HSDKThreadId());
+        free(pConnDev);
+        return NULL;
+    }
+
     pConnDev->eventThread = INVALID_THREAD_HANDLE;
     pConnDev->type = type;
+    pConnDev->lengthFieldSize = 2;
+    pConnDev->clearBus = 1;
+    pConnDev->rxBufferSize = PHYS_RX_SIZE;
+
+    /* SPI drains every frame available on the bus in a single read. */
+    if (pConnDev->configParams->linkMtu != 0 && type != SPI) {
+        pConnDev->rxBufferSize = pConnDev->configParams->linkMtu + PHYS_FRAMING_OVERHEAD;
+    }
+    pConnDev->shard = NULL;
 
     AttachToConcreteImplementation(pConnDev, deviceName);
 
@@ -399,7 +608,7 @@ int DestroyPhysicalDevice(PhysicalDevice *device)
 
     int err;
 
-    if (device->status == PHYS_OPENED) {
+    if (device->status == PHYS_OPENED || device->status == PHYS_LOST || device->status == PHYS_RECONNECTING) {
         err = ClosePhysicalDevice(device);
         if (err != HSDK_ERROR_SUCCESS) {
             logMessage(HSDK_ERROR, "[PhysicalDevice]DestroyPhysicalDevice", "Closing failed", HSDKThreadId());
@@ -419,6 +628,12 @@ int DestroyPhysicalDevice(PhysicalDevice *device)
         return err;
     }
 
+    err = HSDKDestroyEvent(device->lostEvent);
+    if (err != HSDK_ERROR_SUCCESS) {
+        logMessage(HSDK_ERROR, "[PhysicalDevice]DestroyPhysicalDevice", "Error closing lostEvent event", HSDKThreadId());
+        return err;
+    }
+
     err = DestroyMessageQueue(device->inMessages);
     device->inMessages = NULL;
     if (err != HSDK_ERROR_SUCCESS) {
@@ -466,32 +681,24 @@ int OpenPhysicalDevice(PhysicalDevice *device)
 
     // Open device with the configured data. The open function also initializes the port
     int ret = device->open(device->deviceHandle, device->configurationData);
-    if (ret == HSDK_ERROR_SUCCESS) {
-        device->status = PHYS_OPENED;
-        int sig = HSDKSignalEvent(device->startThread);
-        if (sig != HSDK_ERROR_SUCCESS) {
-            logMessage(HSDK_WARNING, "[PhysicalDevice]OpenPhysicalDevice", "Failed to signal thread to start", HSDKThreadId());
-            device->status = PHYS_ERROR;
-            return sig;
-        }
-    } else {
+    if (ret != HSDK_ERROR_SUCCESS) {
         device->status = PHYS_ERROR;
         return ret;
     }
 
-    // Create a new thread to process data on device open not creation
-    device->eventThread = HSDKCreateThread(DeviceThreadRoutine, device);
-    if (device->eventThread == INVALID_THREAD_HANDLE) {
-        logMessage(HSDK_ERROR, "[PhysicalDevice]OpenPhysicalDevice", "Physical device is NULL", HSDKThreadId());
-        return HSDK_ERROR_INVALID;
-    }
+    device->status = PHYS_OPENED;
 
-    logMessage(HSDK_INFO, "[PhysicalDevice]OpenPhysicalDevice", "Created and start device thread", HSDKThreadId());
+    ret = StartDeviceService(device);
+    if (ret != HSDK_ERROR_SUCCESS) {
+        device->status = PHYS_ERROR;
+        return ret;
+    }
 
 #ifdef __linux__pcap__
     // Create a new thread which will run pcap_loop.
     if (device->type == PCAP) {
-        Thread rxThread = HSDKCreateThread(PCAPLoopThreadRoutine, device);
+        Thread rxThread = HSDKCreateThreadWithAttributes(PCAPLoopThreadRoutine, device, &device->configParams->pcapThread);
+        ((PCAPHandle *)device->deviceHandle)->loopThread = rxThread;
         if (rxThread == INVALID_THREAD_HANDLE) {
             logMessage(HSDK_ERROR, "[PhysicalDevice]OpenPhysicalDevice", "rxThread creation failed", HSDKThreadId());
             return HSDK_ERROR_INVALID;
@@ -518,44 +725,36 @@ int ClosePhysicalDevice(PhysicalDevice *crtDevice)
         return HSDK_ERROR_INVALID;
     }
 
-    if (crtDevice->status != PHYS_OPENED) {
+    if (crtDevice->status != PHYS_OPENED && crtDevice->status != PHYS_LOST && crtDevice->status != PHYS_RECONNECTING) {
         logMessage(HSDK_ERROR, "[PhysicalDevice]ClosePhysicalDevice", "Cannot close a closed device or errored device", HSDKThreadId());
         return HSDK_ERROR_INVALID;
     }
 
     int err;
 
-    if (crtDevice->stopThread == INVALID_EVENT_HANDLE) {
-        logMessage(HSDK_ERROR, "[PhysicalDevice]ClosePhysicalDevice", "stopThread event is invalid", HSDKThreadId());
-        return HSDK_ERROR_INVALID;
-    }
+    // The port of a device being reconnected is already closed
+    if (crtDevice->status != PHYS_RECONNECTING) {
+        err = StopDeviceService(crtDevice);
+        if (err != HSDK_ERROR_SUCCESS) {
+            return err;
+        }
 
-    err = HSDKSignalEvent(crtDevice->stopThread);
-    if (err != HSDK_ERROR_SUCCESS) {
-        logMessage(HSDK_ERROR, "[PhysicalDevice]ClosePhysicalDevice", "stopThread signaling error", HSDKThreadId());
-        return err;
-    }
+        err = crtDevice->close(crtDevice->deviceHandle);
 
-    if (crtDevice->eventThread == INVALID_THREAD_HANDLE) {
-        logMessage(HSDK_ERROR, "[PhysicalDevice]ClosePhysicalDevice", "EventThread thread is invalid", HSDKThreadId());
-        return HSDK_ERROR_INVALID;
-    }
-
-    err = HSDKDestroyThread(crtDevice->eventThread);
-    if (err != HSDK_ERROR_SUCCESS) {
-        logMessage(HSDK_ERROR, "[PhysicalDevice]ClosePhysicalDevice", "Error destroying thread eventThread", HSDKThreadId());
-        return err;
+        if (err != HSDK_ERROR_SUCCESS) {
+            logMessage(HSDK_ERROR, "[PhysicalDevice]ClosePhysicalDevice", "Error closing port", HSDKThreadId());
+            return err;
+        }
     }
 
-    err = crtDevice->close(crtDevice->deviceHandle);
+    crtDevice->status = PHYS_CLOSED;
 
-    if (err != HSDK_ERROR_SUCCESS) {
-        logMessage(HSDK_ERROR, "[PhysicalDevice]ClosePhysicalDevice", "Error closing port", HSDKThreadId());
-        return err;
+    /* The rest of a partly written frame is not sent. */
+    if (crtDevice->txFrame != NULL) {
+        DestroyRawFrame(crtDevice->txFrame);
+        crtDevice->txFrame = NULL;
     }
 
-    crtDevice->status = PHYS_CLOSED;
-
     ClearMessageQueue(crtDevice->inMessages);
 
     return HSDK_ERROR_SUCCESS;
@@ -590,7 +789,6 @@ int ConfigurePhysicalDevice(PhysicalDevice *device, void *data)
 ********************************************************************************** */
 int WritePhysicalDevice(void *device, uint8_t *buf, uint32_t size)
 {
-    int err;
     PhysicalDevice *crtDevice = (PhysicalDevice *) device;
     // Check if the device exists
     if (crtDevice == NULL) {
@@ -598,8 +796,65 @@ int WritePhysicalDevice(void *device, uint8_t *buf, uint32_t size)
         return HSDK_ERROR_INVALID;
     }
 
-    RawFrame *tx = CreateTxRawFrame(buf, size);
-    MessageQueuePut(crtDevice->inMessages, tx);
+    RawFrame *tx = CreateTxRawFrame(buf, size, &crtDevice->txSequence);
+    if (tx == NULL) {
+        logMessage(HSDK_ERROR, "[PhysicalDevice]WritePhysicalDevice", "Memory allocation failed", HSDKThreadId());
+        return HSDK_ERROR_ALLOC;
+    }
+
+    return WritePhysicalDeviceFrame(crtDevice, tx);
+}
+
+/*! *********************************************************************************
+* \brief   Puts a frame created with CreateTxRawFrame or CreateSegmentedTxRawFrame
+*          in the message queue of the device, to be written at the appropriate time.
+*          The segments are flattened first for devices that write a single buffer.
+*
+* \param[in, out] device   pointer to the PhysicalDevice structure.
+* \param[in] tx            the frame, owned by the device from now on, also on failure
+*
+* \return HSDK_ERROR_SUCCESS on success, HSDK_ERROR_BUSY if the device is lost and
+*         ReconnectTxPolicy is fail, an error code otherwise
+********************************************************************************** */
+int WritePhysicalDeviceFrame(void *device, RawFrame *tx)
+{
+    int err;
+    PhysicalDevice *crtDevice = (PhysicalDevice *) device;
+    // Check if the device exists
+    if (crtDevice == NULL) {
+        logMessage(HSDK_ERROR, "[PhysicalDevice]WritePhysicalDeviceFrame", "Physical device is NULL", HSDKThreadId());
+        DestroyRawFrame(tx);
+        return HSDK_ERROR_INVALID;
+    }
+
+    // Frames written while the device is lost are held in the queue unless configured otherwise
+    if (crtDevice->status == PHYS_LOST || crtDevice->status == PHYS_RECONNECTING) {
+        if (crtDevice->configParams->reconnectTxPolicy == RECONNECT_TX_DROP) {
+            DestroyRawFrame(tx);
+            return HSDK_ERROR_SUCCESS;
+        } else if (crtDevice->configParams->reconnectTxPolicy == RECONNECT_TX_FAIL) {
+            DestroyRawFrame(tx);
+            return HSDK_ERROR_BUSY;
+        }
+    }
+
+    if (crtDevice->writeSegments == NULL) {
+        err = FlattenRawFrame(tx);
+        if (err != HSDK_ERROR_SUCCESS) {
+            logMessage(HSDK_ERROR, "[PhysicalDevice]WritePhysicalDeviceFrame", "Memory allocation failed", HSDKThreadId());
+            DestroyRawFrame(tx);
+            return err;
+        }
+    }
+
+    uint32_t size = tx->cbTotalSize;
+    err = MessageQueuePut(crtDevice->inMessages, tx);
+    if (err != HSDK_ERROR_SUCCESS) {
+        logMessage(HSDK_WARNING, "[PhysicalDevice]WritePhysicalDeviceFrame", "TX queue full, frame dropped", HSDKThreadId());
+        DestroyRawFrame(tx);
+        return err;
+    }
+    HSDK_TRACE(TRACE_TX_ENQUEUE, TRACE_INSTANT, size);
     err = HSDKReleaseSemaphore(crtDevice->inMessages->sAnnounceData);
 
     return err;
@@ -623,7 +878,7 @@ void AttachToPhysicalDevice(void *dev, void *observer, void(*Callback) (void *ca
     RegisterToEventManager(physDev->evtManager, observer, Callback);
 
     // this info is needed for sending ACKs to the device
-    LENGTH_FIELD_SIZE = ((Framer *)observer)->lengthFieldSize;
+    physDev->lengthFieldSize = ((Framer *)observer)->lengthFieldSize;
 }
 
 /*! *********************************************************************************
@@ -640,6 +895,355 @@ void DetachFromPhysicalDevice(void *dev, void *observer)
     DeregisterFromEvent(physDev->evtManager, observer);
 }
 
+/*! *********************************************************************************
+* \brief  Reads the data available on the device and notifies the attached framers.
+*         Called by the device thread or by a reactor shard when the RX event of the
+*         device is triggered. The read goes into a pooled buffer sized after the
+*         bytes waiting on the device, which is handed to the framers without copying.
+*         A frame taken from the TX queue for readWrite goes back to the front of the
+*         queue if readWrite did not send it, for the TX to send on its own or once
+*         the device recovers.
+*
+* \param[in] device        pointer to the PhysicalDevice
+*
+* \return HSDK_ERROR_SUCCESS if the read succeeded, an error code otherwise
+********************************************************************************** */
+int ServicePhysicalDeviceRx(PhysicalDevice *device)
+{
+    uint32_t bytesRead = 0;
+    RawFrame *tx = NULL;
+    int err;
+
+    if (device->available == NULL ||
+            device->available(device->deviceHandle, &bytesRead) != HSDK_ERROR_SUCCESS ||
+            bytesRead == 0 || bytesRead > device->rxBufferSize) {
+        bytesRead = device->rxBufferSize;
+    }
+
+    uint8_t *dataBuffer = (uint8_t *)PoolAlloc(bytesRead);
+    if (dataBuffer == NULL) {
+        logMessage(HSDK_ERROR, "[PhysicalDevice]ServicePhysicalDeviceRx", "Memory allocation failed", HSDKThreadId());
+        return HSDK_ERROR_ALLOC;
+    }
+
+    /* A frame waiting to be sent goes out with the read, sparing the TX its own transfer. */
+    if (device->readWrite != NULL && device->txFrame == NULL && !device->configParams->fsciTxAck) {
+        tx = (RawFrame *)MessageQueueGet(device->inMessages);
+    }
+
+    if (tx != NULL) {
+        HSDK_TRACE(TRACE_TX_WRITE, TRACE_BEGIN, tx->cbTotalSize);
+        tx->timestampNs = HSDKMonotonicNs();
+        err = device->readWrite(device->deviceHandle, tx->segments[0].data, tx->segments[0].size, dataBuffer, &bytesRead);
+        HSDK_TRACE(TRACE_TX_WRITE, TRACE_END, tx->cbTotalSize);
+        if (err == HSDK_ERROR_SUCCESS) {
+            DestroyRawFrame(tx);
+        } else {
+            if (PushFront(device->inMessages, tx) != HSDK_ERROR_SUCCESS) {
+                logMessage(HSDK_ERROR, "[PhysicalDevice]ServicePhysicalDeviceRx", "Could not requeue the frame, frame dropped", HSDKThreadId());
+                DestroyRawFrame(tx);
+            }
+            if (err == HSDK_ERROR_BUSY) {
+                /* Read, but the frame did not fit in the transfers. */
+                err = HSDK_ERROR_SUCCESS;
+            }
+        }
+    } else {
+        err = device->read(device->deviceHandle, dataBuffer, &bytesRead);
+    }
+
+    if (err != HSDK_ERROR_SUCCESS || bytesRead == 0) {
+        PoolFree(dataBuffer);
+        return err;
+    }
+    HSDK_TRACE(TRACE_RX_READ, TRACE_INSTANT, bytesRead);
+
+    return DeliverPhysicalDeviceRx(device, dataBuffer, bytesRead);
+}
+
+/*! *********************************************************************************
+* \brief  Hands data read from the device to the attached framers. Used by
+*         ServicePhysicalDeviceRx and by the io_uring reactor, whose reads complete
+*         without a call to device->read.
+*
+* \param[in] device        pointer to the PhysicalDevice
+* \param[in] dataBuffer    a pooled buffer holding the data, owned by the callee
+* \param[in] size          number of bytes in dataBuffer
+*
+* \return HSDK_ERROR_SUCCESS on success, HSDK_ERROR_ALLOC if the frame could not be created
+********************************************************************************** */
+int DeliverPhysicalDeviceRx(PhysicalDevice *device, uint8_t *dataBuffer, uint32_t size)
+{
+    RawFrame *frame = AdoptRxRawFrame(dataBuffer, size, &device->rxSequence);
+    if (frame == NULL) {
+        PoolFree(dataBuffer);
+        return HSDK_ERROR_ALLOC;
+    }
+
+    if (device->configParams->fsciRxAck) {
+        /* Prevent other TXs until we send back the ACK. */
+        HSDKAcquireLock(device->inMessages->lock);
+    }
+
+    /* The last framer gets the frame itself, the others a copy. */
+    device->rxUndelivered = 0;
+    NotifyOnSameEventMove(device->evtManager, frame, (void *(*)(void *))CloneRawFrame, (void (*)(void *))DestroyRawFrame);
+
+    if (device->rxUndelivered && device->configParams->fsciRxAck) {
+        /* No ACK will be sent for the lost data, let TX go on. */
+        HSDKReleaseLock(device->inMessages->lock);
+    }
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+* \brief  Sends one frame from the TX queue of the device. Called by the device
+*         thread or by a reactor shard when the TX semaphore of the device is released,
+*         and again when the device becomes writable if the previous call returned
+*         HSDK_ERROR_BUSY; the partly written frame is then resumed instead of a new
+*         one being taken from the queue.
+*
+* \param[in] device    pointer to the PhysicalDevice
+*
+* \return HSDK_ERROR_SUCCESS if a frame was sent or the queue was empty,
+*         HSDK_ERROR_BUSY if the device accepted only part of the frame, an error
+*         code if the write failed
+********************************************************************************** */
+int ServicePhysicalDeviceTx(PhysicalDevice *device)
+{
+    RawFrame *tx = device->txFrame;
+
+    /* The frames of a lost device wait for it to be reopened. */
+    if (device->status != PHYS_OPENED) {
+        return HSDK_ERROR_SUCCESS;
+    }
+
+    if (tx == NULL) {
+        tx = (RawFrame *)MessageQueueGet(device->inMessages);
+        if (tx == NULL) {
+            return HSDK_ERROR_SUCCESS;
+        }
+
+        HSDK_TRACE(TRACE_TX_WRITE, TRACE_BEGIN, tx->cbTotalSize);
+        tx->timestampNs = HSDKMonotonicNs();
+        tx->iCrtIndex = 0;
+    }
+
+    int err = WriteRawFrame(device, tx);
+    if (err == HSDK_ERROR_BUSY) {
+        device->txFrame = tx;
+        return HSDK_ERROR_BUSY;
+    }
+    device->txFrame = NULL;
+    HSDK_TRACE(TRACE_TX_WRITE, TRACE_END, tx->cbTotalSize);
+
+    if (err == HSDK_ERROR_SUCCESS && device->configParams->fsciTxAck) {
+        /* Do not cascade ACKs. */
+        if ( tx->segments[0].data[1] != 0xA4 ||
+             tx->segments[0].data[2] != 0xFD ) {
+            CheckFSCIAck(device, tx);
+        }
+    }
+
+    DestroyRawFrame(tx);
+    if (err != HSDK_ERROR_SUCCESS) {
+        FailPhysicalDevice(device);
+        return HSDK_ERROR_INVALID;
+    }
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+* \brief  Marks an opened device as lost after a failed read or write, which is how
+*         the removal or the reset of a USB board shows. The device is no longer
+*         serviced until it is closed, or reopened by its DeviceSupervisor, which is
+*         woken through lostEvent. Called by the thread servicing the device.
+*
+* \param[in] device    pointer to the PhysicalDevice
+*
+* \return None
+********************************************************************************** */
+void FailPhysicalDevice(PhysicalDevice *device)
+{
+    if (device->status != PHYS_OPENED) {
+        return;
+    }
+
+    logMessage(HSDK_ERROR, "[PhysicalDevice]FailPhysicalDevice", "Device failed or removed, no longer serviced", HSDKThreadId());
+    device->status = PHYS_LOST;
+    HSDKSignalEvent(device->lostEvent);
+}
+
+/*! *********************************************************************************
+* \brief  Closes the port of a lost device, keeping its queue, framers and
+*         observers, so that it can be reopened with ResumePhysicalDevice. The frames
+*         queued meanwhile are kept or discarded as set by ReconnectTxPolicy.
+*
+* \param[in] device    pointer to the PhysicalDevice, PHYS_LOST
+*
+* \return HSDK_ERROR_SUCCESS if the device is now PHYS_RECONNECTING, an error code otherwise
+********************************************************************************** */
+int SuspendPhysicalDevice(PhysicalDevice *device)
+{
+    if (device->status != PHYS_LOST) {
+        logMessage(HSDK_ERROR, "[PhysicalDevice]SuspendPhysicalDevice", "Device is not lost", HSDKThreadId());
+        return HSDK_ERROR_INVALID;
+    }
+
+    int err = StopDeviceService(device);
+    if (err != HSDK_ERROR_SUCCESS) {
+        return err;
+    }
+
+    /* The port is gone, an error closing it is of no consequence. */
+    device->close(device->deviceHandle);
+    device->status = PHYS_RECONNECTING;
+
+    /* The rest of a partly written frame is not sent. */
+    if (device->txFrame != NULL) {
+        DestroyRawFrame(device->txFrame);
+        device->txFrame = NULL;
+    }
+
+    if (device->configParams->reconnectTxPolicy != RECONNECT_TX_HOLD) {
+        ClearMessageQueue(device->inMessages);
+    }
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+* \brief  Opens again the port of a device closed by SuspendPhysicalDevice, with its
+*         configuration data, and services it again. The frames held while the device
+*         was lost are sent first.
+*
+* \param[in] device    pointer to the PhysicalDevice, PHYS_RECONNECTING
+*
+* \return HSDK_ERROR_SUCCESS if the device is opened again, an error code otherwise,
+*         the device being still PHYS_RECONNECTING
+********************************************************************************** */
+int ResumePhysicalDevice(PhysicalDevice *device)
+{
+    uint32_t held;
+
+    if (device->status != PHYS_RECONNECTING) {
+        logMessage(HSDK_ERROR, "[PhysicalDevice]ResumePhysicalDevice", "Device is not being reconnected", HSDKThreadId());
+        return HSDK_ERROR_INVALID;
+    }
+
+    int err = device->open(device->deviceHandle, device->configurationData);
+    if (err != HSDK_ERROR_SUCCESS) {
+        return err;
+    }
+
+    device->status = PHYS_OPENED;
+
+    err = StartDeviceService(device);
+    if (err != HSDK_ERROR_SUCCESS) {
+        device->close(device->deviceHandle);
+        device->status = PHYS_RECONNECTING;
+        return err;
+    }
+
+    /* A reactor may have taken the announcements of the held frames while the device was lost. */
+    HSDKAcquireLock(device->inMessages->lock);
+    held = device->inMessages->cMessages;
+    HSDKReleaseLock(device->inMessages->lock);
+    while (held-- > 0) {
+        HSDKReleaseSemaphore(device->inMessages->sAnnounceData);
+    }
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+
+/*! *********************************************************************************
+* \brief  Fills in the statistics of a device.
+*
+* \param[in] device     pointer to the PhysicalDevice
+* \param[out] stats     the statistics of the device
+*
+* \return HSDK_ERROR_SUCCESS on success, HSDK_ERROR_INVALID for invalid arguments
+********************************************************************************** */
+int GetPhysicalDeviceStats(PhysicalDevice *device, PhysicalDeviceStats *stats)
+{
+    if (device == NULL || stats == NULL) {
+        logMessage(HSDK_ERROR, "[PhysicalDevice]GetPhysicalDeviceStats", "Physical device or stats is NULL", HSDKThreadId());
+        return HSDK_ERROR_INVALID;
+    }
+
+    memset(stats, 0, sizeof(PhysicalDeviceStats));
+
+    /* Memory owned by the device: its structures and the frames waiting to be sent. */
+    stats->heapBytes = sizeof(PhysicalDevice) + sizeof(ConfigParams) + sizeof(MessageQueue) + sizeof(EventManager);
+
+    HSDKAcquireLock(device->inMessages->lock);
+    Node *node = device->inMessages->head;
+    while (node != NULL) {
+        stats->heapBytes += sizeof(Node) + sizeof(RawFrame) + ((RawFrame *)node->data)->cbTotalSize;
+        node = node->next;
+    }
+    stats->queuedMessages = device->inMessages->cMessages;
+    HSDKReleaseLock(device->inMessages->lock);
+
+#ifdef _WIN32
+    stats->spinWaits = device->spin.waits;
+    stats->spinHits = device->spin.hits;
+    stats->rxFramesDropped = device->rxFramesDropped;
+#else
+    stats->spinWaits = __atomic_load_n(&device->spin.waits, __ATOMIC_RELAXED);
+    stats->spinHits = __atomic_load_n(&device->spin.hits, __ATOMIC_RELAXED);
+    stats->rxFramesDropped = __atomic_load_n(&device->rxFramesDropped, __ATOMIC_RELAXED);
+#endif
+
+    if (device->status != PHYS_OPENED) {
+        return HSDK_ERROR_SUCCESS;
+    }
+
+    if (device->shard != NULL) {
+        ReactorGetThreadCpuTime(device, &stats->deviceThreadCpuNs);
+    } else if (device->eventThread != INVALID_THREAD_HANDLE) {
+        HSDKGetThreadCpuTime(device->eventThread, &stats->deviceThreadCpuNs);
+        HSDKGetThreadStackSize(device->eventThread, &stats->stackBytes);
+    }
+
+    if (device->type == UART) {
+        UARTLineCounters counters;
+        if (UARTGetLineCounters(device->deviceHandle, &counters) == HSDK_ERROR_SUCCESS) {
+            stats->rxOverruns = counters.overrun;
+            stats->rxParityErrors = counters.parity;
+            stats->rxFrameErrors = counters.frame;
+            stats->rxBufferOverruns = counters.bufOverrun;
+        }
+    }
+
+#ifdef __linux__spi__
+    if (device->type == SPI) {
+        SPICounters counters;
+        if (SPIGetCounters(device->deviceHandle, &counters) == HSDK_ERROR_SUCCESS) {
+            stats->duplexFrames = counters.duplexFrames;
+            stats->pollModeSwitches = counters.modeSwitches;
+            stats->rxCrcErrors = counters.crcErrors;
+            stats->rxResyncs = counters.resyncs;
+            stats->speedHz = counters.speedHz;
+        }
+    }
+#endif
+
+#ifdef __linux__pcap__
+    if (device->type == PCAP) {
+        uint32_t stackSize = 0;
+        HSDKGetThreadCpuTime(((PCAPHandle *)device->deviceHandle)->loopThread, &stats->pcapThreadCpuNs);
+        HSDKGetThreadStackSize(((PCAPHandle *)device->deviceHandle)->loopThread, &stackSize);
+        stats->stackBytes += stackSize;
+    }
+#endif
+
+    return HSDK_ERROR_SUCCESS;
+}
+
 
 /************************************************************************************
 *************************************************************************************
@@ -658,13 +1262,13 @@ void DetachFromPhysicalDevice(void *dev, void *observer)
 static void *DeviceThreadRoutine(void *lpParameter)
 {
     PhysicalDevice *device = (PhysicalDevice *) lpParameter;
-    uint8_t *dataBuffer = (uint8_t *)calloc(RX_SIZE, sizeof(uint8_t));
     int8_t ret = 0;
-    uint32_t bytesRead;
-    int err, triggeredEvent;
-    uint8_t loop = 1;
+    int triggeredEvent, err;
+    uint8_t loop = 1, txBusy;
+    uint32_t eventCount = 3;
     void *asyncMask = NULL;
-    RawFrame *tx;
+    void *writeMask = NULL;
+    Event txWritable = NULL;
 
     Event eventArray[3];
     eventArray[0] = device->stopThread;
@@ -678,19 +1282,25 @@ static void *DeviceThreadRoutine(void *lpParameter)
     /* stop event */
     eventArray[0] = device->stopThread;
 
-    /* RX event */
+    /* RX event, registered once for as long as the thread runs */
     eventArray[1] = device->waitable(device->deviceHandle, &asyncMask);
     if (device->type == SPI) {
-        device->initialize(device->deviceHandle, spiClearBus);
-        spiClearBus = 0;
+        device->initialize(device->deviceHandle, device->clearBus);
+        device->clearBus = 0;
     }
 
-    /* TX event */
+    /* TX event, replaced by the writable event of the device while a frame is partly written */
     eventArray[2] = device->inMessages->sAnnounceData;
+    if (device->writable != NULL) {
+        txWritable = device->writable(device->deviceHandle, &writeMask);
+    }
+
+    device->spin.budgetUs = device->configParams->spinBudgetUs;
+    device->spin.spinUs = device->spin.budgetUs;
 
     while (loop) {
 
-        ret = HSDKWaitMultipleEvents(eventArray, 3, INFINITE_WAIT, &triggeredEvent);
+        ret = HSDKSpinWaitMultipleEvents(&device->spin, eventArray, eventCount, &triggeredEvent);
 
         if (ret != HSDK_ERROR_SUCCESS) {
             loop = 0;
@@ -707,57 +1317,44 @@ static void *DeviceThreadRoutine(void *lpParameter)
 #endif
                 break;
 
-            /* Case 1 - RX from the board - not used for PCAP. The handling of packets from board is made in PCAPCallback. */
+            /* Case 1 - RX from the board - not used for PCAP and USB. The handling of packets from board is made in PCAPCallback and USBReadCallback. */
             case 1:
-                bytesRead = (uint32_t)RX_SIZE;
-                err = device->read(device->deviceHandle, dataBuffer, &bytesRead);
-                if (err == HSDK_ERROR_SUCCESS && bytesRead > 0) {
-                    RawFrame *frame = CreateRxRawFrame(dataBuffer, bytesRead);
-                    if (device->configParams->fsciRxAck) {
-                        /* Prevent other TXs until we send back the ACK. */
-                        HSDKAcquireLock(device->inMessages->lock);
-                    }
-                    NotifyOnSameEvent(device->evtManager, frame, (void *(*)(void *))CloneRawFrame);
-                    DestroyRawFrame(frame);
+                err = ServicePhysicalDeviceRx(device);
+                if (err != HSDK_ERROR_SUCCESS && err != HSDK_ERROR_ALLOC) {
+                    FailPhysicalDevice(device);
+                    break;
                 }
 
+#ifdef _WIN32
+                /* The overlapped WaitCommEvent completes once and must be armed again. */
                 if (device->type != SPI) {
                     HSDKFinishTriggerableEvent(asyncMask);
                     eventArray[1] = device->waitable(device->deviceHandle, &asyncMask);
                 }
-
-                memset(dataBuffer, 0, RX_SIZE);
+#endif
                 break;
 
             case 2:
-                tx = (RawFrame *)MessageQueueGet(device->inMessages);
-                if (tx != NULL) {
-                    int err = device->write(device->deviceHandle, tx->aRawData, tx->cbTotalSize);
-
-                    if (device->configParams->fsciTxAck) {
-                        /* Do not cascade ACKs. */
-                        if ( tx->aRawData[1] != 0xA4 ||
-                             tx->aRawData[2] != 0xFD ) {
-                            CheckFSCIAck(device, tx);
-                        }
-                    }
-
-                    DestroyRawFrame(tx);
-                    if (err < 0) {
-                        device->status = PHYS_ERROR;
-                    }
-                }
+                txBusy = (ServicePhysicalDeviceTx(device) == HSDK_ERROR_BUSY);
 #if defined(__linux__) || defined(__APPLE__)
                 HSDKResetEvent(eventArray[2]);
 #endif
+                eventArray[2] = (txBusy && txWritable != NULL) ? txWritable : device->inMessages->sAnnounceData;
+        }
+
+        /* A lost device is left alone, the thread only waits to be stopped. */
+        if (device->status == PHYS_LOST) {
+            eventCount = 1;
         }
     }
 
+    if (writeMask != NULL) {
+        HSDKFinishTriggerableEvent(writeMask);
+    }
     HSDKResetEvent(device->stopThread);
 
 threadFinishLabel:
     ret = 0;
-    free(dataBuffer);
 #ifdef _WIN32
     HSDKFinishTriggerableEvent(asyncMask);
 #endif
@@ -766,6 +1363,30 @@ threadFinishLabel:
 }
 
 
+/*! *********************************************************************************
+* \brief  Names the threads of a device after the device, e.g. dev-ttyACM0, so that
+* they can be told apart in top and perf.
+*
+* \param[in,out] params    the configuration parameters holding the thread attributes
+* \param[in] deviceName    the name of the device
+*
+* \return None
+********************************************************************************** */
+static void SetThreadNames(ConfigParams *params, char *deviceName)
+{
+    char *baseName = "";
+
+    if (deviceName != NULL) {
+        baseName = strrchr(deviceName, '/');
+        baseName = (baseName != NULL) ? baseName + 1 : deviceName;
+    }
+
+    snprintf(params->deviceThread.name, HSDK_THREAD_NAME_SIZE, "dev-%s", baseName);
+    snprintf(params->framerThread.name, HSDK_THREAD_NAME_SIZE, "frm-%s", baseName);
+    snprintf(params->pcapThread.name, HSDK_THREAD_NAME_SIZE, "pcap-%s", baseName);
+    snprintf(params->usbThread.name, HSDK_THREAD_NAME_SIZE, "usb-%s", baseName);
+}
+
 static int AttachToConcreteImplementation(PhysicalDevice *device, char *deviceName)
 {
     switch (device->type) {
@@ -777,6 +1398,11 @@ static int AttachToConcreteImplementation(PhysicalDevice *device, char *deviceNa
             AttachToPCAPDevice(device, deviceName);
             break;
 #endif
+#ifdef __linux__libusb__
+        case USB:
+            AttachToUSBDevice(device, deviceName);
+            break;
+#endif
 #ifdef __linux__spi__
         case SPI:
             AttachToSPIDevice(device, deviceName);
@@ -806,6 +1432,11 @@ static int DetachFromConcreteImplementation(PhysicalDevice *device)
             DetachFromPCAPDevice(device);
             break;
 #endif
+#ifdef __linux__libusb__
+        case USB:
+            DetachFromUSBDevice(device);
+            break;
+#endif
 #ifdef __linux__spi__
         case SPI:
             DetachFromSPIDevice(device);
@@ -0,0 +1,1474 @@
+/*! *********************************************************************************
+* \file PhysicalDeviceManager.c
+* This is a source file which multiplexes many physical devices on a pool of reactor threads.
+*
+* Copyright 2013-2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************** */
+
+/************************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "IoUring.h"
+#include "MemoryPool.h"
+#include "PhysicalDevice.h"
+#include "PhysicalDeviceManager.h"
+#include "RawFrame.h"
+
+#include "hsdkError.h"
+#include "hsdkLogger.h"
+#include "hsdkTrace.h"
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+/* Number of device slots allocated at once in the manager and in a shard. */
+#define SLOT_CHUNK 8
+
+/* Descriptors polled by a shard before the per-device ones: stop and wakeup. */
+#define SHARD_FIXED_FDS 2
+
+/*
+ * The user data of an io_uring request holds the operation in its low bits and the
+ * index of the device record above them; shard requests use index 0 (stop) and 1 (wakeup).
+ */
+#define URING_OP_SHARD      0
+#define URING_OP_RX         1
+#define URING_OP_TX         2
+#define URING_OP_WRITE      3
+#define URING_OP_ACK        4
+#define URING_OP_TIMEOUT    5
+#define URING_OP_CANCEL     6
+#define URING_OP_BITS       3
+#define URING_OP_MASK       ((1 << URING_OP_BITS) - 1)
+#define URING_USER_DATA(index, op) (((uint64_t)(index) << URING_OP_BITS) | (op))
+
+/* Buffer group of the RX buffers of a shard. */
+#define URING_RX_GROUP      0
+
+/* Size of the FSCI ACK frame with a 2-byte length field. */
+#define URING_ACK_MAX       7
+
+/************************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+************************************************************************************/
+/**
+ * @brief A device serviced by a reactor shard.
+ */
+typedef struct {
+    PhysicalDevice *device;     /**< The serviced device. */
+    Event rxEvent;              /**< RX waitable of the device, NULL if the device handles RX by itself (PCAP, USB). */
+    void *asyncMask;            /**< Helper returned together with rxEvent. */
+    Event txWritable;           /**< Polled instead of the TX semaphore while a frame of the device is partly written, NULL if the device writes blocking. */
+    void *writeMask;            /**< Helper returned together with txWritable. */
+    uint8_t rxFailed;           /**< Set when the RX descriptor reported an error; it is no longer polled. */
+    Event detached;             /**< Set by ReactorDetachDevice on io_uring shards, signaled once the reactor let go of the device. */
+    void *uring;                /**< Requests of the device on the io_uring of the shard, owned by the reactor thread. */
+} ReactorSlot;
+
+/**
+ * @brief A reactor thread together with the devices pinned to it.
+ */
+typedef struct {
+    Thread thread;              /**< The reactor thread. */
+    Event stopThread;           /**< Signals the reactor thread to exit. */
+    Event wakeup;               /**< Signals the reactor thread that the set of devices has changed. */
+    Lock lock;                  /**< Protects the slots and busy. */
+    Lock serviceLock;           /**< Held by the reactor thread while it services busy, without lock. */
+    PhysicalDevice *busy;       /**< The device being serviced by the poll() reactor, NULL if none. */
+    ReactorSlot *slots;         /**< Devices currently attached to the shard. */
+    uint32_t slotCount;         /**< Number of attached devices. */
+    uint32_t slotCapacity;      /**< Number of entries allocated in slots. */
+    uint32_t generation;        /**< Incremented every time the set of devices changes. */
+    uint32_t deviceCount;       /**< Number of devices pinned to the shard, opened or not. */
+#ifdef __linux__uring__
+    IoUring *uring;             /**< The io_uring servicing the devices, NULL if the shard polls. */
+    IoUringBufferRing *rxBuffers; /**< Buffers of the multishot reads, NULL if the kernel lacks them. */
+    uint64_t shardEvents[2];    /**< Counters read from stopThread and wakeup through the io_uring. */
+#endif
+} ReactorShard;
+
+#ifdef __linux__uring__
+/**
+ * @brief Requests in flight for a device on the io_uring of a shard. Owned by the
+ * reactor thread; the kernel writes into txAnnounce and ack until they complete.
+ */
+typedef struct {
+    PhysicalDevice *device;     /**< The serviced device. */
+    uint32_t index;             /**< Index of the record, part of the user data of its requests. */
+    int portFd;                 /**< RX descriptor, also written to by UART devices; -1 for PCAP and USB. */
+    int txFd;                   /**< The TX semaphore of the device. */
+    uint8_t rxRead;             /**< RX is a multishot read into the shard buffers, a multishot poll otherwise. */
+    uint8_t asyncWrite;         /**< Frames are written through the io_uring, otherwise by ServicePhysicalDeviceTx. */
+    uint8_t rxFailed;           /**< The RX descriptor reported an error; RX is no longer armed. */
+    uint8_t rxDeferred;         /**< RX was reported while an ACK was awaited. */
+    uint8_t detached;           /**< The device is leaving the shard; its requests are cancelled. */
+    uint8_t awaitAck;           /**< The frame being written waits for an FSCI ACK. */
+    uint8_t retriesLeft;        /**< Writes of the frame left after an ACK timeout. */
+    uint8_t ackLength;          /**< Size of the FSCI ACK of the device. */
+    uint32_t inFlight;          /**< Requests not completed yet; a detached record is freed at 0. */
+    uint32_t txPending;         /**< Frames announced on the TX semaphore and not taken from the queue yet. */
+    uint32_t chainPending;      /**< Completions of the write chain still expected. */
+    RawFrame *tx;               /**< Frame being written, NULL if none. */
+    uint32_t txOffset;          /**< Bytes of tx written so far. */
+    struct iovec txIov[RAW_FRAME_SEGMENTS]; /**< Segments of tx left after txOffset, read by the kernel until the write completes. */
+    int writeResult;            /**< Result of the last write of the chain. */
+    int ackResult;              /**< Result of the ACK read of the chain. */
+    uint64_t txAnnounce;        /**< Counter read from the TX semaphore. */
+    uint8_t ack[URING_ACK_MAX]; /**< The ACK read after a write. */
+    struct __kernel_timespec ackTimeout; /**< Time to wait for the ACK. */
+} UringDevice;
+#endif
+
+/**
+ * @brief Work item of a thread opening the devices of a shard.
+ */
+typedef struct {
+    PhysicalDeviceManager *manager; /**< The manager owning the devices. */
+    void *shard;                    /**< The shard whose devices are opened. */
+    int result;                     /**< HSDK_ERROR_SUCCESS if all the devices were opened. */
+} OpenerJob;
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+static void *OpenerThreadRoutine(void *lpParameter);
+#ifdef __linux__
+static ReactorShard *CreateReactorShard(ThreadAttributes *attributes, ConfigParams *params);
+static void DestroyReactorShard(ReactorShard *shard);
+static void *ReactorThreadRoutine(void *lpParameter);
+static void ReleaseSlotEvents(ReactorSlot *slot);
+#endif
+#ifdef __linux__uring__
+static int ReactorUringRoutine(ReactorShard *shard);
+static int UringSyncDevices(ReactorShard *shard, UringDevice ***records, uint32_t *recordCapacity, uint32_t *liveRecords);
+static int UringArmRx(ReactorShard *shard, UringDevice *record);
+static int UringArmTx(ReactorShard *shard, UringDevice *record);
+static void UringCancelDevice(ReactorShard *shard, UringDevice *record);
+static int UringRetireDevice(ReactorShard *shard, UringDevice *record);
+static void UringCompleteRx(ReactorShard *shard, UringDevice *record, int res, uint32_t flags);
+static void UringStartTx(ReactorShard *shard, UringDevice *record);
+static int UringSubmitWrite(ReactorShard *shard, UringDevice *record);
+static void UringFinishWrite(ReactorShard *shard, UringDevice *record);
+#endif
+
+/************************************************************************************
+*************************************************************************************
+* Public memory declarations
+*************************************************************************************
+************************************************************************************/
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief    Creates a manager for multiple physical devices and starts its reactor
+*           threads. Devices added to the manager are serviced by the reactor threads
+*           instead of a thread of their own.
+*
+* \param[in] shardCount     number of reactor threads; 0 for one per online CPU
+*
+* \return pointer to the manager, NULL on failure
+********************************************************************************** */
+PhysicalDeviceManager *InitPhysicalDeviceManager(uint32_t shardCount)
+{
+    initLogger(NULL);
+
+    PhysicalDeviceManager *manager = (PhysicalDeviceManager *)calloc(1, sizeof(PhysicalDeviceManager));
+    if (manager == NULL) {
+        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]InitPhysicalDeviceManager", "Memory allocation failed", HSDKThreadId());
+        return NULL;
+    }
+
+#ifdef __linux__
+    if (shardCount == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        shardCount = (cpus > 0) ? (uint32_t)cpus : 1;
+    }
+
+    manager->shards = (void **)calloc(shardCount, sizeof(void *));
+    if (manager->shards == NULL) {
+        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]InitPhysicalDeviceManager", "Memory allocation failed", HSDKThreadId());
+        free(manager);
+        return NULL;
+    }
+
+    /* The shards take over the role of the device threads and use their attributes. */
+    ConfigParams *params = ParseConfig();
+    ThreadAttributes attributes = params->deviceThread;
+
+    for (manager->shardCount = 0; manager->shardCount < shardCount; manager->shardCount++) {
+        snprintf(attributes.name, HSDK_THREAD_NAME_SIZE, "shard%u", manager->shardCount);
+        manager->shards[manager->shardCount] = CreateReactorShard(&attributes, params);
+        if (manager->shards[manager->shardCount] == NULL) {
+            logMessage(HSDK_ERROR, "[PhysicalDeviceManager]InitPhysicalDeviceManager", "Reactor shard creation failed", HSDKThreadId());
+            free(params);
+            DestroyPhysicalDeviceManager(manager);
+            return NULL;
+        }
+    }
+    free(params);
+#else
+    /* No reactor on this platform, every device keeps its own thread. */
+    (void)shardCount;
+#endif
+
+    return manager;
+}
+
+/*! *********************************************************************************
+* \brief    Closes and destroys all the devices of the manager, stops the reactor
+*           threads and frees the manager.
+*
+* \param[in] manager    pointer to the manager
+*
+* \return HSDK_ERROR_SUCCESS on success, an error code otherwise
+********************************************************************************** */
+int DestroyPhysicalDeviceManager(PhysicalDeviceManager *manager)
+{
+    uint32_t i;
+    int err, ret = HSDK_ERROR_SUCCESS;
+
+    if (manager == NULL) {
+        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]DestroyPhysicalDeviceManager", "Manager is NULL", HSDKThreadId());
+        return HSDK_ERROR_INVALID;
+    }
+
+    for (i = 0; i < manager->deviceCount; i++) {
+        err = DestroyPhysicalDevice(manager->devices[i]);
+        if (err != HSDK_ERROR_SUCCESS) {
+            ret = err;
+        }
+    }
+    free(manager->devices);
+
+#ifdef __linux__
+    for (i = 0; i < manager->shardCount; i++) {
+        DestroyReactorShard((ReactorShard *)manager->shards[i]);
+    }
+#endif
+    free(manager->shards);
+    free(manager);
+
+    return ret;
+}
+
+/*! *********************************************************************************
+* \brief    Creates a physical device owned by the manager and pins it to a reactor
+*           shard. The shards are filled in round-robin order.
+*
+* \param[in] manager        pointer to the manager
+* \param[in] type           identifier for the device
+* \param[in] pConfigData    pointer to a structure containing configuration data
+* \param[in] deviceName     a string containing the name to identify the device
+* \param[in] policy         the policy for FSCI ACK synchronization
+*
+* \return pointer to the new device, NULL on failure
+********************************************************************************** */
+PhysicalDevice *AddToPhysicalDeviceManager(PhysicalDeviceManager *manager, DeviceType type, void *pConfigData, char *deviceName, FsciAckPolicy policy)
+{
+    if (manager == NULL) {
+        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]AddToPhysicalDeviceManager", "Manager is NULL", HSDKThreadId());
+        return NULL;
+    }
+
+    if (manager->deviceCount == manager->deviceCapacity) {
+        PhysicalDevice **devices = (PhysicalDevice **)realloc(manager->devices, (manager->deviceCapacity + SLOT_CHUNK) * sizeof(PhysicalDevice *));
+        if (devices == NULL) {
+            logMessage(HSDK_ERROR, "[PhysicalDeviceManager]AddToPhysicalDeviceManager", "Memory allocation failed", HSDKThreadId());
+            return NULL;
+        }
+        manager->devices = devices;
+        manager->deviceCapacity += SLOT_CHUNK;
+    }
+
+    PhysicalDevice *device = InitPhysicalDevice(type, pConfigData, deviceName, policy);
+    if (device == NULL) {
+        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]AddToPhysicalDeviceManager", "Physical device creation failed", HSDKThreadId());
+        return NULL;
+    }
+
+#ifdef __linux__
+    if (manager->shardCount > 0) {
+        ReactorShard *shard = (ReactorShard *)manager->shards[manager->deviceCount % manager->shardCount];
+        shard->deviceCount++;
+        device->shard = shard;
+    }
+#endif
+
+    manager->devices[manager->deviceCount++] = device;
+
+    return device;
+}
+
+/*! *********************************************************************************
+* \brief    Opens all the closed devices of the manager. The devices of different
+*           shards are opened in parallel, one opener thread per shard.
+*
+* \param[in] manager    pointer to the manager
+*
+* \return HSDK_ERROR_SUCCESS if all the devices were opened, an error code otherwise
+********************************************************************************** */
+int OpenAllPhysicalDevices(PhysicalDeviceManager *manager)
+{
+    uint32_t i, jobCount;
+    int ret = HSDK_ERROR_SUCCESS;
+
+    if (manager == NULL) {
+        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]OpenAllPhysicalDevices", "Manager is NULL", HSDKThreadId());
+        return HSDK_ERROR_INVALID;
+    }
+
+    /* Without shards a single job opens every device. */
+    jobCount = (manager->shardCount > 0) ? manager->shardCount : 1;
+
+    OpenerJob *jobs = (OpenerJob *)calloc(jobCount, sizeof(OpenerJob));
+    Thread *threads = (Thread *)calloc(jobCount, sizeof(Thread));
+    if (jobs == NULL || threads == NULL) {
+        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]OpenAllPhysicalDevices", "Memory allocation failed", HSDKThreadId());
+        free(jobs);
+        free(threads);
+        return HSDK_ERROR_ALLOC;
+    }
+
+    for (i = 0; i < jobCount; i++) {
+        jobs[i].manager = manager;
+        jobs[i].shard = (manager->shardCount > 0) ? manager->shards[i] : NULL;
+        threads[i] = HSDKCreateThread(OpenerThreadRoutine, &jobs[i]);
+        if (threads[i] == INVALID_THREAD_HANDLE) {
+            /* Open this share of the devices on the calling thread instead. */
+            OpenerThreadRoutine(&jobs[i]);
+        }
+    }
+
+    for (i = 0; i < jobCount; i++) {
+        if (threads[i] != INVALID_THREAD_HANDLE) {
+            HSDKDestroyThread(threads[i]);
+        }
+        if (jobs[i].result != HSDK_ERROR_SUCCESS) {
+            ret = jobs[i].result;
+        }
+    }
+
+    free(jobs);
+    free(threads);
+
+    return ret;
+}
+
+/*! *********************************************************************************
+* \brief    Closes all the opened devices of the manager.
+*
+* \param[in] manager    pointer to the manager
+*
+* \return HSDK_ERROR_SUCCESS if all the devices were closed, an error code otherwise
+********************************************************************************** */
+int CloseAllPhysicalDevices(PhysicalDeviceManager *manager)
+{
+    uint32_t i;
+    int err, ret = HSDK_ERROR_SUCCESS;
+
+    if (manager == NULL) {
+        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]CloseAllPhysicalDevices", "Manager is NULL", HSDKThreadId());
+        return HSDK_ERROR_INVALID;
+    }
+
+    for (i = 0; i < manager->deviceCount; i++) {
+        if (manager->devices[i]->status == PHYS_CLOSED || manager->devices[i]->status == PHYS_ERROR) {
+            continue;
+        }
+
+        err = ClosePhysicalDevice(manager->devices[i]);
+        if (err != HSDK_ERROR_SUCCESS) {
+            ret = err;
+        }
+    }
+
+    return ret;
+}
+
+/*! *********************************************************************************
+* \brief    Starts servicing an opened device on the reactor shard it is pinned to.
+*           Called by OpenPhysicalDevice for devices owned by a manager.
+*
+* \param[in] device     pointer to the opened device
+*
+* \return HSDK_ERROR_SUCCESS on success, an error code otherwise
+********************************************************************************** */
+int ReactorAttachDevice(PhysicalDevice *device)
+{
+#ifdef __linux__
+    ReactorShard *shard = (ReactorShard *)device->shard;
+    ReactorSlot slot;
+
+    memset(&slot, 0, sizeof(ReactorSlot));
+    slot.device = device;
+
+    /* PCAP and USB handle RX in threads of their own, only TX goes through the shard. */
+    if (device->type != PCAP && device->type != USB) {
+        slot.rxEvent = device->waitable(device->deviceHandle, &slot.asyncMask);
+        if (slot.rxEvent == INVALID_EVENT_HANDLE) {
+            logMessage(HSDK_ERROR, "[PhysicalDeviceManager]ReactorAttachDevice", "Device has no RX event", HSDKThreadId());
+            return HSDK_ERROR_INVALID;
+        }
+    }
+
+    if (device->writable != NULL) {
+        slot.txWritable = device->writable(device->deviceHandle, &slot.writeMask);
+    }
+
+    HSDKAcquireLock(shard->lock);
+
+    if (shard->slotCount == shard->slotCapacity) {
+        ReactorSlot *slots = (ReactorSlot *)realloc(shard->slots, (shard->slotCapacity + SLOT_CHUNK) * sizeof(ReactorSlot));
+        if (slots == NULL) {
+            HSDKReleaseLock(shard->lock);
+            logMessage(HSDK_ERROR, "[PhysicalDeviceManager]ReactorAttachDevice", "Memory allocation failed", HSDKThreadId());
+            ReleaseSlotEvents(&slot);
+            return HSDK_ERROR_ALLOC;
+        }
+        shard->slots = slots;
+        shard->slotCapacity += SLOT_CHUNK;
+    }
+
+    if (device->type == SPI) {
+        device->initialize(device->deviceHandle, device->clearBus);
+        device->clearBus = 0;
+    }
+
+    shard->slots[shard->slotCount++] = slot;
+    shard->generation++;
+
+    HSDKReleaseLock(shard->lock);
+    HSDKSignalEvent(shard->wakeup);
+
+    return HSDK_ERROR_SUCCESS;
+#else
+    (void)device;
+    return HSDK_ERROR_INVALID;
+#endif
+}
+
+/*! *********************************************************************************
+* \brief    Stops servicing a device on its reactor shard. When the function returns
+*           the reactor thread no longer touches the device. Must not be called from
+*           a callback running on the reactor thread.
+*
+* \param[in] device     pointer to the opened device
+*
+* \return HSDK_ERROR_SUCCESS on success, HSDK_ERROR_INVALID if the device is not attached
+********************************************************************************** */
+int ReactorDetachDevice(PhysicalDevice *device)
+{
+#ifdef __linux__
+    ReactorShard *shard = (ReactorShard *)device->shard;
+    uint32_t i;
+
+    HSDKAcquireLock(shard->lock);
+
+    for (i = 0; i < shard->slotCount; i++) {
+        if (shard->slots[i].device == device) {
+            break;
+        }
+    }
+
+    if (i == shard->slotCount || shard->slots[i].detached != NULL) {
+        HSDKReleaseLock(shard->lock);
+        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]ReactorDetachDevice", "Device is not attached to its shard", HSDKThreadId());
+        return HSDK_ERROR_INVALID;
+    }
+
+#ifdef __linux__uring__
+    /* The kernel holds requests on the device: the reactor cancels them and removes the slot. */
+    if (shard->uring != NULL) {
+        Event detached = HSDKCreateEvent(0);
+        if (detached == INVALID_EVENT_HANDLE) {
+            HSDKReleaseLock(shard->lock);
+            logMessage(HSDK_ERROR, "[PhysicalDeviceManager]ReactorDetachDevice", "Event creation failed", HSDKThreadId());
+            return HSDK_ERROR_ALLOC;
+        }
+
+        shard->slots[i].detached = detached;
+        shard->generation++;
+
+        HSDKReleaseLock(shard->lock);
+        HSDKSignalEvent(shard->wakeup);
+
+        HSDKWaitEvent(detached, INFINITE_WAIT);
+        HSDKDestroyEvent(detached);
+
+        return HSDK_ERROR_SUCCESS;
+    }
+#endif
+
+    ReactorSlot slot = shard->slots[i];
+    uint8_t busy = (shard->busy == device);
+
+    shard->slots[i] = shard->slots[--shard->slotCount];
+    shard->generation++;
+
+    HSDKReleaseLock(shard->lock);
+    HSDKSignalEvent(shard->wakeup);
+
+    /* The device is serviced without the shard lock: wait for the reactor to let go of it. */
+    if (busy) {
+        HSDKAcquireLock(shard->serviceLock);
+        HSDKReleaseLock(shard->serviceLock);
+    }
+    ReleaseSlotEvents(&slot);
+
+    return HSDK_ERROR_SUCCESS;
+#else
+    (void)device;
+    return HSDK_ERROR_INVALID;
+#endif
+}
+
+/*! *********************************************************************************
+* \brief    Returns the CPU time consumed by the reactor thread servicing a device.
+*
+* \param[in] device         pointer to a device owned by a manager
+* \param[out] nanoseconds   the CPU time consumed, in nanoseconds
+*
+* \return HSDK_ERROR_SUCCESS on success, an error code otherwise
+********************************************************************************** */
+int ReactorGetThreadCpuTime(PhysicalDevice *device, uint64_t *nanoseconds)
+{
+#ifdef __linux__
+    return HSDKGetThreadCpuTime(((ReactorShard *)device->shard)->thread, nanoseconds);
+#else
+    (void)device;
+    *nanoseconds = 0;
+    return HSDK_ERROR_INVALID;
+#endif
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Opens, one after the other, the closed devices pinned to a shard.
+*
+* \param[in] lpParameter    pointer to an OpenerJob
+*
+* \return None
+********************************************************************************** */
+static void *OpenerThreadRoutine(void *lpParameter)
+{
+    OpenerJob *job = (OpenerJob *)lpParameter;
+    uint32_t i;
+    int err;
+
+    job->result = HSDK_ERROR_SUCCESS;
+
+    for (i = 0; i < job->manager->deviceCount; i++) {
+        PhysicalDevice *device = job->manager->devices[i];
+        if (device->shard != job->shard || device->status != PHYS_CLOSED) {
+            continue;
+        }
+
+        err = OpenPhysicalDevice(device);
+        if (err != HSDK_ERROR_SUCCESS) {
+            logMessage(HSDK_ERROR, "[PhysicalDeviceManager]OpenerThreadRoutine", "Failed to open device", HSDKThreadId());
+            job->result = err;
+        }
+    }
+
+    return NULL;
+}
+
+#ifdef __linux__
+static ReactorShard *CreateReactorShard(ThreadAttributes *attributes, ConfigParams *params)
+{
+    ReactorShard *shard = (ReactorShard *)calloc(1, sizeof(ReactorShard));
+    if (shard == NULL) {
+        return NULL;
+    }
+
+    shard->thread = INVALID_THREAD_HANDLE;
+    shard->stopThread = HSDKCreateEvent(0);
+    shard->wakeup = HSDKCreateEvent(0);
+    shard->lock = HSDKCreateLock();
+    shard->serviceLock = HSDKCreateLock();
+
+    if (shard->stopThread == INVALID_EVENT_HANDLE || shard->wakeup == INVALID_EVENT_HANDLE) {
+        DestroyReactorShard(shard);
+        return NULL;
+    }
+
+#ifdef __linux__uring__
+    /* Kernels without io_uring, or too old for it, keep the poll() reactor. */
+    if (params->ioUring) {
+        shard->uring = IoUringCreate(params->ioUringEntries);
+        if (shard->uring == NULL) {
+            logMessage(HSDK_WARNING, "[PhysicalDeviceManager]CreateReactorShard", "io_uring not available, using poll", HSDKThreadId());
+        } else if (shard->uring->readMultishot) {
+            uint32_t bufferSize = params->linkMtu ? params->linkMtu + PHYS_FRAMING_OVERHEAD : PHYS_RX_SIZE;
+            shard->rxBuffers = IoUringCreateBufferRing(shard->uring, URING_RX_GROUP, params->ioUringBuffers, bufferSize);
+        }
+    }
+#else
+    (void)params;
+#endif
+
+    shard->thread = HSDKCreateThreadWithAttributes(ReactorThreadRoutine, shard, attributes);
+    if (shard->thread == INVALID_THREAD_HANDLE) {
+        DestroyReactorShard(shard);
+        return NULL;
+    }
+
+    return shard;
+}
+
+static void DestroyReactorShard(ReactorShard *shard)
+{
+    if (shard == NULL) {
+        return;
+    }
+
+    if (shard->thread != INVALID_THREAD_HANDLE) {
+        HSDKSignalEvent(shard->stopThread);
+        HSDKDestroyThread(shard->thread);
+    }
+
+    if (shard->stopThread != INVALID_EVENT_HANDLE) {
+        HSDKDestroyEvent(shard->stopThread);
+    }
+    if (shard->wakeup != INVALID_EVENT_HANDLE) {
+        HSDKDestroyEvent(shard->wakeup);
+    }
+    HSDKDestroyLock(shard->lock);
+    HSDKDestroyLock(shard->serviceLock);
+
+#ifdef __linux__uring__
+    if (shard->uring != NULL) {
+        IoUringDestroyBufferRing(shard->uring, shard->rxBuffers);
+        IoUringDestroy(shard->uring);
+    }
+#endif
+
+    free(shard->slots);
+    free(shard);
+}
+
+/*! *********************************************************************************
+* \brief  Releases the helpers of the RX and writable events of a device slot.
+*
+* \param[in] slot     the slot of the device
+*
+* \return None
+********************************************************************************** */
+static void ReleaseSlotEvents(ReactorSlot *slot)
+{
+    if (slot->asyncMask != NULL) {
+        HSDKFinishTriggerableEvent(slot->asyncMask);
+        slot->asyncMask = NULL;
+    }
+    if (slot->writeMask != NULL) {
+        HSDKFinishTriggerableEvent(slot->writeMask);
+        slot->writeMask = NULL;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Reactor thread function. Polls the stop and wakeup events together with the
+* RX and TX events of every device attached to the shard and services all the ready
+* ones. The poll set is rebuilt whenever the set of devices changes. Shards with an
+* io_uring run ReactorUringRoutine instead, and come back here if it fails.
+*
+* \param[in] lpParameter    pointer to a ReactorShard
+*
+* \return None
+********************************************************************************** */
+static void *ReactorThreadRoutine(void *lpParameter)
+{
+    ReactorShard *shard = (ReactorShard *)lpParameter;
+    struct pollfd *pfds = NULL;
+    uint32_t pfdCapacity = 0, nfds, generation, i, j;
+    uint8_t loop = 1, rxFailed;
+    PhysicalDevice *device;
+    int rc;
+
+#ifdef __linux__uring__
+    if (shard->uring != NULL && ReactorUringRoutine(shard) == HSDK_ERROR_SUCCESS) {
+        return NULL;
+    }
+#endif
+
+    while (loop) {
+        /* Snapshot the devices of the shard into the poll set. */
+        HSDKAcquireLock(shard->lock);
+
+        /* Devices detached while the shard ran on io_uring. */
+        for (i = shard->slotCount; i > 0; i--) {
+            if (shard->slots[i - 1].detached != NULL) {
+                ReleaseSlotEvents(&shard->slots[i - 1]);
+                HSDKSignalEvent(shard->slots[i - 1].detached);
+                shard->slots[i - 1] = shard->slots[--shard->slotCount];
+                shard->generation++;
+            }
+        }
+
+        generation = shard->generation;
+        nfds = SHARD_FIXED_FDS + 2 * shard->slotCount;
+        if (nfds > pfdCapacity) {
+            struct pollfd *tmp = (struct pollfd *)realloc(pfds, nfds * sizeof(struct pollfd));
+            if (tmp == NULL) {
+                HSDKReleaseLock(shard->lock);
+                logMessage(HSDK_ERROR, "[PhysicalDeviceManager]ReactorThreadRoutine", "Memory allocation failed", HSDKThreadId());
+                break;
+            }
+            pfds = tmp;
+            pfdCapacity = nfds;
+        }
+
+        pfds[0].fd = HSDKEventFile(shard->stopThread);
+        pfds[1].fd = HSDKEventFile(shard->wakeup);
+        for (i = 0; i < nfds; i++) {
+            pfds[i].events = POLLIN;
+            pfds[i].revents = 0;
+        }
+        for (i = 0; i < shard->slotCount; i++) {
+            ReactorSlot *slot = &shard->slots[i];
+            pfds[SHARD_FIXED_FDS + 2 * i].fd = (slot->rxEvent != NULL && !slot->rxFailed) ? slot->rxEvent->event : -1;
+            /* A partly written frame holds back the queue until the device drains. */
+            if (slot->device->txFrame != NULL && slot->txWritable != NULL) {
+                pfds[SHARD_FIXED_FDS + 2 * i + 1].fd = slot->txWritable->event;
+                pfds[SHARD_FIXED_FDS + 2 * i + 1].events = POLLOUT;
+            } else {
+                pfds[SHARD_FIXED_FDS + 2 * i + 1].fd = HSDKEventFile(slot->device->inMessages->sAnnounceData);
+            }
+        }
+
+        HSDKReleaseLock(shard->lock);
+
+        rc = poll(pfds, nfds, -1);
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            logMessage(HSDK_ERROR, "[PhysicalDeviceManager]ReactorThreadRoutine poll", strerror(errno), HSDKThreadId());
+            break;
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            HSDKResetEvent(shard->stopThread);
+            loop = 0;
+            continue;
+        }
+
+        if (pfds[1].revents & POLLIN) {
+            HSDKResetEvent(shard->wakeup);
+        }
+
+        /*
+         * Each ready device is serviced without the shard lock, so that a device waiting
+         * for an FSCI ACK holds back neither attach nor detach. The others of the shard
+         * still wait for it.
+         */
+        for (i = 0; SHARD_FIXED_FDS + 2 * i < nfds; i++) {
+            short rxEvents = pfds[SHARD_FIXED_FDS + 2 * i].revents;
+            struct pollfd *txPfd = &pfds[SHARD_FIXED_FDS + 2 * i + 1];
+            uint8_t txReady = (txPfd->events & POLLOUT) ? ((txPfd->revents & (POLLOUT | POLLERR | POLLHUP)) != 0) :
+                              ((txPfd->revents & POLLIN) != 0);
+
+            if (!(rxEvents & (POLLIN | POLLERR | POLLHUP | POLLNVAL)) && !txReady) {
+                continue;
+            }
+
+            HSDKAcquireLock(shard->lock);
+            /* The poll set is stale if a device was attached or detached meanwhile. */
+            if (generation != shard->generation) {
+                HSDKReleaseLock(shard->lock);
+                break;
+            }
+            device = shard->slots[i].device;
+            HSDKAcquireLock(shard->serviceLock);
+            shard->busy = device;
+            HSDKReleaseLock(shard->lock);
+
+            rxFailed = 0;
+            if (rxEvents & (POLLERR | POLLHUP | POLLNVAL)) {
+                logMessage(HSDK_ERROR, "[PhysicalDeviceManager]ReactorThreadRoutine", "RX descriptor errored, no longer polled", HSDKThreadId());
+                rxFailed = 1;
+                FailPhysicalDevice(device);
+            } else if (rxEvents & POLLIN) {
+                int err = ServicePhysicalDeviceRx(device);
+                if (err != HSDK_ERROR_SUCCESS && err != HSDK_ERROR_ALLOC) {
+                    rxFailed = 1;
+                    FailPhysicalDevice(device);
+                }
+            }
+
+            if (txReady) {
+                ServicePhysicalDeviceTx(device);
+                if (!(txPfd->events & POLLOUT)) {
+                    HSDKResetEvent(device->inMessages->sAnnounceData);
+                }
+            }
+
+            HSDKReleaseLock(shard->serviceLock);
+            HSDKAcquireLock(shard->lock);
+            shard->busy = NULL;
+            for (j = 0; rxFailed && j < shard->slotCount; j++) {
+                if (shard->slots[j].device == device) {
+                    shard->slots[j].rxFailed = 1;
+                }
+            }
+            HSDKReleaseLock(shard->lock);
+        }
+    }
+
+    free(pfds);
+
+    return NULL;
+}
+#endif
+
+#ifdef __linux__uring__
+/*! *********************************************************************************
+* \brief  Reactor loop of a shard with an io_uring. The RX descriptors are serviced by
+* multishot reads into the registered buffers of the shard (multishot polls where the
+* kernel or the device does not allow them), the TX semaphores by reads of the
+* eventfd, and UART frames are written by linked write, ACK read and timeout requests.
+* The requests prepared for all the devices of the shard are submitted together with
+* the wait for the next completions, in a single system call.
+*
+* \param[in] shard    pointer to the ReactorShard
+*
+* \return HSDK_ERROR_SUCCESS when the shard was stopped, an error code if the io_uring
+*         failed and the shard must fall back to poll()
+********************************************************************************** */
+static int ReactorUringRoutine(ReactorShard *shard)
+{
+    IoUring *ring = shard->uring;
+    struct io_uring_cqe *cqe;
+    struct io_uring_sqe *sqe;
+    UringDevice **records = NULL;
+    uint32_t recordCapacity = 0, liveRecords = 0, shardInFlight = 0, generation, i;
+    uint8_t loop = 1, sweep = 0, changed;
+    int rc, ret = HSDK_ERROR_SUCCESS;
+
+    if (IoUringReserve(ring, 2) != HSDK_ERROR_SUCCESS) {
+        return HSDK_ERROR_BUSY;
+    }
+    for (i = 0; i < 2; i++) {
+        sqe = IoUringGetSqe(ring);
+        IoUringPrepRead(sqe, (i == 0) ? HSDKEventFile(shard->stopThread) : HSDKEventFile(shard->wakeup),
+                        &shard->shardEvents[i], sizeof(uint64_t), URING_USER_DATA(i, URING_OP_SHARD));
+        shardInFlight++;
+    }
+
+    generation = shard->generation - 1;
+
+    while (loop || liveRecords > 0 || shardInFlight > 0) {
+        /* Arm the devices attached since the last pass, cancel the detached ones. */
+        HSDKAcquireLock(shard->lock);
+        changed = loop && generation != shard->generation;
+        generation = shard->generation;
+        HSDKReleaseLock(shard->lock);
+
+        if (changed) {
+            ret = UringSyncDevices(shard, &records, &recordCapacity, &liveRecords);
+            if (ret != HSDK_ERROR_SUCCESS) {
+                break;
+            }
+            sweep = 1;
+        }
+
+        /* Cancelled devices without requests in flight have no completion to wait for. */
+        for (i = 0; sweep && i < recordCapacity; i++) {
+            if (records[i] != NULL && records[i]->detached && records[i]->inFlight == 0) {
+                UringRetireDevice(shard, records[i]);
+                records[i] = NULL;
+                liveRecords--;
+            }
+        }
+        sweep = 0;
+
+        rc = IoUringSubmit(ring, 1);
+        if (rc < 0 && rc != -EINTR && rc != -EBUSY) {
+            logMessage(HSDK_ERROR, "[PhysicalDeviceManager]ReactorUringRoutine io_uring_enter", strerror(-rc), HSDKThreadId());
+            ret = HSDK_ERROR_INVALID;
+            break;
+        }
+
+        while ((cqe = IoUringPeekCqe(ring)) != NULL) {
+            uint64_t userData = cqe->user_data;
+            uint32_t flags = cqe->flags;
+            int res = cqe->res;
+            uint32_t index = (uint32_t)(userData >> URING_OP_BITS);
+            UringDevice *record = NULL;
+
+            IoUringCqeSeen(ring);
+
+            if ((userData & URING_OP_MASK) == URING_OP_CANCEL) {
+                continue;
+            }
+
+            if ((userData & URING_OP_MASK) == URING_OP_SHARD) {
+                shardInFlight--;
+                if (index == 0) {
+                    /* Stop: cancel everything and wait for the requests to complete. */
+                    loop = 0;
+                    sweep = 1;
+                    for (i = 0; i < recordCapacity; i++) {
+                        if (records[i] != NULL) {
+                            UringCancelDevice(shard, records[i]);
+                        }
+                    }
+                    if (IoUringReserve(ring, 1) == HSDK_ERROR_SUCCESS) {
+                        IoUringPrepCancel(IoUringGetSqe(ring), URING_USER_DATA(1, URING_OP_SHARD), URING_USER_DATA(1, URING_OP_CANCEL));
+                    }
+                } else if (index == 1 && loop && IoUringReserve(ring, 1) == HSDK_ERROR_SUCCESS) {
+                    IoUringPrepRead(IoUringGetSqe(ring), HSDKEventFile(shard->wakeup), &shard->shardEvents[1], sizeof(uint64_t), URING_USER_DATA(1, URING_OP_SHARD));
+                    shardInFlight++;
+                }
+                continue;
+            }
+
+            if (index < recordCapacity) {
+                record = records[index];
+            }
+            if (record == NULL) {
+                continue;
+            }
+
+            switch (userData & URING_OP_MASK) {
+                case URING_OP_RX:
+                    UringCompleteRx(shard, record, res, flags);
+                    break;
+
+                case URING_OP_TX:
+                    record->inFlight--;
+                    if (record->detached) {
+                        break;
+                    }
+                    if (res == sizeof(uint64_t)) {
+                        record->txPending++;
+                    } else if (res != -EINTR && res != -EAGAIN) {
+                        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]ReactorUringRoutine TX", strerror(-res), HSDKThreadId());
+                        break;
+                    }
+                    UringArmTx(shard, record);
+                    UringStartTx(shard, record);
+                    break;
+
+                case URING_OP_WRITE:
+                case URING_OP_ACK:
+                case URING_OP_TIMEOUT:
+                    record->inFlight--;
+                    if ((userData & URING_OP_MASK) == URING_OP_WRITE) {
+                        record->writeResult = res;
+                        if (res > 0) {
+                            record->txOffset += (uint32_t)res;
+                        }
+                    } else if ((userData & URING_OP_MASK) == URING_OP_ACK) {
+                        record->ackResult = res;
+                    }
+                    if (--record->chainPending == 0) {
+                        UringFinishWrite(shard, record);
+                    }
+                    break;
+            }
+
+            if (record->detached && record->inFlight == 0) {
+                records[index] = NULL;
+                liveRecords--;
+                UringRetireDevice(shard, record);
+            }
+        }
+    }
+
+    free(records);
+
+    if (ret != HSDK_ERROR_SUCCESS) {
+        /*
+         * The kernel may still complete requests into the records and buffers, which are
+         * deliberately leaked together with the io_uring. The slots fall back to poll().
+         */
+        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]ReactorUringRoutine", "io_uring failed, falling back to poll", HSDKThreadId());
+        HSDKAcquireLock(shard->lock);
+        for (i = 0; i < shard->slotCount; i++) {
+            shard->slots[i].uring = NULL;
+        }
+        shard->uring = NULL;
+        shard->rxBuffers = NULL;
+        shard->generation++;
+        HSDKReleaseLock(shard->lock);
+    }
+
+    return ret;
+}
+
+/*! *********************************************************************************
+* \brief  Creates the records of the devices attached to the shard and arms their RX
+* and TX requests, and cancels the requests of the devices being detached.
+*
+* \param[in] shard              pointer to the ReactorShard
+* \param[in,out] records        the records of the shard, indexed by the user data
+* \param[in,out] recordCapacity number of entries allocated in records
+* \param[in,out] liveRecords    number of records in use
+*
+* \return HSDK_ERROR_SUCCESS on success, HSDK_ERROR_ALLOC if a record could not be allocated
+********************************************************************************** */
+static int UringSyncDevices(ReactorShard *shard, UringDevice ***records, uint32_t *recordCapacity, uint32_t *liveRecords)
+{
+    uint32_t i, index;
+
+    HSDKAcquireLock(shard->lock);
+
+    for (i = shard->slotCount; i > 0; i--) {
+        ReactorSlot *slot = &shard->slots[i - 1];
+        UringDevice *record = (UringDevice *)slot->uring;
+
+        if (slot->detached != NULL) {
+            if (record == NULL) {
+                /* Detached before it was ever armed. */
+                ReleaseSlotEvents(slot);
+                HSDKSignalEvent(slot->detached);
+                *slot = shard->slots[--shard->slotCount];
+                shard->generation++;
+            } else if (!record->detached) {
+                UringCancelDevice(shard, record);
+            }
+            continue;
+        }
+
+        if (record != NULL) {
+            continue;
+        }
+
+        /* Records are not moved once created: the kernel writes into them. */
+        for (index = 0; index < *recordCapacity; index++) {
+            if ((*records)[index] == NULL) {
+                break;
+            }
+        }
+        if (index == *recordCapacity) {
+            UringDevice **tmp = (UringDevice **)realloc(*records, (*recordCapacity + SLOT_CHUNK) * sizeof(UringDevice *));
+            if (tmp == NULL) {
+                HSDKReleaseLock(shard->lock);
+                logMessage(HSDK_ERROR, "[PhysicalDeviceManager]UringSyncDevices", "Memory allocation failed", HSDKThreadId());
+                return HSDK_ERROR_ALLOC;
+            }
+            memset(tmp + *recordCapacity, 0, SLOT_CHUNK * sizeof(UringDevice *));
+            *records = tmp;
+            *recordCapacity += SLOT_CHUNK;
+        }
+
+        record = (UringDevice *)calloc(1, sizeof(UringDevice));
+        if (record == NULL) {
+            HSDKReleaseLock(shard->lock);
+            logMessage(HSDK_ERROR, "[PhysicalDeviceManager]UringSyncDevices", "Memory allocation failed", HSDKThreadId());
+            return HSDK_ERROR_ALLOC;
+        }
+
+        PhysicalDevice *device = slot->device;
+        record->device = device;
+        record->index = index;
+        record->portFd = (slot->rxEvent != NULL) ? slot->rxEvent->event : -1;
+        record->txFd = HSDKEventFile(device->inMessages->sAnnounceData);
+        record->asyncWrite = (device->type == UART);
+        /* An FSCI ACK read would race with a multishot read on the same descriptor. */
+        record->rxRead = (device->type == UART && shard->rxBuffers != NULL && !device->configParams->fsciTxAck);
+        record->ackLength = 3 + device->lengthFieldSize + 1 + 1;
+        record->ackTimeout.tv_sec = device->configParams->timeoutAckMs / 1000;
+        record->ackTimeout.tv_nsec = (device->configParams->timeoutAckMs % 1000) * 1000000LL;
+
+        (*records)[index] = record;
+        (*liveRecords)++;
+        slot->uring = record;
+
+        if (record->portFd != -1) {
+            UringArmRx(shard, record);
+        }
+        UringArmTx(shard, record);
+    }
+
+    HSDKReleaseLock(shard->lock);
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+static int UringArmRx(ReactorShard *shard, UringDevice *record)
+{
+    if (IoUringReserve(shard->uring, 1) != HSDK_ERROR_SUCCESS) {
+        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]UringArmRx", "Submission queue full", HSDKThreadId());
+        record->rxFailed = 1;
+        return HSDK_ERROR_BUSY;
+    }
+
+    if (record->rxRead) {
+        IoUringPrepReadMultishot(IoUringGetSqe(shard->uring), record->portFd, URING_RX_GROUP, URING_USER_DATA(record->index, URING_OP_RX));
+    } else {
+        IoUringPrepPollMultishot(IoUringGetSqe(shard->uring), record->portFd, URING_USER_DATA(record->index, URING_OP_RX));
+    }
+    record->inFlight++;
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+static int UringArmTx(ReactorShard *shard, UringDevice *record)
+{
+    if (IoUringReserve(shard->uring, 1) != HSDK_ERROR_SUCCESS) {
+        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]UringArmTx", "Submission queue full", HSDKThreadId());
+        return HSDK_ERROR_BUSY;
+    }
+
+    IoUringPrepRead(IoUringGetSqe(shard->uring), record->txFd, &record->txAnnounce, sizeof(uint64_t), URING_USER_DATA(record->index, URING_OP_TX));
+    record->inFlight++;
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+* \brief  Cancels the requests of a device. The record is freed once they have all
+* completed.
+*
+* \param[in] shard      pointer to the ReactorShard
+* \param[in] record     the record of the device
+*
+* \return None
+********************************************************************************** */
+static void UringCancelDevice(ReactorShard *shard, UringDevice *record)
+{
+    static const uint8_t ops[] = { URING_OP_RX, URING_OP_TX, URING_OP_WRITE, URING_OP_ACK };
+    uint32_t i;
+
+    record->detached = 1;
+
+    for (i = 0; i < sizeof(ops); i++) {
+        if (IoUringReserve(shard->uring, 1) != HSDK_ERROR_SUCCESS) {
+            logMessage(HSDK_ERROR, "[PhysicalDeviceManager]UringCancelDevice", "Submission queue full", HSDKThreadId());
+            return;
+        }
+        IoUringPrepCancel(IoUringGetSqe(shard->uring), URING_USER_DATA(record->index, ops[i]), URING_USER_DATA(record->index, URING_OP_CANCEL));
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Frees the record of a device whose requests have all completed and, if the
+* device is being detached, removes it from the shard and wakes up ReactorDetachDevice.
+*
+* \param[in] shard      pointer to the ReactorShard
+* \param[in] record     the record of the device
+*
+* \return HSDK_ERROR_SUCCESS if the device was removed, HSDK_ERROR_INVALID if the
+*         device stays attached (shard stopped)
+********************************************************************************** */
+static int UringRetireDevice(ReactorShard *shard, UringDevice *record)
+{
+    int ret = HSDK_ERROR_INVALID;
+    uint32_t i;
+
+    HSDKAcquireLock(shard->lock);
+
+    for (i = 0; i < shard->slotCount; i++) {
+        ReactorSlot *slot = &shard->slots[i];
+        if (slot->uring != record) {
+            continue;
+        }
+
+        slot->uring = NULL;
+        if (slot->detached != NULL) {
+            ReleaseSlotEvents(slot);
+            HSDKSignalEvent(slot->detached);
+            *slot = shard->slots[--shard->slotCount];
+            shard->generation++;
+            ret = HSDK_ERROR_SUCCESS;
+        }
+        break;
+    }
+
+    HSDKReleaseLock(shard->lock);
+
+    if (record->tx != NULL) {
+        DestroyRawFrame(record->tx);
+    }
+    free(record);
+
+    return ret;
+}
+
+/*! *********************************************************************************
+* \brief  Handles a completion of the RX request of a device: hands the data of a
+* multishot read to the framers, or reads the device after a multishot poll, and
+* arms the request again once the kernel has terminated it.
+*
+* \param[in] shard      pointer to the ReactorShard
+* \param[in] record     the record of the device
+* \param[in] res        result of the completion
+* \param[in] flags      flags of the completion
+*
+* \return None
+********************************************************************************** */
+static void UringCompleteRx(ReactorShard *shard, UringDevice *record, int res, uint32_t flags)
+{
+    PhysicalDevice *device = record->device;
+
+    if (!(flags & IORING_CQE_F_MORE)) {
+        record->inFlight--;
+    }
+
+    if (record->rxRead) {
+        if (res > 0 && (flags & IORING_CQE_F_BUFFER)) {
+            uint16_t bufferId = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+
+            if (!record->detached) {
+                /* The shard buffer goes back to the kernel at once, the framers get a pooled copy. */
+                uint8_t *dataBuffer = (uint8_t *)PoolAlloc((uint32_t)res);
+                if (dataBuffer == NULL) {
+                    logMessage(HSDK_ERROR, "[PhysicalDeviceManager]UringCompleteRx", "Memory allocation failed", HSDKThreadId());
+                } else {
+                    memcpy(dataBuffer, IoUringBuffer(shard->rxBuffers, bufferId), (size_t)res);
+                    HSDK_TRACE(TRACE_RX_READ, TRACE_INSTANT, res);
+                    DeliverPhysicalDeviceRx(device, dataBuffer, (uint32_t)res);
+                }
+            }
+            IoUringRecycleBuffer(shard->rxBuffers, bufferId);
+        }
+    } else if (res > 0 && !record->detached) {
+        if (res & (POLLERR | POLLHUP | POLLNVAL)) {
+            res = -EIO;
+        } else if (record->tx != NULL && record->awaitAck) {
+            record->rxDeferred = 1;
+        } else {
+            /* A synchronous ACK check may have consumed what the poll reported. */
+            struct pollfd pfd = { record->portFd, POLLIN, 0 };
+            if (!device->configParams->fsciTxAck || poll(&pfd, 1, 0) == 1) {
+                ServicePhysicalDeviceRx(device);
+            }
+        }
+    }
+
+    if (record->detached || record->rxFailed) {
+        return;
+    }
+
+    /* 0 is end of file; -ENOBUFS means the shard buffers ran out and were given back since. */
+    if (res == 0 || (res < 0 && res != -ENOBUFS && res != -EINTR && res != -EAGAIN)) {
+        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]UringCompleteRx", "RX descriptor errored, no longer polled", HSDKThreadId());
+        record->rxFailed = 1;
+        FailPhysicalDevice(device);
+        if ((flags & IORING_CQE_F_MORE) && IoUringReserve(shard->uring, 1) == HSDK_ERROR_SUCCESS) {
+            IoUringPrepCancel(IoUringGetSqe(shard->uring), URING_USER_DATA(record->index, URING_OP_RX), URING_USER_DATA(record->index, URING_OP_CANCEL));
+        }
+        return;
+    }
+
+    if (!(flags & IORING_CQE_F_MORE)) {
+        UringArmRx(shard, record);
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Takes the announced frames from the TX queue of a device, one at a time. UART
+* frames are written through the io_uring, the other devices are serviced by
+* ServicePhysicalDeviceTx.
+*
+* \param[in] shard      pointer to the ReactorShard
+* \param[in] record     the record of the device
+*
+* \return None
+********************************************************************************** */
+static void UringStartTx(ReactorShard *shard, UringDevice *record)
+{
+    PhysicalDevice *device = record->device;
+
+    /* The frames of a lost device wait for it to be reopened. */
+    while (record->tx == NULL && record->txPending > 0 && !record->detached && device->status == PHYS_OPENED) {
+        record->txPending--;
+
+        if (!record->asyncWrite) {
+            ServicePhysicalDeviceTx(device);
+            continue;
+        }
+
+        RawFrame *tx = (RawFrame *)MessageQueueGet(device->inMessages);
+        if (tx == NULL) {
+            continue;
+        }
+
+        HSDK_TRACE(TRACE_TX_WRITE, TRACE_BEGIN, tx->cbTotalSize);
+        tx->timestampNs = HSDKMonotonicNs();
+
+        record->tx = tx;
+        record->txOffset = 0;
+        record->retriesLeft = device->configParams->numberOfRetries;
+        /* Do not cascade ACKs. */
+        record->awaitAck = device->configParams->fsciTxAck &&
+                           (tx->segments[0].data[1] != 0xA4 || tx->segments[0].data[2] != 0xFD);
+
+        if (UringSubmitWrite(shard, record) != HSDK_ERROR_SUCCESS) {
+            HSDK_TRACE(TRACE_TX_WRITE, TRACE_END, tx->cbTotalSize);
+            DestroyRawFrame(tx);
+            record->tx = NULL;
+        }
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Submits the write of the rest of the current frame. When an FSCI ACK is
+* expected, the write is linked to the read of the ACK, itself linked to a timeout.
+*
+* \param[in] shard      pointer to the ReactorShard
+* \param[in] record     the record of the device
+*
+* \return HSDK_ERROR_SUCCESS on success, HSDK_ERROR_BUSY if the submission queue is full
+********************************************************************************** */
+static int UringSubmitWrite(ReactorShard *shard, UringDevice *record)
+{
+    struct io_uring_sqe *sqe;
+    RawFrame *tx = record->tx;
+    uint32_t count = record->awaitAck ? 3 : 1;
+    uint32_t segments = 0, skip = record->txOffset, i;
+
+    if (IoUringReserve(shard->uring, count) != HSDK_ERROR_SUCCESS) {
+        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]UringSubmitWrite", "Submission queue full", HSDKThreadId());
+        return HSDK_ERROR_BUSY;
+    }
+
+    /* The segments not written yet, the first one cut at txOffset. */
+    for (i = 0; i < tx->segmentCount; i++) {
+        if (skip >= tx->segments[i].size) {
+            skip -= tx->segments[i].size;
+            continue;
+        }
+        record->txIov[segments].iov_base = tx->segments[i].data + skip;
+        record->txIov[segments].iov_len = tx->segments[i].size - skip;
+        skip = 0;
+        segments++;
+    }
+
+    sqe = IoUringGetSqe(shard->uring);
+    IoUringPrepWritev(sqe, record->portFd, record->txIov, segments, URING_USER_DATA(record->index, URING_OP_WRITE));
+    record->writeResult = 0;
+    record->ackResult = -ECANCELED;
+
+    if (record->awaitAck) {
+        sqe->flags |= IOSQE_IO_LINK;
+        memset(record->ack, 0, sizeof(record->ack));
+        sqe = IoUringGetSqe(shard->uring);
+        IoUringPrepRead(sqe, record->portFd, record->ack, record->ackLength, URING_USER_DATA(record->index, URING_OP_ACK));
+        sqe->flags |= IOSQE_IO_LINK;
+        IoUringPrepLinkTimeout(IoUringGetSqe(shard->uring), &record->ackTimeout, URING_USER_DATA(record->index, URING_OP_TIMEOUT));
+    }
+
+    record->chainPending = count;
+    record->inFlight += count;
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+* \brief  Handles the end of a write chain: writes the rest of a short write, writes
+* the frame again if no ACK was received in time, as CheckFSCIAck does, and
+* otherwise releases the frame and takes the next one.
+*
+* \param[in] shard      pointer to the ReactorShard
+* \param[in] record     the record of the device
+*
+* \return None
+********************************************************************************** */
+static void UringFinishWrite(ReactorShard *shard, UringDevice *record)
+{
+    PhysicalDevice *device = record->device;
+    RawFrame *tx = record->tx;
+
+    if (record->detached) {
+        return;
+    }
+
+    if (record->writeResult < 0) {
+        logMessage(HSDK_ERROR, "[PhysicalDeviceManager]UringFinishWrite write", strerror(-record->writeResult), HSDKThreadId());
+        FailPhysicalDevice(device);
+    } else if (record->txOffset < tx->cbTotalSize) {
+        /* A short write breaks the link, the ACK read was cancelled. */
+        if (UringSubmitWrite(shard, record) == HSDK_ERROR_SUCCESS) {
+            return;
+        }
+    } else if (record->awaitAck) {
+        if (record->ackResult == record->ackLength &&
+                memcmp(GetAckFrame(device->lengthFieldSize), record->ack, record->ackLength) == 0) {
+            HSDK_TRACE(TRACE_ACK_RECEIVED, TRACE_INSTANT, 0);
+        } else if (record->retriesLeft > 0) {
+            logMessage(HSDK_INFO, "[PhysicalDeviceManager]UringFinishWrite", "No ACK received, retrying", HSDKThreadId());
+            record->retriesLeft--;
+            record->txOffset = 0;
+            if (UringSubmitWrite(shard, record) == HSDK_ERROR_SUCCESS) {
+                return;
+            }
+        }
+    }
+
+    HSDK_TRACE(TRACE_TX_WRITE, TRACE_END, tx->cbTotalSize);
+    DestroyRawFrame(tx);
+    record->tx = NULL;
+
+    /* RX reported while the ACK was awaited and not consumed by the ACK read. */
+    if (record->rxDeferred) {
+        uint32_t available = 0;
+        record->rxDeferred = 0;
+        if (device->available != NULL && device->available(device->deviceHandle, &available) == HSDK_ERROR_SUCCESS && available > 0) {
+            ServicePhysicalDeviceRx(device);
+        }
+    }
+
+    UringStartTx(shard, record);
+}
+#endif
@@ -44,6 +44,11 @@ SPIConfigurationData *defaultSettingsSPI(void)
     config->transferMode = SPI_MODE_0;
     config->bitsPerWord = 8;
     config->maxSpeedHz = 1000000;  // 1MHz
+    config->burstSize = 0;  // a header and a payload transfer per frame
+    config->burstSegments = 1;
+    config->fullDuplex = 0;
+    config->pollIdleUs = 0;  // interrupt per read
+    config->tuneMinSpeedHz = 0;  // fixed clock
 
     return config;
 }
@@ -65,6 +70,62 @@ void setSpeedHzSPI(SPIConfigurationData *config, uint32_t maxSpeedHz)
     config->maxSpeedHz = maxSpeedHz;
 }
 
+/*! *********************************************************************************
+* \brief  Enables the batched read: the bytes available on the bus are clocked in
+*         bursts of burstSize bytes, each burst split in burstSegments transfers of
+*         a single SPI_IOC_MESSAGE ioctl, and the frames are cut out of the bursts.
+*
+* \param[in] config         configuration structure
+* \param[in] burstSize      bytes read per ioctl, 0 to disable the batched read; at
+*                           most the RX buffer of the device, PHYS_RX_SIZE bytes
+* \param[in] burstSegments  number of spi_ioc_transfer segments of a burst
+********************************************************************************** */
+void setBurstReadSPI(SPIConfigurationData *config, uint32_t burstSize, uint8_t burstSegments)
+{
+    config->burstSize = burstSize;
+    config->burstSegments = burstSegments;
+}
+
+/*! *********************************************************************************
+* \brief  Enables the full-duplex mode of the batched read: when the slave raises its
+*         interrupt while a frame is waiting to be sent, the frame is clocked out on
+*         MOSI by the bursts that read the slave, instead of by a transfer of its own.
+*
+* \param[in] config         configuration structure
+* \param[in] fullDuplex     1 to enable, 0 to disable
+********************************************************************************** */
+void setFullDuplexSPI(SPIConfigurationData *config, uint8_t fullDuplex)
+{
+    config->fullDuplex = fullDuplex;
+}
+
+/*! *********************************************************************************
+* \brief  Enables the adaptive mode: when the slave raises its interrupt less than
+*         pollIdleUs after the previous data, the interrupt is left masked and the
+*         slave is polled until it has sent nothing for pollIdleUs.
+*
+* \param[in] config         configuration structure
+* \param[in] pollIdleUs     idle period in microseconds, 0 to disable
+********************************************************************************** */
+void setAdaptivePollSPI(SPIConfigurationData *config, uint32_t pollIdleUs)
+{
+    config->pollIdleUs = pollIdleUs;
+}
+
+/*! *********************************************************************************
+* \brief  Enables the auto-tuning of the clock: the device starts at maxSpeedHz and
+*         steps the clock down on FSCI CRC and resync errors, then up again while the
+*         link is clean, settling on the fastest stable clock between tuneMinSpeedHz
+*         and maxSpeedHz.
+*
+* \param[in] config         configuration structure
+* \param[in] tuneMinSpeedHz lowest clock tried, 0 to disable
+********************************************************************************** */
+void setAutoTuneSPI(SPIConfigurationData *config, uint32_t tuneMinSpeedHz)
+{
+    config->tuneMinSpeedHz = tuneMinSpeedHz;
+}
+
 
 /*! *********************************************************************************
 * \brief  Initialize the SPI device with the configuration attributes.
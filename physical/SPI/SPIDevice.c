@@ -40,6 +40,8 @@
 #include <string.h>
 
 #include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include "PhysicalDevice.h"
 #include "SPIDevice.h"
@@ -54,6 +56,21 @@
 * Private macros
 *************************************************************************************
 ************************************************************************************/
+/* Segments of a batched read; SPI_IOC_MESSAGE encodes their size in 14 bits. */
+#define SPI_MAX_BURST_SEGMENTS 32
+
+/* Parsing states of a batched read. */
+#define SPI_BURST_IDLE      0   /* between frames, the slave clocks out 0xFF */
+#define SPI_BURST_HEADER    1   /* inside the FSCI header */
+#define SPI_BURST_PAYLOAD   2   /* inside the payload and CRC */
+
+/* Auto-tune: frames and errors between two decisions on the clock. */
+#define SPI_TUNE_WINDOW 32
+/* Auto-tune: clean windows in a row before trying a faster clock. */
+#define SPI_TUNE_STABLE_WINDOWS 8
+/* Auto-tune: the search stops within 1/16 of the clock that failed. */
+#define SPI_TUNE_RESOLUTION 16
+
 static SPIHandle *InitSPIDevice(char *);
 static int DestroySPIDevice(SPIHandle *);
 static int InitDeviceAsSPI(PhysicalDevice *device);
@@ -61,10 +78,20 @@ static int SPIOpenPort(void *pDevice, void *configData);
 static int SPIClosePort(void *pDevice);
 static int SPIWrite(void *specificData, uint8_t *buf, uint32_t size);
 static int SPIReadFSCIData(SPIHandle *device, uint8_t *buffer, uint32_t *count);
+static int SPIReadFSCIBurst(SPIHandle *device, uint8_t *tx, uint32_t txSize, uint8_t *buffer, uint32_t *count, uint32_t capacity);
+static uint8_t SPIParseBurst(SPIHandle *device, uint32_t size, uint8_t *buffer, uint32_t *count);
 static int SPIRead(void *specificData, uint8_t *buf, uint32_t *size);
+static int SPIReadWrite(void *specificData, uint8_t *tx, uint32_t txSize, uint8_t *buf, uint32_t *size);
+static int SPIService(SPIHandle *device, uint8_t *tx, uint32_t txSize, uint8_t *buffer, uint32_t *count);
 static int SPIInitialize(void *specificData, uint8_t clearBus);
 static int SPIConfigure(void *specificData, void *configData);
 static Event SPIGetWaitEvent(void *, void **);
+static int SPIOpenPolling(SPIHandle *device);
+static uint8_t SPIUpdatePolling(SPIHandle *device, uint8_t interrupted, uint32_t count);
+static void SPICountFrame(SPIHandle *device, uint8_t crcValid);
+static void SPICountResync(SPIHandle *device);
+static void SPISetSpeed(SPIHandle *device, uint32_t speedHz);
+static void SPITuneClock(SPIHandle *device);
 
 /************************************************************************************
 *************************************************************************************
@@ -103,6 +130,9 @@ int AttachToSPIDevice(PhysicalDevice *pDevice, char *deviceName)
         return HSDK_ERROR_ALLOC;
     }
 
+    /* Set the current PhysicalDevice as the parent for our handle. */
+    ((SPIHandle *)(pDevice->deviceHandle))->parent = pDevice;
+
     return InitDeviceAsSPI(pDevice);
 }
 
@@ -117,6 +147,7 @@ int DetachFromSPIDevice(PhysicalDevice *pDevice)
     pDevice->open = NULL;
     pDevice->close = NULL;
     pDevice->read = NULL;
+    pDevice->readWrite = NULL;
     pDevice->initialize = NULL;
     pDevice->write = NULL;
     pDevice->configure = NULL;
@@ -135,6 +166,7 @@ int InitDeviceAsSPI(PhysicalDevice *device)
     device->open = SPIOpenPort;
     device->close = SPIClosePort;
     device->read = SPIRead;
+    device->readWrite = NULL;    /* Set by SPIOpenPort in full-duplex mode. */
     device->initialize = SPIInitialize;
     device->write = SPIWrite;
     device->configure = SPIConfigure;
@@ -167,6 +199,8 @@ SPIHandle *InitSPIDevice(char *deviceName)
 
     device->deviceName = strdup(deviceName);
     HSDKInvalidateDescriptor(&device->portHandle);
+    HSDKInvalidateDescriptor(&device->epollHandle);
+    HSDKInvalidateDescriptor(&device->pollKick);
 
     return device;
 }
@@ -194,6 +228,8 @@ int DestroySPIDevice(SPIHandle *device)
 
     free(device->deviceName);
     device->deviceName = NULL;
+    /* Not our job to free our parent. */
+    device->parent = NULL;
     free(device);
 
     return HSDK_ERROR_SUCCESS;
@@ -203,9 +239,92 @@ int DestroySPIDevice(SPIHandle *device)
 static Event SPIGetWaitEvent(void *device, void **asyncMask)
 {
     SPIHandle *pDevice = (SPIHandle *)device;
+
+    /* In adaptive mode the device is also serviced while pollKick is readable. */
+    if (pDevice->pollIdleUs) {
+        return HSDKDeviceTriggerableEvent(pDevice->epollHandle, asyncMask);
+    }
     return HSDKDeviceTriggerableEvent(pDevice->uioPortHandle, asyncMask);
 }
 
+/*! *********************************************************************************
+* \brief  Creates the descriptors of the adaptive mode: pollKick, and an epoll
+*         descriptor readable when the interrupt or pollKick is, so that the device
+*         thread or reactor shard waits for both through the waitable event.
+*
+* \param[in] device    pointer to a SPI handle, pollIdleUs set
+*
+* \return HSDK_ERROR_SUCCESS for success, HSDK_ERROR_INVALID otherwise
+********************************************************************************** */
+static int SPIOpenPolling(SPIHandle *device)
+{
+    struct epoll_event ev;
+
+    device->pollKick = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    device->epollHandle = epoll_create1(EPOLL_CLOEXEC);
+    if (!HSDKIsDescriptorValid(device->pollKick) || !HSDKIsDescriptorValid(device->epollHandle)) {
+        return HSDK_ERROR_INVALID;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = device->uioPortHandle;
+    if (epoll_ctl(device->epollHandle, EPOLL_CTL_ADD, device->uioPortHandle, &ev) != 0) {
+        return HSDK_ERROR_INVALID;
+    }
+    ev.data.fd = device->pollKick;
+    if (epoll_ctl(device->epollHandle, EPOLL_CTL_ADD, device->pollKick, &ev) != 0) {
+        return HSDK_ERROR_INVALID;
+    }
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+* \brief  Switches the adaptive mode after a read. An interrupt raised less than
+*         pollIdleUs after the previous data starts polling: the interrupt stays
+*         masked and pollKick readable, so the slave is read again as soon as the
+*         thread is done with its other events. pollKick is written on every turn,
+*         the io_uring reactor only being woken by a new signal. Polling stops once
+*         the slave has sent nothing for pollIdleUs.
+*
+* \param[in] device       pointer to a SPI handle
+* \param[in] interrupted  whether the read was started by the interrupt
+* \param[in] count        number of bytes read
+*
+* \return 1 if the slave is polled and the interrupt must stay masked, 0 otherwise
+********************************************************************************** */
+static uint8_t SPIUpdatePolling(SPIHandle *device, uint8_t interrupted, uint32_t count)
+{
+    uint64_t now = HSDKMonotonicNs(), kick = 1;
+    uint64_t idleNs = (uint64_t)device->pollIdleUs * 1000;
+    uint8_t busy = (now - device->lastDataNs) < idleNs;
+
+    if (count) {
+        device->lastDataNs = now;
+    }
+
+    if (device->polling && !count && !busy) {
+        device->polling = 0;
+        __atomic_add_fetch(&device->counters.modeSwitches, 1, __ATOMIC_RELAXED);
+        /* Clears all the kicks written while polling. */
+        if (read(device->pollKick, &kick, sizeof(kick)) != sizeof(kick)) {
+            logMessage(HSDK_WARNING, "[SPIDevice]SPIUpdatePolling", "Failed to stop polling", HSDKThreadId());
+        }
+    } else if (device->polling || (interrupted && busy)) {
+        if (!device->polling) {
+            device->polling = 1;
+            __atomic_add_fetch(&device->counters.modeSwitches, 1, __ATOMIC_RELAXED);
+        }
+        /* A multishot poll is edge-triggered: each turn needs its own wakeup. */
+        if (write(device->pollKick, &kick, sizeof(kick)) != sizeof(kick)) {
+            logMessage(HSDK_WARNING, "[SPIDevice]SPIUpdatePolling", "Failed to kick polling", HSDKThreadId());
+        }
+    }
+
+    return device->polling;
+}
+
 
 /*! *********************************************************************************
 * \brief  Opens the specified port and creates the thread
@@ -249,6 +368,57 @@ static int SPIOpenPort(void *pDevice, void *configData)
         return HSDK_ERROR_INVALID;
     }
 
+    device->burstSize = pConfig->burstSize;
+    device->burstSegments = pConfig->burstSegments;
+    if (device->burstSegments == 0) {
+        device->burstSegments = 1;
+    } else if (device->burstSegments > SPI_MAX_BURST_SEGMENTS) {
+        device->burstSegments = SPI_MAX_BURST_SEGMENTS;
+    }
+    /* A larger burst would never fit in the read buffer, and nothing would be read. */
+    if (device->burstSize > device->parent->rxBufferSize) {
+        logMessage(HSDK_WARNING, "[SPIDevice]SPIOpenPort", "Burst larger than the RX buffer, clamped", HSDKThreadId());
+        device->burstSize = device->parent->rxBufferSize;
+    }
+    if (device->burstSize < device->burstSegments) {
+        device->burstSize = 0;
+    }
+    device->frameState = SPI_BURST_IDLE;
+    device->fullDuplex = pConfig->fullDuplex;
+    device->tuneMinSpeedHz = pConfig->tuneMinSpeedHz;
+    if (device->tuneMinSpeedHz && device->tuneMaxSpeedHz == pConfig->maxSpeedHz && device->counters.speedHz) {
+        /* Reopened: resume from the clock tuned so far. */
+        SPISetSpeed(device, device->counters.speedHz);
+    } else {
+        device->tuneMaxSpeedHz = pConfig->maxSpeedHz;
+        device->stableSpeedHz = 0;
+        device->failedSpeedHz = 0;
+        __atomic_store_n(&device->counters.speedHz, pConfig->maxSpeedHz, __ATOMIC_RELAXED);
+    }
+    device->windowFrames = 0;
+    device->windowErrors = 0;
+    device->cleanWindows = 0;
+    device->pollIdleUs = pConfig->pollIdleUs;
+    device->polling = 0;
+    if (device->pollIdleUs && SPIOpenPolling(device) != HSDK_ERROR_SUCCESS) {
+        logMessage(HSDK_WARNING, "[SPIDevice]SPIOpenPort", "Failed to create the polling descriptors, adaptive mode disabled", HSDKThreadId());
+        device->pollIdleUs = 0;
+    }
+    if (device->burstSize) {
+        device->burst = (uint8_t *)malloc(device->burstSize);
+        device->burstTx = (uint8_t *)malloc(device->burstSize);
+        if (device->burst == NULL || device->burstTx == NULL) {
+            logMessage(HSDK_WARNING, "[SPIDevice]SPIOpenPort", "Memory allocation failed, batched read disabled", HSDKThreadId());
+            free(device->burst);
+            free(device->burstTx);
+            device->burst = NULL;
+            device->burstTx = NULL;
+            device->burstSize = 0;
+        }
+    }
+    /* Without bursts the frames go out through the TX path, as in half-duplex mode. */
+    device->parent->readWrite = (device->fullDuplex && device->burstSize) ? SPIReadWrite : NULL;
+
     if (freeConfig) {
         freeSettingsSPI(pConfig);
         pConfig = NULL;
@@ -283,6 +453,21 @@ static int SPIClosePort(void *device)
     }
 
     HSDKInvalidateDescriptor(&crtDevice->portHandle);
+    free(crtDevice->burst);
+    free(crtDevice->burstTx);
+    crtDevice->burst = NULL;
+    crtDevice->burstTx = NULL;
+
+    /* A masked interrupt is unmasked by SPIInitialize when the device is started again. */
+    if (HSDKIsDescriptorValid(crtDevice->epollHandle)) {
+        HSDKCloseFile(crtDevice->epollHandle);
+        HSDKInvalidateDescriptor(&crtDevice->epollHandle);
+    }
+    if (HSDKIsDescriptorValid(crtDevice->pollKick)) {
+        HSDKCloseFile(crtDevice->pollKick);
+        HSDKInvalidateDescriptor(&crtDevice->pollKick);
+    }
+    crtDevice->polling = 0;
     return HSDK_ERROR_SUCCESS;
 }
 
@@ -322,7 +507,8 @@ static int SPIReadFSCIData(SPIHandle *device, uint8_t *buffer, uint32_t *count)
     uint32_t fsci_header_len = 3 + device->lengthFieldSize;
     uint32_t fsci_payload_len = 0, sync_len = 1, curr_len = fsci_header_len;
     uint8_t fsci_header[fsci_header_len], no_more_data[fsci_header_len], *curr = fsci_header;
-    uint8_t check_sync = 1, errored = 0;
+    uint8_t check_sync = 1, errored = 0, crc;
+    uint32_t i;
 
     /* Stop condition is all FFs. */
     memset(no_more_data, 0xFF, fsci_header_len);
@@ -358,12 +544,14 @@ static int SPIReadFSCIData(SPIHandle *device, uint8_t *buffer, uint32_t *count)
                 memcpy(buffer + *count, fsci_header, fsci_header_len);
                 *count += fsci_header_len;
             } else if (memcmp(fsci_header, no_more_data, fsci_header_len) == 0) {
-                if (errored) {
-                    rc = HSDK_ERROR_INVALID;
-                }
+                /* The frames read before the unexpected bytes are kept: an error
+                   would have the device treated as failed. */
                 break;
             } else {
                 logMessage(HSDK_WARNING, "[SPIDevice]SPIRead", "Unexpected bytes - frame dismissed", HSDKThreadId());
+                if (!errored) {
+                    SPICountResync(device);
+                }
                 errored = 1;
                 continue;  // continue until all useful bytes are read
             }
@@ -382,6 +570,13 @@ static int SPIReadFSCIData(SPIHandle *device, uint8_t *buffer, uint32_t *count)
         }
         *count += fsci_payload_len;
 
+        /* The CRC is the XOR of the bytes after the sync byte. */
+        crc = 0;
+        for (i = *count - fsci_payload_len - fsci_header_len + 1; i < *count - 1; i++) {
+            crc ^= buffer[i];
+        }
+        SPICountFrame(device, crc == buffer[*count - 1]);
+
         /* Check again sync for next packet. */
         check_sync = 1;
     }
@@ -389,6 +584,172 @@ static int SPIReadFSCIData(SPIHandle *device, uint8_t *buffer, uint32_t *count)
     return rc;
 }
 
+/*! *********************************************************************************
+* \brief  Batched variant of SPIReadFSCIData. The bus is read in bursts of
+*         burstSize bytes, each a single SPI_IOC_MESSAGE ioctl of burstSegments
+*         transfers with the chip select held between them, until the slave clocks
+*         out a header worth of 0xFF after the last frame. A frame longer than
+*         a burst is completed by the next ones; the frames are handed to the framer
+*         without the idle bytes between them. A frame to send is clocked out on
+*         MOSI by the first bursts, padded with 0 like the reads, and the bursts go
+*         on until it is sent; it is left to the caller when the bursts that fit in
+*         buffer could not carry all of it, so that a frame is never split between
+*         the bursts and a write of its own.
+*
+* \param[in]     device     a pointer to the SPI device
+* \param[in]     tx         the frame to send, NULL if none
+* \param[in]     txSize     number of bytes in tx
+* \param[in,out] buffer     a byte array where the data shall be read into
+* \param[in,out] count      number of bytes successfully read
+* \param[in]     capacity   size of buffer; a burst that might not fit is left on the
+*                           bus for the next interrupt
+*
+* \return HSDK_ERROR_SUCCESS for success, HSDK_ERROR_BUSY if the data was read but tx
+*         not sent, HSDK_ERROR_INVALID if a transfer failed
+********************************************************************************** */
+static int SPIReadFSCIBurst(SPIHandle *device, uint8_t *tx, uint32_t txSize, uint8_t *buffer, uint32_t *count, uint32_t capacity)
+{
+    struct spi_ioc_transfer xfer[SPI_MAX_BURST_SEGMENTS];
+    uint32_t segmentSize = device->burstSize / device->burstSegments;
+    uint32_t txSent = 0, chunk;
+    uint8_t i, idle;
+    int rc = HSDK_ERROR_SUCCESS;
+
+    /* Each burst that fits in buffer adds at most burstSize bytes to it. */
+    if (txSize > (capacity - *count) / device->burstSize * device->burstSize) {
+        tx = NULL;
+        txSize = 0;
+        rc = HSDK_ERROR_BUSY;
+    }
+
+    memset(xfer, 0, sizeof(xfer));
+    for (i = 0; i < device->burstSegments; i++) {
+        xfer[i].rx_buf = (unsigned long)(device->burst + i * segmentSize);
+        xfer[i].len = segmentSize;
+    }
+    /* The last segment takes the remainder. */
+    xfer[device->burstSegments - 1].len += device->burstSize % device->burstSegments;
+
+    do {
+        if (*count + device->burstSize > capacity) {
+            break;
+        }
+
+        if (txSent < txSize) {
+            chunk = txSize - txSent;
+            if (chunk > device->burstSize) {
+                chunk = device->burstSize;
+            }
+            memcpy(device->burstTx, tx + txSent, chunk);
+            memset(device->burstTx + chunk, 0, device->burstSize - chunk);
+            txSent += chunk;
+            for (i = 0; i < device->burstSegments; i++) {
+                xfer[i].tx_buf = (unsigned long)(device->burstTx + i * segmentSize);
+            }
+        } else {
+            for (i = 0; i < device->burstSegments; i++) {
+                xfer[i].tx_buf = 0;
+            }
+        }
+
+        if (ioctl(device->portHandle, SPI_IOC_MESSAGE(device->burstSegments), xfer) < 0) {
+            logMessage(HSDK_WARNING, "[SPIDevice]SPIReadFSCIBurst", "Error reading burst from port", HSDKThreadId());
+            return HSDK_ERROR_INVALID;
+        }
+        idle = SPIParseBurst(device, device->burstSize, buffer, count);
+    } while (!idle || txSent < txSize);
+
+    if (txSize) {
+        __atomic_add_fetch(&device->counters.duplexFrames, 1, __ATOMIC_RELAXED);
+    }
+
+    return rc;
+}
+
+/*! *********************************************************************************
+* \brief  Copies the FSCI frames of the last burst to the read buffer, dropping the
+*         0xFF idle bytes and any unexpected byte between frames. The framer gets
+*         the frames back to back and checks their CRC.
+*
+* \param[in]     device     a pointer to the SPI device
+* \param[in]     size       number of bytes in device->burst
+* \param[in,out] buffer     a byte array where the frames are copied
+* \param[in,out] count      number of bytes in buffer
+*
+* \return 1 when the burst ends with a header worth of idle bytes, 0 otherwise
+********************************************************************************** */
+static uint8_t SPIParseBurst(SPIHandle *device, uint32_t size, uint8_t *buffer, uint32_t *count)
+{
+    uint8_t *burst = device->burst;
+    uint32_t headerLen = 3 + device->lengthFieldSize;
+    uint32_t i = 0, j, idle = 0, chunk;
+    uint8_t junk = 0;
+
+    while (i < size) {
+        switch (device->frameState) {
+            case SPI_BURST_IDLE:
+                if (burst[i] == 0x02) {
+                    device->frameState = SPI_BURST_HEADER;
+                    device->frameHeaderCount = 0;
+                    device->frameCrc = 0;
+                    idle = 0;
+                    junk = 0;
+                    break;
+                }
+                if (burst[i] == 0xFF) {
+                    idle++;
+                    junk = 0;
+                } else {
+                    if (!junk) {
+                        logMessage(HSDK_WARNING, "[SPIDevice]SPIParseBurst", "Unexpected bytes - dismissed", HSDKThreadId());
+                        SPICountResync(device);
+                    }
+                    idle = 0;
+                    junk = 1;
+                }
+                i++;
+                break;
+
+            case SPI_BURST_HEADER:
+                /* The CRC is the XOR of the bytes after the sync byte. */
+                if (device->frameHeaderCount) {
+                    device->frameCrc ^= burst[i];
+                }
+                device->frameHeader[device->frameHeaderCount++] = burst[i];
+                buffer[(*count)++] = burst[i++];
+                if (device->frameHeaderCount == headerLen) {
+                    if (headerLen == 4) {
+                        device->frameBytesLeft = device->frameHeader[3] + 1;  // +1 for CRC
+                    } else {
+                        device->frameBytesLeft = device->frameHeader[3] + (device->frameHeader[4] << 8) + 1;  // +1 for CRC
+                    }
+                    device->frameState = SPI_BURST_PAYLOAD;
+                }
+                break;
+
+            case SPI_BURST_PAYLOAD:
+                chunk = size - i;
+                if (chunk > device->frameBytesLeft) {
+                    chunk = device->frameBytesLeft;
+                }
+                memcpy(buffer + *count, burst + i, chunk);
+                for (j = 0; j < chunk && device->frameBytesLeft - j > 1; j++) {
+                    device->frameCrc ^= burst[i + j];
+                }
+                *count += chunk;
+                i += chunk;
+                device->frameBytesLeft -= chunk;
+                if (device->frameBytesLeft == 0) {
+                    SPICountFrame(device, device->frameCrc == burst[i - 1]);
+                    device->frameState = SPI_BURST_IDLE;
+                }
+                break;
+        }
+    }
+
+    return device->frameState == SPI_BURST_IDLE && idle >= headerLen;
+}
+
 
 /*! *********************************************************************************
 * \brief  Read data from the SPI device.
@@ -401,22 +762,71 @@ static int SPIReadFSCIData(SPIHandle *device, uint8_t *buffer, uint32_t *count)
 ********************************************************************************** */
 static int SPIRead(void *specificData, uint8_t *buffer, uint32_t *count)
 {
-    SPIHandle *device = (SPIHandle *)specificData;
+    return SPIService((SPIHandle *)specificData, NULL, 0, buffer, count);
+}
+
+/*! *********************************************************************************
+* \brief  Read data from the SPI device and send a frame waiting in the TX queue in
+*         the transfers of the read. Only installed in full-duplex mode with bursts.
+*         A frame longer than the bursts that fit in buffer is not sent.
+*
+* \param[in] specificData   a pointer to the SPI device
+* \param[in] tx             the frame to send
+* \param[in] txSize         number of bytes in tx
+* \param[in,out] buffer     a byte array where the data shall be read into
+* \param[in,out] count      size of buffer, then number of bytes successfully read
+*
+* \return HSDK_ERROR_SUCCESS for success, HSDK_ERROR_BUSY if the data was read but tx
+*         not sent, an error code otherwise
+********************************************************************************** */
+static int SPIReadWrite(void *specificData, uint8_t *tx, uint32_t txSize, uint8_t *buffer, uint32_t *count)
+{
+    return SPIService((SPIHandle *)specificData, tx, txSize, buffer, count);
+}
 
+/*! *********************************************************************************
+* \brief  Handles an interrupt of the slave, or a poll in adaptive mode: reads the
+*         frames available and unmasks the interrupt unless the slave is polled.
+*
+* \param[in] device         a pointer to the SPI device
+* \param[in] tx             a frame to send in the bursts of the read, NULL if none
+* \param[in] txSize         number of bytes in tx
+* \param[in,out] buffer     a byte array where the data shall be read into
+* \param[in,out] count      size of buffer, then number of bytes successfully read
+*
+* \return HSDK_ERROR_SUCCESS for success, an error code otherwise
+********************************************************************************** */
+static int SPIService(SPIHandle *device, uint8_t *tx, uint32_t txSize, uint8_t *buffer, uint32_t *count)
+{
     int rc = 0;
-    uint32_t info = 1, temp;
+    uint32_t info = 1, temp, capacity = *count;
+    uint8_t interrupted = !device->polling;
     ssize_t nb;
 
     *count = 0;
 
-    /* Read the interrupt. */
-    nb = read(device->uioPortHandle, &temp, sizeof(temp));
-    if (nb != sizeof(info)) {
-        return HSDK_ERROR_INVALID;
+    /* Read the interrupt, masked while the slave is polled. */
+    if (interrupted) {
+        nb = read(device->uioPortHandle, &temp, sizeof(temp));
+        if (nb != sizeof(info)) {
+            return HSDK_ERROR_INVALID;
+        }
     }
 
     /* Process available data. */
-    rc = SPIReadFSCIData(device, buffer, count);
+    if (device->burstSize) {
+        rc = SPIReadFSCIBurst(device, tx, txSize, buffer, count, capacity);
+    } else {
+        rc = SPIReadFSCIData(device, buffer, count);
+    }
+
+    if (device->tuneMinSpeedHz) {
+        SPITuneClock(device);
+    }
+
+    if (device->pollIdleUs && SPIUpdatePolling(device, interrupted, *count)) {
+        return rc;
+    }
 
     /* Unmask the interrupt. */
     nb = write(device->uioPortHandle, &info, sizeof(info));
@@ -429,6 +839,128 @@ static int SPIRead(void *specificData, uint8_t *buffer, uint32_t *count)
     return rc;
 }
 
+/*! *********************************************************************************
+* \brief  Counts a frame cut by the SPI framing, and its CRC error if any.
+*
+* \param[in] device     pointer to a SPI handle
+* \param[in] crcValid   whether the CRC of the frame matched
+*
+* \return None
+********************************************************************************** */
+static void SPICountFrame(SPIHandle *device, uint8_t crcValid)
+{
+    device->windowFrames++;
+    if (!crcValid) {
+        device->windowErrors++;
+        __atomic_add_fetch(&device->counters.crcErrors, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Counts a run of unexpected bytes between frames, a loss of synchronization.
+*
+* \param[in] device     pointer to a SPI handle
+*
+* \return None
+********************************************************************************** */
+static void SPICountResync(SPIHandle *device)
+{
+    device->windowErrors++;
+    __atomic_add_fetch(&device->counters.resyncs, 1, __ATOMIC_RELAXED);
+}
+
+/*! *********************************************************************************
+* \brief  Sets the clock of the following transfers.
+*
+* \param[in] device     pointer to a SPI handle
+* \param[in] speedHz    the clock in Hz
+*
+* \return None
+********************************************************************************** */
+static void SPISetSpeed(SPIHandle *device, uint32_t speedHz)
+{
+    if (ioctl(device->portHandle, SPI_IOC_WR_MAX_SPEED_HZ, &speedHz) < 0) {
+        logMessage(HSDK_WARNING, "[SPIDevice]SPISetSpeed", "Failed to set the clock", HSDKThreadId());
+        return;
+    }
+
+    __atomic_store_n(&device->counters.speedHz, speedHz, __ATOMIC_RELAXED);
+}
+
+/*! *********************************************************************************
+* \brief  Steps the clock once SPI_TUNE_WINDOW frames and errors were counted. A
+*         window with errors goes back to the fastest clock found stable, or a
+*         quarter lower if none is; SPI_TUNE_STABLE_WINDOWS clean windows in a row
+*         try halfway to the slowest clock that failed, or to tuneMaxSpeedHz. The
+*         clock settles within 1/SPI_TUNE_RESOLUTION of the fastest stable one.
+*
+* \param[in] device     pointer to a SPI handle, tuneMinSpeedHz set
+*
+* \return None
+********************************************************************************** */
+static void SPITuneClock(SPIHandle *device)
+{
+    uint32_t speed = device->counters.speedHz, next = speed, ceiling;
+
+    if (device->windowFrames + device->windowErrors < SPI_TUNE_WINDOW) {
+        return;
+    }
+
+    if (device->windowErrors) {
+        device->failedSpeedHz = speed;
+        if (device->stableSpeedHz >= speed) {
+            /* The link got worse, what was stable is no longer. */
+            device->stableSpeedHz = 0;
+        }
+        next = device->stableSpeedHz ? device->stableSpeedHz : speed / 4 * 3;
+        if (next < device->tuneMinSpeedHz) {
+            next = device->tuneMinSpeedHz;
+        }
+        device->cleanWindows = 0;
+    } else {
+        if (speed > device->stableSpeedHz) {
+            device->stableSpeedHz = speed;
+        }
+        if (++device->cleanWindows >= SPI_TUNE_STABLE_WINDOWS) {
+            device->cleanWindows = 0;
+            ceiling = device->failedSpeedHz ? device->failedSpeedHz : device->tuneMaxSpeedHz;
+            if (ceiling > speed && ceiling - speed > ceiling / SPI_TUNE_RESOLUTION) {
+                next = speed + (ceiling - speed) / 2;
+            }
+        }
+    }
+
+    device->windowFrames = 0;
+    device->windowErrors = 0;
+
+    if (next != speed) {
+        logMessage(HSDK_INFO, "[SPIDevice]SPITuneClock", (next < speed) ? "Clock stepped down" : "Clock stepped up", HSDKThreadId());
+        SPISetSpeed(device, next);
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Returns the frames sent in full-duplex mode, the switches of the adaptive
+*         mode and the receive errors since the device was created, and the clock.
+*
+* \param[in] specificData   pointer to a SPI handle
+* \param[out] counters      the counters
+*
+* \return 0 for success
+********************************************************************************** */
+int SPIGetCounters(void *specificData, SPICounters *counters)
+{
+    SPIHandle *device = (SPIHandle *)specificData;
+
+    counters->duplexFrames = __atomic_load_n(&device->counters.duplexFrames, __ATOMIC_RELAXED);
+    counters->modeSwitches = __atomic_load_n(&device->counters.modeSwitches, __ATOMIC_RELAXED);
+    counters->crcErrors = __atomic_load_n(&device->counters.crcErrors, __ATOMIC_RELAXED);
+    counters->resyncs = __atomic_load_n(&device->counters.resyncs, __ATOMIC_RELAXED);
+    counters->speedHz = __atomic_load_n(&device->counters.speedHz, __ATOMIC_RELAXED);
+
+    return HSDK_ERROR_SUCCESS;
+}
+
 /*! *********************************************************************************
 * \brief  Read data from the SPI device, before starting the device loop.
 *
@@ -32,6 +32,8 @@
 #define _DEFAULT_SOURCE
 
 #include "UARTConfiguration.h"
+#include "hsdkError.h"
+#include "hsdkLogger.h"
 #include <stdlib.h>
 
 
@@ -48,6 +50,9 @@ void setDefaultLineConfig(UARTLineConfig *config)
     config->outCtsFlow = 1;
     config->outDsrFlow = 1;
     config->outX = 0;
+    config->customBaudrate = 0;
+    config->lowLatency = 0;
+    config->latencyTimerMs = 0;
 }
 
 void setDefaultTimeConfig(UARTTimeConfig *config)
@@ -85,6 +90,26 @@ void setBaudrate(UARTConfigurationData *config, Baudrate br)
     config->lineConfig->baudrate = br;
 }
 
+void setCustomBaudrate(UARTConfigurationData *config, uint32_t baudrate)
+{
+    config->lineConfig->baudrate = BR_CUSTOM;
+    config->lineConfig->customBaudrate = baudrate;
+}
+
+void setLowLatency(UARTConfigurationData *config, uint8_t lowLatency, uint8_t latencyTimerMs)
+{
+    config->lineConfig->lowLatency = lowLatency;
+    config->lineConfig->latencyTimerMs = latencyTimerMs;
+}
+
+void setHardwareFlowControl(UARTConfigurationData *config, uint8_t enable)
+{
+    /* Disabled, the defaults of setDefaultLineConfig are restored: CTS output flow
+    stays on, as Windows always had it. */
+    config->lineConfig->handleRTSControl = enable ? RTSHANDSHAKE : ENABLERTS;
+    config->lineConfig->outCtsFlow = 1;
+}
+
 void setParity(UARTConfigurationData *config, ParityType pt)
 {
     config->lineConfig->parity = pt;
@@ -155,6 +180,9 @@ int InitPort(File portHandle, UARTConfigurationData *config)
         case BR921600:
             dcbPortSettings.BaudRate = 921600;
             break;
+        case BR_CUSTOM:
+            dcbPortSettings.BaudRate = config->lineConfig->customBaudrate;
+            break;
         default:
             return FALSE;
     }
@@ -274,13 +302,154 @@ int InitPort(File portHandle, UARTConfigurationData *config)
     return TRUE;
 }
 
+/*! *********************************************************************************
+* \brief  Reads back the settings in effect on an open port.
+*
+* \param[in] portHandle     the port
+* \param[out] settings      the settings
+*
+* \return HSDK_ERROR_SUCCESS, an error code otherwise
+********************************************************************************** */
+int GetPortSettings(File portHandle, UARTPortSettings *settings)
+{
+    DCB dcbPortSettings;
+
+    memset(settings, 0, sizeof(UARTPortSettings));
+    settings->latencyTimerMs = -1;
+
+    memset(&dcbPortSettings, 0, sizeof(dcbPortSettings));
+    dcbPortSettings.DCBlength = sizeof(dcbPortSettings);
+    if (GetCommState(portHandle, &dcbPortSettings) == FALSE) {
+        return (int)GetLastError();
+    }
+    settings->baudrate = dcbPortSettings.BaudRate;
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+* \brief  Reads the receive error counters of a port. Not available on Windows.
+*
+* \param[in] portHandle     the port
+* \param[out] counters      the counters
+*
+* \return HSDK_ERROR_INVALID
+********************************************************************************** */
+int GetPortLineCounters(File portHandle, UARTLineCounters *counters)
+{
+    memset(counters, 0, sizeof(UARTLineCounters));
+    return HSDK_ERROR_INVALID;
+}
+
 #elif __linux__ || __APPLE__
 
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 #include <sys/ioctl.h>
 #include <termios.h>
 
+#ifdef __linux__
+#include <linux/serial.h>
+
+#include "UARTTermios2.h"
+
+/*! *********************************************************************************
+* \brief  Converts a Bxxx speed to bits per second, for the targets without termios2.
+*
+* \param[in] speed      the speed, as returned by cfgetospeed
+*
+* \return the baudrate, 0 if the speed is not known
+********************************************************************************** */
+static uint32_t SpeedToBaudrate(speed_t speed)
+{
+    static const struct {
+        speed_t speed;
+        uint32_t baudrate;
+    } speeds[] = {
+        { B110, 110 }, { B300, 300 }, { B600, 600 }, { B1200, 1200 },
+        { B2400, 2400 }, { B4800, 4800 }, { B9600, 9600 }, { B19200, 19200 },
+        { B38400, 38400 }, { B57600, 57600 }, { B115200, 115200 }, { B921600, 921600 },
+    };
+    uint32_t i;
+
+    for (i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+        if (speeds[i].speed == speed) {
+            return speeds[i].baudrate;
+        }
+    }
+
+    return 0;
+}
+
+/*! *********************************************************************************
+* \brief  Builds the sysfs path of the latency timer of the USB-serial bridge of a
+*         port, e.g. /sys/class/tty/ttyUSB0/device/latency_timer.
+*
+* \param[in] portHandle     the port
+* \param[out] path          the path
+* \param[in] size           the size of path
+*
+* \return 0 for success, -1 if the name of the port is not known
+********************************************************************************** */
+static int LatencyTimerPath(File portHandle, char *path, size_t size)
+{
+    char link[64], target[256], *name;
+    ssize_t len;
+
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", portHandle);
+    len = readlink(link, target, sizeof(target) - 1);
+    if (len <= 0) {
+        return -1;
+    }
+    target[len] = '\0';
+
+    name = strrchr(target, '/');
+    name = (name != NULL) ? name + 1 : target;
+    snprintf(path, size, "/sys/class/tty/%s/device/latency_timer", name);
+
+    return 0;
+}
+
+/*! *********************************************************************************
+* \brief  Sets ASYNC_LOW_LATENCY on the port and the latency timer of its FTDI
+*         bridge. Failures are logged, the port stays usable with the defaults.
+*
+* \param[in] portHandle     the port
+* \param[in] lineConfig     the line configuration
+*
+* \return None
+********************************************************************************** */
+static void SetLowLatencyMode(File portHandle, UARTLineConfig *lineConfig)
+{
+    struct serial_struct serial;
+    char path[300];
+    FILE *fp;
+
+    if (lineConfig->lowLatency) {
+        if (ioctl(portHandle, TIOCGSERIAL, &serial) == -1) {
+            logMessage(HSDK_WARNING, "[UARTConfiguration]InitPort", "TIOCGSERIAL not supported, ASYNC_LOW_LATENCY not set", HSDKThreadId());
+        } else {
+            serial.flags |= ASYNC_LOW_LATENCY;
+            if (ioctl(portHandle, TIOCSSERIAL, &serial) == -1) {
+                logMessage(HSDK_WARNING, "[UARTConfiguration]InitPort", "TIOCSSERIAL failed, ASYNC_LOW_LATENCY not set", HSDKThreadId());
+            }
+        }
+    }
+
+    if (lineConfig->latencyTimerMs > 0 && LatencyTimerPath(portHandle, path, sizeof(path)) == 0) {
+        fp = fopen(path, "w");
+        if (fp == NULL) {
+            logMessage(HSDK_WARNING, "[UARTConfiguration]InitPort", "Cannot write latency_timer, the bridge keeps its default", HSDKThreadId());
+            return;
+        }
+        fprintf(fp, "%u\n", lineConfig->latencyTimerMs);
+        fclose(fp);
+    }
+}
+#endif
+
 /*! *********************************************************************************
 * \brief  Initialize the COMPORT with the baudrate and sets the communication timeouts.
 *
@@ -347,6 +516,15 @@ int InitPort(File portHandle, UARTConfigurationData *config)
 #define B921600 0010007 /* OS X does not have a define for this baudrate. */
             rc = cfsetspeed(&newtio, B921600);
             break;
+        case BR_CUSTOM:
+#ifdef __linux__
+            /* Placeholder, replaced through termios2 once the attributes are set. */
+            rc = cfsetspeed(&newtio, B38400);
+#else
+            /* OS X takes the baudrate as a number. */
+            rc = cfsetspeed(&newtio, (speed_t)config->lineConfig->customBaudrate);
+#endif
+            break;
     }
 
     if (rc == -1) {
@@ -394,6 +572,12 @@ int InitPort(File portHandle, UARTConfigurationData *config)
             return 0;
     }
 
+    /* RTS/CTS in both directions: the UART stops sending while CTS is low and the
+    driver drops RTS when its receive buffer fills. */
+    if (config->lineConfig->handleRTSControl == RTSHANDSHAKE) {
+        newtio.c_cflag |= CRTSCTS;
+    }
+
     rc = tcflush(portHandle, TCIFLUSH);
     if (rc == -1) {
         perror("InitPort tcflush");
@@ -405,6 +589,15 @@ int InitPort(File portHandle, UARTConfigurationData *config)
         return -1;
     }
 
+#ifdef __linux__
+    if (config->lineConfig->baudrate == BR_CUSTOM &&
+            SetTermios2Baudrate(portHandle, config->lineConfig->customBaudrate) == -1) {
+        perror("InitPort SetTermios2Baudrate");
+        logMessage(HSDK_ERROR, "[UARTConfiguration]InitPort", "Failed to set the custom baudrate", HSDKThreadId());
+        return -1;
+    }
+#endif
+
     rc = ioctl(portHandle, TIOCMGET, &argp);
     if (rc == -1) {
         perror("InitPort ioctl(portHandle, TIOCMGET, &argp)");
@@ -418,6 +611,9 @@ int InitPort(File portHandle, UARTConfigurationData *config)
         case ENABLERTS:
             argp |= TIOCM_RTS;
             break;
+        case RTSHANDSHAKE:
+            /* Driven by the driver. */
+            break;
         default:
             return 0;
     }
@@ -439,7 +635,104 @@ int InitPort(File portHandle, UARTConfigurationData *config)
         return -1;
     }
 
+#ifdef __linux__
+    SetLowLatencyMode(portHandle, config->lineConfig);
+#endif
+
+    UARTPortSettings settings;
+    if (GetPortSettings(portHandle, &settings) == HSDK_ERROR_SUCCESS) {
+        char message[96];
+        snprintf(message, sizeof(message), "Port at %u baud, low latency %u, latency timer %d ms",
+                 settings.baudrate, settings.lowLatency, settings.latencyTimerMs);
+        logMessage(HSDK_INFO, "[UARTConfiguration]InitPort", message, HSDKThreadId());
+    }
+
     return 0;
 }
 
+/*! *********************************************************************************
+* \brief  Reads back the settings in effect on an open port.
+*
+* \param[in] portHandle     the port
+* \param[out] settings      the settings
+*
+* \return HSDK_ERROR_SUCCESS, an error code otherwise
+********************************************************************************** */
+int GetPortSettings(File portHandle, UARTPortSettings *settings)
+{
+    memset(settings, 0, sizeof(UARTPortSettings));
+    settings->latencyTimerMs = -1;
+
+#ifdef __linux__
+    struct serial_struct serial;
+    struct termios tio;
+    char path[300];
+    FILE *fp;
+
+    if (GetTermios2Baudrate(portHandle, &settings->baudrate) == -1) {
+        if (errno != ENOSYS) {
+            return errno;
+        }
+        /* No termios2 on this target, only the Bxxx speeds can be set. */
+        if (tcgetattr(portHandle, &tio) == -1) {
+            return errno;
+        }
+        settings->baudrate = SpeedToBaudrate(cfgetospeed(&tio));
+    }
+
+    if (ioctl(portHandle, TIOCGSERIAL, &serial) == 0) {
+        settings->lowLatency = (serial.flags & ASYNC_LOW_LATENCY) ? 1 : 0;
+    }
+
+    if (LatencyTimerPath(portHandle, path, sizeof(path)) == 0) {
+        fp = fopen(path, "r");
+        if (fp != NULL) {
+            if (fscanf(fp, "%d", &settings->latencyTimerMs) != 1) {
+                settings->latencyTimerMs = -1;
+            }
+            fclose(fp);
+        }
+    }
+#else
+    struct termios tio;
+
+    if (tcgetattr(portHandle, &tio) == -1) {
+        return errno;
+    }
+    settings->baudrate = (uint32_t)cfgetospeed(&tio);
+#endif
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+* \brief  Reads the receive error counters of a port with TIOCGICOUNT, counted by
+*         the driver since it registered the port. Not available on OS X.
+*
+* \param[in] portHandle     the port
+* \param[out] counters      the counters
+*
+* \return HSDK_ERROR_SUCCESS, an error code otherwise
+********************************************************************************** */
+int GetPortLineCounters(File portHandle, UARTLineCounters *counters)
+{
+    memset(counters, 0, sizeof(UARTLineCounters));
+
+#ifdef __linux__
+    struct serial_icounter_struct icount;
+
+    if (ioctl(portHandle, TIOCGICOUNT, &icount) == -1) {
+        return errno;
+    }
+    counters->overrun = (uint32_t)icount.overrun;
+    counters->parity = (uint32_t)icount.parity;
+    counters->frame = (uint32_t)icount.frame;
+    counters->bufOverrun = (uint32_t)icount.buf_overrun;
+
+    return HSDK_ERROR_SUCCESS;
+#else
+    return HSDK_ERROR_INVALID;
+#endif
+}
+
 #endif
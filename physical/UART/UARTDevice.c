@@ -40,6 +40,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#if __linux__ || __APPLE__
+#include <poll.h>
+#endif
 #include "PhysicalDevice.h"
 #include "UARTDevice.h"
 #include "UARTConfiguration.h"
@@ -62,8 +65,13 @@ static int UARTOpenPort(void *pDevice, void *configData);
 static int UARTClosePort(void *pDevice);
 static int UARTWrite(void *specificData, uint8_t *buf, uint32_t size);
 static int UARTRead(void *specificData, uint8_t *buf, uint32_t *size);
+static int UARTAvailable(void *specificData, uint32_t *size);
 static int UARTConfigure(void *specificData, void *configData);
 static Event UARTGetWaitEvent(void *, void **);
+#if __linux__ || __APPLE__
+static int UARTWriteSegments(void *specificData, RawSegment *segments, uint32_t count);
+static Event UARTGetWritableEvent(void *, void **);
+#endif
 static char *UARTSystemPath(char *uartPath);
 
 /************************************************************************************
@@ -102,6 +110,8 @@ int AttachToUARTDevice(PhysicalDevice *pDevice, char *deviceName)
     if (!pDevice->deviceHandle) {
         return HSDK_ERROR_ALLOC;
     }
+    /* Set the current PhysicalDevice as the parent for our handle. */
+    ((UARTHandle *)(pDevice->deviceHandle))->parent = pDevice;
     InitDeviceAsUART(pDevice);
 
     return HSDK_ERROR_SUCCESS;
@@ -118,7 +128,10 @@ int DetachFromUARTDevice(PhysicalDevice *pDevice)
     pDevice->open = NULL;
     pDevice->close = NULL;
     pDevice->read = NULL;
+    pDevice->available = NULL;
     pDevice->write = NULL;
+    pDevice->writeSegments = NULL;
+    pDevice->writable = NULL;
     pDevice->configure = NULL;
 
     return HSDK_ERROR_SUCCESS;
@@ -134,9 +147,14 @@ void InitDeviceAsUART(PhysicalDevice *device)
     device->open = UARTOpenPort;
     device->close = UARTClosePort;
     device->read = UARTRead;
+    device->available = UARTAvailable;
     device->write = UARTWrite;
     device->configure = UARTConfigure;
     device->waitable = UARTGetWaitEvent;
+#if __linux__ || __APPLE__
+    device->writeSegments = UARTWriteSegments;
+    device->writable = UARTGetWritableEvent;
+#endif
 }
 
 /*! *********************************************************************************
@@ -188,6 +206,8 @@ int DestroyUARTDevice(UARTHandle *device)
 
     free(device->deviceName);
     device->deviceName = NULL;
+    /* Not our job to free our parent. */
+    device->parent = NULL;
     free(device);
 
     return HSDK_ERROR_SUCCESS;
@@ -200,6 +220,14 @@ static Event UARTGetWaitEvent(void *device, void **asyncMask)
     return HSDKDeviceTriggerableEvent(pDevice->portHandle, asyncMask);
 }
 
+#if __linux__ || __APPLE__
+static Event UARTGetWritableEvent(void *device, void **asyncMask)
+{
+    UARTHandle *pDevice = (UARTHandle *)device;
+    return HSDKDeviceWritableEvent(pDevice->portHandle, asyncMask);
+}
+#endif
+
 
 /*! *********************************************************************************
 * \brief  Opens the specified port and creates the thread
@@ -227,6 +255,13 @@ static int UARTOpenPort(void *pDevice, void *configData)
         return HSDK_ERROR_INVALID;
     }
 
+#if __linux__ || __APPLE__
+    /* Frames are written as far as the tty buffer allows and resumed when it drains. */
+    if (HSDKSetFileNonBlocking(device->portHandle) != HSDK_ERROR_SUCCESS) {
+        logMessage(HSDK_WARNING, "[UARTDevice]UARTOpenPort", "Failed to make port non-blocking", HSDKThreadId());
+    }
+#endif
+
     UARTConfigurationData *pConfig = NULL;
     if (configData == NULL) {
         pConfig = defaultConfigurationData();
@@ -241,6 +276,9 @@ static int UARTOpenPort(void *pDevice, void *configData)
         rc = HSDK_ERROR_INVALID;
     }
 
+    /* The driver counts errors since it registered the port, they are reported from now on. */
+    GetPortLineCounters(device->portHandle, &device->countersAtOpen);
+
     if (freeConfig) {
         freeConfigurationData(pConfig);
     }
@@ -286,19 +324,85 @@ static int UARTClosePort(void *device)
 * \param[in] buffer         a byte array containing the data to be sent
 * \param[in] count          number of bytes to be written
 *
-* \return a positive integer for success, -1 for failure
+* \return a positive integer for success, -1 for failure, also when the port accepted
+*         none of the data for WriteTimeoutMs
 ********************************************************************************** */
 static int UARTWrite(void *specificData, uint8_t *buffer, uint32_t count)
 {
     UARTHandle *device = (UARTHandle *)specificData;
 
+#if __linux__ || __APPLE__
+    /* The port is non-blocking, wait for it to take all of the buffer. */
+    RawSegment segment = { buffer, count };
+    void *writeMask = NULL;
+    int triggeredEvent, err = 0;
+
+    while (segment.size > 0) {
+        err = UARTWriteSegments(device, &segment, 1);
+        if (err < 0) {
+            return err;
+        } else if (err > 0) {
+            segment.data += err;
+            segment.size -= (uint32_t)err;
+            continue;
+        }
+
+        Event writable = HSDKDeviceWritableEvent(device->portHandle, &writeMask);
+        if (writable == INVALID_EVENT_HANDLE) {
+            return -1;
+        }
+        err = HSDKWaitMultipleEvents(&writable, 1, device->parent->configParams->writeTimeoutMs, &triggeredEvent);
+        HSDKFinishTriggerableEvent(writeMask);
+        if (err != HSDK_ERROR_SUCCESS) {
+            logMessage(HSDK_WARNING, "[UARTDevice]UARTWrite", "Port not writable, write abandoned", HSDKThreadId());
+            return -1;
+        }
+    }
+
+    return (int)count;
+#else
     int err = HSDKWriteFile(device->portHandle, buffer, count);
 
     if (err == -1) {
         logMessage(HSDK_WARNING, "[UARTDevice]UARTWrite", "Error writing data to port", HSDKThreadId());
     }
     return err;
+#endif
+}
+
+#if __linux__ || __APPLE__
+/*! *********************************************************************************
+* \brief  Write the segments of a frame to the UART device, in a single call and
+*         without waiting for the port to accept them.
+*
+* \param[in] specificData   a pointer to the UART device
+* \param[in] segments       the segments to be sent, in order
+* \param[in] count          number of segments
+*
+* \return number of bytes written, 0 if the port accepts no data now, -1 for failure
+********************************************************************************** */
+static int UARTWriteSegments(void *specificData, RawSegment *segments, uint32_t count)
+{
+    UARTHandle *device = (UARTHandle *)specificData;
+    uint8_t *buffers[RAW_FRAME_SEGMENTS];
+    uint32_t counts[RAW_FRAME_SEGMENTS], i;
+
+    if (count > RAW_FRAME_SEGMENTS) {
+        count = RAW_FRAME_SEGMENTS;
+    }
+    for (i = 0; i < count; i++) {
+        buffers[i] = segments[i].data;
+        counts[i] = segments[i].size;
+    }
+
+    int err = HSDKWriteFileVector(device->portHandle, buffers, counts, count);
+
+    if (err == -1) {
+        logMessage(HSDK_WARNING, "[UARTDevice]UARTWriteSegments", "Error writing data to port", HSDKThreadId());
+    }
+    return err;
 }
+#endif
 
 /*! *********************************************************************************
 * \brief  Read data to the UART device.
@@ -318,9 +422,59 @@ static int UARTRead(void *specificData, uint8_t *buffer, uint32_t *count)
     if (err != HSDK_ERROR_SUCCESS) {
         logMessage(HSDK_WARNING, "[UARTDevice]UARTRead", "Error reading data from port", HSDKThreadId());
     }
+#if __linux__ || __APPLE__
+    /* A tty hung up by the removal of its USB device reads as end of file. */
+    else if (*count == 0) {
+        struct pollfd pfd = { device->portHandle, POLLIN, 0 };
+        if (poll(&pfd, 1, 0) == 1 && (pfd.revents & (POLLHUP | POLLERR | POLLNVAL))) {
+            logMessage(HSDK_WARNING, "[UARTDevice]UARTRead", "Port hung up", HSDKThreadId());
+            err = HSDK_ERROR_INVALID;
+        }
+    }
+#endif
     return err;
 }
 
+/*! *********************************************************************************
+* \brief  Gets the number of bytes waiting in the input buffer of the UART device.
+*
+* \param[in] specificData   a pointer to the UART device
+* \param[out] size          number of bytes that can be read without blocking
+*
+* \return 0 for success, an error code for failure
+********************************************************************************** */
+static int UARTAvailable(void *specificData, uint32_t *size)
+{
+    UARTHandle *device = (UARTHandle *)specificData;
+
+    return HSDKBytesAvailable(device->portHandle, size);
+}
+
+/*! *********************************************************************************
+* \brief  Returns the receive errors counted by the driver since the port was opened.
+*
+* \param[in] specificData   pointer to a UART handle
+* \param[out] counters      the counters
+*
+* \return 0 for success, an error code if the driver does not count them
+********************************************************************************** */
+int UARTGetLineCounters(void *specificData, UARTLineCounters *counters)
+{
+    UARTHandle *device = (UARTHandle *)specificData;
+
+    int rc = GetPortLineCounters(device->portHandle, counters);
+    if (rc != HSDK_ERROR_SUCCESS) {
+        return rc;
+    }
+
+    counters->overrun -= device->countersAtOpen.overrun;
+    counters->parity -= device->countersAtOpen.parity;
+    counters->frame -= device->countersAtOpen.frame;
+    counters->bufOverrun -= device->countersAtOpen.bufOverrun;
+
+    return HSDK_ERROR_SUCCESS;
+}
+
 /*! *********************************************************************************
 * \brief  Wrapper over UARTOpen.
 *
@@ -155,24 +155,27 @@ void DestroyDeviceManager()
 
     HSDKAcquireLock(listLock);
 
-    Node *crt = deviceManager->currentActiveDevices;
+    Node *crt = deviceManager->currentActiveDevices, *next;
     while (crt != NULL) {
         DestroyDeviceState((DeviceState *)crt->data);
-        crt->data = NULL;
+        next = crt->next;
+        DestroyNode(crt);
 
-        crt = crt->next;
+        crt = next;
     }
 
-    crt = deviceManager->currentActiveDevices;
+    crt = deviceManager->listOfFSIdentities;
     while (crt != NULL) {
         DestroyIdentifierNode(crt->data);
-        crt->data = NULL;
+        next = crt->next;
+        DestroyNode(crt);
 
-        crt = crt->next;
+        crt = next;
     }
 
     HSDKReleaseLock(listLock);
 
+    HSDKDestroyEvent(deviceManager->stopThread);
     free(deviceManager);
 
     HSDKDestroyLock(listLock);
@@ -221,7 +224,6 @@ void DestroyDeviceState(DeviceState *deviceState)
             free(deviceState->deviceName);
         }
 
-#ifdef _WIN32
         if (deviceState->vid != NULL) {
             free(deviceState->vid);
         }
@@ -229,7 +231,7 @@ void DestroyDeviceState(DeviceState *deviceState)
         if (deviceState->pid != NULL) {
             free(deviceState->pid);
         }
-#endif
+
         free(deviceState);
     }
 }
@@ -310,10 +312,8 @@ static DeviceNotification *CreateNotification(Node *oldNode, DeviceNotificationE
     state->deviceName = strdup(oldState->deviceName);
     state->friendlyName = strdup(oldState->friendlyName);
     state->isKinetisWDevice = oldState->isKinetisWDevice;
-#ifdef _WIN32
-    state->vid = strdup(oldState->vid);
-    state->pid = strdup(oldState->pid);
-#endif
+    state->vid = (oldState->vid != NULL) ? strdup(oldState->vid) : NULL;
+    state->pid = (oldState->pid != NULL) ? strdup(oldState->pid) : NULL;
     state->state = oldState->state;
     return deviceNotification;
 }
@@ -335,6 +335,7 @@ static void UpdateListOfDevices(Node **head, Node *newNode, uint8_t notify)
     while (crt != NULL) {
         if (!strncmp(((DeviceState *)crt->data)->deviceName, ((DeviceState *)newNode->data)->deviceName, MAXNAME)) {
             crt->found = 1;
+            DestroyDeviceState((DeviceState *)newNode->data);
             DestroyNode(newNode);
             break;
         }
@@ -381,6 +382,7 @@ static void RemoveNotFound(Node **head, uint8_t notify)
                 NotifyOnEvent(deviceManager->evtManager, CreateNotification(crt, DeviceRemoved));
             }
             prev->next = crt->next;
+            DestroyDeviceState((DeviceState *)crt->data);
             DestroyNode(crt);
         }
 
@@ -396,6 +398,7 @@ static void RemoveNotFound(Node **head, uint8_t notify)
             NotifyOnEvent(deviceManager->evtManager, CreateNotification(crt, DeviceRemoved));
         }
 
+        DestroyDeviceState((DeviceState *)crt->data);
         DestroyNode(crt);
     }
 
@@ -914,43 +917,55 @@ static void *DeviceNotificationRoutine(void *lpParameter)
 
 #include <termios.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
 #ifdef __linux__udev__
 #   include <libudev.h>
 #endif
 
+#define SYSFS_TTY_CLASS "/sys/class/tty"
+#define SYSFS_ATTRIBUTE_SIZE 128
+
+/* Multicast group of the uevents sent by the kernel. */
+#define UEVENT_KERNEL_GROUP 1
+#define UEVENT_BUFFER_SIZE 8192
+
+/* USB to UART bridges of the Kinetis-W boards, as (vendor ID, product ID). */
+static const char *kinetisWIdentities[][2] = {
+    { "2504", "0300" },
+    { "15A2", "0300" },
+    { "15A2", "005A" },
+    { "1357", "0089" },
+    { "0403", "6001" },
+    { "1357", "0707" },
+    { "1366", "0105" },
+    { "0D28", "0204" }, // FRDM-KW40Z
+    { "1366", "1015" }, // J-Link CDC UART
+};
+
 static void SetState(DeviceState *device) {}
 static void CreateListOfKinetisWIdentities() {}
-static void CreateInitialList() {}
-static void *DeviceNotificationRoutine(void *lpParameter)
-{
-    return NULL;
-}
-
-char **vendorList;
-char **productList;
+static DeviceState *ScanTtyDevices(uint32_t *size);
 
 int isKinetisWDevice(const char *idVendor, const char *idProduct)
 {
-    int i;
-
-    if (vendorList == NULL) {
-        vendorList = (char **)calloc(9, sizeof(char *));
-        productList = (char **)calloc(9, sizeof(char *));
-
-        vendorList[0] = strdup("2504"); productList[0] = strdup("0300");
-        vendorList[1] = strdup("15A2"); productList[1] = strdup("0300");
-        vendorList[2] = strdup("15A2"); productList[2] = strdup("005A");
-        vendorList[3] = strdup("1357"); productList[3] = strdup("0089");
-        vendorList[4] = strdup("0403"); productList[4] = strdup("6001");
-        vendorList[5] = strdup("1357"); productList[5] = strdup("0707");
-        vendorList[6] = strdup("1366"); productList[6] = strdup("0105");
-        vendorList[7] = strdup("0D28"); productList[7] = strdup("0204"); // FRDM-KW40Z
-        vendorList[8] = strdup("1366"); productList[8] = strdup("1015"); // J-Link CDC UART
+    uint32_t i;
+
+    if (idVendor == NULL || idProduct == NULL) {
+        return 0;
     }
 
-    for (i = 0; i < 9; i++) {
-        if (strcmp(vendorList[i], idVendor) && strcmp(productList[i], idProduct)) {
+    /* sysfs and udev report the IDs in lower case. */
+    for (i = 0; i < sizeof(kinetisWIdentities) / sizeof(kinetisWIdentities[0]); i++) {
+        if (strcasecmp(kinetisWIdentities[i][0], idVendor) == 0 &&
+                strcasecmp(kinetisWIdentities[i][1], idProduct) == 0) {
             return 1;
         }
     }
@@ -958,26 +973,64 @@ int isKinetisWDevice(const char *idVendor, const char *idProduct)
     return 0;
 }
 
-/*
- * Overriding GetAllDevices feature for Linux.
- */
-DeviceState *GetAllDevices(uint32_t *size)
+/*! *********************************************************************************
+* \brief  Appends a DeviceState to a list of devices, growing it as needed.
+*
+* \param[in,out] allDevices the list of devices
+* \param[in,out] size       number of devices in the list
+* \param[in,out] capacity   number of devices the list has room for
+* \param[in] devNode        the device file, e.g. /dev/ttyACM0
+* \param[in] vid            the vendor ID of the USB device
+* \param[in] pid            the product ID of the USB device
+* \param[in] product        the product string of the USB device, NULL if it has none
+*
+* \return HSDK_ERROR_SUCCESS, HSDK_ERROR_ALLOC if the list could not be grown
+********************************************************************************** */
+static int AppendDeviceState(DeviceState **allDevices, uint32_t *size, uint32_t *capacity,
+                             const char *devNode, const char *vid, const char *pid, const char *product)
 {
-#ifdef __linux__udev__
-    *size = 0;
+    if (*size == *capacity) {
+        uint32_t newCapacity = (*capacity == 0) ? 8 : *capacity * 2;
+        DeviceState *devices = (DeviceState *)realloc(*allDevices, newCapacity * sizeof(DeviceState));
+        if (devices == NULL) {
+            return HSDK_ERROR_ALLOC;
+        }
+        *allDevices = devices;
+        *capacity = newCapacity;
+    }
 
-    HSDKAcquireLock(listLock);
+    DeviceState *deviceState = &(*allDevices)[*size];
+    memset(deviceState, 0, sizeof(DeviceState));
+
+    deviceState->state = Available;
+    deviceState->deviceName = strdup(devNode);
+    deviceState->friendlyName = strdup((product != NULL && product[0] != '\0') ? product : devNode);
+    deviceState->vid = strdup(vid);
+    deviceState->pid = strdup(pid);
+    deviceState->isKinetisWDevice = (uint8_t)isKinetisWDevice(vid, pid);
 
+    *size = *size + 1;
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+#ifdef __linux__udev__
+/*
+ * Enumerates the tty devices through libudev.
+ */
+static DeviceState *ScanTtyDevices(uint32_t *size)
+{
     struct udev *udev;
     struct udev_enumerate *enumerate;
     struct udev_list_entry *devices, *dev_list_entry;
+    DeviceState *allDevices = NULL;
+    uint32_t capacity = 0;
 
-    /* Get the number of connected devices. */
     udev = udev_new();
 
     if (!udev) {
         printf("Can't create udev\n");
-        exit(1);
+        return NULL;
     }
 
     enumerate = udev_enumerate_new(udev);
@@ -986,79 +1039,301 @@ DeviceState *GetAllDevices(uint32_t *size)
     devices = udev_enumerate_get_list_entry(enumerate);
 
     udev_list_entry_foreach(dev_list_entry, devices) {
-        *size = *size + 1;
+        const char *path = udev_list_entry_get_name(dev_list_entry);
+        struct udev_device *tty = udev_device_new_from_syspath(udev, path);
+        if (tty == NULL) {
+            continue;
+        }
+
+        /* The parent belongs to the tty device and is released along with it. */
+        struct udev_device *dev = udev_device_get_parent_with_subsystem_devtype(tty, "usb", "usb_device");
+        const char *devFile = udev_device_get_devnode(tty);
+
+        if (dev != NULL && devFile != NULL &&
+                udev_device_get_sysattr_value(dev, "idVendor") != NULL &&
+                udev_device_get_sysattr_value(dev, "idProduct") != NULL) {
+            AppendDeviceState(&allDevices, size, &capacity, devFile,
+                              udev_device_get_sysattr_value(dev, "idVendor"),
+                              udev_device_get_sysattr_value(dev, "idProduct"),
+                              udev_device_get_sysattr_value(dev, "product"));
+        }
+
+        udev_device_unref(tty);
     }
 
     udev_enumerate_unref(enumerate);
 
     udev_unref(udev);
 
-    /* Get info about devices. */
-    DeviceState *allDevices = (DeviceState *)calloc(*size, sizeof(DeviceState));
-    int i = 0;
+    return allDevices;
+}
+#else
+/*
+ * Reads a sysfs attribute, without the trailing newline. Returns 0 on success.
+ */
+static int ReadSysfsAttribute(const char *dir, const char *name, char *value, size_t size)
+{
+    char path[PATH_MAX];
+    ssize_t len;
 
-    udev = udev_new();
+    if (snprintf(path, sizeof(path), "%s/%s", dir, name) >= (int)sizeof(path)) {
+        return -1;
+    }
 
-    if (!udev) {
-        printf("Can't create udev\n");
-        exit(1);
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return -1;
     }
 
-    enumerate = udev_enumerate_new(udev);
-    udev_enumerate_add_match_subsystem(enumerate, "tty");
-    udev_enumerate_scan_devices(enumerate);
-    devices = udev_enumerate_get_list_entry(enumerate);
+    len = read(fd, value, size - 1);
+    close(fd);
 
-    udev_list_entry_foreach(dev_list_entry, devices) {
-        const char *path;
-        const char *devFile;
+    if (len <= 0) {
+        return -1;
+    }
+
+    while (len > 0 && (value[len - 1] == '\n' || value[len - 1] == ' ')) {
+        len--;
+    }
+    value[len] = '\0';
 
-        path = udev_list_entry_get_name(dev_list_entry);
-        struct udev_device *dev = udev_device_new_from_syspath(udev, path);
+    return 0;
+}
 
-        devFile = udev_device_get_devnode(dev);
+/*
+ * Enumerates the tty devices by reading /sys/class/tty. The link of each entry
+ * holds the path of the device in sysfs, so the ttys that are not on a USB bus
+ * (virtual consoles, on-board UARTs) are skipped without reading any attribute.
+ * The USB device of the others is the closest parent directory holding idVendor.
+ */
+static DeviceState *ScanTtyDevices(uint32_t *size)
+{
+    DIR *dir;
+    struct dirent *entry;
+    DeviceState *allDevices = NULL;
+    uint32_t capacity = 0;
+    char path[PATH_MAX], usbDevice[PATH_MAX];
+    char vid[SYSFS_ATTRIBUTE_SIZE], pid[SYSFS_ATTRIBUTE_SIZE], product[SYSFS_ATTRIBUTE_SIZE];
+    char devNode[PATH_MAX];
+    ssize_t len;
+
+    dir = opendir(SYSFS_TTY_CLASS);
+    if (dir == NULL) {
+        return NULL;
+    }
 
-        dev = udev_device_get_parent_with_subsystem_devtype(
-                  dev,
-                  "usb",
-                  "usb_device");
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
 
-        if (dev) {
-            DeviceState *deviceState = (DeviceState *)calloc(1, sizeof(DeviceState));
+        snprintf(path, sizeof(path), "%s/%s", SYSFS_TTY_CLASS, entry->d_name);
+        len = snprintf(usbDevice, sizeof(usbDevice), "%s/", SYSFS_TTY_CLASS);
+        ssize_t linkLen = readlink(path, usbDevice + len, sizeof(usbDevice) - len - 1);
+        if (linkLen <= 0) {
+            continue;
+        }
+        usbDevice[len + linkLen] = '\0';
 
-            deviceState->state = Available;
-            deviceState->friendlyName = (char *) devFile;
-            deviceState->deviceName = (char *) devFile;
-            deviceState->isKinetisWDevice = 0;
-            deviceState->vid = strdup(udev_device_get_sysattr_value(dev, "idVendor"));
-            deviceState->pid = strdup(udev_device_get_sysattr_value(dev, "idProduct"));
+        if (strstr(usbDevice + len, "/usb") == NULL) {
+            continue;
+        }
 
-            if (isKinetisWDevice(deviceState->vid, deviceState->pid)) {
-                deviceState->isKinetisWDevice = 1;
+        /* Walk up from the tty to the USB device; stop at the sysfs class directory. */
+        char *slash;
+        while ((slash = strrchr(usbDevice, '/')) != NULL && slash - usbDevice > len) {
+            *slash = '\0';
+            if (ReadSysfsAttribute(usbDevice, "idVendor", vid, sizeof(vid)) == 0) {
+                break;
             }
+        }
+        if (slash == NULL || slash - usbDevice <= len ||
+                ReadSysfsAttribute(usbDevice, "idProduct", pid, sizeof(pid)) != 0) {
+            continue;
+        }
+        if (ReadSysfsAttribute(usbDevice, "product", product, sizeof(product)) != 0) {
+            product[0] = '\0';
+        }
+
+        snprintf(devNode, sizeof(devNode), "/dev/%s", entry->d_name);
+        AppendDeviceState(&allDevices, size, &capacity, devNode, vid, pid, product);
+    }
+
+    closedir(dir);
+
+    return allDevices;
+}
+#endif
+
+/*! *********************************************************************************
+* \brief  Scans the tty devices and updates the list of current devices with them,
+*         adding the new ones and removing those no longer in the system.
+*
+* \param[in] notify  whether to notify the subscribers on each device change found
+*
+* \return nothing
+********************************************************************************** */
+static void CheckTtyDevices(uint8_t notify)
+{
+    uint32_t size = 0, i;
+    DeviceState *devices = ScanTtyDevices(&size);
 
-            allDevices[i] = *deviceState;
+    for (i = 0; i < size; i++) {
+        DeviceState *deviceState = (DeviceState *)malloc(sizeof(DeviceState));
+        Node *node = (deviceState != NULL) ? CreateNode(deviceState) : NULL;
+        if (node == NULL) {
             free(deviceState);
-            i++;
+            deviceState = &devices[i];
+            free(deviceState->friendlyName);
+            free(deviceState->deviceName);
+            free(deviceState->vid);
+            free(deviceState->pid);
+            continue;
         }
+
+        *deviceState = devices[i];
+        UpdateListOfDevices(&deviceManager->currentActiveDevices, node, notify);
     }
+    free(devices);
 
-    udev_enumerate_unref(enumerate);
+    RemoveNotFound(&deviceManager->currentActiveDevices, notify);
+}
 
-    udev_unref(udev);
+/*! *********************************************************************************
+* \brief  Creates the initial list of devices
+*
+* \return nothing
+********************************************************************************** */
+static void CreateInitialList()
+{
+    CheckTtyDevices(0);
+}
 
-    HSDKReleaseLock(listLock);
+/*! *********************************************************************************
+* \brief  Reads all the uevents waiting on the socket.
+*
+* \param[in] sock    the NETLINK_KOBJECT_UEVENT socket
+*
+* \return 1 if a tty was added or removed, or events were lost; 0 otherwise
+********************************************************************************** */
+static int ReadUevents(int sock)
+{
+    char buffer[UEVENT_BUFFER_SIZE];
+    struct sockaddr_nl sender;
+    socklen_t senderLength;
+    ssize_t len;
+    int ttyChanged = 0;
+
+    for (;;) {
+        senderLength = sizeof(sender);
+        len = recvfrom(sock, buffer, sizeof(buffer) - 1, 0, (struct sockaddr *)&sender, &senderLength);
+        if (len < 0) {
+            /* The socket buffer overflowed, rescan rather than miss a device. */
+            if (errno == ENOBUFS) {
+                ttyChanged = 1;
+                continue;
+            }
+            break;
+        }
 
-    return allDevices;
-#else
-    fprintf(stderr, "[HSDK-Warning] "
-            "UART library is compiled w/o udev (device detection) support. "
-            "Define USE_UDEV=__linux__udev__ in Makefile to enable it.\n"
-           );
+        /* Only the kernel is trusted, not other processes of the group. */
+        if (sender.nl_pid != 0 || len == 0) {
+            continue;
+        }
+        buffer[len] = '\0';
+
+        /* "ACTION@DEVPATH" followed by NUL-terminated KEY=VALUE pairs. */
+        uint8_t addOrRemove = (strncmp(buffer, "add@", 4) == 0 || strncmp(buffer, "remove@", 7) == 0);
+        char *field = buffer + strlen(buffer) + 1;
+        while (addOrRemove && field < buffer + len) {
+            if (strcmp(field, "SUBSYSTEM=tty") == 0) {
+                ttyChanged = 1;
+                break;
+            }
+            field += strlen(field) + 1;
+        }
+    }
+
+    return ttyChanged;
+}
+
+/*! *********************************************************************************
+* \brief  The routine for the DeviceManager thread on Linux. It waits on a netlink
+*         socket for the uevents of the kernel and rescans the tty devices when one
+*         is added or removed, so it takes no CPU time while no device changes.
+*
+* \param[in] lpParameter    a pointer to the thread parameter
+*
+* \return nothing
+********************************************************************************** */
+static void *DeviceNotificationRoutine(void *lpParameter)
+{
+    int triggeredEvent;
+    int loop = 1;
+    void *ueventMask = NULL;
+    struct sockaddr_nl address;
+
+    int sock = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (sock == -1) {
+        return NULL;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = UEVENT_KERNEL_GROUP;
+    if (bind(sock, (struct sockaddr *)&address, sizeof(address)) == -1) {
+        close(sock);
+        return NULL;
+    }
+
+    /* Devices plugged in between the initial list and the bind. */
+    CheckTtyDevices(1);
+
+    Event eventArray[2];
+    eventArray[0] = deviceManager->stopThread;
+    eventArray[1] = HSDKDeviceTriggerableEvent(sock, &ueventMask);
+
+    while (loop) {
+        int rc = HSDKWaitMultipleEvents(eventArray, 2, INFINITE_WAIT, &triggeredEvent);
+
+        if (rc != HSDK_ERROR_SUCCESS) {
+            loop = 0;
+            continue;
+        }
+
+        switch (triggeredEvent) {
+            case 0:
+                loop = 0;
+                break;
+            case 1:
+                if (ReadUevents(sock)) {
+                    CheckTtyDevices(1);
+                }
+                break;
+        }
+    }
+
+    HSDKFinishTriggerableEvent(ueventMask);
+    close(sock);
     return NULL;
-#endif
 }
 
+/*
+ * Overriding GetAllDevices feature for Linux. The devices are found through
+ * sysfs, or through libudev when built with __linux__udev__.
+ */
+DeviceState *GetAllDevices(uint32_t *size)
+{
+    *size = 0;
+
+    HSDKAcquireLock(listLock);
+
+    DeviceState *allDevices = ScanTtyDevices(size);
+
+    HSDKReleaseLock(listLock);
+
+    return allDevices;
+}
 
 #elif __APPLE__
 
@@ -0,0 +1,108 @@
+/*! *********************************************************************************
+* \file UARTTermios2.c
+* This is a source file for the UARTTermios2 module. It sets and reads back the
+* baudrate of a port as a number, through the kernel's struct termios2 and BOTHER.
+* The kernel definitions clash with the ones of the C library's <termios.h>, hence
+* this separate module.
+*
+* Copyright 2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************** */
+#include "UARTTermios2.h"
+
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+/* Per architecture: the size of c_cc differs, e.g. on MIPS, and some have no TCGETS2. */
+#include <asm/termbits.h>
+#include <asm/ioctls.h>
+#endif
+
+#if defined(__linux__) && defined(TCGETS2)
+
+/*! *********************************************************************************
+* \brief  Sets a baudrate that has no Bxxx constant, through termios2 and BOTHER.
+*         The other attributes of the port are kept.
+*
+* \param[in] portHandle     the port
+* \param[in] baudrate       the baudrate in bits per second
+*
+* \return 0 for success, -1 otherwise with errno set
+********************************************************************************** */
+int SetTermios2Baudrate(File portHandle, uint32_t baudrate)
+{
+    struct termios2 tio;
+
+    if (ioctl(portHandle, TCGETS2, &tio) == -1) {
+        return -1;
+    }
+
+    tio.c_cflag &= ~CBAUD;
+    tio.c_cflag |= BOTHER;
+    tio.c_ispeed = baudrate;
+    tio.c_ospeed = baudrate;
+
+    return ioctl(portHandle, TCSETS2, &tio);
+}
+
+/*! *********************************************************************************
+* \brief  Reads the output baudrate of a port in bits per second.
+*
+* \param[in] portHandle     the port
+* \param[out] baudrate      the baudrate
+*
+* \return 0 for success, -1 otherwise with errno set
+********************************************************************************** */
+int GetTermios2Baudrate(File portHandle, uint32_t *baudrate)
+{
+    struct termios2 tio;
+
+    if (ioctl(portHandle, TCGETS2, &tio) == -1) {
+        return -1;
+    }
+    *baudrate = tio.c_ospeed;
+
+    return 0;
+}
+
+#else
+
+/* No termios2 on this target: errno is ENOSYS and the callers use the Bxxx speeds. */
+int SetTermios2Baudrate(File portHandle, uint32_t baudrate)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+int GetTermios2Baudrate(File portHandle, uint32_t *baudrate)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif
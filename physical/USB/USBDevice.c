@@ -0,0 +1,644 @@
+/*! *********************************************************************************
+* \file USBDevice.c
+* This is a source file for the USBDevice module.
+*
+* Copyright 2015-2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************** */
+
+/************************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PhysicalDevice.h"
+#include "USBDevice.h"
+#include "MemoryPool.h"
+
+#include "hsdkError.h"
+#include "hsdkLogger.h"
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+/* CDC class request setting DTR and RTS, which CDC ACM firmware waits for before sending. */
+#define CDC_SET_CONTROL_LINE_STATE  0x22
+#define CDC_LINE_STATE_DTR_RTS      0x0003
+#define CDC_REQUEST_TYPE            (LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE | LIBUSB_ENDPOINT_OUT)
+
+#define USB_CONTROL_TIMEOUT_MS      1000
+#define USB_WRITE_TIMEOUT_MS        1000
+
+/* Longest time the event thread waits for libusb events before checking for a close. */
+#define USB_EVENT_TIMEOUT_US        100000
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+static USBHandle *InitUSBDevice(char *);
+static int DestroyUSBDevice(USBHandle *);
+static void InitDeviceAsUSB(PhysicalDevice *);
+static libusb_device_handle *OpenMatchingDevice(USBHandle *);
+static int FindBulkEndpoints(USBHandle *);
+static int SubmitReadTransfers(USBHandle *);
+static void FreeReadTransfers(USBHandle *);
+static void LIBUSB_CALL USBReadCallback(struct libusb_transfer *);
+static void *USBEventThreadRoutine(void *);
+static int USBOpenPort(void *, void *);
+static int USBClosePort(void *);
+static int USBWrite(void *pDevice, uint8_t *buffer, uint32_t count);
+static Event USBGetWaitEvent(void *, void **);
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+int AttachToUSBDevice(PhysicalDevice *pDevice, char *deviceName)
+{
+    pDevice->deviceHandle = InitUSBDevice(deviceName);
+    if (pDevice->deviceHandle == NULL) {
+        return -1;
+    }
+
+    InitDeviceAsUSB(pDevice);
+
+    /* Set the current PhysicalDevice as the parent for our handle. */
+    ((USBHandle *)(pDevice->deviceHandle))->parent = pDevice;
+
+    return 0;
+}
+
+int DetachFromUSBDevice(PhysicalDevice *pDevice)
+{
+    int rc = DestroyUSBDevice((USBHandle *)(pDevice->deviceHandle));
+    if (rc != 0) {
+        return rc;
+    }
+
+    pDevice->deviceHandle = NULL;
+    pDevice->open = NULL;
+    pDevice->close = NULL;
+    pDevice->read = NULL;
+    pDevice->write = NULL;
+    pDevice->waitable = NULL;
+
+    return 0;
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+static void InitDeviceAsUSB(PhysicalDevice *device)
+{
+    device->open = USBOpenPort;
+    device->close = USBClosePort;
+    device->read = NULL;  // RX is delivered by the transfer callbacks
+    device->write = USBWrite;
+    device->configure = NULL; // not used
+    device->waitable = USBGetWaitEvent;
+}
+
+/*! *********************************************************************************
+* \brief  Initializes a USB device.
+*
+* \param[in] deviceName - the board as vid:pid in hex, optionally followed by
+* @bus.address to choose between boards with the same IDs, e.g. 1fc9:0021@1.4
+*
+* \return a pointer to a USBHandle, NULL if the name is not valid
+********************************************************************************** */
+static USBHandle *InitUSBDevice(char *deviceName)
+{
+    unsigned int vendorId, productId, busNumber, deviceAddress;
+
+    if (deviceName == NULL || strlen(deviceName) == 0) {
+        logMessage(HSDK_ERROR, "[USBDevice]InitUSBDevice", "Device name is null or empty", HSDKThreadId());
+        return NULL;
+    }
+
+    int fields = sscanf(deviceName, "%x:%x@%u.%u", &vendorId, &productId, &busNumber, &deviceAddress);
+    if (fields != 2 && fields != 4) {
+        logMessage(HSDK_ERROR, "[USBDevice]InitUSBDevice", "Device name is not vid:pid[@bus.address]", HSDKThreadId());
+        return NULL;
+    }
+
+    USBHandle *device = (USBHandle *) calloc(1, sizeof(USBHandle));
+    if (device == NULL) {
+        logMessage(HSDK_ERROR, "[USBDevice]InitUSBDevice", "Memory allocation failed", HSDKThreadId());
+        return NULL;
+    }
+
+    device->deviceName = strdup(deviceName);
+    device->vendorId = (uint16_t)vendorId;
+    device->productId = (uint16_t)productId;
+    device->busNumber = (fields == 4) ? (int)busNumber : -1;
+    device->deviceAddress = (fields == 4) ? (int)deviceAddress : -1;
+    device->commInterface = -1;
+    device->dataInterface = -1;
+    device->eventThread = INVALID_THREAD_HANDLE;
+
+    return device;
+}
+
+/*! *********************************************************************************
+* \brief  Free the space allocated for the USB device.
+*
+* \param[in] device pointer to the USB handle.
+*
+* \return 0 for success, -1 for failure
+********************************************************************************** */
+static int DestroyUSBDevice(USBHandle *device)
+{
+    if (device == NULL) {
+        logMessage(HSDK_ERROR, "[USBDevice]DestroyUSBDevice", "Argument is null", HSDKThreadId());
+        return -1;
+    }
+
+    if (device->context != NULL) {
+        USBClosePort(device);
+    }
+
+    free(device->deviceName);
+    device->deviceName = NULL;
+    /* Not our job to free our parent. */
+    device->parent = NULL;
+    free(device);
+
+    return 0;
+}
+
+/*! *********************************************************************************
+* \brief  Opens the first board with the IDs, bus and address of the handle.
+*
+* \param[in] device pointer to the USB handle, with its libusb context created
+*
+* \return the opened board, NULL if none was found or it could not be opened
+********************************************************************************** */
+static libusb_device_handle *OpenMatchingDevice(USBHandle *device)
+{
+    libusb_device **list;
+    libusb_device_handle *usbHandle = NULL;
+    struct libusb_device_descriptor descriptor;
+    ssize_t count, i;
+    int rc = LIBUSB_ERROR_NOT_FOUND;
+
+    count = libusb_get_device_list(device->context, &list);
+    if (count < 0) {
+        logMessage(HSDK_ERROR, "[USBDevice]OpenMatchingDevice", libusb_error_name((int)count), HSDKThreadId());
+        return NULL;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (libusb_get_device_descriptor(list[i], &descriptor) != LIBUSB_SUCCESS ||
+                descriptor.idVendor != device->vendorId || descriptor.idProduct != device->productId) {
+            continue;
+        }
+        if (device->busNumber != -1 &&
+                (libusb_get_bus_number(list[i]) != device->busNumber ||
+                 libusb_get_device_address(list[i]) != device->deviceAddress)) {
+            continue;
+        }
+
+        rc = libusb_open(list[i], &usbHandle);
+        break;
+    }
+
+    libusb_free_device_list(list, 1);
+
+    if (rc != LIBUSB_SUCCESS) {
+        logMessage(HSDK_ERROR, "[USBDevice]OpenMatchingDevice", libusb_error_name(rc), HSDKThreadId());
+        return NULL;
+    }
+
+    return usbHandle;
+}
+
+/*! *********************************************************************************
+* \brief  Looks up the CDC interfaces of the active configuration: the data
+* interface with a bulk IN and a bulk OUT endpoint and, if present, the
+* communication interface.
+*
+* \param[in,out] device pointer to the USB handle, with the board opened
+*
+* \return HSDK_ERROR_SUCCESS if the bulk endpoints were found, HSDK_ERROR_INVALID otherwise
+********************************************************************************** */
+static int FindBulkEndpoints(USBHandle *device)
+{
+    struct libusb_config_descriptor *config;
+    uint8_t i, j;
+
+    int rc = libusb_get_active_config_descriptor(libusb_get_device(device->usbHandle), &config);
+    if (rc != LIBUSB_SUCCESS) {
+        logMessage(HSDK_ERROR, "[USBDevice]FindBulkEndpoints", libusb_error_name(rc), HSDKThreadId());
+        return HSDK_ERROR_INVALID;
+    }
+
+    for (i = 0; i < config->bNumInterfaces; i++) {
+        if (config->interface[i].num_altsetting == 0) {
+            continue;
+        }
+
+        const struct libusb_interface_descriptor *alt = &config->interface[i].altsetting[0];
+
+        if (alt->bInterfaceClass == LIBUSB_CLASS_COMM && device->commInterface == -1) {
+            device->commInterface = alt->bInterfaceNumber;
+            continue;
+        }
+
+        if (alt->bInterfaceClass != LIBUSB_CLASS_DATA || device->dataInterface != -1) {
+            continue;
+        }
+
+        uint8_t in = 0, out = 0;
+        uint16_t packetSize = 0;
+        for (j = 0; j < alt->bNumEndpoints; j++) {
+            const struct libusb_endpoint_descriptor *ep = &alt->endpoint[j];
+            if ((ep->bmAttributes & LIBUSB_TRANSFER_TYPE_MASK) != LIBUSB_TRANSFER_TYPE_BULK) {
+                continue;
+            }
+            if (ep->bEndpointAddress & LIBUSB_ENDPOINT_IN) {
+                in = ep->bEndpointAddress;
+            } else {
+                out = ep->bEndpointAddress;
+                packetSize = ep->wMaxPacketSize;
+            }
+        }
+
+        if (in != 0 && out != 0) {
+            device->dataInterface = alt->bInterfaceNumber;
+            device->inEndpoint = in;
+            device->outEndpoint = out;
+            device->maxPacketSize = packetSize;
+        }
+    }
+
+    libusb_free_config_descriptor(config);
+
+    if (device->dataInterface == -1) {
+        logMessage(HSDK_ERROR, "[USBDevice]FindBulkEndpoints", "No CDC data interface with bulk endpoints", HSDKThreadId());
+        return HSDK_ERROR_INVALID;
+    }
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+* \brief  Allocates the bulk IN transfers, each with a pooled buffer, and submits
+* them so that several reads are always pending on the board.
+*
+* \param[in,out] device pointer to the USB handle, with the data interface claimed
+*
+* \return HSDK_ERROR_SUCCESS if all the transfers were submitted, an error code otherwise
+********************************************************************************** */
+static int SubmitReadTransfers(USBHandle *device)
+{
+    uint32_t i;
+
+    device->rxTransfers = (struct libusb_transfer **)calloc(device->transferCount, sizeof(struct libusb_transfer *));
+    if (device->rxTransfers == NULL) {
+        logMessage(HSDK_ERROR, "[USBDevice]SubmitReadTransfers", "Memory allocation failed", HSDKThreadId());
+        return HSDK_ERROR_ALLOC;
+    }
+
+    for (i = 0; i < device->transferCount; i++) {
+        struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+        uint8_t *buffer = (uint8_t *)PoolAlloc(device->transferSize);
+        if (transfer == NULL || buffer == NULL) {
+            libusb_free_transfer(transfer);
+            PoolFree(buffer);
+            logMessage(HSDK_ERROR, "[USBDevice]SubmitReadTransfers", "Memory allocation failed", HSDKThreadId());
+            return HSDK_ERROR_ALLOC;
+        }
+
+        libusb_fill_bulk_transfer(transfer, device->usbHandle, device->inEndpoint, buffer,
+                                  (int)device->transferSize, USBReadCallback, device, 0);
+        device->rxTransfers[i] = transfer;
+
+        int rc = libusb_submit_transfer(transfer);
+        if (rc != LIBUSB_SUCCESS) {
+            logMessage(HSDK_ERROR, "[USBDevice]SubmitReadTransfers", libusb_error_name(rc), HSDKThreadId());
+            return HSDK_ERROR_INVALID;
+        }
+        device->activeTransfers++;
+    }
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+* \brief  Frees the bulk IN transfers and their buffers. None of them may be in flight.
+*
+* \param[in,out] device pointer to the USB handle
+*
+* \return None
+********************************************************************************** */
+static void FreeReadTransfers(USBHandle *device)
+{
+    uint32_t i;
+
+    if (device->rxTransfers == NULL) {
+        return;
+    }
+
+    for (i = 0; i < device->transferCount; i++) {
+        if (device->rxTransfers[i] != NULL) {
+            PoolFree(device->rxTransfers[i]->buffer);
+            libusb_free_transfer(device->rxTransfers[i]);
+        }
+    }
+
+    free(device->rxTransfers);
+    device->rxTransfers = NULL;
+}
+
+/*! *********************************************************************************
+* \brief  Completion of a bulk IN transfer, run by the event thread. The filled
+* buffer is handed to the framers without a copy and the transfer is submitted
+* again with a new pooled buffer, unless the port is closing or the board is gone.
+*
+* \param[in] transfer   the completed transfer
+*
+* \return None
+********************************************************************************** */
+static void LIBUSB_CALL USBReadCallback(struct libusb_transfer *transfer)
+{
+    USBHandle *device = (USBHandle *)transfer->user_data;
+
+    if (transfer->status == LIBUSB_TRANSFER_COMPLETED && transfer->actual_length > 0) {
+        uint8_t *buffer = (uint8_t *)PoolAlloc(device->transferSize);
+        if (buffer == NULL) {
+            /* Drop the data and read again into the same buffer. */
+            logMessage(HSDK_ERROR, "[USBDevice]USBReadCallback", "Memory allocation failed", HSDKThreadId());
+        } else {
+            uint8_t *data = transfer->buffer;
+            transfer->buffer = buffer;
+            DeliverPhysicalDeviceRx(device->parent, data, (uint32_t)transfer->actual_length);
+        }
+    }
+
+    switch (transfer->status) {
+        case LIBUSB_TRANSFER_COMPLETED:
+        case LIBUSB_TRANSFER_TIMED_OUT:
+            break;
+
+        case LIBUSB_TRANSFER_CANCELLED:
+            device->activeTransfers--;
+            return;
+
+        default:
+            logMessage(HSDK_ERROR, "[USBDevice]USBReadCallback", "Bulk IN transfer failed, board disconnected?", HSDKThreadId());
+            FailPhysicalDevice(device->parent);
+            device->activeTransfers--;
+            return;
+    }
+
+    if (__atomic_load_n(&device->stopping, __ATOMIC_ACQUIRE)) {
+        device->activeTransfers--;
+        return;
+    }
+
+    int rc = libusb_submit_transfer(transfer);
+    if (rc != LIBUSB_SUCCESS) {
+        logMessage(HSDK_ERROR, "[USBDevice]USBReadCallback", libusb_error_name(rc), HSDKThreadId());
+        device->activeTransfers--;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Thread function handling the libusb events of a device, in which the
+* transfer callbacks run. Once the port is closing it cancels the transfers and
+* returns when none of them is in flight.
+*
+* \param[in] pDevice    pointer to the USB handle
+*
+* \return None
+********************************************************************************** */
+static void *USBEventThreadRoutine(void *pDevice)
+{
+    USBHandle *device = (USBHandle *)pDevice;
+    uint8_t cancelled = 0;
+    uint32_t i;
+
+    while (device->activeTransfers > 0) {
+        struct timeval timeout = { 0, USB_EVENT_TIMEOUT_US };
+
+        /* Cancelled from this thread, so no callback can resubmit a transfer afterwards. */
+        if (!cancelled && __atomic_load_n(&device->stopping, __ATOMIC_ACQUIRE)) {
+            for (i = 0; i < device->transferCount; i++) {
+                libusb_cancel_transfer(device->rxTransfers[i]);
+            }
+            cancelled = 1;
+        }
+
+        int rc = libusb_handle_events_timeout_completed(device->context, &timeout, NULL);
+        if (rc != LIBUSB_SUCCESS && rc != LIBUSB_ERROR_INTERRUPTED) {
+            logMessage(HSDK_ERROR, "[USBDevice]USBEventThreadRoutine", libusb_error_name(rc), HSDKThreadId());
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/*! *********************************************************************************
+* \brief  Opens the board, claims its CDC data interface, raises DTR and RTS on the
+* communication interface, submits the bulk IN transfers and starts the event thread.
+*
+* \param[in] pDevice    pointer to a USB handle
+* \param[in] configData configuration data, NULL for USB
+*
+* \return HSDK_ERROR_SUCCESS for success, an error code otherwise
+********************************************************************************** */
+static int USBOpenPort(void *pDevice, void *configData)
+{
+    USBHandle *device = (USBHandle *) pDevice;
+    ConfigParams *params = device->parent->configParams;
+
+    int rc = libusb_init(&device->context);
+    if (rc != LIBUSB_SUCCESS) {
+        logMessage(HSDK_ERROR, "[USBDevice]USBOpenPort libusb_init", libusb_error_name(rc), HSDKThreadId());
+        device->context = NULL;
+        return HSDK_ERROR_INVALID;
+    }
+
+    device->usbHandle = OpenMatchingDevice(device);
+    if (device->usbHandle == NULL) {
+        USBClosePort(device);
+        return HSDK_ERROR_INVALID;
+    }
+
+    /* Take the interfaces from cdc_acm for as long as the port is open. */
+    libusb_set_auto_detach_kernel_driver(device->usbHandle, 1);
+
+    if (FindBulkEndpoints(device) != HSDK_ERROR_SUCCESS) {
+        USBClosePort(device);
+        return HSDK_ERROR_INVALID;
+    }
+
+    rc = libusb_claim_interface(device->usbHandle, device->dataInterface);
+    if (rc != LIBUSB_SUCCESS) {
+        logMessage(HSDK_ERROR, "[USBDevice]USBOpenPort libusb_claim_interface", libusb_error_name(rc), HSDKThreadId());
+        device->dataInterface = -1;
+        USBClosePort(device);
+        return HSDK_ERROR_INVALID;
+    }
+
+    /* Boards without a communication interface, or refusing the request, still work. */
+    if (device->commInterface != -1) {
+        if (libusb_claim_interface(device->usbHandle, device->commInterface) != LIBUSB_SUCCESS) {
+            device->commInterface = -1;
+        } else if (libusb_control_transfer(device->usbHandle, CDC_REQUEST_TYPE, CDC_SET_CONTROL_LINE_STATE,
+                                           CDC_LINE_STATE_DTR_RTS, device->commInterface, NULL, 0,
+                                           USB_CONTROL_TIMEOUT_MS) < 0) {
+            logMessage(HSDK_WARNING, "[USBDevice]USBOpenPort", "Failed to set DTR and RTS", HSDKThreadId());
+        }
+    }
+
+    device->transferCount = params->usbTransfers;
+    device->transferSize = params->usbTransferSize;
+    __atomic_store_n(&device->stopping, 0, __ATOMIC_RELEASE);
+
+    if (SubmitReadTransfers(device) != HSDK_ERROR_SUCCESS) {
+        USBClosePort(device);
+        return HSDK_ERROR_INVALID;
+    }
+
+    device->eventThread = HSDKCreateThreadWithAttributes(USBEventThreadRoutine, device, &params->usbThread);
+    if (device->eventThread == INVALID_THREAD_HANDLE) {
+        logMessage(HSDK_ERROR, "[USBDevice]USBOpenPort", "Event thread creation failed", HSDKThreadId());
+        USBClosePort(device);
+        return HSDK_ERROR_INVALID;
+    }
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+* \brief  Close the opened board but do no free the memory. Waits for the bulk IN
+* transfers to be cancelled and for the event thread to finish.
+*
+* \param[in] pDevice pointer to the USB handle
+*
+* \return HSDK_ERROR_SUCCESS for success, HSDK_ERROR_INVALID for a NULL handle
+********************************************************************************** */
+static int USBClosePort(void *pDevice)
+{
+    USBHandle *device = (USBHandle *) pDevice;
+    uint32_t i;
+
+    if (device == NULL) {
+        logMessage(HSDK_ERROR, "[USBDevice]USBClosePort", "Trying to close on a NULL reference", HSDKThreadId());
+        return HSDK_ERROR_INVALID;
+    }
+
+    __atomic_store_n(&device->stopping, 1, __ATOMIC_RELEASE);
+
+    if (device->eventThread != INVALID_THREAD_HANDLE) {
+        HSDKDestroyThread(device->eventThread);
+        device->eventThread = INVALID_THREAD_HANDLE;
+    } else if (device->activeTransfers > 0) {
+        /* Open failed part way: no event thread, retire the submitted transfers here. */
+        for (i = 0; i < device->transferCount; i++) {
+            if (device->rxTransfers[i] != NULL) {
+                libusb_cancel_transfer(device->rxTransfers[i]);
+            }
+        }
+        while (device->activeTransfers > 0) {
+            if (libusb_handle_events(device->context) != LIBUSB_SUCCESS) {
+                break;
+            }
+        }
+    }
+    device->activeTransfers = 0;
+    FreeReadTransfers(device);
+
+    if (device->usbHandle != NULL) {
+        if (device->commInterface != -1) {
+            libusb_release_interface(device->usbHandle, device->commInterface);
+        }
+        if (device->dataInterface != -1) {
+            libusb_release_interface(device->usbHandle, device->dataInterface);
+        }
+        libusb_close(device->usbHandle);
+        device->usbHandle = NULL;
+    }
+    device->commInterface = -1;
+    device->dataInterface = -1;
+
+    if (device->context != NULL) {
+        libusb_exit(device->context);
+        device->context = NULL;
+    }
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+* \brief  Write data to the bulk OUT endpoint. A write of a multiple of the packet
+* size is ended by a zero-length packet, so that the board sees the end of it.
+*
+* \param[in] pDevice        a pointer to the USB device
+* \param[in] buffer         a byte array containing the data to be sent
+* \param[in] count          number of bytes to be written
+*
+* \return the number of bytes written for success, -1 for failure
+********************************************************************************** */
+static int USBWrite(void *pDevice, uint8_t *buffer, uint32_t count)
+{
+    USBHandle *device = (USBHandle *) pDevice;
+    int transferred = 0;
+
+    int rc = libusb_bulk_transfer(device->usbHandle, device->outEndpoint, buffer, (int)count,
+                                  &transferred, USB_WRITE_TIMEOUT_MS);
+    if (rc != LIBUSB_SUCCESS || (uint32_t)transferred != count) {
+        logMessage(HSDK_ERROR, "[USBDevice]USBWrite libusb_bulk_transfer", libusb_error_name(rc), HSDKThreadId());
+        return -1;
+    }
+
+    if (device->maxPacketSize != 0 && count % device->maxPacketSize == 0) {
+        libusb_bulk_transfer(device->usbHandle, device->outEndpoint, buffer, 0, &transferred, USB_WRITE_TIMEOUT_MS);
+    }
+
+    return (int)count;
+}
+
+/* Nothing to wait for: the libusb event thread delivers the received data itself,
+   like the pcap_loop thread of a PCAP device, and the writes are synchronous. */
+static Event USBGetWaitEvent(void *device, void **asyncMask)
+{
+    return NULL;
+}
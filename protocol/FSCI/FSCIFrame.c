@@ -40,6 +40,7 @@
 #include <stdlib.h>
 
 #include "FSCIFrame.h"
+#include "MemoryPool.h"
 
 /************************************************************************************
  *************************************************************************************
@@ -52,6 +53,7 @@
  * Private prototypes
  *************************************************************************************
  ************************************************************************************/
+static FSCIFrame *AllocFSCIFrame(uint8_t *data, uint32_t length);
 
 
 /************************************************************************************
@@ -96,7 +98,7 @@ FSCIFrame *CreateFSCIFrameAdHoc(uint8_t ogf, uint8_t ocf, uint8_t *data, uint32_
     uint32_t i;
     uint8_t crc[2] = {0};
     uint8_t len[2] = {0};
-    FSCIFrame *frame = (FSCIFrame *)calloc(1, sizeof(FSCIFrame));
+    FSCIFrame *frame = AllocFSCIFrame(data, dataSize);
 
     if (!frame) {
         return NULL;
@@ -105,18 +107,6 @@ FSCIFrame *CreateFSCIFrameAdHoc(uint8_t ogf, uint8_t ocf, uint8_t *data, uint32_
     frame->sync = FSCI_SYNC_BYTE;
     frame->opGroup = ogf;
     frame->opCode = ocf;
-    frame->length = dataSize;
-
-    if (dataSize) {
-        frame->data = (uint8_t *)calloc(dataSize, sizeof(uint8_t));
-        if (!frame->data) {
-            free(frame);
-            return NULL;
-        }
-        memcpy(frame->data, data, dataSize);
-    } else {
-        frame->data = NULL;
-    }
 
     crc[0] = ogf;
     crc[0] ^= ocf;
@@ -140,7 +130,7 @@ FSCIFrame *CreateFSCIFrameAdHoc(uint8_t ogf, uint8_t ocf, uint8_t *data, uint32_
 
     frame->virtualInterface = virtualInterface;
     frame->endian = localEndian;
-    frame->timeStamp = time(NULL);
+    frame->timestampNs = HSDKMonotonicNs();
 
     return frame;
 }
@@ -152,7 +142,7 @@ FSCIFrame *CreateFSCIFrame(Framer *framer, uint8_t ogf, uint8_t ocf, uint8_t *da
 
 FSCIFrame *CreateRawFSCIFrameAdHoc(uint8_t sync, uint8_t opGroup, uint8_t opCode, uint8_t *data, uint32_t length, uint32_t crc, uint8_t virtualId, endianness endian)
 {
-    FSCIFrame *frame = (FSCIFrame *)calloc(1, sizeof(FSCIFrame));
+    FSCIFrame *frame = AllocFSCIFrame(data, length);
 
     if (!frame) {
         return NULL;
@@ -161,24 +151,12 @@ FSCIFrame *CreateRawFSCIFrameAdHoc(uint8_t sync, uint8_t opGroup, uint8_t opCode
     frame->sync = sync;
     frame->opGroup = opGroup;
     frame->opCode = opCode;
-    frame->length = length;
-
-    if (length) {
-        frame->data = (uint8_t *)calloc(length, sizeof(uint8_t));
-        if (!frame->data) {
-            free(frame);
-            return NULL;
-        }
-        memcpy(frame->data, data, length);
-    } else {
-        frame->data = NULL;
-    }
 
     frame->crc = crc;
 
     frame->virtualInterface = virtualId;
     frame->endian = endian;
-    frame->timeStamp = time(NULL);
+    frame->timestampNs = HSDKMonotonicNs();
 
     return frame;
 }
@@ -222,19 +200,65 @@ void PrintFSCIFrame(Framer *framer, FSCIFrame *frame)
 }
 
 /*! *********************************************************************************
- * \brief  Deallocate memory required by a frame.
+ * \brief  Deallocate memory required by a frame. A frame created by the library goes
+ * back to the pool it was taken from, which may be the pool of a framer; it is safe
+ * to call this from any thread. A frame allocated by the application, and a payload
+ * it attached to any frame, are released with free().
  *
- * \param[in] frame a pointer to the FSCIFrame to be printed
+ * \param[in] frame a pointer to the FSCIFrame to be freed
  *
  * \return none
  ********************************************************************************** */
 void DestroyFSCIFrame(FSCIFrame *frame)
 {
     if (frame) {
-        if (frame->data) {
+        if ((frame->pooled & FSCI_FRAME_POOLED) && frame->data == FSCI_INLINE_DATA(frame)) {
+            /* Released with the frame. */
+        } else if (frame->pooled & FSCI_DATA_POOLED) {
+            PoolFree(frame->data);
+        } else {
             free(frame->data);
         }
         frame->data = NULL;
-        free(frame);
+
+        if (frame->pooled & FSCI_FRAME_POOLED) {
+            MemoryPoolPut(frame);
+        } else {
+            free(frame);
+        }
     }
 }
+
+/************************************************************************************
+ *************************************************************************************
+ * Private functions
+ *************************************************************************************
+ ************************************************************************************/
+
+/*! *********************************************************************************
+ * \brief  Allocates a frame together with its payload in a single pooled block.
+ *
+ * \param[in] data      the payload of the frame
+ * \param[in] length    the size of the payload
+ *
+ * \return NULL if allocation failed, a pointer to FSCIFrame otherwise
+ ********************************************************************************** */
+static FSCIFrame *AllocFSCIFrame(uint8_t *data, uint32_t length)
+{
+    FSCIFrame *frame = (FSCIFrame *)PoolAlloc(sizeof(FSCIFrame) + length);
+
+    if (!frame) {
+        return NULL;
+    }
+
+    memset(frame, 0, sizeof(FSCIFrame));
+    frame->pooled = FSCI_FRAME_POOLED;
+    frame->length = length;
+
+    if (length) {
+        frame->data = FSCI_INLINE_DATA(frame);
+        memcpy(frame->data, data, length);
+    }
+
+    return frame;
+}
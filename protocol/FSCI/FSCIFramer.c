@@ -40,16 +40,22 @@
 #include <stdio.h>
 
 #include "hsdkLogger.h"
+#include "hsdkTrace.h"
 #include "utils.h"
 #include "RawFrame.h"
 #include "FSCIFrame.h"
 #include "FSCIFramer.h"
+#include "MemoryPool.h"
+#include "PhysicalDevice.h"
 
 /************************************************************************************
 *************************************************************************************
 * Private macros
 *************************************************************************************
 ************************************************************************************/
+/* Frames allocated up front and kept for reuse by the pool of each framer. */
+#define FSCI_FRAME_POOL_PREALLOCATED 8
+#define FSCI_FRAME_POOL_MAX_FREE 64
 
 /************************************************************************************
 *************************************************************************************
@@ -57,8 +63,10 @@
 *************************************************************************************
 ************************************************************************************/
 static uint8_t *CreatePacket(Framer *framer, uint8_t ogf, uint8_t ocf, uint32_t length, uint8_t *data, uint32_t crc, uint8_t crcFieldSize, uint32_t *size);
+static RawFrame *CreateFSCITxFrame(Framer *framer, void *frame, uint32_t *sequence);
 static uint8_t CalculateCRC(Framer *framer, FSCIFrame *frame);
 static FSCIFrame *FSCIHandleNewFrame(Framer *framer);
+static uint8_t *FSCIPayloadBuffer(Framer *framer, FSCIFrame *frame, uint32_t length);
 static FrameStatus FSCIJunkData(Framer *framer, FSCIFrame **currentFrame, uint32_t *dataSize);
 static FrameStatus FSCISyncField(Framer *framer, FSCIFrame **currentFrame, uint32_t *dataSize);
 static FrameStatus FSCIOpCodeField(Framer *framer, FSCIFrame **currentFrame, uint32_t *dataSize);
@@ -219,9 +227,17 @@ int FSCIFinalState (void)
 void FSCIFramerInitialization(Framer *framer)
 {
     framer->CreatePacket = CreateFSCIPacket;
+    framer->CreateTxFrame = CreateFSCITxFrame;
     framer->StateMachineDispatch = FSCIStateMachineDispatch;
     framer->SMStartState = FSCIStartState;
     framer->SMFinalState = FSCIFinalState;
+
+    /* Received frames come from a pool of the framer, with small payloads inline. */
+    uint32_t inlinePayload = ((PhysicalDevice *)framer->physicalLayer)->configParams->fsciInlinePayload;
+    framer->framePool = CreateMemoryPool(sizeof(FSCIFrame) + inlinePayload, FSCI_FRAME_POOL_PREALLOCATED, FSCI_FRAME_POOL_MAX_FREE);
+    if (framer->framePool == NULL) {
+        logMessage(HSDK_WARNING, "[FSCIFramer]FSCIFramerInitialization", "Frame pool creation failed, using the shared pools", HSDKThreadId());
+    }
 }
 
 /************************************************************************************
@@ -255,7 +271,7 @@ static uint8_t *CreatePacket(Framer *framer, uint8_t ogf, uint8_t ocf, uint32_t
        protocol descriptor variable. */
     *size = FSCI_SYNC_SIZE + FSCI_OGF_SIZE + FSCI_OCF_SIZE + framer->lengthFieldSize + length + crcFieldSize;
 
-    packet = (uint8_t *) calloc(*size, sizeof(uint8_t));
+    packet = (uint8_t *) PoolAlloc(*size);
 
     if (!packet) {
         return NULL;
@@ -282,6 +298,40 @@ static uint8_t *CreatePacket(Framer *framer, uint8_t ogf, uint8_t ocf, uint32_t
     return packet;
 }
 
+/*! *********************************************************************************
+* \brief    Creates the RawFrame to be sent for a FSCIFrame: the sync byte, opGroup,
+*           opCode and length go into the header segment and the CRC into the
+*           trailer, around a single copy of the payload.
+*
+* \param[in] framer         pointer to a Framer object
+* \param[in] frame          a pointer to a FSCIFrame
+* \param[in,out] sequence   the TX counter of the device
+*
+* \return   NULL in case of allocation failure, otherwise the RawFrame
+********************************************************************************** */
+static RawFrame *CreateFSCITxFrame(Framer *framer, void *frame, uint32_t *sequence)
+{
+    FSCIFrame *fsciFrame = (FSCIFrame *) frame;
+    uint8_t header[FSCI_SYNC_SIZE + FSCI_OGF_SIZE + FSCI_OCF_SIZE + 2];
+    uint8_t arCRC[2];
+    uint8_t len[2];
+    uint8_t crcFieldSize = (!(fsciFrame->virtualInterface)) ? 1 : 2;
+    unsigned int i, crt = 0;
+
+    header[crt++] = FSCI_SYNC_BYTE;
+    header[crt++] = fsciFrame->opGroup;
+    header[crt++] = fsciFrame->opCode;
+
+    Store16(fsciFrame->length, len, framer->framerEndianness);
+    for (i = 0; i < framer->lengthFieldSize; i++) {
+        header[crt++] = len[i];
+    }
+
+    Store16(fsciFrame->crc, arCRC, framer->framerEndianness);
+
+    return CreateSegmentedTxRawFrame(header, crt, fsciFrame->data, fsciFrame->length, arCRC, crcFieldSize, sequence);
+}
+
 /*! *********************************************************************************
 * \brief    Computes the XOR CRC validation code for the received FSCIFrame.
 *
@@ -332,18 +382,41 @@ static FSCIFrame *FSCIHandleNewFrame(Framer *framer)
         return NULL;
     }
 
-    FSCIFrame *workingCopy = (FSCIFrame *)calloc(1, sizeof(FSCIFrame));
+    FSCIFrame *workingCopy = (FSCIFrame *)((framer->framePool != NULL) ? MemoryPoolGet(framer->framePool) : PoolAlloc(sizeof(FSCIFrame)));
     if (workingCopy == NULL) {
         logMessage(HSDK_WARNING, "[FSCIFramer]FSCIHandleNewFrame", "workingCopy memory allocation failed", HSDKThreadId());
         return NULL;
     }
+    memset(workingCopy, 0, sizeof(FSCIFrame));
+    workingCopy->pooled = FSCI_FRAME_POOLED;
 
-    workingCopy->timeStamp = rawFrame->timeStamp;
+    workingCopy->timestampNs = rawFrame->timestampNs;
     workingCopy->index = rawFrame->packetIndex;
 
     return workingCopy;
 }
 
+/*! *********************************************************************************
+* \brief    Returns the storage for the payload of a frame: the inline area of a frame
+*           from the framer pool if the payload fits, a block from the shared pools
+*           otherwise. DestroyFSCIFrame releases either.
+*
+* \param[in] framer     pointer to the Framer owning the frame pool
+* \param[in] frame      the frame the payload belongs to
+* \param[in] length     the size of the payload
+*
+* \return NULL on allocation failure, a pointer to length bytes otherwise
+********************************************************************************** */
+static uint8_t *FSCIPayloadBuffer(Framer *framer, FSCIFrame *frame, uint32_t length)
+{
+    if (framer->framePool != NULL && length <= framer->framePool->blockSize - sizeof(FSCIFrame)) {
+        return FSCI_INLINE_DATA(frame);
+    }
+
+    frame->pooled |= FSCI_DATA_POOLED;
+    return (uint8_t *)PoolAlloc(length);
+}
+
 /*! *********************************************************************************
 * \brief    Handles the case for junk data. Data is considered junk until the first
 *           valid frame starting with SYNC.
@@ -358,16 +431,24 @@ static FrameStatus FSCIJunkData(Framer *framer, FSCIFrame **currentFrame, uint32
 {
     MessageQueue *queue = framer->queue;
     FSCIFrame *workingCopy = *currentFrame;
-    uint16_t cbJunkSize;
+    uint16_t cbJunkSize = 0;
     uint8_t found = 0;
-    workingCopy->data = ReadDataUntilByte(queue, &cbJunkSize, FSCI_SYNC_BYTE, &found);
+    uint8_t *junk = ReadDataUntilByte(queue, &cbJunkSize, FSCI_SYNC_BYTE, &found);
     if (!cbJunkSize) {
-        free(workingCopy->data);
-        workingCopy->data = NULL;
+        PoolFree(junk);
         framer->currentState = FSCI_SM_SYNC;
         return SUFFICIENT_DATA;
     } else {
-        workingCopy->length = cbJunkSize;
+        workingCopy->data = FSCIPayloadBuffer(framer, workingCopy, cbJunkSize);
+        if (workingCopy->data != NULL) {
+            memcpy(workingCopy->data, junk, cbJunkSize);
+            workingCopy->length = cbJunkSize;
+        } else {
+            /* The junk is still consumed, the observers get it empty. */
+            logMessage(HSDK_WARNING, "[FSCIFramer]FSCIJunkData", "Junk memory allocation failed", HSDKThreadId());
+            workingCopy->length = 0;
+        }
+        PoolFree(junk);
         *dataSize -= cbJunkSize;
         framer->currentState = FSCI_SM_FINISHED_FRAME;
         return JUNK_DATA;
@@ -458,9 +539,9 @@ static FrameStatus FSCILengthField(Framer *framer, FSCIFrame **currentFrame, uin
     if (framer->lengthFieldSize == 1) {
         workingCopy->length = ReadSingleByte(queue);
     } else {
-        uint8_t *multibyte_length = ReadMultiByte(queue, framer->lengthFieldSize);
+        uint8_t multibyte_length[2] = {0};
+        ReadMultiByteInto(queue, multibyte_length, framer->lengthFieldSize);
         workingCopy->length = Read16(multibyte_length, framer->framerEndianness);
-        free(multibyte_length);
     }
     framer->currentState = FSCI_SM_DATA;
     *dataSize -= framer->lengthFieldSize;
@@ -482,8 +563,23 @@ static FrameStatus FSCIDataField(Framer *framer, FSCIFrame **currentFrame, uint3
         return INSUFFICIENT_DATA;
 
     MessageQueue *queue = framer->queue;
-    (*currentFrame)->data = ReadMultiByte(queue, (*currentFrame)->length);
-    *dataSize -= (*currentFrame)->length;
+    FSCIFrame *workingCopy = *currentFrame;
+
+    /* A frame dismissed for its CRC is reused; drop its old payload. */
+    if (workingCopy->data != NULL && workingCopy->data != FSCI_INLINE_DATA(workingCopy)) {
+        PoolFree(workingCopy->data);
+    }
+    workingCopy->data = NULL;
+
+    if (workingCopy->length) {
+        workingCopy->data = FSCIPayloadBuffer(framer, workingCopy, workingCopy->length);
+        if (workingCopy->data == NULL) {
+            logMessage(HSDK_WARNING, "[FSCIFramer]FSCIDataField", "Payload memory allocation failed", HSDKThreadId());
+            return INSUFFICIENT_DATA;
+        }
+        ReadMultiByteInto(queue, workingCopy->data, workingCopy->length);
+    }
+    *dataSize -= workingCopy->length;
     framer->currentState = FSCI_SM_CRC_FST;
     return SUFFICIENT_DATA;
 }
@@ -511,6 +607,7 @@ static FrameStatus FSCICrcField(Framer *framer, FSCIFrame **currentFrame, uint32
     workingCopy->crc = crc;
     *dataSize -= 1;
 
+    HSDK_TRACE(TRACE_CRC_CHECK, TRACE_INSTANT, crc == calculatedCRC);
     if (crc == calculatedCRC) {
         framer->currentState = FSCI_SM_FINISHED_FRAME;
         return VALID_FRAME;
@@ -552,6 +649,7 @@ static FrameStatus FSCISecondCrcField(Framer *framer, FSCIFrame **currentFrame,
     uint8_t aCRCArray[2] = {oldCRC, crc};
     workingCopy->crc = Read16(aCRCArray, framer->framerEndianness);
 
+    HSDK_TRACE(TRACE_CRC_CHECK, TRACE_INSTANT, (oldCRC ^ calculatedCRC) == crc);
     if ((oldCRC ^ calculatedCRC) == crc) {
         return VALID_FRAME;
     } else {
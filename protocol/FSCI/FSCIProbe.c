@@ -0,0 +1,339 @@
+/*! *********************************************************************************
+* \file FSCIProbe.c
+* This is a source file for the FSCIProbe module.
+*
+* Copyright 2013-2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************** */
+
+/************************************************************************************
+ *************************************************************************************
+ * Include
+ *************************************************************************************
+ ************************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "FSCIProbe.h"
+#include "FSCIFrame.h"
+#include "Framer.h"
+#include "PhysicalDeviceManager.h"
+#include "hsdkOSCommon.h"
+#include "hsdkLogger.h"
+#include "hsdkError.h"
+
+/************************************************************************************
+ *************************************************************************************
+ * Private macros
+ *************************************************************************************
+ ************************************************************************************/
+#define FSCI_PROBE_CRC_SIZE 1
+
+/************************************************************************************
+ *************************************************************************************
+ * Private type definitions
+ *************************************************************************************
+ ************************************************************************************/
+/**
+ * @brief State shared by the framer threads of all the probed devices.
+ */
+typedef struct {
+    Lock lock;                  /**< Protects pending and the results of the targets. */
+    Event done;                 /**< Signaled when the last expected response arrives. */
+    uint32_t pending;           /**< Number of devices still expected to answer. */
+    FSCIProbeRequest *request;  /**< The request and its expected response. */
+} ProbeSession;
+
+/**
+ * @brief A probed device, registered as the observer of its framer.
+ */
+typedef struct {
+    ProbeSession *session;      /**< The session the device belongs to. */
+    FSCIProbeResult *result;    /**< Where the outcome of the device is stored. */
+    Framer *framer;             /**< The framer attached to the device. */
+    uint8_t settled;            /**< Whether result holds the final outcome; responses are dropped while set. */
+} ProbeTarget;
+
+/************************************************************************************
+ *************************************************************************************
+ * Private prototypes
+ *************************************************************************************
+ ************************************************************************************/
+static void ProbeCallback(void *callee, void *object);
+
+/************************************************************************************
+ *************************************************************************************
+ * Public memory declarations
+ *************************************************************************************
+ ************************************************************************************/
+
+/************************************************************************************
+ *************************************************************************************
+ * Private memory declarations
+ *************************************************************************************
+ ************************************************************************************/
+
+/************************************************************************************
+ *************************************************************************************
+ * Public functions
+ *************************************************************************************
+ ************************************************************************************/
+
+/*! *********************************************************************************
+ * \brief  Identifies a set of devices at once. The devices are opened by a
+ * PhysicalDeviceManager, one shard at a time per opener thread, the request is sent
+ * to each of them as soon as they are all opened and the responses are collected
+ * until every device has answered or the single deadline expires, so probing N
+ * boards costs about as much as probing the slowest one. An open in progress is
+ * not interrupted, so a device blocking in its open may delay the return past
+ * timeoutMs; no request is sent once the deadline has passed.
+ *
+ * \param[in] deviceNames   the names of the devices to probe
+ * \param[in] count         the number of devices
+ * \param[in] request       the identification request and its expected response
+ * \param[in] timeoutMs     the time allowed for the whole probe, counted from the
+ *                          call and thus including the opening of the devices
+ *
+ * \return NULL on invalid arguments or allocation failure, otherwise an array of
+ * count results, entry i holding the outcome of deviceNames[i]. The array must be
+ * released with DestroyFSCIProbeResults
+ ********************************************************************************** */
+FSCIProbeResult *ProbeFSCIDevices(char **deviceNames, uint32_t count, FSCIProbeRequest *request, uint32_t timeoutMs)
+{
+    uint32_t i;
+    uint64_t deadlineNs = HSDKMonotonicNs() + (uint64_t)timeoutMs * 1000000ULL;
+
+    if (deviceNames == NULL || count == 0 || request == NULL) {
+        logMessage(HSDK_ERROR, "[FSCIProbe]ProbeFSCIDevices", "Invalid arguments", HSDKThreadId());
+        return NULL;
+    }
+
+    FSCIProbeResult *results = (FSCIProbeResult *)calloc(count, sizeof(FSCIProbeResult));
+    ProbeTarget *targets = (ProbeTarget *)calloc(count, sizeof(ProbeTarget));
+    if (results == NULL || targets == NULL) {
+        logMessage(HSDK_ERROR, "[FSCIProbe]ProbeFSCIDevices", "Memory allocation failed", HSDKThreadId());
+        free(results);
+        free(targets);
+        return NULL;
+    }
+
+    ProbeSession session;
+    session.lock = HSDKCreateLock();
+    session.done = HSDKCreateEvent(0);
+    session.pending = 0;
+    session.request = request;
+
+    for (i = 0; i < count; i++) {
+        results[i].deviceName = (deviceNames[i] != NULL) ? strdup(deviceNames[i]) : NULL;
+        results[i].status = HSDK_ERROR_INVALID;
+        targets[i].session = &session;
+        targets[i].result = &results[i];
+        /* Nothing is expected from a device before its request is sent. */
+        targets[i].settled = 1;
+    }
+
+    PhysicalDeviceManager *manager = InitPhysicalDeviceManager(0);
+    if (manager == NULL) {
+        logMessage(HSDK_ERROR, "[FSCIProbe]ProbeFSCIDevices", "Could not create the device manager", HSDKThreadId());
+        for (i = 0; i < count; i++) {
+            results[i].status = HSDK_ERROR_ALLOC;
+        }
+        goto cleanup;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (deviceNames[i] == NULL) {
+            continue;
+        }
+
+        PhysicalDevice *device = AddToPhysicalDeviceManager(manager, request->type, request->configData, deviceNames[i], NONE);
+        if (device == NULL) {
+            continue;
+        }
+
+        targets[i].framer = InitializeFramer(device, FSCI, request->lengthFieldSize, FSCI_PROBE_CRC_SIZE, request->endian);
+        if (targets[i].framer == NULL) {
+            results[i].status = HSDK_ERROR_ALLOC;
+            continue;
+        }
+        AttachToFramer(targets[i].framer, &targets[i], ProbeCallback);
+    }
+
+    /* The failures are reported per device through its status. */
+    OpenAllPhysicalDevices(manager);
+
+    HSDKAcquireLock(session.lock);
+    for (i = 0; i < count; i++) {
+        if (targets[i].framer == NULL) {
+            continue;
+        }
+
+        PhysicalDevice *device = (PhysicalDevice *)targets[i].framer->physicalLayer;
+        if (device->status != PHYS_OPENED) {
+            results[i].status = HSDK_ERROR_INVALID;
+            continue;
+        }
+
+        /* The opens or the previous sends used up the time, the response could not be awaited. */
+        if (HSDKMonotonicNs() >= deadlineNs) {
+            results[i].status = HSDK_ERROR_TIMEOUT;
+            continue;
+        }
+
+        FSCIFrame *frame = CreateFSCIFrame(targets[i].framer, request->opGroup, request->opCode, request->data, request->length, 0);
+        if (frame == NULL) {
+            results[i].status = HSDK_ERROR_ALLOC;
+            continue;
+        }
+
+        /* Counted before sending, the response may arrive as soon as the frame is out. */
+        results[i].status = HSDK_ERROR_TIMEOUT;
+        targets[i].settled = 0;
+        session.pending++;
+        HSDKReleaseLock(session.lock);
+
+        int err = SendFrame(targets[i].framer, frame);
+        DestroyFSCIFrame(frame);
+
+        HSDKAcquireLock(session.lock);
+        if (err != HSDK_ERROR_SUCCESS && !targets[i].settled) {
+            targets[i].settled = 1;
+            results[i].status = err;
+            session.pending--;
+        }
+    }
+
+    while (session.pending > 0) {
+        uint64_t nowNs = HSDKMonotonicNs();
+        if (nowNs >= deadlineNs) {
+            break;
+        }
+
+        HSDKReleaseLock(session.lock);
+        /* Round up so that the last wait does not spin on a sub-millisecond remainder. */
+        HSDKWaitEvent(session.done, (int64_t)((deadlineNs - nowNs + 999999ULL) / 1000000ULL));
+        HSDKAcquireLock(session.lock);
+    }
+
+    /* Responses arriving from now on are dropped; the ones still missing time out. */
+    for (i = 0; i < count; i++) {
+        targets[i].settled = 1;
+    }
+    HSDKReleaseLock(session.lock);
+
+cleanup:
+    /* Stop the deliveries to the framers before destroying them. */
+    if (manager != NULL) {
+        CloseAllPhysicalDevices(manager);
+    }
+    for (i = 0; i < count; i++) {
+        if (targets[i].framer != NULL) {
+            DestroyFramer(targets[i].framer);
+        }
+    }
+    if (manager != NULL) {
+        DestroyPhysicalDeviceManager(manager);
+    }
+
+    HSDKDestroyEvent(session.done);
+    HSDKDestroyLock(session.lock);
+    free(targets);
+
+    return results;
+}
+
+/*! *********************************************************************************
+ * \brief  Releases the results returned by ProbeFSCIDevices.
+ *
+ * \param[in] results   the array of results
+ * \param[in] count     the number of results, as given to ProbeFSCIDevices
+ *
+ * \return none
+ ********************************************************************************** */
+void DestroyFSCIProbeResults(FSCIProbeResult *results, uint32_t count)
+{
+    uint32_t i;
+
+    if (results == NULL) {
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        free(results[i].deviceName);
+        free(results[i].identity);
+    }
+    free(results);
+}
+
+/************************************************************************************
+ *************************************************************************************
+ * Private functions
+ *************************************************************************************
+ ************************************************************************************/
+
+/*! *********************************************************************************
+ * \brief  Called by the framer of a probed device for each received frame. The
+ * first frame matching the expected response settles the device.
+ *
+ * \param[in] callee    the ProbeTarget of the device
+ * \param[in] object    the received FSCIFrame
+ *
+ * \return none
+ ********************************************************************************** */
+static void ProbeCallback(void *callee, void *object)
+{
+    ProbeTarget *target = (ProbeTarget *)callee;
+    FSCIFrame *frame = (FSCIFrame *)object;
+    ProbeSession *session = target->session;
+
+    if (frame->opGroup == session->request->responseOpGroup &&
+            frame->opCode == session->request->responseOpCode) {
+        HSDKAcquireLock(session->lock);
+        if (!target->settled) {
+            target->settled = 1;
+            target->result->status = HSDK_ERROR_SUCCESS;
+
+            if (frame->length > 0) {
+                target->result->identity = (uint8_t *)malloc(frame->length);
+                if (target->result->identity != NULL) {
+                    memcpy(target->result->identity, frame->data, frame->length);
+                    target->result->identityLength = frame->length;
+                } else {
+                    target->result->status = HSDK_ERROR_ALLOC;
+                }
+            }
+
+            session->pending--;
+            if (session->pending == 0) {
+                HSDKSignalEvent(session->done);
+            }
+        }
+        HSDKReleaseLock(session->lock);
+    }
+
+    DestroyFSCIFrame(frame);
+}
@@ -46,12 +46,15 @@
 
 #include "hsdkError.h"
 #include "hsdkLogger.h"
+#include "hsdkTrace.h"
 
 /************************************************************************************
  *************************************************************************************
  * Private macros
  *************************************************************************************
  ************************************************************************************/
+/* Junk bytes are gathered in buffers growing from the smallest pool size class. */
+#define JUNK_BYTES_CHUNK 32
 
 /************************************************************************************
  *************************************************************************************
@@ -63,6 +66,8 @@ static void AttachToConcreteImplementation(Framer *framer, FramerProtocol protoc
 static void DetachFromConcreteImplementation(Framer *framer);
 static void *FramerThreadRoutine(void *lpParam);
 static void FramerCallback (void *callee, void *object);
+static void DispatchFrame(Framer *framer, void *frame);
+static void CountDroppedFrame(PhysicalDevice *device);
 
 /************************************************************************************
  *************************************************************************************
@@ -100,15 +105,15 @@ static void FramerCallback (void *callee, void *object);
  * \param[in,out] found     flag that indicates whether the frames have the startByte
  *
  * \return  NULL in case of allocation failure, otherwise an array of bytes with the
- *          junk bytes received until the next SYNC byte
+ *          junk bytes received until the next SYNC byte, to be released with PoolFree
  ********************************************************************************** */
 uint8_t *ReadDataUntilByte(MessageQueue *queue, uint16_t *cbSize, uint8_t startByte, uint8_t *found)
 {
     uint16_t cbProcessed, cbJunkBytes;
     RawFrame *pRawFrame;
     uint8_t *aResult, *tmp;
-    cbJunkBytes = 4;
-    aResult = (uint8_t *) calloc(cbJunkBytes, sizeof(uint8_t));
+    cbJunkBytes = JUNK_BYTES_CHUNK;
+    aResult = (uint8_t *) PoolAlloc(cbJunkBytes);
 
     if (!aResult) {
         return NULL;
@@ -127,18 +132,18 @@ uint8_t *ReadDataUntilByte(MessageQueue *queue, uint16_t *cbSize, uint8_t startB
             if (cbProcessed == cbJunkBytes) {
                 cbJunkBytes *= 2;
 
-                tmp = (uint8_t *) realloc(aResult, cbJunkBytes);
+                tmp = (uint8_t *) PoolAlloc(cbJunkBytes);
                 if (tmp == NULL) {
-                    free(aResult);
+                    PoolFree(aResult);
                     return NULL;
-                } else {
-                    aResult = tmp;
                 }
-                memset(aResult + cbProcessed, 0, cbJunkBytes - cbProcessed);
+                memcpy(tmp, aResult, cbProcessed);
+                PoolFree(aResult);
+                aResult = tmp;
             }
         }
 
-        if (pRawFrame->aRawData[pRawFrame->iCrtIndex] == startByte) {
+        if (pRawFrame->iCrtIndex < pRawFrame->cbTotalSize && pRawFrame->aRawData[pRawFrame->iCrtIndex] == startByte) {
             *found = 1;
         }
 
@@ -194,31 +199,48 @@ uint8_t ReadSingleByte(MessageQueue *queue)
  ********************************************************************************** */
 uint8_t *ReadMultiByte(MessageQueue *queue, uint32_t cbDemanded)
 {
-    uint32_t cbProcessed;
-    RawFrame *pRawFrame;
-    uint8_t *aResult;
-
-    cbProcessed = 0;
-    aResult = (uint8_t *) calloc(cbDemanded, sizeof(uint8_t));
+    uint8_t *aResult = (uint8_t *) calloc(cbDemanded, sizeof(uint8_t));
 
     if (!aResult) {
         return NULL;
     }
 
+    ReadMultiByteInto(queue, aResult, cbDemanded);
+
+    return aResult;
+}
+
+/*! *********************************************************************************
+ * \brief   Reads a number of bytes from the message queue into a buffer provided by
+ *          the caller.
+ *
+ * \param[in] queue
+ * \param[out] buffer       where the bytes are copied, at least cbDemanded long
+ * \param[in] cbDemanded
+ *
+ * \return the number of bytes read, less than cbDemanded if the queue ran out
+ ********************************************************************************** */
+uint32_t ReadMultiByteInto(MessageQueue *queue, uint8_t *buffer, uint32_t cbDemanded)
+{
+    uint32_t cbProcessed;
+    RawFrame *pRawFrame;
+
+    cbProcessed = 0;
+
     while (cbProcessed < cbDemanded) {
         pRawFrame = (RawFrame *) MessageQueueGet(queue);
         if (pRawFrame == NULL) {
             /* No more frames, return partial result. */
-            return aResult;
+            return cbProcessed;
         }
         HSDKAcquireExplicitlySemaphore(queue->sAnnounceData);
 
         if (pRawFrame->cbTotalSize - pRawFrame->iCrtIndex <= cbDemanded - cbProcessed) {
-            memcpy(aResult + cbProcessed, pRawFrame->aRawData + pRawFrame->iCrtIndex, pRawFrame->cbTotalSize - pRawFrame->iCrtIndex);
+            memcpy(buffer + cbProcessed, pRawFrame->aRawData + pRawFrame->iCrtIndex, pRawFrame->cbTotalSize - pRawFrame->iCrtIndex);
             cbProcessed += (pRawFrame->cbTotalSize - pRawFrame->iCrtIndex);
             DestroyRawFrame(pRawFrame);
         } else {
-            memcpy(aResult + cbProcessed, pRawFrame->aRawData + pRawFrame->iCrtIndex, cbDemanded - cbProcessed);
+            memcpy(buffer + cbProcessed, pRawFrame->aRawData + pRawFrame->iCrtIndex, cbDemanded - cbProcessed);
             pRawFrame->iCrtIndex += (cbDemanded - cbProcessed);
             cbProcessed = cbDemanded;
             PushFront(queue, pRawFrame);
@@ -228,7 +250,7 @@ uint8_t *ReadMultiByte(MessageQueue *queue, uint32_t cbDemanded)
         }
     }
 
-    return aResult;
+    return cbProcessed;
 }
 
 /*! *********************************************************************************
@@ -246,12 +268,27 @@ int SendFrame(Framer *framer, void *frame)
         return HSDK_ERROR_INVALID;
     }
 
+    if (framer->CreateTxFrame != NULL) {
+        PhysicalDevice *device = (PhysicalDevice *)(framer->physicalLayer);
+        RawFrame *tx = framer->CreateTxFrame(framer, frame, &device->txSequence);
+        if (tx == NULL) {
+            logMessage(HSDK_ERROR, "[Framer]SendFrame", "Frame allocation failed", HSDKThreadId());
+            return HSDK_ERROR_ALLOC;
+        }
+
+        return WritePhysicalDeviceFrame(device, tx);
+    }
+
     uint32_t size;
     uint8_t *packet = framer->CreatePacket(framer, frame, &size);
+    if (packet == NULL) {
+        logMessage(HSDK_ERROR, "[Framer]SendFrame", "Packet allocation failed", HSDKThreadId());
+        return HSDK_ERROR_ALLOC;
+    }
 
     int err = SendBytes(framer, packet, size);
 
-    free(packet);
+    PoolFree(packet);
 
     return err;
 }
@@ -269,8 +306,11 @@ static void SendFsciAck(Framer *framer, FSCIFrame *frame)
     if (device->configParams->fsciRxAck) {
         /* Do not cascade ACKs. */
         if (frame->opGroup != 0xA4 || frame->opCode != 0xFD) {
-            device->write(device->deviceHandle, GetAckFrame(framer->lengthFieldSize),
-                          3 + framer->lengthFieldSize + 1 + 1);
+            if (device->write(device->deviceHandle, GetAckFrame(framer->lengthFieldSize),
+                              3 + framer->lengthFieldSize + 1 + 1) < 0) {
+                logMessage(HSDK_WARNING, "[Framer]SendFsciAck", "ACK not sent", HSDKThreadId());
+            }
+            HSDK_TRACE(TRACE_ACK_SENT, TRACE_INSTANT, 0);
             HSDKReleaseLock(device->inMessages->lock);
         }
     }
@@ -289,7 +329,19 @@ uint8_t *PackageFrame(Framer *framer, void *frame, uint32_t *size)
         return NULL;
     }
 
-    return framer->CreatePacket(framer, frame, size);
+    /* The packet comes from the pools; the caller gets a copy it can free(). */
+    uint8_t *packet = framer->CreatePacket(framer, frame, size);
+    if (packet == NULL) {
+        return NULL;
+    }
+
+    uint8_t *copy = (uint8_t *)malloc(*size);
+    if (copy != NULL) {
+        memcpy(copy, packet, *size);
+    }
+    PoolFree(packet);
+
+    return copy;
 }
 
 /*! *********************************************************************************
@@ -327,6 +379,8 @@ Framer *InitializeFramer(void *connDev, FramerProtocol protocol, uint8_t lengthF
     }
     logMessage(HSDK_INFO, "[Framer]InitializeFramer", "Created stopThread event", HSDKThreadId());
 
+    /* Not bounded: the received bytes are all parsed, and the frames of a framer too
+    far behind are dropped whole by DispatchFrame. */
     framer->queue = InitializeMessageQueue(INT32_MAX);
     if (framer->queue == NULL) {
         logMessage(HSDK_ERROR, "[Framer]InitializeFramer", "MessageQueue init failed", HSDKThreadId());
@@ -343,14 +397,18 @@ Framer *InitializeFramer(void *connDev, FramerProtocol protocol, uint8_t lengthF
     }
     logMessage(HSDK_INFO, "[Framer]InitializeFramer", "Created event manager for framer", HSDKThreadId());
 
+    framer->spin.budgetUs = ((PhysicalDevice *)connDev)->configParams->spinBudgetUs;
+    framer->spin.spinUs = framer->spin.budgetUs;
+
     AttachToPhysicalDevice(connDev, framer, FramerCallback);
     AttachToConcreteImplementation(framer, protocol);
 
-    framer->framerThread = HSDKCreateThread(FramerThreadRoutine, framer);
+    framer->framerThread = HSDKCreateThreadWithAttributes(FramerThreadRoutine, framer, &((PhysicalDevice *)connDev)->configParams->framerThread);
     if (!framer->framerThread) {
         DetachFromPhysicalDevice(connDev, framer);
         DestroyMessageQueue(framer->queue);
         framer->queue = NULL;
+        DestroyMemoryPool(framer->framePool);
         HSDKDestroyEvent(framer->stopThread);
 
         free(framer);
@@ -415,6 +473,10 @@ int DestroyFramer(Framer *framer)
 
     DestroyEventManager(framer->evtManager);
 
+    /* Frames still held by subscribers keep the pool alive until released. */
+    DestroyMemoryPool(framer->framePool);
+    framer->framePool = NULL;
+
     err = DestroyMessageQueue(framer->queue);
     framer->queue = NULL;
     if (err != HSDK_ERROR_SUCCESS) {
@@ -475,7 +537,7 @@ static void *FramerThreadRoutine(void *lpParam)
     framer->currentState = framer->SMStartState();
 
     while (loop) {
-        ret = HSDKWaitMultipleEvents(eventArray, 2, INFINITE_WAIT, &triggeredEvent);
+        ret = HSDKSpinWaitMultipleEvents(&framer->spin, eventArray, 2, &triggeredEvent);
 
         if (ret != HSDK_ERROR_SUCCESS) {
             loop = 0;
@@ -485,11 +547,13 @@ static void *FramerThreadRoutine(void *lpParam)
         switch (triggeredEvent) {
             case 0:
                 logMessage(HSDK_INFO, "[Framer]FramerThreadRoutine", "Framer terminated", HSDKThreadId());
-                return NULL;
+                loop = 0;
+                break;
 
             case 1:
 #ifdef _WIN32
                 cbCrtAvailable = MessageQueueGetContentSize(framer->queue);
+                HSDK_TRACE(TRACE_FRAMER_DEQUEUE, TRACE_INSTANT, cbCrtAvailable);
                 HSDKReleaseSemaphore(framer->queue->sAnnounceData);
                 cbSaved = cbCrtAvailable;
                 status = framer->StateMachineDispatch(framer, &response, &cbCrtAvailable);
@@ -501,8 +565,10 @@ static void *FramerThreadRoutine(void *lpParam)
                     } else if (status == INVALID_CRC) {
                         logMessage(HSDK_WARNING, "[Framer]FramerThreadRoutine", "Invalid CRC detected - frame dismissed.", HSDKThreadId());
                     } else {
+                        HSDK_TRACE(TRACE_FRAME_COMPLETE, TRACE_INSTANT,
+                                   ((FSCIFrame *)response)->opGroup << 8 | ((FSCIFrame *)response)->opCode);
                         SendFsciAck(framer, (FSCIFrame *)response);
-                        NotifyOnEvent(framer->evtManager, response);
+                        DispatchFrame(framer, response);
                         response = NULL;
                     }
                 } else if (status == INSUFFICIENT_DATA) {
@@ -518,6 +584,7 @@ static void *FramerThreadRoutine(void *lpParam)
                 if (cbCrtAvailable == 0) {
                     continue;
                 }
+                HSDK_TRACE(TRACE_FRAMER_DEQUEUE, TRACE_INSTANT, cbCrtAvailable);
                 cbSaved = cbCrtAvailable;
                 status = framer->StateMachineDispatch(framer, &response, &cbCrtAvailable);
                 MessageQueueDecrementSize(framer->queue, cbSaved - cbCrtAvailable);
@@ -528,8 +595,10 @@ static void *FramerThreadRoutine(void *lpParam)
                     } else if (status == INVALID_CRC) {
                         logMessage(HSDK_WARNING, "[Framer]FramerThreadRoutine", "Invalid CRC detected - frame dismissed.", HSDKThreadId());
                     } else {
+                        HSDK_TRACE(TRACE_FRAME_COMPLETE, TRACE_INSTANT,
+                                   ((FSCIFrame *)response)->opGroup << 8 | ((FSCIFrame *)response)->opCode);
                         SendFsciAck(framer, (FSCIFrame *)response);
-                        NotifyOnEvent(framer->evtManager, response);
+                        DispatchFrame(framer, response);
                         response = NULL;
                     }
                 }
@@ -541,14 +610,70 @@ static void *FramerThreadRoutine(void *lpParam)
         }
     }
 
+    /* Drop the frame left incomplete. */
+    if (response) {
+        DestroyFSCIFrame((FSCIFrame *)response);
+    }
+
     return NULL;
 }
 
+/*! *********************************************************************************
+ * \brief   Hands a complete frame to the observers of the framer. While the framer is
+ *          more than MaxQueuedMessages reads behind the device, the frame is dropped
+ *          instead, so that the framer catches up without losing the framing.
+ *
+ * \param[in] framer    pointer to the Framer
+ * \param[in] frame     the frame, owned by the callee
+ *
+ * \return None
+ ********************************************************************************** */
+static void DispatchFrame(Framer *framer, void *frame)
+{
+    PhysicalDevice *device = (PhysicalDevice *)(framer->physicalLayer);
+    uint32_t backlog;
+
+    HSDKAcquireLock(framer->queue->lock);
+    backlog = framer->queue->cMessages;
+    HSDKReleaseLock(framer->queue->lock);
+
+    if (backlog > device->configParams->maxQueuedMessages) {
+        logMessage(HSDK_WARNING, "[Framer]DispatchFrame", "Framer behind the device, frame dropped", HSDKThreadId());
+        CountDroppedFrame(device);
+        DestroyFSCIFrame((FSCIFrame *)frame);
+        return;
+    }
+
+    HSDK_TRACE(TRACE_CALLBACK, TRACE_BEGIN, 0);
+    NotifyOnEvent(framer->evtManager, frame);
+    HSDK_TRACE(TRACE_CALLBACK, TRACE_END, 0);
+}
+
+static void CountDroppedFrame(PhysicalDevice *device)
+{
+#ifdef _WIN32
+    InterlockedIncrement((volatile LONG *)&device->rxFramesDropped);
+#else
+    __atomic_fetch_add(&device->rxFramesDropped, 1, __ATOMIC_RELAXED);
+#endif
+}
+
 static void FramerCallback(void *callee, void *object)
 {
     Framer *framer = (Framer *) callee;
     RawFrame *frame = (RawFrame *) object;
-    MessageQueuePutWithSize(framer->queue, frame, frame->cbTotalSize);
+    PhysicalDevice *device = (PhysicalDevice *)(framer->physicalLayer);
+    uint32_t size = (frame != NULL) ? frame->cbTotalSize : 0;
+
+    /* A copy for this framer could not be made, or not queued. */
+    if (frame == NULL || MessageQueuePutWithSize(framer->queue, frame, size) != HSDK_ERROR_SUCCESS) {
+        logMessage(HSDK_WARNING, "[Framer]FramerCallback", "Memory allocation failed, received data dropped", HSDKThreadId());
+        DestroyRawFrame(frame);
+        CountDroppedFrame(device);
+        device->rxUndelivered = 1;
+        return;
+    }
+    HSDK_TRACE(TRACE_RX_ENQUEUE, TRACE_INSTANT, size);
     HSDKReleaseSemaphore(framer->queue->sAnnounceData);
 }
 
@@ -170,6 +170,39 @@ void NotifyOnSameEvent(EventManager *evt, void *object, void *(*func) (void *))
     }
 }
 
+/*! *********************************************************************************
+ * \brief Notifies every Observer, handing the object itself to the last one.
+ * \details Observers before the last receive a copy made with clone. If there are no
+ * Observers, the object is released with destroy.
+ *
+ * \param[in] evt      pointer to the EventManager
+ * \param[in] object   the object to hand off; ownership passes to the observers
+ * \param[in] clone    function creating a copy of the object
+ * \param[in] destroy  function releasing the object
+ *
+ * \return None
+ ********************************************************************************* */
+void NotifyOnSameEventMove(EventManager *evt, void *object, void *(*clone) (void *), void (*destroy) (void *))
+{
+    Observer *last = NULL;
+    Observer *crt = evt->obsList->next;
+    while (crt != NULL) {
+        if (crt->Callback != NULL) {
+            if (last != NULL) {
+                last->Callback(last->callee, clone(object));
+            }
+            last = crt;
+        }
+        crt = crt->next;
+    }
+
+    if (last != NULL) {
+        last->Callback(last->callee, object);
+    } else {
+        destroy(object);
+    }
+}
+
 /************************************************************************************
 *************************************************************************************
 * Private functions
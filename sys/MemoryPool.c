@@ -0,0 +1,511 @@
+/*! *********************************************************************************
+* \file MemoryPool.c
+* This is a source file for the MemoryPool module.
+*
+* Copyright 2013-2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************** */
+
+/************************************************************************************
+ *************************************************************************************
+ * Include
+ *************************************************************************************
+ ************************************************************************************/
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "MemoryPool.h"
+
+#include "hsdkError.h"
+
+/************************************************************************************
+ *************************************************************************************
+ * Private macros
+ *************************************************************************************
+ ************************************************************************************/
+/* Size classes served by PoolAlloc: 32, 64, ..., 4096 bytes. */
+#define SMALLEST_CLASS_SHIFT 5
+#define NUMBER_OF_CLASSES 8
+#define LARGEST_CLASS_SIZE (1 << (SMALLEST_CLASS_SHIFT + NUMBER_OF_CLASSES - 1))
+
+/* Free blocks kept by each size class. */
+#define CLASS_MAX_FREE 64
+
+/************************************************************************************
+ *************************************************************************************
+ * Private type definitions
+ *************************************************************************************
+ ************************************************************************************/
+/**
+ * @brief Header placed in front of every block.
+ */
+typedef struct _PoolBlock {
+    MemoryPool *pool;           /**< The pool the block belongs to, NULL for a block from the heap. */
+    struct _PoolBlock *next;    /**< Next block in the free list of the pool. */
+} PoolBlock;
+
+/************************************************************************************
+ *************************************************************************************
+ * Private prototypes
+ *************************************************************************************
+ ************************************************************************************/
+static MemoryPool **GetSizeClasses(void);
+static void FreePool(MemoryPool *pool);
+static void *SystemAllocate(void *context, size_t size);
+static void SystemRelease(void *context, void *block);
+static void *HookAllocate(size_t size);
+static void HookRelease(void *block);
+static int CountMiss(void);
+
+/************************************************************************************
+ *************************************************************************************
+ * Public memory declarations
+ *************************************************************************************
+ ************************************************************************************/
+
+/************************************************************************************
+ *************************************************************************************
+ * Private memory declarations
+ *************************************************************************************
+ ************************************************************************************/
+static MemoryPool **sizeClasses = NULL;
+
+static AllocatorHooks allocator = { SystemAllocate, SystemRelease, NULL };
+static uint8_t allocatorInUse = 0;
+
+/* Zero-malloc mode: pool misses are counted and, with failOnMiss, fail. */
+static uint8_t zeroMalloc = 0;
+static uint8_t zeroMallocFailOnMiss = 0;
+static uint32_t poolMisses = 0;
+
+/************************************************************************************
+ *************************************************************************************
+ * Public functions
+ *************************************************************************************
+ ************************************************************************************/
+
+/*! *********************************************************************************
+ * \brief  Creates a pool of fixed size blocks.
+ *
+ * \param[in] blockSize     usable size of each block
+ * \param[in] preallocated  number of blocks allocated up front
+ * \param[in] maxFree       maximum number of free blocks kept for reuse
+ *
+ * \return NULL on allocation failure, a pointer to the pool otherwise
+ ********************************************************************************** */
+MemoryPool *CreateMemoryPool(uint32_t blockSize, uint32_t preallocated, uint32_t maxFree)
+{
+    uint32_t i;
+
+    MemoryPool *pool = (MemoryPool *)HookAllocate(sizeof(MemoryPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    memset(pool, 0, sizeof(MemoryPool));
+
+    pool->blockSize = blockSize;
+    pool->maxFree = (maxFree > preallocated) ? maxFree : preallocated;
+    pool->lock = HSDKCreateLock();
+
+    for (i = 0; i < preallocated; i++) {
+        PoolBlock *block = (PoolBlock *)HookAllocate(sizeof(PoolBlock) + blockSize);
+        if (block == NULL) {
+            FreePool(pool);
+            return NULL;
+        }
+        block->pool = pool;
+        block->next = (PoolBlock *)pool->freeList;
+        pool->freeList = block;
+        pool->freeCount++;
+    }
+
+    return pool;
+}
+
+/*! *********************************************************************************
+ * \brief  Destroys a pool. If blocks are still in use, the pool is freed when the
+ *         last of them is returned.
+ *
+ * \param[in,out] pool pointer to the pool
+ *
+ * \return None
+ ********************************************************************************** */
+void DestroyMemoryPool(MemoryPool *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+
+    HSDKAcquireLock(pool->lock);
+    pool->closing = 1;
+    if (pool->outstanding > 0) {
+        HSDKReleaseLock(pool->lock);
+        return;
+    }
+    HSDKReleaseLock(pool->lock);
+
+    FreePool(pool);
+}
+
+/*! *********************************************************************************
+ * \brief  Takes a block from the pool, allocating a new one if the pool is empty.
+ *
+ * \param[in,out] pool pointer to the pool
+ *
+ * \return NULL on allocation failure, a pointer to blockSize bytes otherwise
+ ********************************************************************************** */
+void *MemoryPoolGet(MemoryPool *pool)
+{
+    PoolBlock *block;
+
+    HSDKAcquireLock(pool->lock);
+    block = (PoolBlock *)pool->freeList;
+    if (block != NULL) {
+        pool->freeList = block->next;
+        pool->freeCount--;
+    }
+    pool->outstanding++;
+    HSDKReleaseLock(pool->lock);
+
+    if (block == NULL) {
+        block = (CountMiss() == HSDK_ERROR_SUCCESS) ? (PoolBlock *)HookAllocate(sizeof(PoolBlock) + pool->blockSize) : NULL;
+        if (block == NULL) {
+            HSDKAcquireLock(pool->lock);
+            pool->outstanding--;
+            HSDKReleaseLock(pool->lock);
+            return NULL;
+        }
+        block->pool = pool;
+    }
+
+    return block + 1;
+}
+
+/*! *********************************************************************************
+ * \brief  Returns a block to the pool it was taken from. May be called from any
+ *         thread, including after the pool was destroyed.
+ *
+ * \param[in] block pointer returned by MemoryPoolGet or PoolAlloc
+ *
+ * \return None
+ ********************************************************************************** */
+void MemoryPoolPut(void *block)
+{
+    PoolBlock *header;
+    MemoryPool *pool;
+    uint8_t freePool = 0;
+
+    if (block == NULL) {
+        return;
+    }
+
+    header = (PoolBlock *)block - 1;
+    pool = header->pool;
+
+    if (pool == NULL) {
+        HookRelease(header);
+        return;
+    }
+
+    HSDKAcquireLock(pool->lock);
+    pool->outstanding--;
+    if (!pool->closing && pool->freeCount < pool->maxFree) {
+        header->next = (PoolBlock *)pool->freeList;
+        pool->freeList = header;
+        pool->freeCount++;
+        header = NULL;
+    }
+    freePool = pool->closing && pool->outstanding == 0;
+    HSDKReleaseLock(pool->lock);
+
+    if (header != NULL) {
+        HookRelease(header);
+    }
+    if (freePool) {
+        FreePool(pool);
+    }
+}
+
+/*! *********************************************************************************
+ * \brief  Allocates a block from the shared size class pools. Sizes above the largest
+ *         class are allocated from the heap.
+ *
+ * \param[in] size  number of bytes needed
+ *
+ * \return NULL on allocation failure, a pointer to at least size bytes otherwise
+ ********************************************************************************** */
+void *PoolAlloc(uint32_t size)
+{
+    uint32_t i;
+    MemoryPool **classes = GetSizeClasses();
+
+    if (classes != NULL && size <= LARGEST_CLASS_SIZE) {
+        for (i = 0; i < NUMBER_OF_CLASSES; i++) {
+            if (size <= classes[i]->blockSize) {
+                return MemoryPoolGet(classes[i]);
+            }
+        }
+    }
+
+    if (CountMiss() != HSDK_ERROR_SUCCESS) {
+        return NULL;
+    }
+
+    PoolBlock *block = (PoolBlock *)HookAllocate(sizeof(PoolBlock) + size);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->pool = NULL;
+
+    return block + 1;
+}
+
+/*! *********************************************************************************
+ * \brief  Frees a block allocated with PoolAlloc.
+ *
+ * \param[in] block pointer returned by PoolAlloc
+ *
+ * \return None
+ ********************************************************************************** */
+void PoolFree(void *block)
+{
+    MemoryPoolPut(block);
+}
+
+/*! *********************************************************************************
+ * \brief  Replaces the allocator backing the pools. Must be called before the first
+ *         allocation, i.e. before InitPhysicalDevice.
+ *
+ * \param[in] hooks the allocator to use, NULL for the system heap
+ *
+ * \return HSDK_ERROR_SUCCESS on success, HSDK_ERROR_BUSY if memory was already
+ *         allocated, HSDK_ERROR_INVALID if a hook is missing
+ ********************************************************************************** */
+int SetAllocatorHooks(AllocatorHooks *hooks)
+{
+    if (allocatorInUse) {
+        return HSDK_ERROR_BUSY;
+    }
+
+    if (hooks == NULL) {
+        allocator.allocate = SystemAllocate;
+        allocator.release = SystemRelease;
+        allocator.context = NULL;
+        return HSDK_ERROR_SUCCESS;
+    }
+
+    if (hooks->allocate == NULL || hooks->release == NULL) {
+        return HSDK_ERROR_INVALID;
+    }
+
+    allocator = *hooks;
+
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+ * \brief  Fills the shared size class pools with blocksPerClass blocks each and
+ *         enters the zero-malloc mode: from then on, a pool with no free block counts
+ *         a miss and, if failOnMiss is set, fails the allocation instead of going to
+ *         the allocator. Pools created later preallocate their own blocks.
+ *
+ * \param[in] blocksPerClass    number of free blocks to keep in each size class
+ * \param[in] failOnMiss        fail allocations on a miss instead of counting them
+ *
+ * \return HSDK_ERROR_SUCCESS on success, HSDK_ERROR_ALLOC if the blocks could not
+ *         be allocated
+ ********************************************************************************** */
+int EnableZeroMalloc(uint32_t blocksPerClass, uint8_t failOnMiss)
+{
+    uint32_t i;
+    int err = HSDK_ERROR_SUCCESS;
+    MemoryPool **classes = GetSizeClasses();
+
+    if (classes == NULL) {
+        return HSDK_ERROR_ALLOC;
+    }
+
+    for (i = 0; i < NUMBER_OF_CLASSES && err == HSDK_ERROR_SUCCESS; i++) {
+        MemoryPool *pool = classes[i];
+
+        HSDKAcquireLock(pool->lock);
+        if (pool->maxFree < blocksPerClass) {
+            pool->maxFree = blocksPerClass;
+        }
+        while (pool->freeCount < blocksPerClass) {
+            PoolBlock *block = (PoolBlock *)HookAllocate(sizeof(PoolBlock) + pool->blockSize);
+            if (block == NULL) {
+                err = HSDK_ERROR_ALLOC;
+                break;
+            }
+            block->pool = pool;
+            block->next = (PoolBlock *)pool->freeList;
+            pool->freeList = block;
+            pool->freeCount++;
+        }
+        HSDKReleaseLock(pool->lock);
+    }
+
+    zeroMallocFailOnMiss = failOnMiss;
+    zeroMalloc = 1;
+
+    return err;
+}
+
+/*! *********************************************************************************
+ * \brief  Returns the number of allocations that missed the pools since the
+ *         zero-malloc mode was enabled.
+ *
+ * \return the number of misses
+ ********************************************************************************** */
+uint32_t GetPoolMisses(void)
+{
+    return poolMisses;
+}
+
+/************************************************************************************
+ *************************************************************************************
+ * Private functions
+ *************************************************************************************
+ ************************************************************************************/
+
+/*! *********************************************************************************
+ * \brief  Returns the shared size class pools, creating them on first use.
+ *
+ * \return NULL on allocation failure, the array of size class pools otherwise
+ ********************************************************************************** */
+static MemoryPool **GetSizeClasses(void)
+{
+    uint32_t i;
+
+    if (sizeClasses != NULL) {
+        return sizeClasses;
+    }
+
+    MemoryPool **classes = (MemoryPool **)HookAllocate(NUMBER_OF_CLASSES * sizeof(MemoryPool *));
+    if (classes == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < NUMBER_OF_CLASSES; i++) {
+        classes[i] = CreateMemoryPool(1 << (SMALLEST_CLASS_SHIFT + i), 0, CLASS_MAX_FREE);
+        if (classes[i] == NULL) {
+            while (i--) {
+                FreePool(classes[i]);
+            }
+            HookRelease(classes);
+            return NULL;
+        }
+    }
+
+    /* Another thread may have created them meanwhile; keep only one set. */
+#ifdef _WIN32
+    if (InterlockedCompareExchangePointer((PVOID *)&sizeClasses, classes, NULL) != NULL) {
+#else
+    if (!__sync_bool_compare_and_swap(&sizeClasses, NULL, classes)) {
+#endif
+        for (i = 0; i < NUMBER_OF_CLASSES; i++) {
+            FreePool(classes[i]);
+        }
+        HookRelease(classes);
+    }
+
+    return sizeClasses;
+}
+
+/*! *********************************************************************************
+ * \brief  Frees a pool together with its free blocks.
+ *
+ * \param[in,out] pool pointer to the pool
+ *
+ * \return None
+ ********************************************************************************** */
+static void FreePool(MemoryPool *pool)
+{
+    PoolBlock *block = (PoolBlock *)pool->freeList;
+
+    while (block != NULL) {
+        PoolBlock *next = block->next;
+        HookRelease(block);
+        block = next;
+    }
+
+    HSDKDestroyLock(pool->lock);
+    HookRelease(pool);
+}
+
+/*! *********************************************************************************
+ * \brief  Default allocator hooks, over the system heap.
+ ********************************************************************************** */
+static void *SystemAllocate(void *context, size_t size)
+{
+    return malloc(size);
+}
+
+static void SystemRelease(void *context, void *block)
+{
+    free(block);
+}
+
+/*! *********************************************************************************
+ * \brief  Allocates through the installed hooks, which can no longer be replaced.
+ *
+ * \param[in] size  number of bytes needed
+ *
+ * \return NULL on allocation failure, a pointer to size bytes otherwise
+ ********************************************************************************** */
+static void *HookAllocate(size_t size)
+{
+    allocatorInUse = 1;
+    return allocator.allocate(allocator.context, size);
+}
+
+static void HookRelease(void *block)
+{
+    allocator.release(allocator.context, block);
+}
+
+/*! *********************************************************************************
+ * \brief  Accounts for an allocation that the pools could not serve.
+ *
+ * \return HSDK_ERROR_SUCCESS if the allocator may be used, HSDK_ERROR_ALLOC if the
+ *         zero-malloc mode fails on misses
+ ********************************************************************************** */
+static int CountMiss(void)
+{
+    if (!zeroMalloc) {
+        return HSDK_ERROR_SUCCESS;
+    }
+
+#ifdef _WIN32
+    InterlockedIncrement((volatile LONG *)&poolMisses);
+#else
+    __sync_fetch_and_add(&poolMisses, 1);
+#endif
+
+    return zeroMallocFailOnMiss ? HSDK_ERROR_ALLOC : HSDK_ERROR_SUCCESS;
+}
@@ -38,6 +38,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include "MessageQueue.h"
+#include "MemoryPool.h"
 
 #include "hsdkError.h"
 
@@ -98,6 +99,8 @@ MessageQueue *InitializeMessageQueue(uint32_t maxMessageFlow)
     pMessageQueue->tail = NULL;
     pMessageQueue->lock = HSDKCreateLock();
     pMessageQueue->cAvailableData = 0;
+    pMessageQueue->cMessages = 0;
+    pMessageQueue->maxMessages = maxMessageFlow;
     pMessageQueue->sAnnounceData = HSDKCreateSemaphore(0, maxMessageFlow);
 
     return pMessageQueue;
@@ -146,17 +149,25 @@ int ClearMessageQueue(MessageQueue *pMessageQueue)
  * \param[in,out] pMessageQueue pointer to the queue
  * \param[in] pData pointer to data
  *
- * \return None
+ * \return HSDK_ERROR_SUCCESS, HSDK_ERROR_BUSY if the queue is full or HSDK_ERROR_ALLOC;
+ *         on error the data is not enqueued and still belongs to the caller
  ********************************************************************************** */
-void MessageQueuePut(MessageQueue *pMessageQueue, void *pData)
+int MessageQueuePut(MessageQueue *pMessageQueue, void *pData)
 {
     Node *pNode = CreateNode(pData);
     if (pNode == NULL) {
-        return;
+        return HSDK_ERROR_ALLOC;
     }
 
     HSDKAcquireLock(pMessageQueue->lock);
 
+    if (pMessageQueue->cMessages >= pMessageQueue->maxMessages) {
+        HSDKReleaseLock(pMessageQueue->lock);
+        DestroyNode(pNode);
+        return HSDK_ERROR_BUSY;
+    }
+    pMessageQueue->cMessages++;
+
     if (IsEmpty(pMessageQueue, 0)) {
         pMessageQueue->head = pNode;
         pMessageQueue->tail = pNode;
@@ -166,6 +177,8 @@ void MessageQueuePut(MessageQueue *pMessageQueue, void *pData)
     }
 
     HSDKReleaseLock(pMessageQueue->lock);
+
+    return HSDK_ERROR_SUCCESS;
 }
 /*! *********************************************************************************
  * \brief  Get the data in the front of the queue.
@@ -191,6 +204,7 @@ void *MessageQueueGet(MessageQueue *pMessageQueue)
     pMessageQueue->head = pMessageQueue->head->next;
     if (!pMessageQueue->head)
         pMessageQueue->tail = NULL;
+    pMessageQueue->cMessages--;
 
     HSDKReleaseLock(pMessageQueue->lock);
 
@@ -230,17 +244,21 @@ uint8_t IsEmpty(MessageQueue *pMessageQueue, uint8_t synchronized)
  * \param[in, out] pMessageQueue pointer to the queue
  * \param[in] pData pointer to the data
  *
- * \return 1 is the queue is empty and 0 otherwise.
+ * \return HSDK_ERROR_SUCCESS, or HSDK_ERROR_ALLOC in which case the data still
+ *         belongs to the caller
  ********************************************************************************** */
-void PushFront(MessageQueue *pMessageQueue, void *pData)
+int PushFront(MessageQueue *pMessageQueue, void *pData)
 {
     Node *pNode = CreateNode(pData);
     if (pNode == NULL) {
-        return;
+        return HSDK_ERROR_ALLOC;
     }
 
     HSDKAcquireLock(pMessageQueue->lock);
 
+    /* Pushing back an element taken from the queue is always allowed. */
+    pMessageQueue->cMessages++;
+
     if (IsEmpty(pMessageQueue, 0)) {
         pMessageQueue->head = pNode;
         pMessageQueue->tail = pNode;
@@ -250,6 +268,8 @@ void PushFront(MessageQueue *pMessageQueue, void *pData)
     }
 
     HSDKReleaseLock(pMessageQueue->lock);
+
+    return HSDK_ERROR_SUCCESS;
 }
 
 /*! *********************************************************************************
@@ -298,7 +318,7 @@ Node *CreateNode(void *pData)
         return NULL;
     }
 
-    Node *pNode = (Node *) calloc(1, sizeof(Node));
+    Node *pNode = (Node *) PoolAlloc(sizeof(Node));
 
     if (!pNode) {
         return NULL;
@@ -322,7 +342,7 @@ int DestroyNode(Node *pNode)
     pNode->next = NULL;
     pNode->data = NULL;
 
-    free(pNode);
+    PoolFree(pNode);
 
     return HSDK_ERROR_SUCCESS;
 }
@@ -334,17 +354,25 @@ int DestroyNode(Node *pNode)
  * \param[in] pData pointer to the data to enqueue
  * \param[in] cSize size of the element enqueued
 
- * \return None
+ * \return HSDK_ERROR_SUCCESS, HSDK_ERROR_BUSY if the queue is full or HSDK_ERROR_ALLOC;
+ *         on error the data is not enqueued and still belongs to the caller
  ********************************************************************************** */
-void MessageQueuePutWithSize(MessageQueue *pMessageQueue, void *pData, uint32_t cSize)
+int MessageQueuePutWithSize(MessageQueue *pMessageQueue, void *pData, uint32_t cSize)
 {
     Node *pNode = CreateNode(pData);
     if (pNode == NULL) {
-        return;
+        return HSDK_ERROR_ALLOC;
     }
 
     HSDKAcquireLock(pMessageQueue->lock);
 
+    if (pMessageQueue->cMessages >= pMessageQueue->maxMessages) {
+        HSDKReleaseLock(pMessageQueue->lock);
+        DestroyNode(pNode);
+        return HSDK_ERROR_BUSY;
+    }
+    pMessageQueue->cMessages++;
+
     if (IsEmpty(pMessageQueue, 0)) {
         pMessageQueue->head = pNode;
         pMessageQueue->cAvailableData += cSize;
@@ -358,6 +386,8 @@ void MessageQueuePutWithSize(MessageQueue *pMessageQueue, void *pData, uint32_t
     }
 
     HSDKReleaseLock(pMessageQueue->lock);
+
+    return HSDK_ERROR_SUCCESS;
 }
 
 /*! *********************************************************************************
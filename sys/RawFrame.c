@@ -38,6 +38,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include "RawFrame.h"
+#include "MemoryPool.h"
+#include "hsdkOSCommon.h"
+#include "hsdkError.h"
 
 /************************************************************************************
 *************************************************************************************
@@ -51,6 +54,8 @@
 *************************************************************************************
 ************************************************************************************/
 RawFrame *CreateRawFrame(uint8_t *data, uint32_t size);
+static RawFrame *WrapRawData(uint8_t *data, uint32_t size);
+static uint32_t NextSequence(uint32_t *sequence);
 
 /************************************************************************************
 *************************************************************************************
@@ -69,9 +74,6 @@ RawFrame *CreateRawFrame(uint8_t *data, uint32_t size);
 * Private memory declarations
 *************************************************************************************
 ************************************************************************************/
-uint32_t RxIndex = 0;
-uint32_t TxIndex = 0;
-
 /************************************************************************************
 *************************************************************************************
 * Public functions
@@ -94,38 +96,167 @@ uint8_t *GetAckFrame(uint8_t lengthFieldSize)
 }
 
 /*! *********************************************************************************
-* \brief    Creates a received RawFrame. It increments rx counter
+* \brief    Creates a received RawFrame, stamped with the current time. It increments
+*           the rx counter of the device
 *
 * \param[in,out] data
 * \param[in,out] size
+* \param[in,out] sequence  the rx counter of the device
 *
 * \return   NULL on allocation failure, a pointer to a RawFrame object containing the
 *           data
 ********************************************************************************** */
-RawFrame *CreateRxRawFrame(uint8_t *data, uint32_t size)
+RawFrame *CreateRxRawFrame(uint8_t *data, uint32_t size, uint32_t *sequence)
 {
     RawFrame *frame = CreateRawFrame(data, size);
-    frame->packetIndex = RxIndex++;
+    if (frame != NULL) {
+        frame->packetIndex = NextSequence(sequence);
+    }
 
     return frame;
 }
 
 /*! *********************************************************************************
-* \brief    Creates a received RawFrame. It increments tx counter
+* \brief    Creates a received RawFrame around a buffer obtained with PoolAlloc,
+*           without copying it. The frame takes ownership of the buffer and releases
+*           it in DestroyRawFrame. The frame is stamped with the current time, to be
+*           called right after the read. It increments the rx counter of the device
+*
+* \param[in] data       buffer allocated with PoolAlloc
+* \param[in] size       number of valid bytes in the buffer
+* \param[in,out] sequence  the rx counter of the device
+*
+* \return   NULL on allocation failure, a pointer to a RawFrame object owning the
+*           data. On failure the buffer is still owned by the caller.
+********************************************************************************** */
+RawFrame *AdoptRxRawFrame(uint8_t *data, uint32_t size, uint32_t *sequence)
+{
+    RawFrame *frame = WrapRawData(data, size);
+    if (frame != NULL) {
+        frame->packetIndex = NextSequence(sequence);
+    }
+
+    return frame;
+}
+
+/*! *********************************************************************************
+* \brief    Creates a RawFrame to be sent. It increments the tx counter of the device;
+*           the timestamp is set again when the frame is written
 *
 * \param[in,out] data
 * \param[in,out] size
+* \param[in,out] sequence  the tx counter of the device
 *
 * \return   NULL on allocation failure, a pointer to a RawFrame object containing the
 *           data
 ********************************************************************************** */
-RawFrame *CreateTxRawFrame(uint8_t *data, uint32_t size)
+RawFrame *CreateTxRawFrame(uint8_t *data, uint32_t size, uint32_t *sequence)
 {
     RawFrame *frame = CreateRawFrame(data, size);
-    frame->packetIndex = TxIndex++;
+    if (frame != NULL) {
+        frame->packetIndex = NextSequence(sequence);
+        frame->segments[0].data = frame->aRawData;
+        frame->segments[0].size = size;
+        frame->segmentCount = 1;
+    }
+    return frame;
+}
+
+/*! *********************************************************************************
+* \brief    Creates a RawFrame to be sent made of a header, a payload and a trailer,
+*           written together without being assembled into one buffer. The header and
+*           the trailer are stored in the frame and the payload is copied once, as the
+*           caller keeps its buffer. It increments the tx counter of the device
+*
+* \param[in] header        the bytes before the payload
+* \param[in] headerSize    size of the header
+* \param[in] payload       the payload, may be NULL if payloadSize is 0
+* \param[in] payloadSize   size of the payload
+* \param[in] trailer       the bytes after the payload, usually the CRC
+* \param[in] trailerSize   size of the trailer
+* \param[in,out] sequence  the tx counter of the device
+*
+* \return   NULL on allocation failure or if the header and trailer do not fit
+*           RAW_FRAME_FRAMING_SIZE, a pointer to a RawFrame object otherwise
+********************************************************************************** */
+RawFrame *CreateSegmentedTxRawFrame(uint8_t *header, uint32_t headerSize, uint8_t *payload, uint32_t payloadSize,
+                                    uint8_t *trailer, uint32_t trailerSize, uint32_t *sequence)
+{
+    RawFrame *frame;
+    uint8_t *copy = NULL;
+
+    if (headerSize + trailerSize > RAW_FRAME_FRAMING_SIZE) {
+        return NULL;
+    }
+
+    if (payloadSize > 0) {
+        copy = (uint8_t *)PoolAlloc(payloadSize);
+        if (!copy) {
+            return NULL;
+        }
+        memcpy(copy, payload, payloadSize);
+    }
+
+    frame = WrapRawData(copy, headerSize + payloadSize + trailerSize);
+    if (!frame) {
+        PoolFree(copy);
+        return NULL;
+    }
+
+    memcpy(frame->framing, header, headerSize);
+    memcpy(frame->framing + headerSize, trailer, trailerSize);
+
+    frame->segments[0].data = frame->framing;
+    frame->segments[0].size = headerSize;
+    frame->segments[1].data = copy;
+    frame->segments[1].size = payloadSize;
+    frame->segments[2].data = frame->framing + headerSize;
+    frame->segments[2].size = trailerSize;
+    frame->segmentCount = 3;
+    frame->packetIndex = NextSequence(sequence);
+
     return frame;
 }
 
+/*! *********************************************************************************
+* \brief    Gathers the segments of a RawFrame to be sent into a single buffer, for
+*           the devices that cannot write several buffers at once. aRawData then holds
+*           the whole frame, as for a frame created with CreateTxRawFrame
+*
+* \param[in,out] frame
+*
+* \return   HSDK_ERROR_SUCCESS on success, HSDK_ERROR_ALLOC on allocation failure
+********************************************************************************** */
+int FlattenRawFrame(RawFrame *frame)
+{
+    uint32_t i, offset = 0;
+    uint8_t *data;
+
+    if (frame->segmentCount <= 1) {
+        return HSDK_ERROR_SUCCESS;
+    }
+
+    data = (uint8_t *)PoolAlloc(frame->cbTotalSize);
+    if (!data) {
+        return HSDK_ERROR_ALLOC;
+    }
+
+    for (i = 0; i < frame->segmentCount; i++) {
+        memcpy(data + offset, frame->segments[i].data, frame->segments[i].size);
+        offset += frame->segments[i].size;
+    }
+
+    if (frame->aRawData != NULL) {
+        PoolFree(frame->aRawData);
+    }
+    frame->aRawData = data;
+    frame->segments[0].data = data;
+    frame->segments[0].size = frame->cbTotalSize;
+    frame->segmentCount = 1;
+
+    return HSDK_ERROR_SUCCESS;
+}
+
 
 /*! *********************************************************************************
 * \brief    Free the memory allocated for a RawFrame object.
@@ -138,27 +269,28 @@ void DestroyRawFrame(RawFrame *frame)
 {
     if (frame != NULL) {
         if (frame->aRawData != NULL) {
-            free(frame->aRawData);
+            PoolFree(frame->aRawData);
         }
 
         frame->aRawData = NULL;
-        free(frame);
+        PoolFree(frame);
     }
 }
 
 RawFrame *CloneRawFrame(RawFrame *frame)
 {
-    RawFrame *newFrame = (RawFrame *)calloc(1, sizeof(RawFrame));
+    RawFrame *newFrame = (RawFrame *)PoolAlloc(sizeof(RawFrame));
 
     if (!newFrame) {
         return NULL;
     }
+    memset(newFrame, 0, sizeof(RawFrame));
 
-    newFrame->timeStamp = frame->timeStamp;
-    newFrame->aRawData = (uint8_t *)calloc(frame->cbTotalSize, sizeof(uint8_t));
+    newFrame->timestampNs = frame->timestampNs;
+    newFrame->aRawData = (uint8_t *)PoolAlloc(frame->cbTotalSize);
 
     if (!newFrame->aRawData) {
-        free(newFrame);
+        PoolFree(newFrame);
         return NULL;
     }
 
@@ -190,24 +322,59 @@ RawFrame *CloneRawFrame(RawFrame *frame)
 ********************************************************************************** */
 RawFrame *CreateRawFrame(uint8_t *data, uint32_t size)
 {
-    RawFrame *frame = (RawFrame *)calloc(1, sizeof(RawFrame));
+    uint8_t *copy = (uint8_t *)PoolAlloc(size);
 
-    if (!frame) {
+    if (!copy) {
         return NULL;
     }
 
-    frame->timeStamp = time(NULL);
-    frame->aRawData = (uint8_t *)calloc(size, sizeof(uint8_t));
+    memcpy(copy, data, size);
 
-    if (!frame->aRawData) {
-        free(frame);
-        return NULL;
+    RawFrame *frame = WrapRawData(copy, size);
+    if (!frame) {
+        PoolFree(copy);
     }
 
-    memcpy(frame->aRawData, data, size);
+    return frame;
+}
+
+/*! *********************************************************************************
+* \brief    Creates a RawFrame that takes ownership of a pooled data buffer.
+*
+* \param[in] data   buffer allocated with PoolAlloc
+* \param[in] size   number of valid bytes in the buffer
+*
+* \return   NULL on allocation failure, a pointer to a RawFrame object
+********************************************************************************** */
+static RawFrame *WrapRawData(uint8_t *data, uint32_t size)
+{
+    RawFrame *frame = (RawFrame *)PoolAlloc(sizeof(RawFrame));
 
+    if (!frame) {
+        return NULL;
+    }
+    memset(frame, 0, sizeof(RawFrame));
+
+    frame->timestampNs = HSDKMonotonicNs();
+    frame->aRawData = data;
     frame->cbTotalSize = size;
     frame->iCrtIndex = 0;
 
     return frame;
 }
+
+/*! *********************************************************************************
+* \brief    Returns the next number of a sequence shared by several threads.
+*
+* \param[in,out] sequence  the counter of the sequence
+*
+* \return   the value of the counter before it was incremented
+********************************************************************************** */
+static uint32_t NextSequence(uint32_t *sequence)
+{
+#ifdef _WIN32
+    return (uint32_t)InterlockedIncrement((volatile LONG *)sequence) - 1;
+#else
+    return __sync_fetch_and_add(sequence, 1);
+#endif
+}
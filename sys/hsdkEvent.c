@@ -30,7 +30,9 @@
 * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************************************************** */
 #include "hsdkOSCommon.h"
+#include "hsdkError.h"
 #include "hsdkLogger.h"
+#include "MemoryPool.h"
 
 #ifdef _WIN32
 
@@ -53,7 +55,7 @@ Event HSDKCreateEvent(int initialValue)
 
 Event HSDKDeviceTriggerableEvent(File e, void **asyncMask)
 {
-    CommEventHelper *evtHelper = (CommEventHelper *) calloc(1, sizeof(CommEventHelper));
+    CommEventHelper *evtHelper = (CommEventHelper *) PoolAlloc(sizeof(CommEventHelper));
     if (evtHelper == NULL) {
         logMessage(HSDK_ERROR, "[hsdkEvent]HSDKDeviceTriggerableEvent", "Failed to allocate memory for helper", HSDKThreadId());
         return INVALID_EVENT_HANDLE;
@@ -84,7 +86,7 @@ int HSDKFinishTriggerableEvent(void *asyncMask)
         logMessage(HSDK_ERROR, "[hsdkEvent]HSDKFinishTriggerableEvent", "Failed to close event", HSDKThreadId());
         return (int)err;
     }
-    free(evtHelper);
+    PoolFree(evtHelper);
 
     return ERROR_SUCCESS;
 }
@@ -185,37 +187,132 @@ int HSDKWaitMultipleEvents(Event *events, uint32_t noEvents, int64_t millisecond
     return ERROR_SUCCESS;
 }
 
+/* Checks the events without waiting; returns 1 if one is signaled, 0 otherwise. */
+static int TryMultipleEvents(Event *events, uint32_t noEvents, int *triggeredEvent)
+{
+    DWORD ret = WaitForMultipleObjectsEx(noEvents, events, FALSE, 0, FALSE);
+    DWORD evtNumber = ret - WAIT_OBJECT_0;
 
-#elif __linux__
+    if (evtNumber >= noEvents) {
+        return 0;
+    }
+
+    *triggeredEvent = (int)evtNumber;
+    return 1;
+}
 
-#include "hsdkError.h"
+
+#elif __linux__
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <linux/futex.h>
 #include <sys/eventfd.h>
 #include <sys/select.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 
 
+/* Set in the count of an event once it has moved to its eventfd. */
+#define EVENT_FD_MODE 0x80000000u
+
+/* Cleared on kernels without futex_waitv, older than Linux 5.16. */
+static uint8_t futexWaitvSupported = 1;
+
+static int FutexWait(uint32_t *word, uint32_t expected, const struct timespec *timeout)
+{
+    return (int)syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, timeout, NULL, 0);
+}
+
+static void FutexWake(uint32_t *word)
+{
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+/* Takes one signal from the count of a pure event; returns 1 if taken, 0 if the
+count is 0 and -1 if the event has moved to its eventfd. */
+static int TryAcquireEvent(Event e)
+{
+    uint32_t count = __atomic_load_n(&e->count, __ATOMIC_SEQ_CST);
+
+    do {
+        if (count & EVENT_FD_MODE) {
+            return -1;
+        }
+        if (count == 0) {
+            return 0;
+        }
+    } while (!__atomic_compare_exchange_n(&e->count, &count, count - 1, 1, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+
+    return 1;
+}
+
 Event HSDKCreateEvent(int initialValue)
 {
     Event evt = (Event) calloc(1, sizeof(EvtWrapper));
+    if (evt == NULL) {
+        logMessage(HSDK_ERROR, "[hsdkEvent]HSDKCreateEvent", "Failed to allocate memory for event", HSDKThreadId());
+        return INVALID_EVENT_HANDLE;
+    }
 
+    /* The eventfd is created by HSDKEventFile, once the event is polled along with other files. */
     evt->pureEvent = 1;
-    evt->event = eventfd(initialValue, EFD_SEMAPHORE);
+    evt->event = -1;
+    evt->count = (uint32_t)initialValue;
 
     return evt;
 }
 
+File HSDKEventFile(Event e)
+{
+    int fd = __atomic_load_n(&e->event, __ATOMIC_ACQUIRE);
+    int expected = -1;
+    uint64_t count;
+
+    if (!e->pureEvent || fd != -1) {
+        return fd;
+    }
+
+    fd = eventfd(0, EFD_SEMAPHORE);
+    if (fd == -1) {
+        perror("HSDKEventFile eventfd");
+        logMessage(HSDK_ERROR, "[hsdkEvent]HSDKEventFile", strerror(errno), HSDKThreadId());
+        return -1;
+    }
+
+    if (!__atomic_compare_exchange_n(&e->event, &expected, fd, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        close(fd);
+        return expected;
+    }
+
+    /* Signals go to the eventfd from now on, those counted so far are moved into it. */
+    count = __atomic_exchange_n(&e->count, EVENT_FD_MODE, __ATOMIC_SEQ_CST);
+    if (count > 0 && write(fd, &count, sizeof(uint64_t)) == -1) {
+        perror("HSDKEventFile write");
+    }
+    if (__atomic_load_n(&e->waiters, __ATOMIC_SEQ_CST) > 0) {
+        FutexWake(&e->count);
+    }
+
+    return fd;
+}
+
 Event HSDKDeviceTriggerableEvent(File e, void **asyncMask)
 {
-    Event evt = (Event) calloc(1, sizeof(EvtWrapper));
+    Event evt = (Event) PoolAlloc(sizeof(EvtWrapper));
+    if (evt == NULL) {
+        logMessage(HSDK_ERROR, "[hsdkEvent]HSDKDeviceTriggerableEvent", "Failed to allocate memory for event", HSDKThreadId());
+        return INVALID_EVENT_HANDLE;
+    }
+    memset(evt, 0, sizeof(EvtWrapper));
 
     evt->pureEvent = 0;
     evt->event = e;
@@ -225,17 +322,27 @@ Event HSDKDeviceTriggerableEvent(File e, void **asyncMask)
     return evt;
 }
 
+Event HSDKDeviceWritableEvent(File e, void **asyncMask)
+{
+    Event evt = HSDKDeviceTriggerableEvent(e, asyncMask);
+    if (evt != INVALID_EVENT_HANDLE) {
+        evt->writable = 1;
+    }
+
+    return evt;
+}
+
 int HSDKFinishTriggerableEvent(void *asyncMask)
 {
     Event evt = (Event) asyncMask;
-    free(evt);
+    PoolFree(evt);
     /* Maybe it should be invalid for a non pure event. */
     return 0;
 }
 
 int HSDKResetEvent(Event e)
 {
-    if (e->pureEvent) {
+    if (e->pureEvent && TryAcquireEvent(e) == -1) {
         uint64_t inc;
         int rc = read(e->event, &inc, sizeof(uint64_t));
         if (rc == -1) {
@@ -249,7 +356,7 @@ int HSDKResetEvent(Event e)
 
 int HSDKDestroyEvent(Event e)
 {
-    if (e->pureEvent) {
+    if (e->pureEvent && e->event != -1) {
         close(e->event);
     }
     free(e);
@@ -260,75 +367,265 @@ int HSDKDestroyEvent(Event e)
 int HSDKSignalEvent(Event e)
 {
     if (e->pureEvent) {
-        uint64_t inc = 1;
-        int rc = write(e->event, &inc, sizeof(uint64_t));
-        if (rc == -1) {
-            perror("HSDKSignalEvent write");
-            return errno;
+        uint32_t count = __atomic_load_n(&e->count, __ATOMIC_SEQ_CST);
+
+        do {
+            if (count & EVENT_FD_MODE) {
+                uint64_t inc = 1;
+                int rc = write(e->event, &inc, sizeof(uint64_t));
+                if (rc == -1) {
+                    perror("HSDKSignalEvent write");
+                    return errno;
+                }
+                return 0;
+            }
+        } while (!__atomic_compare_exchange_n(&e->count, &count, count + 1, 1, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+
+        /* No system call unless a thread sleeps on the event. */
+        if (__atomic_load_n(&e->waiters, __ATOMIC_SEQ_CST) > 0) {
+            FutexWake(&e->count);
         }
     }
     /* Maybe it should be invalid for a non pure event. */
     return 0;
 }
 
-int HSDKWaitEvent(Event e, int64_t millisecondsToWait)
+/* Waits for an event that has moved to its eventfd. */
+static int WaitEventFile(Event e, int64_t millisecondsToWait)
 {
-    if (e->pureEvent) {
-        uint64_t inc;
+    uint64_t inc;
 
-        struct pollfd pfds[1];
-        int nfds = 1;
-        pfds[0].fd = e->event;
-        pfds[0].events = POLLIN;
+    struct pollfd pfds[1];
+    int nfds = 1;
+    pfds[0].fd = e->event;
+    pfds[0].events = POLLIN;
 
-        int rc = poll(pfds, nfds, (int)millisecondsToWait);
-        /* Poll error */
+    int rc = poll(pfds, nfds, (int)millisecondsToWait);
+    /* Poll error */
+    if (rc == -1) {
+        perror("[HSDKWaitEvent] poll");
+        logMessage(HSDK_ERROR, "[HSDKWaitEvent] poll", strerror(errno), HSDKThreadId());
+        return -1;
+    }
+    /* Poll timeout */
+    else if (rc == 0) {
+        logMessage(HSDK_INFO, "[HSDKWaitEvent] poll", "timeout", HSDKThreadId());
+        return 0;
+    }
+
+    if (pfds[0].revents & POLLIN) {
+        rc = read(e->event, &inc, sizeof(uint64_t));
         if (rc == -1) {
-            perror("[HSDKWaitEvent] poll");
-            logMessage(HSDK_ERROR, "[HSDKWaitEvent] poll", strerror(errno), HSDKThreadId());
+            perror("[HSDKWaitEvent] read");
+            logMessage(HSDK_ERROR, "[HSDKWaitEvent] read", strerror(errno), HSDKThreadId());
             return -1;
         }
-        /* Poll timeout */
-        else if (rc == 0) {
-            logMessage(HSDK_INFO, "[HSDKWaitEvent] poll", "timeout", HSDKThreadId());
-            return 0;
+    }
+
+    return 1;
+}
+
+int HSDKWaitEvent(Event e, int64_t millisecondsToWait)
+{
+    uint64_t deadline = 0, now;
+    struct timespec timeout;
+    int rc;
+
+    if (!e->pureEvent) {
+        /* Maybe it should be invalid for a non pure event. */
+        return HSDK_ERROR_INVALID;
+    }
+
+    if (millisecondsToWait != INFINITE_WAIT) {
+        deadline = HSDKMonotonicNs() + (uint64_t)millisecondsToWait * 1000000;
+    }
+
+    while (1) {
+        rc = TryAcquireEvent(e);
+        if (rc == 1) {
+            return 1;
         }
 
-        if (pfds[0].revents & POLLIN) {
-            rc = read(e->event, &inc, sizeof(uint64_t));
-            if (rc == -1) {
-                perror("[HSDKWaitEvent] read");
-                logMessage(HSDK_ERROR, "[HSDKWaitEvent] read", strerror(errno), HSDKThreadId());
-                return -1;
+        now = (millisecondsToWait != INFINITE_WAIT) ? HSDKMonotonicNs() : 0;
+        if (rc == -1) {
+            return WaitEventFile(e, (millisecondsToWait == INFINITE_WAIT) ? INFINITE_WAIT :
+                                 (now < deadline) ? (int64_t)((deadline - now + 999999) / 1000000) : 0);
+        }
+        if (millisecondsToWait != INFINITE_WAIT) {
+            if (now >= deadline) {
+                logMessage(HSDK_INFO, "[HSDKWaitEvent] futex", "timeout", HSDKThreadId());
+                return 0;
             }
+            timeout.tv_sec = (time_t)((deadline - now) / 1000000000);
+            timeout.tv_nsec = (long)((deadline - now) % 1000000000);
         }
 
-        return 1;
+        __atomic_fetch_add(&e->waiters, 1, __ATOMIC_SEQ_CST);
+        rc = FutexWait(&e->count, 0, (millisecondsToWait == INFINITE_WAIT) ? NULL : &timeout);
+        __atomic_fetch_sub(&e->waiters, 1, __ATOMIC_SEQ_CST);
+
+        if (rc == -1 && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT) {
+            perror("[HSDKWaitEvent] futex");
+            logMessage(HSDK_ERROR, "[HSDKWaitEvent] futex", strerror(errno), HSDKThreadId());
+            return -1;
+        }
     }
+}
 
-    /* Maybe it should be invalid for a non pure event. */
-    return HSDK_ERROR_INVALID;
+/* Checks the pure events that have no eventfd; returns 1 if one is signaled, 0 if
+none is and the number of the other events in fileEvents. */
+static int CheckPureEvents(Event *events, uint32_t noEvents, int *triggeredEvent, uint32_t *fileEvents)
+{
+    uint32_t i, count;
+
+    *fileEvents = 0;
+    for (i = 0; i < noEvents; i++) {
+        if (events[i] == NULL) {
+            continue;
+        }
+        if (!events[i]->pureEvent) {
+            (*fileEvents)++;
+            continue;
+        }
+
+        count = __atomic_load_n(&events[i]->count, __ATOMIC_SEQ_CST);
+        if (count & EVENT_FD_MODE) {
+            (*fileEvents)++;
+        } else if (count > 0) {
+            *triggeredEvent = i;
+            return 1;
+        }
+    }
+
+    return 0;
 }
 
+/* Sleeps on the counts of pure events that have no eventfd; returns 1 if one is
+signaled, 0 on timeout, -1 on error and -2 if the events must be polled instead. */
+static int FutexWaitMultipleEvents(Event *events, uint32_t noEvents, int millisecondsToWait, int *triggeredEvent)
+{
+#if defined(FUTEX_32) && defined(SYS_futex_waitv)
+    struct futex_waitv vector[noEvents];
+    struct timespec deadline;
+    uint32_t i, noWaiters = 0, fileEvents;
+    int rc, err;
 
+    for (i = 0; i < noEvents; i++) {
+        if (events[i] != NULL) {
+            memset(&vector[noWaiters], 0, sizeof(struct futex_waitv));
+            vector[noWaiters].uaddr = (uintptr_t)&events[i]->count;
+            vector[noWaiters].flags = FUTEX_32 | FUTEX_PRIVATE_FLAG;
+            noWaiters++;
+        }
+    }
+    if (noWaiters == 0 || noWaiters > FUTEX_WAITV_MAX) {
+        return -2;
+    }
 
-int HSDKWaitMultipleEvents(Event *events, uint32_t noEvents, int64_t millisecondsToWait, int *triggeredEvent)
+    if (millisecondsToWait != INFINITE_WAIT) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += millisecondsToWait / 1000;
+        deadline.tv_nsec += (long)(millisecondsToWait % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    while (1) {
+        if (CheckPureEvents(events, noEvents, triggeredEvent, &fileEvents)) {
+            return 1;
+        }
+        if (fileEvents > 0) {
+            return -2;
+        }
+
+        for (i = 0; i < noEvents; i++) {
+            if (events[i] != NULL) {
+                __atomic_fetch_add(&events[i]->waiters, 1, __ATOMIC_SEQ_CST);
+            }
+        }
+        rc = (int)syscall(SYS_futex_waitv, vector, noWaiters, 0,
+                          (millisecondsToWait == INFINITE_WAIT) ? NULL : &deadline, CLOCK_MONOTONIC);
+        err = errno;
+        for (i = 0; i < noEvents; i++) {
+            if (events[i] != NULL) {
+                __atomic_fetch_sub(&events[i]->waiters, 1, __ATOMIC_SEQ_CST);
+            }
+        }
+
+        if (rc == -1) {
+            if (err == ETIMEDOUT) {
+                return 0;
+            } else if (err == ENOSYS) {
+                futexWaitvSupported = 0;
+                return -2;
+            } else if (err != EAGAIN && err != EINTR) {
+                errno = err;
+                return -1;
+            }
+        }
+    }
+#else
+    return -2;
+#endif
+}
+
+/* Polls the events; returns the result of poll, the signaled event is stored in triggeredEvent. */
+static int PollMultipleEvents(Event *events, uint32_t noEvents, int millisecondsToWait, int *triggeredEvent)
 {
     int rc = 0;
-    uint32_t i;
+    uint32_t i, fileEvents;
+
+    /* Pure events are checked, and waited for while no file is involved, without an eventfd. */
+    if (CheckPureEvents(events, noEvents, triggeredEvent, &fileEvents)) {
+        return 1;
+    }
+    if (fileEvents == 0) {
+        if (millisecondsToWait == 0) {
+            return 0;
+        }
+        if (futexWaitvSupported) {
+            rc = FutexWaitMultipleEvents(events, noEvents, millisecondsToWait, triggeredEvent);
+            if (rc != -2) {
+                return rc;
+            }
+        }
+    }
 
     /* Set up descriptors to poll on. */
     struct pollfd pfds[noEvents];
     for (i = 0; i < noEvents; i++) {
         if (events[i] != NULL) {
-            pfds[i].fd = events[i]->event;
+            pfds[i].fd = HSDKEventFile(events[i]);
+            pfds[i].events = events[i]->writable ? POLLOUT : POLLIN;
         } else {
             pfds[i].fd = -1;
+            pfds[i].events = POLLIN;
+        }
+    }
+
+    rc = poll(pfds, noEvents, millisecondsToWait);
+    if (rc <= 0) {
+        return rc;
+    }
+
+    for (i = 0; i < noEvents; i++) {
+        /* A device that errored is reported writable, the write reports the error. */
+        if ((pfds[i].revents & POLLIN) ||
+                ((pfds[i].events & POLLOUT) && (pfds[i].revents & (POLLOUT | POLLERR | POLLHUP)))) {
+            *triggeredEvent = i;
+            break;
         }
-        pfds[i].events = POLLIN;
     }
 
-    rc = poll(pfds, noEvents, (int)millisecondsToWait);
+    return rc;
+}
+
+int HSDKWaitMultipleEvents(Event *events, uint32_t noEvents, int64_t millisecondsToWait, int *triggeredEvent)
+{
+    int rc = PollMultipleEvents(events, noEvents, (int)millisecondsToWait, triggeredEvent);
+
     /* Poll error */
     if (rc == -1) {
         perror("[HSDKWaitMultipleEvents] poll");
@@ -341,16 +638,15 @@ int HSDKWaitMultipleEvents(Event *events, uint32_t noEvents, int64_t millisecond
         return -1;
     }
 
-    for (i = 0; i < noEvents; i++) {
-        if (pfds[i].revents & POLLIN) {
-            *triggeredEvent = i;
-            break;
-        }
-    }
-
     return HSDK_ERROR_SUCCESS;
 }
 
+/* Checks the events without waiting; returns 1 if one is signaled, 0 otherwise. */
+static int TryMultipleEvents(Event *events, uint32_t noEvents, int *triggeredEvent)
+{
+    return PollMultipleEvents(events, noEvents, 0, triggeredEvent) > 0;
+}
+
 
 #elif __APPLE__
 
@@ -384,7 +680,12 @@ Event HSDKCreateEvent(int initialValue)
 
 Event HSDKDeviceTriggerableEvent(File e, void **asyncMask)
 {
-    Event evt = (Event) calloc(1, sizeof(EvtWrapper));
+    Event evt = (Event) PoolAlloc(sizeof(EvtWrapper));
+    if (evt == NULL) {
+        logMessage(HSDK_ERROR, "[hsdkEvent]HSDKDeviceTriggerableEvent", "Failed to allocate memory for event", HSDKThreadId());
+        return INVALID_EVENT_HANDLE;
+    }
+    memset(evt, 0, sizeof(EvtWrapper));
 
     evt->pureEvent = 0;
     evt->read_end = e;
@@ -394,10 +695,20 @@ Event HSDKDeviceTriggerableEvent(File e, void **asyncMask)
     return evt;
 }
 
+Event HSDKDeviceWritableEvent(File e, void **asyncMask)
+{
+    Event evt = HSDKDeviceTriggerableEvent(e, asyncMask);
+    if (evt != INVALID_EVENT_HANDLE) {
+        evt->writable = 1;
+    }
+
+    return evt;
+}
+
 int HSDKFinishTriggerableEvent(void *asyncMask)
 {
     Event evt = (Event) asyncMask;
-    free(evt);
+    PoolFree(evt);
     //Maybe it should be invalid for a non pure event
     return 0;
 }
@@ -466,20 +777,20 @@ int HSDKWaitEvent(Event e, int64_t millisecondsToWait)
 int HSDKWaitMultipleEvents(Event *events, uint32_t noEvents, int64_t millisecondsToWait, int *triggeredEvent)
 {
     uint32_t i;
-    int max = events[0]->read_end;
-    fd_set waitSet;
+    int max = -1;
+    fd_set waitSet, writeSet;
     FD_ZERO(&waitSet);
-    FD_SET(events[0]->read_end, &waitSet);
+    FD_ZERO(&writeSet);
 
-    for (i = 1; i < noEvents; i++) {
-        FD_SET(events[i]->read_end, &waitSet);
+    for (i = 0; i < noEvents; i++) {
+        FD_SET(events[i]->read_end, events[i]->writable ? &writeSet : &waitSet);
         if (max < events[i]->read_end) {
             max = events[i]->read_end;
         }
     }
 
     if (millisecondsToWait == INFINITE_WAIT) {
-        int rc = select(max + 1, &waitSet, NULL, NULL, NULL);
+        int rc = select(max + 1, &waitSet, &writeSet, NULL, NULL);
         if (rc < 0) {
             perror("HSDKWaitMultipleEvents select");
         }
@@ -489,13 +800,13 @@ int HSDKWaitMultipleEvents(Event *events, uint32_t noEvents, int64_t millisecond
         time.tv_sec = (int)millisecondsToWait / 1000;
         time.tv_usec = (millisecondsToWait - time.tv_sec * 1000) * 1000;
 
-        select(max + 1, &waitSet, NULL, NULL, &time);
+        select(max + 1, &waitSet, &writeSet, NULL, &time);
     }
 
     *triggeredEvent = -1;
 
     for (i = 0; i < noEvents; i++) {
-        if (FD_ISSET(events[i]->read_end, &waitSet)) {
+        if (FD_ISSET(events[i]->read_end, events[i]->writable ? &writeSet : &waitSet)) {
             HSDKWaitEvent(events[i], 0);
             *triggeredEvent = i;
             break;
@@ -505,4 +816,67 @@ int HSDKWaitMultipleEvents(Event *events, uint32_t noEvents, int64_t millisecond
     return 0;
 }
 
+/* Checks the events without waiting; returns 1 if one is signaled, 0 otherwise. */
+static int TryMultipleEvents(Event *events, uint32_t noEvents, int *triggeredEvent)
+{
+    HSDKWaitMultipleEvents(events, noEvents, 0, triggeredEvent);
+    return *triggeredEvent >= 0;
+}
+
+#endif
+
+/* Hint to the CPU that the thread is busy-waiting. */
+#if defined(_MSC_VER)
+#define SPIN_PAUSE() YieldProcessor()
+#elif defined(__i386__) || defined(__x86_64__)
+#define SPIN_PAUSE() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define SPIN_PAUSE() __asm__ __volatile__("yield")
+#else
+#define SPIN_PAUSE()
+#endif
+
+/* The counters of a SpinWait are read by GetPhysicalDeviceStats from other threads. */
+#ifdef _WIN32
+#define SPIN_COUNT(p) InterlockedIncrement((volatile LONG *)(p))
+#else
+#define SPIN_COUNT(p) __atomic_fetch_add((p), 1, __ATOMIC_RELAXED)
 #endif
+
+int HSDKSpinWaitMultipleEvents(SpinWait *spin, Event *events, uint32_t noEvents, int *triggeredEvent)
+{
+    uint64_t start, deadline, now;
+    int ret;
+
+    if (spin->spinUs > 0) {
+        start = HSDKMonotonicNs();
+        deadline = start + (uint64_t)spin->spinUs * 1000;
+        SPIN_COUNT(&spin->waits);
+
+        do {
+            if (TryMultipleEvents(events, noEvents, triggeredEvent)) {
+                SPIN_COUNT(&spin->hits);
+                spin->spinUs = (spin->spinUs * 2 < spin->budgetUs) ? spin->spinUs * 2 : spin->budgetUs;
+                return HSDK_ERROR_SUCCESS;
+            }
+            SPIN_PAUSE();
+            now = HSDKMonotonicNs();
+        } while (now < deadline);
+    } else {
+        start = HSDKMonotonicNs();
+    }
+
+    ret = HSDKWaitMultipleEvents(events, noEvents, INFINITE_WAIT, triggeredEvent);
+
+    if (spin->budgetUs > 0) {
+        /* A wait that a full spin would have covered restores the budget, an idle
+        link halves the spin down to blocking right away. */
+        if (HSDKMonotonicNs() - start <= (uint64_t)spin->budgetUs * 1000) {
+            spin->spinUs = spin->budgetUs;
+        } else {
+            spin->spinUs /= 2;
+        }
+    }
+
+    return ret;
+}
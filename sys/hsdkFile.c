@@ -170,7 +170,6 @@ int HSDKReadFile(File file, uint8_t *buffer, uint32_t *count)
     OVERLAPPED ov;
     ZeroMemory(&ov, sizeof(OVERLAPPED));
     ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-    memset(buffer, 0, *count);
 
     DWORD dwBytesRead = 0;
     BOOL ret;
@@ -196,6 +195,20 @@ int HSDKReadFile(File file, uint8_t *buffer, uint32_t *count)
     return ERROR_SUCCESS;
 }
 
+int HSDKBytesAvailable(File file, uint32_t *count)
+{
+    DWORD dwErrors = 0;
+    COMSTAT stat;
+
+    if (!ClearCommError(file, &dwErrors, &stat)) {
+        *count = 0;
+        return (int)GetLastError();
+    }
+
+    *count = stat.cbInQue;
+    return ERROR_SUCCESS;
+}
+
 int HSDKIsDescriptorValid(File f)
 {
     return f != INVALID_HANDLE_VALUE;
@@ -215,7 +228,9 @@ void HSDKInvalidateDescriptor(File *f)
 #include <string.h>
 #include <unistd.h>
 
+#include <sys/ioctl.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #if USE_AIO
 #include <aio.h>
@@ -293,10 +308,55 @@ int HSDKWriteFile(File file, uint8_t *buffer, uint32_t count)
     return rc;
 }
 
+int HSDKWriteFileVector(File file, uint8_t **buffers, uint32_t *counts, uint32_t noBuffers)
+{
+    struct iovec iov[noBuffers];
+    uint32_t i, left;
+    ssize_t rc;
+
+    for (i = 0; i < noBuffers; i++) {
+        iov[i].iov_base = buffers[i];
+        iov[i].iov_len = counts[i];
+    }
+
+    rc = writev(file, iov, (int)noBuffers);
+    if (rc == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return 0;
+        }
+        perror("HSDKWriteFileVector writev");
+        logMessage(HSDK_ERROR, "[HSDKWriteFileVector] writev", strerror(errno), HSDKThreadId());
+        return -1;
+    }
+
+    for (i = 0, left = (uint32_t)rc; i < noBuffers && left > 0; i++) {
+        printBuffer("TX", buffers[i], (int)((counts[i] < left) ? counts[i] : left));
+        left -= (counts[i] < left) ? counts[i] : left;
+    }
+
+    return (int)rc;
+}
+
+int HSDKSetFileNonBlocking(File file)
+{
+    int flags = fcntl(file, F_GETFL);
+
+    if (flags == -1 || fcntl(file, F_SETFL, flags | O_NONBLOCK) == -1) {
+        logMessage(HSDK_ERROR, "[HSDKSetFileNonBlocking] fcntl", strerror(errno), HSDKThreadId());
+        return errno;
+    }
+
+    return 0;
+}
+
 int HSDKReadFile(File file, uint8_t *buffer, uint32_t *count)
 {
     int rc = read(file, buffer, *count);
-    if (rc == -1) {
+    if (rc == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        /* Non-blocking file, the data reported was taken by another read. */
+        *count = 0;
+        return 0;
+    } else if (rc == -1) {
         logMessage(HSDK_ERROR, "[HSDKReadFile] read", strerror(errno), HSDKThreadId());
         *count = 0;
         return rc;
@@ -307,6 +367,19 @@ int HSDKReadFile(File file, uint8_t *buffer, uint32_t *count)
     }
 }
 
+int HSDKBytesAvailable(File file, uint32_t *count)
+{
+    int available = 0;
+
+    if (ioctl(file, FIONREAD, &available) == -1) {
+        *count = 0;
+        return errno;
+    }
+
+    *count = (uint32_t)available;
+    return 0;
+}
+
 int HSDKIsDescriptorValid(File f)
 {
     return f != -1;
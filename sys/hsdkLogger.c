@@ -32,94 +32,496 @@
 #include "hsdkLogger.h"
 
 #include "hsdkError.h"
+#include "utils.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
 #include <stdlib.h>
 
+#if defined(__linux__) || defined(__APPLE__)
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
 #define DEFAULT_LOG "hsdk.log"
 
 #define LINE_SIZE 256
 #define TAG_SIZE 64
 
+/* Bytes of the message kept by a record, the rest of the line is the tag and the prefix. */
+#define LOG_MESSAGE_SIZE 128
+
+/* Lines formatted by the writer before they are written with a single call. */
+#define LOG_BATCH_SIZE 64
+
+/* Largest burst of the rate limiter, in milliseconds of the log clock. */
+#define MAX_RATE_TOLERANCE_MS (3600 * 1000)
+
+#ifdef _WIN32
+#define THREAD_LOCAL __declspec(thread)
+#define LOG_LOAD_ACQUIRE(p) (MemoryBarrier(), *(p))
+#define LOG_STORE_RELEASE(p, v) do { MemoryBarrier(); *(p) = (v); } while (0)
+#define LOG_INCREMENT(p) InterlockedIncrement((volatile LONG *)(p))
+#define LOG_EXCHANGE(p, v) InterlockedExchange((volatile LONG *)(p), (LONG)(v))
+#define LOG_CAS(p, o, n) (InterlockedCompareExchange((volatile LONG *)(p), (LONG)(n), (LONG)(o)) == (LONG)(o))
+#else
+#define THREAD_LOCAL __thread
+#define LOG_LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define LOG_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define LOG_INCREMENT(p) __sync_fetch_and_add((p), 1)
+#define LOG_EXCHANGE(p, v) __sync_lock_test_and_set((p), (v))
+#define LOG_CAS(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+#endif
+
+/*
+ * A message waiting to be written. The tag is a string literal at every call
+ * site and identifies the format, so only its address is kept; the line is
+ * formatted by the writer thread.
+ */
+typedef struct {
+    const char *tag;
+    int threadId;
+    int prio;
+    char message[LOG_MESSAGE_SIZE];
+} LogRecord;
+
+/*
+ * Ring of records of a single thread. The owner thread is the only producer
+ * and moves tail, the writer thread is the only consumer and moves head.
+ */
+typedef struct _LogRing {
+    struct _LogRing *next;
+    int threadId;               /* Thread that registered the ring, reported with the dropped records. */
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t dropped;  /* Records lost while the ring was full. */
+    volatile uint32_t inUse;    /* Cleared when the owner thread exits, the ring is then given to a new thread. */
+    LogRecord records[];
+} LogRing;
+
 Logger *logger = NULL;
 FILE *logFile = NULL;
 #ifdef USE_LOGGER
 static Lock initialLock;
 static int initialLockSet = 0;
+
+/* Bumped for every new Logger, so that the rings of a closed Logger are not reused. */
+static uint32_t loggerGeneration = 0;
+static THREAD_LOCAL LogRing *threadRing = NULL;
+static THREAD_LOCAL uint32_t threadRingGeneration = 0;
+static THREAD_LOCAL uint8_t isLoggerThread = 0;
+
+/* Releases the ring of a thread when the thread exits. */
+#ifdef _WIN32
+static DWORD ringKey = FLS_OUT_OF_INDEXES;
+#else
+static pthread_key_t ringKey;
 #endif
 
-#ifndef LOG_PRIORITY
-#define LOG_PRIORITY 3
+/* Lines being written by the writer thread, only touched by that thread. */
+static char batchLines[LOG_BATCH_SIZE][LINE_SIZE];
+static uint32_t batchLengths[LOG_BATCH_SIZE];
+static uint32_t batchCount = 0;
 #endif
 
-const char *prios[] = { "", "HSDK_ERROR", "HSDK_WARNING", "HSDK_INFO" };
+const char *prios[] = { "", "HSDK_ERROR", "HSDK_WARNING", "HSDK_INFO", "HSDK_DEBUG" };
 
+volatile uint8_t logLevels[HSDK_LOG_MODULES + 1] = { HSDK_INFO, HSDK_INFO, HSDK_INFO, HSDK_INFO, LOG_PRIORITY };
 
-static void *LoggerThreadRoutine(void *lpParameter)
+#ifdef USE_LOGGER
+/* Rate limiter of the call sites: a message every interval, up to burst messages at once. */
+static uint32_t rateIntervalMs = 0;
+static uint32_t rateToleranceMs = 0;
+#endif
+
+#ifdef USE_LOGGER
+
+#ifdef _WIN32
+static VOID WINAPI ReleaseThreadRing(PVOID data)
+#else
+static void ReleaseThreadRing(void *data)
+#endif
 {
-    char *line = NULL;
-    Event eventArray[2];
-
-    eventArray[0] = logger->stopThread;
-    eventArray[1] = logger->queue->sAnnounceData;
-
-    int loop = 1;
-    while (loop) {
-        int triggeredEvent;
-        int ret = HSDKWaitMultipleEvents(eventArray, 2, INFINITE_WAIT, &triggeredEvent);
-        if (ret != HSDK_ERROR_SUCCESS) {
-            loop = 0;
-            continue;
-        }
-
-        switch (triggeredEvent) {
-            case 0:
-                loop = 0;
-                break;
-
-            case 1:
-                line = (char *)MessageQueueGet(logger->queue);
-                MessageQueueDecrementSize(logger->queue, 1);
-                if (line != NULL) {
-                    fprintf(logFile, "%s", line);
-                    fflush(logFile);
-                    free(line);
-                }
-#if defined(__linux__) || defined(__APPLE__)
-                HSDKResetEvent(logger->queue->sAnnounceData);
+    LogRing *ring = (LogRing *)data;
+
+    if (ring != NULL) {
+        LOG_STORE_RELEASE(&ring->inUse, 0);
+    }
+}
+
+/*
+ * Returns the ring of the calling thread, registering one on the first message
+ * of the thread. A ring left by a thread that exited is reused, otherwise a new
+ * one is added to the list walked by the writer.
+ */
+static LogRing *GetThreadRing(void)
+{
+    LogRing *ring;
+
+    if (threadRing != NULL && threadRingGeneration == loggerGeneration) {
+        return threadRing;
+    }
+
+    HSDKAcquireLock(logger->fileLock);
+    for (ring = (LogRing *)logger->rings; ring != NULL; ring = ring->next) {
+        if (!LOG_LOAD_ACQUIRE(&ring->inUse)) {
+            break;
+        }
+    }
+
+    if (ring == NULL) {
+        ring = (LogRing *)calloc(1, sizeof(LogRing) + logger->ringSize * sizeof(LogRecord));
+        if (ring == NULL) {
+            HSDKReleaseLock(logger->fileLock);
+            return NULL;
+        }
+        ring->next = (LogRing *)logger->rings;
+        /* The writer walks the list without the lock, publish the ring once it is complete. */
+        LOG_STORE_RELEASE(&logger->rings, (void *)ring);
+    }
+    LOG_STORE_RELEASE(&ring->threadId, HSDKThreadId());
+    LOG_STORE_RELEASE(&ring->inUse, 1);
+    HSDKReleaseLock(logger->fileLock);
+
+#ifdef _WIN32
+    FlsSetValue(ringKey, ring);
+#else
+    pthread_setspecific(ringKey, ring);
 #endif
+    threadRing = ring;
+    threadRingGeneration = loggerGeneration;
+
+    return ring;
+}
+
+/*
+ * Stores a record in the ring of the calling thread. Nothing is formatted or
+ * allocated here; when the ring is full the record is counted as dropped.
+ */
+static void PutRecord(int prio, const char *messageTag, const char *message, int threadId)
+{
+    LogRing *ring = GetThreadRing();
+    if (ring == NULL) {
+        return;
+    }
+
+    uint32_t tail = ring->tail;
+    uint32_t head = LOG_LOAD_ACQUIRE(&ring->head);
+    if (tail - head >= logger->ringSize) {
+        LOG_INCREMENT(&ring->dropped);
+        return;
+    }
+
+    LogRecord *record = &ring->records[tail & (logger->ringSize - 1)];
+    record->tag = messageTag;
+    record->threadId = threadId;
+    record->prio = prio;
+    strncpy(record->message, message, LOG_MESSAGE_SIZE - 1);
+    record->message[LOG_MESSAGE_SIZE - 1] = '\0';
+
+    LOG_STORE_RELEASE(&ring->tail, tail + 1);
+
+    /* Wake up the writer at the watermark, or right away for an error. */
+    if (tail + 1 - head >= logger->ringSize / 2 || prio == HSDK_ERROR) {
+        if (LOG_CAS(&logger->wakeupPending, 0, 1)) {
+            HSDKSignalEvent(logger->wakeup);
+        }
+    }
+}
+
+/* Writes the lines of the batch with as few system calls as possible. */
+static void WriteBatch(void)
+{
+    uint32_t i;
+
+    if (batchCount == 0) {
+        return;
+    }
+
+#if defined(__linux__) || defined(__APPLE__)
+    struct iovec iov[LOG_BATCH_SIZE];
+    int fd = fileno(logFile);
+    int count = (int)batchCount;
+    struct iovec *next = iov;
+
+    for (i = 0; i < batchCount; i++) {
+        iov[i].iov_base = batchLines[i];
+        iov[i].iov_len = batchLengths[i];
+    }
+
+    while (count > 0) {
+        ssize_t written = writev(fd, next, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
         }
+
+        /* Skip what was written, a partial write resumes inside a line. */
+        while (count > 0 && (size_t)written >= next->iov_len) {
+            written -= next->iov_len;
+            next++;
+            count--;
+        }
+        if (count > 0) {
+            next->iov_base = (char *)next->iov_base + written;
+            next->iov_len -= written;
+        }
+    }
+#else
+    for (i = 0; i < batchCount; i++) {
+        fwrite(batchLines[i], 1, batchLengths[i], logFile);
+    }
+    fflush(logFile);
+#endif
+
+    batchCount = 0;
+}
+
+static void BatchLine(const char *prio, int threadId, const char *messageTag, const char *message)
+{
+    int length = snprintf(batchLines[batchCount], LINE_SIZE, "%s - [%d] %s:%s\n", prio, threadId, messageTag, message);
+    if (length < 0) {
+        return;
     }
+    if (length >= LINE_SIZE) {
+        length = LINE_SIZE - 1;
+    }
+
+    batchLengths[batchCount++] = (uint32_t)length;
+    if (batchCount == LOG_BATCH_SIZE) {
+        WriteBatch();
+    }
+}
+
+/* Formats and writes the records waiting in all the rings. */
+static void DrainRings(void)
+{
+    LogRing *ring;
+
+    for (ring = (LogRing *)LOG_LOAD_ACQUIRE(&logger->rings); ring != NULL; ring = ring->next) {
+        uint32_t dropped = LOG_EXCHANGE(&ring->dropped, 0);
+        if (dropped) {
+            char message[LOG_MESSAGE_SIZE];
+            snprintf(message, LOG_MESSAGE_SIZE, "%u messages dropped", dropped);
+            BatchLine(prios[HSDK_WARNING], LOG_LOAD_ACQUIRE(&ring->threadId), "[hsdkLogger]logMessage", message);
+        }
 
-    int size = MessageQueueGetContentSize(logger->queue);
-    while (size > 0) {
-        size--;
-        char *line = (char *)MessageQueueGet(logger->queue);
-        if (line != NULL) {
-            fprintf(logFile, "%s", line);
-            fflush(logFile);
-            free(line);
+        uint32_t head = ring->head;
+        uint32_t tail = LOG_LOAD_ACQUIRE(&ring->tail);
+
+        while (head != tail) {
+            LogRecord *record = &ring->records[head & (logger->ringSize - 1)];
+            BatchLine(prios[record->prio], record->threadId, record->tag, record->message);
+            head++;
         }
+
+        /* The records were copied into the batch, give the slots back to the producer. */
+        LOG_STORE_RELEASE(&ring->head, head);
     }
 
+    WriteBatch();
+}
+
+static void *LoggerThreadRoutine(void *lpParameter)
+{
+    /* The wait below logs its timeouts, keep the writer out of its own rings. */
+    isLoggerThread = 1;
+
+    while (!LOG_LOAD_ACQUIRE(&logger->stopping)) {
+        HSDKWaitEvent(logger->wakeup, logger->flushIntervalMs);
+        LOG_EXCHANGE(&logger->wakeupPending, 0);
+        DrainRings();
+    }
+
+    DrainRings();
+
     return NULL;
 }
 
-void logMessage(int prio, const char *messageTag, const char *message, int threadId)
+/* Milliseconds of a monotonic clock, wrapping around every 49 days. */
+static uint32_t LogClockMs(void)
+{
+#ifdef _WIN32
+    return (uint32_t)GetTickCount();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec * 1000 + (uint32_t)(ts.tv_nsec / 1000000);
+#endif
+}
+
+/* Module of a call site, from the directory of its source file. */
+static uint8_t LogModuleOf(const char *file)
+{
+    if (strstr(file, "FSCI") != NULL) {
+        return HSDK_LOG_FSCI;
+    } else if (strstr(file, "protocol") != NULL) {
+        return HSDK_LOG_FRAMER;
+    } else if (strstr(file, "physical") != NULL) {
+        return HSDK_LOG_PHYSICAL;
+    }
+
+    return HSDK_LOG_SYS;
+}
+
+/*
+ * Token bucket of a call site, kept as the time the bucket is full again
+ * (generic cell rate algorithm). Every message moves that time one interval
+ * ahead, a message is allowed while it stays within the burst of now.
+ */
+static int LogSiteAllowed(LogSite *site)
+{
+    uint32_t interval = rateIntervalMs;
+    uint32_t tolerance = rateToleranceMs;
+    uint32_t now, full, next;
+    int32_t ahead;
+
+    if (interval == 0) {
+        return 1;
+    }
+
+    now = LogClockMs();
+    do {
+        full = LOG_LOAD_ACQUIRE(&site->nextAllowedMs);
+        ahead = (int32_t)(full - now);
+        if (ahead > (int32_t)(tolerance + interval)) {
+            /* Left from before the clock wrapped, the site was idle for weeks. */
+            ahead = 0;
+        }
+        if (ahead > (int32_t)tolerance) {
+            return 0;
+        }
+        next = (ahead > 0 ? full : now) + interval;
+    } while (!LOG_CAS(&site->nextAllowedMs, full, next));
+
+    return 1;
+}
+
+/* Writes a line from the calling thread, or hands it to the logger thread. */
+static void WriteMessage(int prio, const char *messageTag, const char *message, int threadId)
+{
+    if (logger->synchronous) {
+        char buffer[LINE_SIZE];
+        int length = snprintf(buffer, LINE_SIZE, "%s - [%d] %s:%s\n", prios[prio], threadId, messageTag, message);
+        if (length < 0) {
+            return;
+        }
+
+        HSDKAcquireLock(logger->fileLock);
+        fputs(buffer, logFile);
+        fflush(logFile);
+        HSDKReleaseLock(logger->fileLock);
+        return;
+    }
+
+    if (isLoggerThread) {
+        return;
+    }
+    PutRecord(prio, messageTag, message, threadId);
+}
+#endif
+
+void logSiteMessage(LogSite *site, const char *file, int prio, const char *messageTag, const char *message, int threadId)
 {
 #ifdef USE_LOGGER
-    if (prio > LOG_PRIORITY) {
+    if (site->module == HSDK_LOG_MODULES) {
+        site->module = LogModuleOf(file);
+        if (prio > logLevels[site->module]) {
+            return;
+        }
+    }
+
+    if (logger == NULL) {
         return;
     }
 
-    if (logger != NULL) {
-        char *line = (char *)calloc(LINE_SIZE, sizeof(char));
-        sprintf(line, "%s - [%d] %s:%s\n", prios[prio], threadId, messageTag, message);
-        MessageQueuePutWithSize(logger->queue, line, 1);
-        HSDKReleaseSemaphore(logger->queue->sAnnounceData);
+    if (!LogSiteAllowed(site)) {
+        LOG_INCREMENT(&site->suppressed);
+        return;
     }
+
+    if (LOG_LOAD_ACQUIRE(&site->suppressed)) {
+        uint32_t suppressed = LOG_EXCHANGE(&site->suppressed, 0);
+        if (suppressed) {
+            char summary[LOG_MESSAGE_SIZE];
+            snprintf(summary, LOG_MESSAGE_SIZE, "%u messages suppressed", suppressed);
+            WriteMessage(prio, messageTag, summary, threadId);
+        }
+    }
+
+    WriteMessage(prio, messageTag, message, threadId);
+#endif
+}
+
+/*! *********************************************************************************
+* \brief  Sets the highest priority logged for a module.
+*
+* \param[in] module    one of HSDK_LOG_SYS, HSDK_LOG_PHYSICAL, HSDK_LOG_FRAMER, HSDK_LOG_FSCI
+* \param[in] level     0 to disable the module, HSDK_ERROR up to HSDK_DEBUG otherwise
+*
+* \return HSDK_ERROR_SUCCESS, or HSDK_ERROR_INVALID for an unknown module or level
+********************************************************************************** */
+int SetLogLevel(int module, int level)
+{
+    if (module < 0 || module >= HSDK_LOG_MODULES || level < 0 || level > HSDK_DEBUG) {
+        return HSDK_ERROR_INVALID;
+    }
+
+    logLevels[module] = (uint8_t)level;
+    return HSDK_ERROR_SUCCESS;
+}
+
+/*! *********************************************************************************
+* \brief  Returns the highest priority logged for a module.
+*
+* \param[in] module    one of HSDK_LOG_SYS, HSDK_LOG_PHYSICAL, HSDK_LOG_FRAMER, HSDK_LOG_FSCI
+*
+* \return the level of the module, -1 for an unknown module
+********************************************************************************** */
+int GetLogLevel(int module)
+{
+    if (module < 0 || module >= HSDK_LOG_MODULES) {
+        return -1;
+    }
+
+    return logLevels[module];
+}
+
+/*! *********************************************************************************
+* \brief  Limits the messages written by every logMessage call site. A site
+* writes at most burst messages at once and messagesPerSecond on average; the
+* messages over the limit are counted and reported by the next one written.
+*
+* \param[in] messagesPerSecond     average rate of a site, 0 or more than 1000 for no limit
+* \param[in] burst                 messages a site may write at once
+********************************************************************************** */
+void SetLogRateLimit(uint32_t messagesPerSecond, uint32_t burst)
+{
+#ifdef USE_LOGGER
+    uint32_t interval = 0;
+
+    if (messagesPerSecond > 0 && messagesPerSecond <= 1000) {
+        interval = 1000 / messagesPerSecond;
+    }
+    if (burst == 0) {
+        burst = 1;
+    }
+
+    /* Keep the bucket well inside the range of the 32-bit log clock. */
+    uint64_t tolerance = (uint64_t)(burst - 1) * interval;
+    if (tolerance > MAX_RATE_TOLERANCE_MS) {
+        tolerance = MAX_RATE_TOLERANCE_MS;
+    }
+
+    rateToleranceMs = (uint32_t)tolerance;
+    rateIntervalMs = interval;
 #endif
 }
 
@@ -134,23 +536,43 @@ void initLogger(char *filename)
 
         HSDKAcquireLock(initialLock);
         if (logger == NULL) {
+            int module;
             logger = (Logger *) calloc(1, sizeof(Logger));
 
-
-            logger->queue = InitializeMessageQueue(256);
-            if (logger->queue == NULL) {
-                HSDKReleaseLock(initialLock);
-                return;
+            ConfigParams *params = ParseConfig();
+            ThreadAttributes attributes = params->loggerThread;
+            logger->synchronous = params->syncLogger;
+            logger->ringSize = 2;
+            while (logger->ringSize < params->logRingSize) {
+                logger->ringSize <<= 1;
             }
-
-            logger->referenceCount = 0;
-            logger->stopThread = HSDKCreateEvent(0);
-            logger->loggerThread = HSDKCreateThread(LoggerThreadRoutine, NULL);
+            logger->flushIntervalMs = params->logFlushIntervalMs;
+            for (module = 0; module < HSDK_LOG_MODULES; module++) {
+                SetLogLevel(module, params->logLevel[module]);
+            }
+            SetLogRateLimit(params->logRateLimit, params->logRateBurst);
+            free(params);
 
             if (filename)
                 logFile = fopen(filename, "w");
             else
                 logFile = fopen(DEFAULT_LOG, "w");
+
+            logger->referenceCount = 0;
+            logger->fileLock = HSDKCreateLock();
+
+            if (!logger->synchronous) {
+#ifdef _WIN32
+                ringKey = FlsAlloc(ReleaseThreadRing);
+#else
+                pthread_key_create(&ringKey, ReleaseThreadRing);
+#endif
+                loggerGeneration++;
+
+                logger->wakeup = HSDKCreateEvent(0);
+                snprintf(attributes.name, HSDK_THREAD_NAME_SIZE, "hsdk-logger");
+                logger->loggerThread = HSDKCreateThreadWithAttributes(LoggerThreadRoutine, NULL, &attributes);
+            }
         }
         logger->referenceCount++;
         HSDKReleaseLock(initialLock);
@@ -178,12 +600,29 @@ void closeLogger()
     if (!logger->referenceCount) {
         HSDKAcquireLock(initialLock);
         if (logger != NULL) {
-            HSDKSignalEvent(logger->stopThread);
-            HSDKDestroyThread(logger->loggerThread);
-            HSDKDestroyEvent(logger->stopThread);
-            DestroyMessageQueue(logger->queue);
+            if (!logger->synchronous) {
+                LOG_STORE_RELEASE(&logger->stopping, 1);
+                HSDKSignalEvent(logger->wakeup);
+                HSDKDestroyThread(logger->loggerThread);
+                HSDKDestroyEvent(logger->wakeup);
+
+                /* No thread exit may touch the rings once they are freed. */
+#ifdef _WIN32
+                FlsFree(ringKey);
+                ringKey = FLS_OUT_OF_INDEXES;
+#else
+                pthread_key_delete(ringKey);
+#endif
+                LogRing *ring = (LogRing *)logger->rings;
+                while (ring != NULL) {
+                    LogRing *next = ring->next;
+                    free(ring);
+                    ring = next;
+                }
+                logger->rings = NULL;
+            }
+            HSDKDestroyLock(logger->fileLock);
 
-            logger->queue = NULL;
             fclose(logFile);
             free(logger);
             logger = NULL;
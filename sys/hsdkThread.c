@@ -29,22 +29,51 @@
 * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
 * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************************************************** */
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
 #include "hsdkOSCommon.h"
 #include "hsdkLogger.h"
 
+#if defined(__linux__) || defined(__APPLE__)
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
 #ifdef _WIN32
 
 Thread HSDKCreateThread(void *(*startRoutine) (void *), void *arg)
+{
+    return HSDKCreateThreadWithAttributes(startRoutine, arg, NULL);
+}
+
+Thread HSDKCreateThreadWithAttributes(void *(*startRoutine) (void *), void *arg, ThreadAttributes *attributes)
 {
     Thread t = CreateThread(NULL,
-                            0,
+                            (attributes != NULL) ? attributes->stackSize : 0,
                             (LPTHREAD_START_ROUTINE)startRoutine,
                             arg,
-                            0,
+                            (attributes != NULL && attributes->stackSize != 0) ? STACK_SIZE_PARAM_IS_A_RESERVATION : 0,
                             NULL);
 
     if (t == NULL) {
         logMessage(HSDK_ERROR, "[hsdkThread]HSDKCreateThread", "Thread creation failed", HSDKThreadId());
+        return t;
+    }
+
+    if (attributes == NULL) {
+        return t;
+    }
+
+    if (attributes->cpuMask != 0 && SetThreadAffinityMask(t, (DWORD_PTR)attributes->cpuMask) == 0) {
+        logMessage(HSDK_WARNING, "[hsdkThread]HSDKCreateThreadWithAttributes", "Failed to set thread affinity", HSDKThreadId());
+    }
+
+    if (attributes->policy != HSDK_SCHED_DEFAULT && !SetThreadPriority(t, THREAD_PRIORITY_TIME_CRITICAL)) {
+        logMessage(HSDK_WARNING, "[hsdkThread]HSDKCreateThreadWithAttributes", "Failed to set thread priority", HSDKThreadId());
     }
 
     return t;
@@ -84,20 +113,113 @@ int HSDKThreadId()
     return GetCurrentThreadId();
 }
 
+int HSDKGetThreadCpuTime(Thread thread, uint64_t *nanoseconds)
+{
+    FILETIME creation, exit, kernel, user;
+
+    if (!GetThreadTimes(thread, &creation, &exit, &kernel, &user)) {
+        return (int)GetLastError();
+    }
+
+    /* FILETIME counts 100 ns intervals. */
+    *nanoseconds = ((((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) +
+                    (((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime)) * 100;
+
+    return ERROR_SUCCESS;
+}
+
+int HSDKGetThreadStackSize(Thread thread, uint32_t *stackSize)
+{
+    /* Not available for other threads on Windows. */
+    *stackSize = 0;
+    return ERROR_NOT_SUPPORTED;
+}
+
+uint64_t HSDKMonotonicNs(void)
+{
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ULL / frequency.QuadPart;
+}
+
 #elif __linux__ || __APPLE__
 
 Thread HSDKCreateThread(void *(*startRoutine) (void *), void *arg)
+{
+    return HSDKCreateThreadWithAttributes(startRoutine, arg, NULL);
+}
+
+Thread HSDKCreateThreadWithAttributes(void *(*startRoutine) (void *), void *arg, ThreadAttributes *attributes)
 {
     int ret;
     Thread thread;
+    pthread_attr_t attr;
 
-    ret = pthread_create(&thread, NULL, startRoutine, arg);
+    pthread_attr_init(&attr);
 
-    if (!ret) {
-        return thread;
-    } else {
+    if (attributes != NULL && attributes->stackSize != 0) {
+        size_t stackSize = attributes->stackSize;
+        if (stackSize < PTHREAD_STACK_MIN) {
+            stackSize = PTHREAD_STACK_MIN;
+        }
+        pthread_attr_setstacksize(&attr, stackSize);
+    }
+
+#ifdef __linux__
+    if (attributes != NULL && attributes->cpuMask != 0) {
+        cpu_set_t cpus;
+        int cpu;
+
+        CPU_ZERO(&cpus);
+        for (cpu = 0; cpu < 64; cpu++) {
+            if (attributes->cpuMask & ((uint64_t)1 << cpu)) {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpus);
+    }
+#endif
+
+    if (attributes != NULL && attributes->policy != HSDK_SCHED_DEFAULT) {
+        struct sched_param param;
+        int policy = (attributes->policy == HSDK_SCHED_FIFO) ? SCHED_FIFO : SCHED_RR;
+
+        param.sched_priority = attributes->priority;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, policy);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    ret = pthread_create(&thread, &attr, startRoutine, arg);
+
+    if (ret == EPERM && attributes != NULL && attributes->policy != HSDK_SCHED_DEFAULT) {
+        /* Real-time scheduling needs CAP_SYS_NICE or an RLIMIT_RTPRIO allowance. */
+        logMessage(HSDK_WARNING, "[hsdkThread]HSDKCreateThreadWithAttributes", "Real-time scheduling not permitted, using the default policy", HSDKThreadId());
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        ret = pthread_create(&thread, &attr, startRoutine, arg);
+    }
+
+    pthread_attr_destroy(&attr);
+
+    if (ret) {
         return 0;
     }
+
+#if defined(__linux__) && !defined(__UCLIBC__)
+    /* Older uClibc toolchains (OpenWrt) lack pthread_setname_np. */
+    if (attributes != NULL && attributes->name[0] != '\0') {
+        pthread_setname_np(thread, attributes->name);
+    }
+#endif
+
+    return thread;
 }
 
 int HSDKDestroyThread(Thread thread)
@@ -109,4 +231,64 @@ int HSDKThreadId()
 {
     return (int)pthread_self();
 }
+
+int HSDKGetThreadCpuTime(Thread thread, uint64_t *nanoseconds)
+{
+#ifdef __linux__
+    clockid_t clock;
+    struct timespec ts;
+
+    int ret = pthread_getcpuclockid(thread, &clock);
+    if (ret) {
+        return ret;
+    }
+
+    if (clock_gettime(clock, &ts) == -1) {
+        return errno;
+    }
+
+    *nanoseconds = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+
+    return 0;
+#else
+    /* No per-thread CPU clocks on OS X. */
+    *nanoseconds = 0;
+    return ENOSYS;
+#endif
+}
+
+int HSDKGetThreadStackSize(Thread thread, uint32_t *stackSize)
+{
+#ifdef __linux__
+    pthread_attr_t attr;
+    size_t size;
+
+    int ret = pthread_getattr_np(thread, &attr);
+    if (ret) {
+        return ret;
+    }
+
+    ret = pthread_attr_getstacksize(&attr, &size);
+    pthread_attr_destroy(&attr);
+    *stackSize = ret ? 0 : (uint32_t)size;
+
+    return ret;
+#else
+    *stackSize = (uint32_t)pthread_get_stacksize_np(thread);
+    return 0;
+#endif
+}
+
+uint64_t HSDKMonotonicNs(void)
+{
+    struct timespec ts;
+
+#ifdef CLOCK_MONOTONIC_RAW
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
 #endif
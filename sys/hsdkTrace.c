@@ -0,0 +1,401 @@
+/*! *********************************************************************************
+* \file hsdkTrace.c
+* This is a source file for the trace module.
+*
+* Copyright 2013-2016 Freescale Semiconductor, Inc.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************************** */
+
+/************************************************************************************
+ *************************************************************************************
+ * Include
+ *************************************************************************************
+ ************************************************************************************/
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hsdkTrace.h"
+
+#include "hsdkError.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+#if !defined(_WIN32) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+/************************************************************************************
+ *************************************************************************************
+ * Private macros
+ *************************************************************************************
+ ************************************************************************************/
+#ifdef _WIN32
+#define THREAD_LOCAL __declspec(thread)
+#define TRACE_LOAD_ACQUIRE(p) (MemoryBarrier(), *(p))
+#define TRACE_STORE_RELEASE(p, v) do { MemoryBarrier(); *(p) = (v); } while (0)
+#define TRACE_CAS(p, o, n) (InterlockedCompareExchange((volatile LONG *)(p), (LONG)(n), (LONG)(o)) == (LONG)(o))
+#define TRACE_CAS_POINTER(p, o, n) (InterlockedCompareExchangePointer((PVOID *)(p), (n), (o)) == (o))
+#else
+#define THREAD_LOCAL __thread
+#define TRACE_LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define TRACE_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define TRACE_CAS(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+#define TRACE_CAS_POINTER(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+#endif
+
+/*
+ * Events are stamped with the cheapest counter of the platform, the TSC on x86 and
+ * the performance counter on Windows, and converted to nanoseconds by DumpTrace.
+ */
+#if defined(_WIN32) || defined(__x86_64__) || defined(__i386__)
+#define TRACE_RAW_TICKS
+#endif
+
+/************************************************************************************
+ *************************************************************************************
+ * Private type definitions
+ *************************************************************************************
+ ************************************************************************************/
+/*
+ * Events of a single thread. Only the owner thread writes; when the ring is full
+ * the oldest events are overwritten, so the ring holds the latest history.
+ */
+typedef struct _TraceRing {
+    struct _TraceRing *next;
+    uint32_t threadId;
+    char name[HSDK_THREAD_NAME_SIZE];
+    uint32_t size;              /* Number of events, a power of two. */
+    volatile uint32_t written;  /* Events recorded since the ring was taken. */
+    volatile uint32_t inUse;    /* Cleared when the owner thread exits, the ring is then reused. */
+    TraceEvent events[];
+} TraceRing;
+
+/************************************************************************************
+ *************************************************************************************
+ * Private prototypes
+ *************************************************************************************
+ ************************************************************************************/
+static TraceRing *GetThreadRing(void);
+static uint64_t TraceTicks(void);
+
+#ifdef _WIN32
+static VOID WINAPI ReleaseThreadRing(PVOID data);
+#else
+static void ReleaseThreadRing(void *data);
+#endif
+
+/************************************************************************************
+ *************************************************************************************
+ * Public memory declarations
+ *************************************************************************************
+ ************************************************************************************/
+volatile uint8_t traceEnabled = 0;
+
+/************************************************************************************
+ *************************************************************************************
+ * Private memory declarations
+ *************************************************************************************
+ ************************************************************************************/
+/* Rings of all the threads that recorded events; rings are never freed. */
+static TraceRing *rings = NULL;
+static uint32_t ringSize = DEFAULT_TRACE_RING_SIZE;
+static THREAD_LOCAL TraceRing *threadRing = NULL;
+
+/* Gives the ring of a thread back when the thread exits. */
+static uint8_t ringKeyCreated = 0;
+#ifdef _WIN32
+static DWORD ringKey;
+#else
+static pthread_key_t ringKey;
+#endif
+
+/* Counter and clock read together by StartTrace, to convert the counter to nanoseconds. */
+static uint64_t originTicks;
+static uint64_t originNs;
+
+static const char *eventNames[TRACE_EVENT_COUNT] = {
+    "",
+    "RX read",
+    "RX enqueue",
+    "Framer dequeue",
+    "CRC check",
+    "Frame complete",
+    "Callback",
+    "TX enqueue",
+    "TX write",
+    "ACK sent",
+    "ACK received"
+};
+
+/************************************************************************************
+ *************************************************************************************
+ * Public functions
+ *************************************************************************************
+ ************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Records an event in the ring of the calling thread. Called through
+*         HSDK_TRACE, which skips the call while the trace is off.
+*
+* \param[in] id         TraceEventId of the event
+* \param[in] phase      TRACE_BEGIN, TRACE_END or TRACE_INSTANT
+* \param[in] arg        argument of the event
+*
+* \return none
+********************************************************************************** */
+void TraceRecord(uint16_t id, uint8_t phase, uint32_t arg)
+{
+    TraceRing *ring = threadRing;
+    if (ring == NULL) {
+        ring = GetThreadRing();
+        if (ring == NULL) {
+            return;
+        }
+    }
+
+    uint32_t written = ring->written;
+    TraceEvent *event = &ring->events[written & (ring->size - 1)];
+    event->timestampNs = TraceTicks();
+    event->arg = arg;
+    event->id = id;
+    event->phase = phase;
+    TRACE_STORE_RELEASE(&ring->written, written + 1);
+}
+
+/*! *********************************************************************************
+* \brief  Starts recording events. May be called again after StopTrace; the events
+*         recorded before are kept.
+*
+* \param[in] eventsPerThread    events kept per thread, rounded up to a power of two;
+*                               0 for DEFAULT_TRACE_RING_SIZE. Applies to the rings
+*                               of the threads that did not record events yet.
+*
+* \return none
+********************************************************************************** */
+void StartTrace(uint32_t eventsPerThread)
+{
+    uint32_t size = 2;
+
+    if (eventsPerThread == 0) {
+        eventsPerThread = DEFAULT_TRACE_RING_SIZE;
+    }
+    while (size < eventsPerThread) {
+        size <<= 1;
+    }
+    ringSize = size;
+
+    if (!ringKeyCreated) {
+#ifdef _WIN32
+        ringKey = FlsAlloc(ReleaseThreadRing);
+#else
+        pthread_key_create(&ringKey, ReleaseThreadRing);
+#endif
+        originTicks = TraceTicks();
+        originNs = HSDKMonotonicNs();
+        ringKeyCreated = 1;
+    }
+
+    traceEnabled = 1;
+}
+
+/*! *********************************************************************************
+* \brief  Stops recording events. The rings keep their events until DumpTrace.
+*
+* \return none
+********************************************************************************** */
+void StopTrace(void)
+{
+    traceEnabled = 0;
+}
+
+/*! *********************************************************************************
+* \brief  Writes the events of all the threads to a file, in the binary format
+*         described in hsdkTrace.h. The recording is paused during the dump.
+*         demo/TraceToChrome converts the file to the Chrome trace JSON format,
+*         which is also opened by Perfetto.
+*
+* \param[in] path       the file to write
+*
+* \return HSDK_ERROR_SUCCESS, or HSDK_ERROR_INVALID if the file cannot be written
+********************************************************************************** */
+int DumpTrace(const char *path)
+{
+    TraceRing *ring;
+    uint32_t header[3] = { TRACE_MAGIC, TRACE_VERSION, 0 };
+    uint8_t enabled = traceEnabled;
+    int err = HSDK_ERROR_SUCCESS;
+#ifdef TRACE_RAW_TICKS
+    uint64_t ticks = TraceTicks() - originTicks;
+    double nsPerTick = ticks ? (double)(HSDKMonotonicNs() - originNs) / (double)ticks : 1.0;
+#endif
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return HSDK_ERROR_INVALID;
+    }
+
+    traceEnabled = 0;
+
+    for (ring = (TraceRing *)TRACE_LOAD_ACQUIRE(&rings); ring != NULL; ring = ring->next) {
+        header[2]++;
+    }
+    if (fwrite(header, sizeof(header), 1, file) != 1) {
+        err = HSDK_ERROR_INVALID;
+    }
+
+    for (ring = (TraceRing *)TRACE_LOAD_ACQUIRE(&rings); ring != NULL && err == HSDK_ERROR_SUCCESS; ring = ring->next) {
+        TraceThreadHeader thread;
+        uint32_t written = TRACE_LOAD_ACQUIRE(&ring->written);
+        uint32_t first = written > ring->size ? written - ring->size : 0;
+        uint32_t i;
+
+        memset(&thread, 0, sizeof(thread));
+        thread.threadId = ring->threadId;
+        thread.eventCount = written - first;
+        memcpy(thread.name, ring->name, HSDK_THREAD_NAME_SIZE);
+        if (fwrite(&thread, sizeof(thread), 1, file) != 1) {
+            err = HSDK_ERROR_INVALID;
+        }
+
+        for (i = first; i != written && err == HSDK_ERROR_SUCCESS; i++) {
+            TraceEvent event = ring->events[i & (ring->size - 1)];
+#ifdef TRACE_RAW_TICKS
+            event.timestampNs = originNs + (uint64_t)((double)(int64_t)(event.timestampNs - originTicks) * nsPerTick);
+#endif
+            if (fwrite(&event, sizeof(TraceEvent), 1, file) != 1) {
+                err = HSDK_ERROR_INVALID;
+            }
+        }
+    }
+
+    traceEnabled = enabled;
+
+    if (fclose(file) != 0) {
+        err = HSDK_ERROR_INVALID;
+    }
+
+    return err;
+}
+
+/*! *********************************************************************************
+* \brief  Returns the name of a traced event.
+*
+* \param[in] id         TraceEventId of the event
+*
+* \return the name of the event, "unknown" for an unknown id
+********************************************************************************** */
+const char *TraceEventName(uint16_t id)
+{
+    if (id == 0 || id >= TRACE_EVENT_COUNT) {
+        return "unknown";
+    }
+
+    return eventNames[id];
+}
+
+/************************************************************************************
+ *************************************************************************************
+ * Private functions
+ *************************************************************************************
+ ************************************************************************************/
+/*
+ * Takes a ring for the calling thread on its first event: the ring of a thread
+ * that exited, or a new one pushed on the list without locking.
+ */
+static TraceRing *GetThreadRing(void)
+{
+    TraceRing *ring;
+
+    for (ring = (TraceRing *)TRACE_LOAD_ACQUIRE(&rings); ring != NULL; ring = ring->next) {
+        if (!ring->inUse && TRACE_CAS(&ring->inUse, 0, 1)) {
+            TRACE_STORE_RELEASE(&ring->written, 0);
+            break;
+        }
+    }
+
+    if (ring == NULL) {
+        ring = (TraceRing *)calloc(1, sizeof(TraceRing) + ringSize * sizeof(TraceEvent));
+        if (ring == NULL) {
+            return NULL;
+        }
+        ring->size = ringSize;
+        ring->inUse = 1;
+
+        do {
+            ring->next = (TraceRing *)TRACE_LOAD_ACQUIRE(&rings);
+        } while (!TRACE_CAS_POINTER(&rings, ring->next, ring));
+    }
+
+    ring->threadId = (uint32_t)HSDKThreadId();
+    memset(ring->name, 0, HSDK_THREAD_NAME_SIZE);
+#if defined(__linux__) && !defined(__UCLIBC__)
+    pthread_getname_np(pthread_self(), ring->name, HSDK_THREAD_NAME_SIZE);
+#endif
+
+#ifdef _WIN32
+    FlsSetValue(ringKey, ring);
+#else
+    pthread_setspecific(ringKey, ring);
+#endif
+    threadRing = ring;
+
+    return ring;
+}
+
+#ifdef _WIN32
+static VOID WINAPI ReleaseThreadRing(PVOID data)
+#else
+static void ReleaseThreadRing(void *data)
+#endif
+{
+    TraceRing *ring = (TraceRing *)data;
+
+    if (ring != NULL) {
+        TRACE_STORE_RELEASE(&ring->inUse, 0);
+    }
+}
+
+static uint64_t TraceTicks(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter;
+
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)counter.QuadPart;
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return HSDKMonotonicNs();
+#endif
+}
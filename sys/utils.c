@@ -254,15 +254,152 @@ static char *trim(char *s)
     return s;
 }
 
+/*
+ * Thread attributes are set with keys made of a role prefix (DeviceThread,
+ * FramerThread, LoggerThread, PcapThread, UsbThread) and an attribute suffix (CpuMask,
+ * Policy, Priority, StackSize), e.g. DeviceThreadCpuMask=0x8.
+ */
+static int ParseThreadKey(ConfigParams *params, char *name, char *value)
+{
+    ThreadAttributes *attributes;
+    char *attribute;
+
+    if (strncmp(name, "DeviceThread", strlen("DeviceThread")) == 0) {
+        attributes = &params->deviceThread;
+        attribute = name + strlen("DeviceThread");
+    } else if (strncmp(name, "FramerThread", strlen("FramerThread")) == 0) {
+        attributes = &params->framerThread;
+        attribute = name + strlen("FramerThread");
+    } else if (strncmp(name, "LoggerThread", strlen("LoggerThread")) == 0) {
+        attributes = &params->loggerThread;
+        attribute = name + strlen("LoggerThread");
+    } else if (strncmp(name, "PcapThread", strlen("PcapThread")) == 0) {
+        attributes = &params->pcapThread;
+        attribute = name + strlen("PcapThread");
+    } else if (strncmp(name, "UsbThread", strlen("UsbThread")) == 0) {
+        attributes = &params->usbThread;
+        attribute = name + strlen("UsbThread");
+    } else {
+        return 0;
+    }
+
+    if (strcmp(attribute, "CpuMask") == 0) {
+        attributes->cpuMask = strtoull(value, NULL, 0);
+    } else if (strcmp(attribute, "StackSize") == 0) {
+        attributes->stackSize = (uint32_t)strtoul(value, NULL, 0);
+    } else if (strcmp(attribute, "Policy") == 0) {
+        attributes->policy = (ThreadPolicy)atoi(value);
+    } else if (strcmp(attribute, "Priority") == 0) {
+        attributes->priority = atoi(value);
+    } else {
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Fills in the values not set in the configuration file: the defaults of the
+ * low-footprint profile if it is enabled, unbounded queues and the default
+ * logger rings otherwise.
+ */
+static void ApplyFootprintProfile(ConfigParams *params, uint32_t stackSize, int syncLogger)
+{
+    ThreadAttributes *roles[] = { &params->deviceThread, &params->framerThread, &params->loggerThread, &params->pcapThread, &params->usbThread };
+    uint32_t i;
+
+    if (params->lowFootprint) {
+        if (stackSize == 0) {
+            stackSize = LOW_FOOTPRINT_STACK_SIZE;
+        }
+        if (params->linkMtu == 0) {
+            params->linkMtu = LOW_FOOTPRINT_LINK_MTU;
+        }
+        if (params->maxQueuedMessages == 0) {
+            params->maxQueuedMessages = LOW_FOOTPRINT_MAX_QUEUED;
+        }
+        if (syncLogger == -1) {
+            syncLogger = 1;
+        }
+        if (params->logRingSize == 0) {
+            params->logRingSize = LOW_FOOTPRINT_LOG_RING_SIZE;
+        }
+        if (params->traceRingSize == 0) {
+            params->traceRingSize = LOW_FOOTPRINT_TRACE_RING_SIZE;
+        }
+        if (params->ioUringBuffers == 0) {
+            params->ioUringBuffers = LOW_FOOTPRINT_IO_URING_BUFFERS;
+        }
+        if (params->usbTransfers == 0) {
+            params->usbTransfers = LOW_FOOTPRINT_USB_TRANSFERS;
+        }
+        if (params->usbTransferSize == 0) {
+            params->usbTransferSize = LOW_FOOTPRINT_USB_TRANSFER_SIZE;
+        }
+    }
+
+    if (params->maxQueuedMessages == 0) {
+        params->maxQueuedMessages = INT32_MAX;
+    }
+    params->syncLogger = (syncLogger == 1);
+    if (params->logRingSize == 0) {
+        params->logRingSize = DEFAULT_LOG_RING_SIZE;
+    }
+    if (params->logFlushIntervalMs == 0) {
+        params->logFlushIntervalMs = DEFAULT_LOG_FLUSH_INTERVAL_MS;
+    }
+    if (params->ioUringEntries == 0) {
+        params->ioUringEntries = DEFAULT_IO_URING_ENTRIES;
+    }
+    if (params->ioUringBuffers == 0) {
+        params->ioUringBuffers = DEFAULT_IO_URING_BUFFERS;
+    }
+    if (params->usbTransfers == 0) {
+        params->usbTransfers = DEFAULT_USB_TRANSFERS;
+    }
+    if (params->usbTransferSize == 0) {
+        params->usbTransferSize = DEFAULT_USB_TRANSFER_SIZE;
+    }
+    if (params->reconnectMinDelayMs == 0) {
+        params->reconnectMinDelayMs = DEFAULT_RECONNECT_MIN_DELAY_MS;
+    }
+    if (params->writeTimeoutMs == 0) {
+        params->writeTimeoutMs = DEFAULT_WRITE_TIMEOUT_MS;
+    }
+    if (params->reconnectMaxDelayMs < params->reconnectMinDelayMs) {
+        params->reconnectMaxDelayMs = (params->reconnectMinDelayMs > DEFAULT_RECONNECT_MAX_DELAY_MS) ?
+                                      params->reconnectMinDelayMs : DEFAULT_RECONNECT_MAX_DELAY_MS;
+    }
+
+    /* ThreadStackSize applies to the roles without a stack size of their own. */
+    for (i = 0; i < sizeof(roles) / sizeof(roles[0]); i++) {
+        if (roles[i]->stackSize == 0) {
+            roles[i]->stackSize = stackSize;
+        }
+    }
+}
+
 ConfigParams *ParseConfig(void)
 {
     ConfigParams *params = (ConfigParams *)calloc(1, sizeof(ConfigParams));
+    uint32_t stackSize = 0;
+    int syncLogger = -1;
+
+    params->fsciInlinePayload = DEFAULT_FSCI_INLINE_PAYLOAD;
+    memset(params->logLevel, HSDK_INFO, sizeof(params->logLevel));
+    params->logRateLimit = DEFAULT_LOG_RATE_LIMIT;
+    params->logRateBurst = DEFAULT_LOG_RATE_BURST;
+
+#ifdef HSDK_LOW_FOOTPRINT
+    params->lowFootprint = 1;
+#endif
 
     char *s, *saveptr, buff[256];
     FILE *fp = fopen(CONFIG_FILE, "r");
     if (fp == NULL) {
         printf("WARNING: Cannot open %s => FSCI ACKs are disabled\n", CONFIG_FILE);
-        return params;  // everything is zeroed out by calloc
+        ApplyFootprintProfile(params, stackSize, syncLogger);
+        return params;
     }
 
     while ((s = fgets(buff, sizeof buff, fp)) != NULL) {
@@ -300,6 +437,64 @@ ConfigParams *ParseConfig(void)
             params->timeoutAckMs = atoi(value);
         } else if (strcmp(name, "FsciRxAck") == 0) {
             params->fsciRxAck = atoi(value);
+        } else if (strcmp(name, "LowFootprint") == 0) {
+            params->lowFootprint = atoi(value);
+        } else if (strcmp(name, "ThreadStackSize") == 0) {
+            stackSize = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "LinkMtu") == 0) {
+            params->linkMtu = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "MaxQueuedMessages") == 0) {
+            params->maxQueuedMessages = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "SyncLogger") == 0) {
+            syncLogger = atoi(value) ? 1 : 0;
+        } else if (strcmp(name, "LogRingSize") == 0) {
+            params->logRingSize = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "LogFlushIntervalMs") == 0) {
+            params->logFlushIntervalMs = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "LogLevelSys") == 0) {
+            params->logLevel[HSDK_LOG_SYS] = atoi(value);
+        } else if (strcmp(name, "LogLevelPhysical") == 0) {
+            params->logLevel[HSDK_LOG_PHYSICAL] = atoi(value);
+        } else if (strcmp(name, "LogLevelFramer") == 0) {
+            params->logLevel[HSDK_LOG_FRAMER] = atoi(value);
+        } else if (strcmp(name, "LogLevelFsci") == 0) {
+            params->logLevel[HSDK_LOG_FSCI] = atoi(value);
+        } else if (strcmp(name, "LogRateLimit") == 0) {
+            params->logRateLimit = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "LogRateBurst") == 0) {
+            params->logRateBurst = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "TraceEnabled") == 0) {
+            params->traceEnabled = atoi(value);
+        } else if (strcmp(name, "TraceRingSize") == 0) {
+            params->traceRingSize = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "FsciInlinePayload") == 0) {
+            params->fsciInlinePayload = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "ZeroMallocBlocks") == 0) {
+            params->zeroMallocBlocks = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "ZeroMallocFailFast") == 0) {
+            params->zeroMallocFailFast = atoi(value);
+        } else if (strcmp(name, "IoUring") == 0) {
+            params->ioUring = atoi(value);
+        } else if (strcmp(name, "IoUringEntries") == 0) {
+            params->ioUringEntries = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "IoUringBuffers") == 0) {
+            params->ioUringBuffers = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "SpinBudgetUs") == 0) {
+            params->spinBudgetUs = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "UsbTransfers") == 0) {
+            params->usbTransfers = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "UsbTransferSize") == 0) {
+            params->usbTransferSize = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "ReconnectMinDelayMs") == 0) {
+            params->reconnectMinDelayMs = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "ReconnectMaxDelayMs") == 0) {
+            params->reconnectMaxDelayMs = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(name, "ReconnectTxPolicy") == 0) {
+            params->reconnectTxPolicy = (ReconnectTxPolicy)atoi(value);
+        } else if (strcmp(name, "WriteTimeoutMs") == 0) {
+            params->writeTimeoutMs = (uint32_t)strtoul(value, NULL, 0);
+        } else if (ParseThreadKey(params, name, value)) {
+            continue;
         } else {
             printf("WARNING: %s/%s: Unknown name/value pair!\n", name, value);
         }
@@ -307,5 +502,7 @@ ConfigParams *ParseConfig(void)
 
     fclose(fp);
 
+    ApplyFootprintProfile(params, stackSize, syncLogger);
+
     return params;
 }